@@ -0,0 +1,616 @@
+/*
+ * xoron_bench.cpp - Host benchmarks for the Xoron engine
+ * Runs against the development build (Linux/macOS host), not on device
+ *
+ * Usage: xoron_bench [iterations] [--json FILE] [--baseline FILE]
+ *                    [--threshold PCT] [--filter GROUP] [--url URL]
+ *
+ * --json writes the results as JSON; --baseline compares against a file
+ * written by an earlier --json run and exits with status 2 when any
+ * metric regresses by more than --threshold percent (default 15).
+ * A benchmark that fails to run is reported as FAILED, written as null,
+ * and makes the run exit non-zero.
+ * The http group needs a server and only runs when --url is given.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include "../../xoron.h"
+#include "../common/test_utils.h"
+
+struct BenchResult {
+    std::string name;
+    double value;
+    const char* unit;
+    bool higher_is_better;
+};
+
+// Result of a benchmark that could not run; propagates through ratio()
+static const double BENCH_FAILED = std::numeric_limits<double>::quiet_NaN();
+
+static std::vector<BenchResult> g_results;
+static const char* g_filter = nullptr;
+
+static double median(std::vector<double>& v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0.0 : v[v.size() / 2];
+}
+
+// a / b, keeping a failure in either operand
+static double ratio(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) return BENCH_FAILED;
+    return b > 0 ? a / b : 0.0;
+}
+
+static bool bench_enabled(const char* group) {
+    return !g_filter || strstr(group, g_filter) != nullptr;
+}
+
+static void report(const char* name, double value, const char* unit, bool higher_is_better = false) {
+    g_results.push_back({name, value, unit, higher_is_better});
+    if (std::isnan(value)) {
+        TEST_LOG("%-28s %14s %s", name, "FAILED", unit);
+    } else {
+        TEST_LOG("%-28s %14.3f %s", name, value, unit);
+    }
+}
+
+static void null_output(const char* msg, void* ud) {
+    (void)msg; (void)ud;
+}
+
+// Runs precompiled bytecode repeatedly on one VM, returns the median in ms or BENCH_FAILED
+static double time_bytecode(xoron_vm_t* vm, xoron_bytecode_t* bc, int iterations) {
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        Timer t;
+        if (xoron_run(vm, bc) != XORON_OK) {
+            TEST_LOG("run failed: %s", xoron_last_error());
+            return BENCH_FAILED;
+        }
+        times.push_back(t.elapsed_ms());
+    }
+    return median(times);
+}
+
+// Compiles and times a script on a fresh VM after running its setup chunk
+static double time_script(const char* setup, const char* body, int iterations) {
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        TEST_LOG("vm_new failed: %s", xoron_last_error());
+        return BENCH_FAILED;
+    }
+    if (setup && xoron_dostring(vm, setup, "bench_setup") != XORON_OK) {
+        TEST_LOG("setup failed: %s", xoron_last_error());
+        xoron_vm_free(vm);
+        return BENCH_FAILED;
+    }
+    double ms = BENCH_FAILED;
+    xoron_bytecode_t* bc = xoron_compile(body, strlen(body), "bench");
+    if (bc) {
+        xoron_run(vm, bc);  // warm-up, materializes lazy libraries
+        ms = time_bytecode(vm, bc, iterations);
+        xoron_bytecode_free(bc);
+    } else {
+        TEST_LOG("compile failed: %s", xoron_last_error());
+    }
+    xoron_vm_free(vm);
+    return ms;
+}
+
+// VM creation: time and baseline heap with lazy and eager library registration
+static void bench_vm_create(bool lazy, int iterations) {
+    xoron_set_lazy_libs(lazy);
+    
+    // Warm-up also pays the one-time lazy index discovery
+    xoron_vm_free(xoron_vm_new());
+    
+    std::vector<double> times;
+    size_t heap = 0;
+    for (int i = 0; i < iterations; i++) {
+        Timer t;
+        xoron_vm_t* vm = xoron_vm_new();
+        times.push_back(t.elapsed_ms());
+        if (!vm) {
+            TEST_LOG("vm_new failed: %s", xoron_last_error());
+            report(lazy ? "vm_create_lazy" : "vm_create_eager", BENCH_FAILED, "ms");
+            report(lazy ? "vm_heap_lazy" : "vm_heap_eager", BENCH_FAILED, "bytes");
+            xoron_set_lazy_libs(true);
+            return;
+        }
+        heap = xoron_vm_memory(vm);
+        xoron_vm_free(vm);
+    }
+    
+    report(lazy ? "vm_create_lazy" : "vm_create_eager", median(times), "ms");
+    report(lazy ? "vm_heap_lazy" : "vm_heap_eager", (double)heap, "bytes");
+    xoron_set_lazy_libs(true);
+}
+
+// First access cost: one library materialized on demand
+static void bench_vm_first_use(int iterations) {
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        xoron_vm_t* vm = xoron_vm_new();
+        if (!vm) {
+            TEST_LOG("vm_new failed: %s", xoron_last_error());
+            report("vm_first_use", BENCH_FAILED, "ms");
+            return;
+        }
+        Timer t;
+        int rc = xoron_dostring(vm, "local _ = readfile", "bench");
+        times.push_back(t.elapsed_ms());
+        xoron_vm_free(vm);
+        if (rc != XORON_OK) {
+            TEST_LOG("first use failed: %s", xoron_last_error());
+            report("vm_first_use", BENCH_FAILED, "ms");
+            return;
+        }
+    }
+    report("vm_first_use", median(times), "ms");
+}
+
+// Compile throughput over a synthetic ~64 KB module
+static void bench_compile(int iterations) {
+    std::string source;
+    for (int i = 0; source.size() < 64 * 1024; i++) {
+        char chunk[512];
+        snprintf(chunk, sizeof(chunk),
+                 "local function f%d(t, n)\n"
+                 "    local acc = {}\n"
+                 "    for i = 1, n do\n"
+                 "        acc[#acc + 1] = string.format(\"%%d:%%s\", i, tostring(t[i]))\n"
+                 "    end\n"
+                 "    return table.concat(acc, \",\"), math.max(n, %d)\n"
+                 "end\n", i, i);
+        source += chunk;
+    }
+    
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        Timer t;
+        xoron_bytecode_t* bc = xoron_compile(source.c_str(), source.size(), "bench");
+        times.push_back(t.elapsed_ms());
+        if (!bc) {
+            TEST_LOG("compile failed: %s", xoron_last_error());
+            times.assign(1, BENCH_FAILED);
+            break;
+        }
+        xoron_bytecode_free(bc);
+    }
+    
+    double ms = median(times);
+    report("compile_64k", ms, "ms");
+    report("compile_throughput", ratio(source.size() / 1048576.0, ms / 1000.0), "MB/s", true);
+}
+
+// xoron_run latency for a tiny chunk and a small loop
+static void bench_run(int iterations) {
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        TEST_LOG("vm_new failed: %s", xoron_last_error());
+        report("run_empty", BENCH_FAILED, "us");
+        report("run_loop_10k", BENCH_FAILED, "us");
+        return;
+    }
+    
+    const char* empty = "return";
+    const char* loop = "local x = 0 for i = 1, 10000 do x = x + i end";
+    xoron_bytecode_t* bc_empty = xoron_compile(empty, strlen(empty), "bench");
+    xoron_bytecode_t* bc_loop = xoron_compile(loop, strlen(loop), "bench");
+    if (bc_empty && bc_loop) {
+        report("run_empty", time_bytecode(vm, bc_empty, iterations) * 1000.0, "us");
+        report("run_loop_10k", time_bytecode(vm, bc_loop, iterations) * 1000.0, "us");
+    } else {
+        TEST_LOG("compile failed: %s", xoron_last_error());
+        report("run_empty", BENCH_FAILED, "us");
+        report("run_loop_10k", BENCH_FAILED, "us");
+    }
+    if (bc_empty) xoron_bytecode_free(bc_empty);
+    if (bc_loop) xoron_bytecode_free(bc_loop);
+    xoron_vm_free(vm);
+}
+
+// print() through the host output callback and rconsoleprint() through the console
+static void bench_print(int iterations) {
+    xoron_set_output(null_output, null_output, nullptr);
+    xoron_set_console_callbacks(null_output, null_output, nullptr);
+    
+    double ms = time_script(nullptr, "for i = 1, 1000 do print(\"bench\", i) end", iterations);
+    report("print_1000", ms, "ms");
+    ms = time_script(nullptr, "for i = 1, 1000 do rconsoleprint(\"bench\") end", iterations);
+    report("console_print_1000", ms, "ms");
+    
+    xoron_set_console_callbacks(nullptr, nullptr, nullptr);
+    xoron_set_output(nullptr, nullptr, nullptr);
+}
+
+// Hashing through the C API and crypt library, base64 round trip
+static void bench_crypto(int iterations) {
+    std::vector<uint8_t> data(1024 * 1024);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 31 + 7);
+    
+    std::vector<double> times;
+    uint8_t hash[32];
+    for (int i = 0; i < iterations; i++) {
+        Timer t;
+        xoron_sha256(data.data(), data.size(), hash);
+        times.push_back(t.elapsed_ms());
+    }
+    double ms = median(times);
+    report("sha256_throughput", ratio(1000.0, ms), "MB/s", true);
+    
+    ms = time_script("payload = string.rep(\"x\", 1024)",
+                     "for i = 1, 100 do crypt.hash(payload, \"sha256\") end", iterations);
+    report("crypt_hash_1k_x100", ms, "ms");
+    ms = time_script("payload = string.rep(\"xoron\", 2048)",
+                     "for i = 1, 100 do crypt.base64decode(crypt.base64encode(payload)) end", iterations);
+    report("base64_roundtrip_10k_x100", ms, "ms");
+}
+
+// lz4 compress/decompress of a compressible 256 KB payload
+static void bench_lz4(int iterations) {
+    const char* setup =
+        "payload = string.rep(\"the quick brown fox jumps over the lazy dog \", 5958)\n"
+        "packed = lz4compress(payload)";
+    double ms = time_script(setup, "lz4compress(payload)", iterations);
+    report("lz4_compress_throughput", ratio(0.25, ms / 1000.0), "MB/s", true);
+    ms = time_script(setup, "lz4decompress(packed, #payload)", iterations);
+    report("lz4_decompress_throughput", ratio(0.25, ms / 1000.0), "MB/s", true);
+}
+
+// writefile/readfile of 64 KB in a scratch workspace
+static void bench_filesystem(int iterations) {
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / "xoron_bench_workspace";
+    std::filesystem::create_directories(dir, ec);
+    xoron_set_workspace(dir.string().c_str());
+    
+    const char* setup = "payload = string.rep(\"z\", 65536) writefile(\"bench.bin\", payload)";
+    report("fs_write_64k", time_script(setup, "writefile(\"bench.bin\", payload)", iterations) * 1000.0, "us");
+    report("fs_read_64k", time_script(setup, "readfile(\"bench.bin\")", iterations) * 1000.0, "us");
+    
+    std::filesystem::remove_all(dir, ec);
+}
+
+// Drawing property writes, the hot path of per-frame ESP scripts
+static void bench_drawing(int iterations) {
+    const char* setup = "line = Drawing.new(\"Line\") text = Drawing.new(\"Text\")";
+    const char* body =
+        "for i = 1, 1000 do\n"
+        "    line.From = {X = i, Y = i}\n"
+        "    line.To = {X = i + 10, Y = i + 10}\n"
+        "    line.Thickness = 2\n"
+        "    line.Visible = true\n"
+        "    text.Text = \"bench\"\n"
+        "end";
+    report("drawing_update_1000", time_script(setup, body, iterations), "ms");
+}
+
+// Reference pure-Lua JSON, the kind of implementation scripts ship today
+static const char* LUA_JSON =
+    "local escapes = {['\"'] = '\\\\\"', ['\\\\'] = '\\\\\\\\', ['\\n'] = '\\\\n', ['\\r'] = '\\\\r', ['\\t'] = '\\\\t'}\n"
+    "local function esc(s)\n"
+    "    return (string.gsub(s, '[%c\"\\\\]', function(c) return escapes[c] or string.format('\\\\u%04x', string.byte(c)) end))\n"
+    "end\n"
+    "function lua_encode(v)\n"
+    "    local t = type(v)\n"
+    "    if t == 'table' then\n"
+    "        local out = {}\n"
+    "        if #v > 0 or next(v) == nil then\n"
+    "            for i = 1, #v do out[i] = lua_encode(v[i]) end\n"
+    "            return '[' .. table.concat(out, ',') .. ']'\n"
+    "        end\n"
+    "        for k, x in pairs(v) do out[#out + 1] = '\"' .. esc(tostring(k)) .. '\":' .. lua_encode(x) end\n"
+    "        return '{' .. table.concat(out, ',') .. '}'\n"
+    "    elseif t == 'string' then return '\"' .. esc(v) .. '\"'\n"
+    "    elseif t == 'number' then\n"
+    "        if v == math.floor(v) then return string.format('%d', v) end\n"
+    "        return string.format('%.14g', v)\n"
+    "    elseif t == 'boolean' then return tostring(v) end\n"
+    "    return 'null'\n"
+    "end\n"
+    "local unescapes = {b = '\\b', f = '\\f', n = '\\n', r = '\\r', t = '\\t'}\n"
+    "function lua_decode(s)\n"
+    "    local pos = 1\n"
+    "    local function ws() pos = string.find(s, '[^ \\t\\r\\n]', pos) or #s + 1 end\n"
+    "    local function str()\n"
+    "        local out, i = {}, pos + 1\n"
+    "        while true do\n"
+    "            local j = string.find(s, '[\"\\\\]', i)\n"
+    "            out[#out + 1] = string.sub(s, i, j - 1)\n"
+    "            if string.sub(s, j, j) == '\"' then pos = j + 1 return table.concat(out) end\n"
+    "            local c = string.sub(s, j + 1, j + 1)\n"
+    "            if c == 'u' then\n"
+    "                out[#out + 1] = utf8.char(tonumber(string.sub(s, j + 2, j + 5), 16))\n"
+    "                i = j + 6\n"
+    "            else\n"
+    "                out[#out + 1] = unescapes[c] or c\n"
+    "                i = j + 2\n"
+    "            end\n"
+    "        end\n"
+    "    end\n"
+    "    local value\n"
+    "    function value()\n"
+    "        ws()\n"
+    "        local c = string.sub(s, pos, pos)\n"
+    "        if c == '{' then\n"
+    "            local t = {}\n"
+    "            pos = pos + 1 ws()\n"
+    "            if string.sub(s, pos, pos) == '}' then pos = pos + 1 return t end\n"
+    "            while true do\n"
+    "                ws() local k = str() ws() pos = pos + 1\n"
+    "                t[k] = value() ws()\n"
+    "                local d = string.sub(s, pos, pos) pos = pos + 1\n"
+    "                if d == '}' then return t end\n"
+    "            end\n"
+    "        elseif c == '[' then\n"
+    "            local t = {}\n"
+    "            pos = pos + 1 ws()\n"
+    "            if string.sub(s, pos, pos) == ']' then pos = pos + 1 return t end\n"
+    "            while true do\n"
+    "                t[#t + 1] = value() ws()\n"
+    "                local d = string.sub(s, pos, pos) pos = pos + 1\n"
+    "                if d == ']' then return t end\n"
+    "            end\n"
+    "        elseif c == '\"' then return str()\n"
+    "        elseif string.sub(s, pos, pos + 3) == 'true' then pos = pos + 4 return true\n"
+    "        elseif string.sub(s, pos, pos + 4) == 'false' then pos = pos + 5 return false\n"
+    "        elseif string.sub(s, pos, pos + 3) == 'null' then pos = pos + 4 return nil\n"
+    "        end\n"
+    "        local num = string.match(s, '^-?%d+%.?%d*[eE]?[-+]?%d*', pos)\n"
+    "        pos = pos + #num\n"
+    "        return tonumber(num)\n"
+    "    end\n"
+    "    return value()\n"
+    "end\n";
+
+// json.decode/encode throughput on a ~100 KB API-style payload, against pure Lua
+static void bench_json(int iterations) {
+    std::string text = "[";
+    for (int i = 1; i <= 500; i++) {
+        if (i > 1) text += ",";
+        text += "{\"id\":" + std::to_string(i) + ",\"name\":\"item \\\"" + std::to_string(i) +
+                "\\\"\",\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"price\":" + std::to_string(i) +
+                ".25,\"active\":" + (i % 2 ? "true" : "false") +
+                ",\"owner\":{\"user\":\"player" + std::to_string(i) + "\",\"level\":" + std::to_string(i % 90) + "}}";
+    }
+    text += "]";
+    double mb = text.size() / (1024.0 * 1024.0);
+    std::string setup = std::string(LUA_JSON) + "text = [==[" + text + "]==]\nitems = json.decode(text)";
+    
+    double native_decode = time_script(setup.c_str(), "json.decode(text)", iterations);
+    double native_encode = time_script(setup.c_str(), "json.encode(items)", iterations);
+    int lua_iterations = std::max(1, iterations / 10);
+    double lua_decode = time_script(setup.c_str(), "lua_decode(text)", lua_iterations);
+    double lua_encode = time_script(setup.c_str(), "lua_encode(items)", lua_iterations);
+    
+    report("json_decode_throughput", ratio(mb, native_decode / 1000.0), "MB/s", true);
+    report("json_encode_throughput", ratio(mb, native_encode / 1000.0), "MB/s", true);
+    report("json_decode_vs_lua", ratio(lua_decode, native_decode), "x", true);
+    report("json_encode_vs_lua", ratio(lua_encode, native_encode), "x", true);
+}
+
+// Global-heavy loop in a loadstring chunk: its own safeenv script environment
+// against the same chunk moved onto an __index proxy env, which is not safeenv
+static const char* LUA_GLOBAL_HEAVY =
+    "work = loadstring([[\n"
+    "    local acc = 0\n"
+    "    for i = 1, 20000 do\n"
+    "        acc = acc + math.floor(i * 0.5) + math.abs(-i) + math.max(i, 7) + math.sqrt(i)\n"
+    "        acc = acc + bit32.band(i, 255) + string.len(type(acc)) + select('#', i, acc)\n"
+    "    end\n"
+    "    return acc\n"
+    "]])\n";
+
+static void bench_env(int iterations) {
+    std::string proxied = std::string(LUA_GLOBAL_HEAVY) +
+                          "setfenv(work, setmetatable({}, {__index = getfenv()}))\n";
+    double safe = time_script(LUA_GLOBAL_HEAVY, "work()", iterations);
+    double proxy = time_script(proxied.c_str(), "work()", iterations);
+    
+    report("globals_safeenv", safe, "ms");
+    report("globals_proxy_env", proxy, "ms");
+    report("globals_safeenv_speedup", ratio(proxy, safe), "x", true);
+}
+
+// Fetches url `requests` times from `concurrency` threads, returns requests per second;
+// any failed request fails the measurement
+static double http_throughput(const char* url, int requests, int concurrency) {
+    std::atomic<int> next{0};
+    std::atomic<int> failed{0};
+    Timer t;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < concurrency; i++) {
+        threads.emplace_back([&] {
+            while (next++ < requests) {
+                int status = 0;
+                char* body = xoron_http_get(url, &status, nullptr);
+                if (!body || status != 200) failed++;
+                xoron_http_free(body);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    double ms = t.elapsed_ms();
+    if (failed > 0) {
+        TEST_LOG("%d of %d requests to %s failed", failed.load(), requests, url);
+        return BENCH_FAILED;
+    }
+    return ratio(requests * 1000.0, ms);
+}
+
+static double metric_value(const char* name) {
+    char* json = xoron_metrics_snapshot();
+    std::string key = std::string("\"") + name + "\":";
+    const char* at = json ? strstr(json, key.c_str()) : nullptr;
+    double value = at ? strtod(at + key.size(), nullptr) : 0.0;
+    xoron_free(json);
+    return value;
+}
+
+// Serial against 16-way concurrent GETs; over https the h2 stream count shows
+// whether the requests were multiplexed or fell back to HTTP/1.1
+static void bench_http(const char* url, int iterations) {
+    xoron_metrics_reset();
+    report("http_get_serial", http_throughput(url, iterations, 1), "req/s", true);
+    report("http_get_concurrent16", http_throughput(url, iterations, 16), "req/s", true);
+    report("http2_streams", metric_value("http2.streams"), "streams", true);
+    report("http2_connections", metric_value("http2.connections"), "conns");
+}
+
+// ==================== Results I/O ====================
+
+static bool write_json(const char* path, int iterations) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        TEST_LOG("cannot write %s", path);
+        return false;
+    }
+    fprintf(f, "{\n  \"version\": \"%s\",\n  \"iterations\": %d,\n  \"results\": [\n",
+            xoron_version(), iterations);
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const BenchResult& r = g_results[i];
+        char value[64];
+        if (std::isnan(r.value)) {
+            snprintf(value, sizeof(value), "null");
+        } else {
+            snprintf(value, sizeof(value), "%.6f", r.value);
+        }
+        fprintf(f, "    {\"name\": \"%s\", \"value\": %s, \"unit\": \"%s\", \"better\": \"%s\"}%s\n",
+                r.name.c_str(), value, r.unit, r.higher_is_better ? "higher" : "lower",
+                i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+// Reads the name/value pairs back out of a file written by write_json
+static bool read_baseline(const char* path, std::vector<std::pair<std::string, double>>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        const char* name = strstr(line, "\"name\": \"");
+        const char* value = strstr(line, "\"value\": ");
+        if (!name || !value) continue;
+        name += 9;
+        const char* end = strchr(name, '"');
+        if (!end) continue;
+        out.emplace_back(std::string(name, end - name), strtod(value + 9, nullptr));
+    }
+    fclose(f);
+    return true;
+}
+
+// Returns the number of metrics that regressed past the threshold or failed to run
+static int compare_baseline(const std::vector<std::pair<std::string, double>>& baseline, double threshold) {
+    int regressions = 0;
+    TEST_LOG("%-28s %14s %14s %9s", "metric", "baseline", "current", "change");
+    for (const BenchResult& r : g_results) {
+        auto it = std::find_if(baseline.begin(), baseline.end(),
+                               [&](const std::pair<std::string, double>& b) { return b.first == r.name; });
+        if (std::isnan(r.value)) {
+            regressions++;
+            TEST_LOG("%-28s %14.3f %14s %9s FAILED", r.name.c_str(), it != baseline.end() ? it->second : 0.0, "-", "-");
+            continue;
+        }
+        if (it == baseline.end() || it->second <= 0.0) continue;
+        
+        double change = (r.value - it->second) / it->second * 100.0;
+        double regression = r.higher_is_better ? -change : change;
+        bool failed = regression > threshold;
+        if (failed) regressions++;
+        TEST_LOG("%-28s %14.3f %14.3f %+8.1f%% %s", r.name.c_str(), it->second, r.value, change,
+                 failed ? "REGRESSED" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 200;
+    const char* json_path = nullptr;
+    const char* baseline_path = nullptr;
+    double threshold = 15.0;
+    const char* url = nullptr;
+    
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--json") == 0 && has_value) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && has_value) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            g_filter = argv[++i];
+        } else if (strcmp(argv[i], "--url") == 0 && has_value) {
+            url = argv[++i];
+        } else if (argv[i][0] != '-') {
+            iterations = atoi(argv[i]);
+        } else {
+            TEST_LOG("usage: %s [iterations] [--json FILE] [--baseline FILE] [--threshold PCT] [--filter GROUP] "
+                     "[--url URL]", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0) iterations = 200;
+    
+    std::vector<std::pair<std::string, double>> baseline;
+    if (baseline_path && !read_baseline(baseline_path, baseline)) {
+        TEST_LOG("cannot read baseline %s", baseline_path);
+        return 1;
+    }
+    
+    if (xoron_init() != XORON_OK) {
+        TEST_LOG("xoron_init failed: %s", xoron_last_error());
+        return 1;
+    }
+    
+    if (bench_enabled("vm")) {
+        bench_vm_create(false, iterations);
+        bench_vm_create(true, iterations);
+        bench_vm_first_use(iterations);
+    }
+    if (bench_enabled("compile")) bench_compile(std::max(1, iterations / 10));
+    if (bench_enabled("run")) bench_run(iterations);
+    if (bench_enabled("print")) bench_print(std::max(1, iterations / 10));
+    if (bench_enabled("crypto")) bench_crypto(std::max(1, iterations / 10));
+    if (bench_enabled("lz4")) bench_lz4(iterations);
+    if (bench_enabled("fs")) bench_filesystem(iterations);
+    if (bench_enabled("drawing")) bench_drawing(std::max(1, iterations / 10));
+    if (bench_enabled("json")) bench_json(iterations);
+    if (bench_enabled("env")) bench_env(std::max(1, iterations / 10));
+    if (url && bench_enabled("http")) bench_http(url, iterations);
+    
+    xoron_shutdown();
+    
+    if (json_path && !write_json(json_path, iterations)) return 1;
+    
+    if (baseline_path) {
+        int regressions = compare_baseline(baseline, threshold);
+        if (regressions > 0) {
+            TEST_LOG("%d metric(s) regressed by more than %.1f%% or failed", regressions, threshold);
+            return 2;
+        }
+    }
+    int failures = (int)std::count_if(g_results.begin(), g_results.end(),
+                                      [](const BenchResult& r) { return std::isnan(r.value); });
+    if (failures > 0) {
+        TEST_LOG("%d metric(s) failed to run", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,891 @@
+/*
+ * test_host_integration.cpp - Host integration tests for Xoron
+ * Tests: Bytecode round trip and source detection, script environments,
+ *        KV store recovery and compaction, serialize round trips and
+ *        malformed input, Buffer slices and typed access, JSON escapes,
+ *        nesting and malformed input, actor messaging and lifetime,
+ *        parallel map and reduce
+ * Platform: development build (Linux/macOS host), registered with ctest
+ *
+ * Each test drives the public C API; Lua-side checks raise errors that
+ * surface through xoron_last_error. HOME points at a fresh temporary
+ * directory so the workspace starts empty on every run.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <string>
+#include <filesystem>
+
+#include "../../xoron.h"
+#include "../common/test_utils.h"
+
+static int g_failed = 0;
+
+static void record(TestSuite& suite, const char* name, bool passed, Timer& timer) {
+    suite.recordResult(name, passed, passed ? "" : xoron_last_error(), timer.elapsed_ms());
+    if (!passed) g_failed++;
+    timer.reset();
+}
+
+// MARK: - Bytecode
+
+bool test_bytecode() {
+    TestSuite suite("Bytecode");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    // Compile, dump the blob, free the handle and run the copy
+    xoron_bytecode_t* bc = xoron_compile("local t = {} for i = 1, 6 do t[i] = i * 7 end result = t[6]", 0, "roundtrip");
+    std::string blob;
+    if (bc) {
+        size_t len = 0;
+        const char* data = xoron_bytecode_data(bc, &len);
+        blob.assign(data, len);
+        xoron_bytecode_free(bc);
+    }
+    record(suite, "Compile and dump", !blob.empty() && (unsigned char)blob[0] != 0, timer);
+    
+    bool ran = !blob.empty() && xoron_run_bytecode(vm, blob.data(), blob.size(), "roundtrip") == XORON_OK &&
+               xoron_dostring(vm, "assert(result == 42, 'dumped bytecode returned ' .. tostring(result))", "check") == XORON_OK;
+    record(suite, "Run dumped bytecode", ran, timer);
+    
+    bc = xoron_compile("return 1", 0, "analyze");
+    char* report = bc ? xoron_bytecode_analyze(bc) : nullptr;
+    record(suite, "Analyze compiled bytecode", report && strstr(report, "\"version\":") != nullptr, timer);
+    if (report) xoron_free(report);
+    xoron_bytecode_free(bc);
+    
+    // Text is only treated as bytecode when it parses as a container; a leading
+    // control byte, even one inside the version range, goes to the compiler
+    const char* detection = R"(
+        local ok = analyzebytecode("\t\vlocal x = 1")
+        assert(ok, "source with leading whitespace controls was not compiled")
+        for _, text in ipairs({"\1x = 1", "\4x = 1", "\0"}) do
+            local report, err = analyzebytecode(text)
+            assert(report == nil, "invalid source analyzed")
+            assert(not err:find("bytecode version"), "source read as bytecode: " .. err)
+        end
+        local report = analyzebytecode("local function f() return g end")
+        assert(report and report.version > 0, "source not analyzed")
+    )";
+    record(suite, "Control-byte text compiled as source", xoron_dostring(vm, detection, "detection") == XORON_OK, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Script Environments
+
+bool test_script_env() {
+    TestSuite suite("Script Environments");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    bool ok = xoron_dostring(vm, "shared = 1; _G.via_g = 2; getgenv().Enabled = true", "writer") == XORON_OK &&
+              xoron_dostring(vm, "assert(shared == 1 and via_g == 2 and getgenv().shared == 1, 'globals not shared')", "reader") == XORON_OK;
+    record(suite, "Bare globals shared through getgenv", ok, timer);
+    
+    // Enabled already exists when the reader loads; it must still be read at call time
+    ok = xoron_dostring(vm, "function isEnabled() return Enabled end", "loop") == XORON_OK &&
+         xoron_dostring(vm, R"(
+            getgenv().Enabled = false
+            assert(isEnabled() == false, "getgenv value captured at load time")
+         )", "toggle") == XORON_OK;
+    record(suite, "getgenv values are not captured", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local a, b = loadstring("return 1"), loadstring("return 2")
+        assert(getfenv(a) ~= getfenv(b), "loadstring chunks share an environment")
+        assert(getfenv(a) ~= getgenv() and getfenv(1) ~= getgenv(), "script runs in getgenv directly")
+        assert(getmetatable(getfenv(a)).__index == getgenv(), "chunk environment does not read through getgenv")
+    )", "separate") == XORON_OK;
+    record(suite, "Each chunk has its own environment", ok, timer);
+    
+    // An override assigned before a chunk loads is what the chunk's import resolves to
+    ok = xoron_dostring(vm, R"lua(
+        getgenv().tostring = function() return "overridden" end
+        local f = loadstring("return tostring(1)")
+        local result = f()
+        getgenv().tostring = nil
+        assert(result == "overridden", "getgenv override ignored at load")
+        assert(tostring(1) == "1")
+    )lua", "override") == XORON_OK;
+    record(suite, "Builtin override resolved at load", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        assert(not pcall(function() string.split = function() end end), "library table is writable")
+        getgenv().split = function(s) return s end
+        assert(split("x") == "x")
+        assert(math.floor(2.5) == 2 and bit32.band(6, 3) == 2)
+    )", "readonly") == XORON_OK;
+    record(suite, "Library tables are readonly", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - KV Store
+
+static std::string kv_log(const char* name) {
+    return std::string(xoron_get_workspace()) + "/kv/" + name + ".log";
+}
+
+bool test_kv() {
+    TestSuite suite("KV Store");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    // Two records: the CRC test corrupts the second, which must leave only the first
+    bool ok = xoron_dostring(vm, R"(
+        local s = assert(kv.open("recovery"))
+        assert(s:set("kept", {n = 1, tag = "first"}))
+        s:close()
+    )", "kv_first") == XORON_OK;
+    std::error_code ec;
+    uintmax_t first_size = std::filesystem::file_size(kv_log("recovery"), ec);
+    ok = ok && xoron_dostring(vm, R"(
+        local s = assert(kv.open("recovery"))
+        assert(s:set("lost", string.rep("x", 64)))
+        s:close()
+    )", "kv_second") == XORON_OK;
+    record(suite, "Write records", ok && !ec, timer);
+    
+    // Flip the last payload byte; replay must stop at the bad checksum and truncate there
+    FILE* f = fopen(kv_log("recovery").c_str(), "r+b");
+    if (f) {
+        fseek(f, -1, SEEK_END);
+        int c = fgetc(f);
+        fseek(f, -1, SEEK_END);
+        fputc(c ^ 0xFF, f);
+        fclose(f);
+    }
+    ok = f && xoron_dostring(vm, R"(
+        local s = assert(kv.open("recovery"))
+        assert(s:get("kept").tag == "first", "record before the corrupt one was lost")
+        assert(s:get("lost") == nil, "record with a bad checksum was applied")
+        assert(s:count() == 1, "unexpected count " .. s:count())
+        s:close()
+    )", "kv_crc") == XORON_OK;
+    record(suite, "CRC mismatch truncates the record", ok && std::filesystem::file_size(kv_log("recovery"), ec) == first_size, timer);
+    
+    // A torn tail: half a record header with no payload
+    f = fopen(kv_log("recovery").c_str(), "ab");
+    if (f) {
+        fwrite("\x12\x34\x56\x78\x40", 1, 5, f);
+        fclose(f);
+    }
+    ok = f && xoron_dostring(vm, R"(
+        local s = assert(kv.open("recovery"))
+        assert(s:get("kept").n == 1, "record before the torn tail was lost")
+        assert(s:set("after", true), "write after recovery failed")
+        s:close()
+        s = assert(kv.open("recovery"))
+        assert(s:get("after") == true, "write after recovery did not persist")
+        assert(s:count() == 2, "unexpected count " .. s:count())
+        s:close()
+    )", "kv_torn") == XORON_OK;
+    record(suite, "Torn record is dropped", ok, timer);
+    
+    // Overwrite and delete most keys, compact, then check the rewritten log from a fresh open
+    ok = xoron_dostring(vm, R"(
+        local s = assert(kv.open("compaction"))
+        for round = 1, 3 do
+            local sets = {}
+            for i = 1, 200 do sets["k" .. i] = {i = i, round = round} end
+            assert(s:batch(sets))
+        end
+        for i = 1, 200, 2 do assert(s:delete("k" .. i)) end
+        s:close()
+    )", "kv_fill") == XORON_OK;
+    uintmax_t before = std::filesystem::file_size(kv_log("compaction"), ec);
+    ok = ok && xoron_dostring(vm, R"(
+        local s = assert(kv.open("compaction"))
+        assert(s:compact())
+        assert(s:set("k1", "after compaction"))
+        s:close()
+    )", "kv_compact") == XORON_OK;
+    uintmax_t after = std::filesystem::file_size(kv_log("compaction"), ec);
+    ok = ok && xoron_dostring(vm, R"(
+        local s = assert(kv.open("compaction"))
+        assert(s:count() == 101, "unexpected count " .. s:count())
+        assert(s:get("k1") == "after compaction", "write after compaction lost")
+        for i = 2, 200, 2 do
+            local v = s:get("k" .. i)
+            assert(v and v.i == i and v.round == 3, "k" .. i .. " has a stale value")
+        end
+        assert(s:get("k3") == nil, "deleted key came back")
+        s:close()
+    )", "kv_reopen") == XORON_OK;
+    record(suite, "Compact then reopen", ok && after < before, timer);
+    record(suite, "No leftover compaction file", !std::filesystem::exists(kv_log("compaction") + ".compact"), timer);
+    
+    // A value close to the record limit next to small ones must not be packed past it
+    ok = xoron_dostring(vm, R"(
+        local s = assert(kv.open("large"))
+        for i = 1, 100 do assert(s:set("small" .. i, string.rep("s", 1000))) end
+        assert(s:set("big", string.rep("b", 64 * 1024 * 1024 - 64 * 1024)))
+        assert(s:compact())
+        s:close()
+        s = assert(kv.open("large"))
+        assert(s:count() == 101, "unexpected count " .. s:count())
+        assert(#s:get("big") == 64 * 1024 * 1024 - 64 * 1024, "large value lost")
+        for i = 1, 100 do assert(s:get("small" .. i), "small" .. i .. " lost") end
+        s:close()
+    )", "kv_large") == XORON_OK;
+    record(suite, "Compaction keeps records under the size limit", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Serialize
+
+bool test_serialize() {
+    TestSuite suite("Serialize");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    // Deep compare that tells NaN and -0 apart, shared by the cases below
+    bool ok = xoron_dostring(vm, R"(
+        function same(a, b)
+            if type(a) ~= type(b) then return false end
+            if type(a) == "number" then
+                if a ~= a then return b ~= b end
+                return a == b and 1 / a == 1 / b
+            end
+            if type(a) ~= "table" then return a == b end
+            for k, v in pairs(a) do
+                if not same(v, b[k]) then return false end
+            end
+            for k in pairs(b) do
+                if a[k] == nil then return false end
+            end
+            return true
+        end
+        
+        local value = {
+            name = "xoron", utf8 = "h\195\169llo", bytes = "\255\0\1",
+            zero = -0.0, nan = 0 / 0, pi = math.pi, half = 0.5, negative = -123456,
+            flag = false, [true] = "yes", [1.5] = "key", [7] = "seven",
+            nested = {list = {1, 2, {x = 3}}, empty = {}},
+        }
+        for _, format in ipairs({"msgpack", "cbor"}) do
+            local data = assert(serialize.pack(value, {format = format}))
+            local back = assert(serialize.unpack(data, {format = format}))
+            assert(same(back, value), format .. " round trip changed the value")
+        end
+    )", "ser_roundtrip") == XORON_OK;
+    record(suite, "MessagePack and CBOR round trips", ok, timer);
+    
+    // Tables whose keys all lie in 1..#t are arrays, holes included; anything else is a map
+    ok = xoron_dostring(vm, R"(
+        assert(serialize.pack({1, 2, 3}):byte(1) == 0x93, "sequence not packed as an array")
+        assert(serialize.pack({a = 1}):byte(1) == 0x81, "record not packed as a map")
+        assert(serialize.pack({1, 2, x = 3}):byte(1) == 0x83, "mixed table not packed as a map")
+        local holes = serialize.pack({1, nil, 3})
+        assert(holes:byte(1) == 0x93 and holes:byte(3) == 0xC0, "hole not packed as nil")
+        assert(same(serialize.unpack(holes), {1, nil, 3}))
+        
+        local sparse = {[1] = "a", [2] = "b", [10] = "j"}
+        for _, format in ipairs({"msgpack", "cbor"}) do
+            local back = serialize.unpack(serialize.pack(sparse, {format = format}), {format = format})
+            assert(same(back, sparse), format .. " sparse array changed")
+        end
+    )", "ser_arrays") == XORON_OK;
+    record(suite, "Arrays, maps and sparse arrays", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local values = {2^53, 2^53 + 2, 2^60, -2^60, -2^63, 2^64 - 2048}
+        for _, format in ipairs({"msgpack", "cbor"}) do
+            local back = serialize.unpack(serialize.pack(values, {format = format}), {format = format})
+            for i, v in ipairs(values) do
+                assert(back[i] == v, format .. " changed " .. string.format("%.17g", v))
+            end
+        end
+        assert(serialize.pack(2^60):byte(1) == 0xCF, "large integer not packed as uint64")
+        assert(serialize.pack(-2^60):byte(1) == 0xD3, "large negative integer not packed as int64")
+    )", "ser_integers") == XORON_OK;
+    record(suite, "Integers above 2^53", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local cases = {
+            {"\x81\xCA\x7F\xC0\x00\x00\x01", "msgpack"},
+            {"\x81\xC0\x01", "msgpack"},
+            {"\xA1\xF9\x7E\x00\x01", "cbor"},
+        }
+        for i, case in ipairs(cases) do
+            local v, err = serialize.unpack(case[1], {format = case[2]})
+            assert(v == nil and err:find("Invalid map key"), "case " .. i .. " accepted a bad key")
+        end
+        
+        local cyclic = {}
+        cyclic.self = cyclic
+        local v, err = serialize.pack(cyclic)
+        assert(v == nil and err:find("cyclic"), "cycle not rejected")
+        local shared = {1}
+        assert(serialize.pack({a = shared, b = shared}), "shared table rejected as a cycle")
+        v, err = serialize.pack({f = print})
+        assert(v == nil and err:find("function"), "function not rejected")
+    )", "ser_reject") == XORON_OK;
+    record(suite, "NaN keys and cycles rejected", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local dict = serialize.dictionary({"position", "velocity", "health"})
+        local entity = {position = 1, velocity = 2, health = 100, name = "npc"}
+        for _, format in ipairs({"msgpack", "cbor"}) do
+            local plain = assert(serialize.pack(entity, {format = format}))
+            local keyed = assert(serialize.pack(entity, {format = format, dictionary = dict}))
+            assert(#keyed < #plain, format .. " dictionary did not shrink the output")
+            assert(same(serialize.unpack(keyed, {format = format, dictionary = dict}), entity))
+            local v, err = serialize.unpack(keyed, {format = format})
+            assert(v == nil and err:find("without a dictionary"), format .. " dictionary key read without one")
+        end
+        assert(not pcall(serialize.dictionary, {"a", "b", "a"}), "duplicate dictionary key accepted")
+        
+        -- vector(1, 2, -3) as MessagePack ext type 2
+        local bytes = "\xC7\x0C\x02\x3F\x80\x00\x00\x40\x00\x00\x00\xC0\x40\x00\x00"
+        local vec = assert(serialize.unpack(bytes))
+        assert(type(vec) == "vector", "ext 2 not read as a vector")
+        assert(serialize.pack(vec) == bytes, "vector packed differently")
+        local cbor = assert(serialize.pack({vec}, {format = "cbor"}))
+        assert(serialize.unpack(cbor, {format = "cbor"})[1] == vec, "CBOR vector changed")
+    )", "ser_dictionary") == XORON_OK;
+    record(suite, "Key dictionary and vectors", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local rows = {}
+        for i = 1, 200 do rows[i] = {id = i, name = "entry", tags = {"a", "b"}} end
+        for _, format in ipairs({"msgpack", "cbor"}) do
+            local plain = assert(serialize.pack(rows, {format = format}))
+            local packed = assert(serialize.pack(rows, {format = format, compress = true}))
+            assert(#packed < #plain, format .. " compression did not shrink the output")
+            assert(same(serialize.unpack(packed, {format = format, compress = true}), rows))
+        end
+    )", "ser_compress") == XORON_OK;
+    record(suite, "Compressed round trip", ok, timer);
+    
+    // Headers that claim more than the input holds fail cleanly instead of allocating
+    ok = xoron_dostring(vm, R"(
+        local cases = {
+            {"", "msgpack"},
+            {"\xDC\x00", "msgpack"},
+            {"\xDD\xFF\xFF\xFF\xFF", "msgpack"},
+            {"\xDF\x7F\xFF\xFF\xFF\x01", "msgpack"},
+            {"\xDB\x00\x01\x00\x00abc", "msgpack"},
+            {"\xC6\xFF\xFF\xFF\xFF", "msgpack"},
+            {"\x92\x01", "msgpack"},
+            {"", "cbor"},
+            {"\x9B\x00\x00\x00\x01\x00\x00\x00\x00", "cbor"},
+            {"\x7A\xFF\xFF\xFF\xFF", "cbor"},
+            {"\xBB\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", "cbor"},
+            {"\x19\x01", "cbor"},
+        }
+        for i, case in ipairs(cases) do
+            local ok, v, err = pcall(serialize.unpack, case[1], {format = case[2]})
+            assert(ok, "case " .. i .. " raised: " .. tostring(v))
+            assert(v == nil and type(err) == "string" and err:find("Truncated"), "case " .. i .. " was accepted")
+        end
+        local v, err = serialize.unpack("\x01\x02")
+        assert(v == nil and err:find("trailing"), "trailing bytes accepted")
+    )", "ser_truncated") == XORON_OK;
+    record(suite, "Truncated and oversized headers", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Buffer
+
+bool test_buffer() {
+    TestSuite suite("Buffer");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    // Growing moves the parent's storage; the slice must follow it and shrink with it
+    bool ok = xoron_dostring(vm, R"(
+        local b = Buffer.fromstring("hello world")
+        local s = b:slice(6, 5)
+        assert(s:tostring() == "world")
+        b:resize(4096)
+        assert(s:tostring() == "world", "slice lost its bytes when the parent grew")
+        b:writestring(6, "WORLD")
+        assert(s:tostring() == "WORLD", "slice does not share the parent's storage")
+        b:resize(8)
+        assert(#s == 2 and s:tostring() == "WO", "slice not cut by a truncated parent")
+        b:clear()
+        assert(#s == 0 and s:tostring() == "", "slice of a cleared parent is not empty")
+        b:append("0123456789")
+        assert(s:tostring() == "6789", "slice does not see the refilled parent")
+        
+        local kept
+        do
+            local parent = Buffer.fromstring("persistent")
+            kept = parent:slice(3, 4)
+        end
+        collectgarbage("collect")
+        assert(kept:tostring() == "sist", "slice lost its storage with the parent")
+        assert(not pcall(function() kept:append("x") end), "append to a slice accepted")
+        assert(not pcall(function() kept:resize(16) end), "resize of a slice accepted")
+    )", "buf_slices") == XORON_OK;
+    record(suite, "Slices survive resize and clear", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local b = Buffer.fromstring("abc")
+        for _ = 1, 7 do b:append(b) end
+        assert(b:tostring() == string.rep("abc", 128), "self-append corrupted the buffer")
+        
+        local w = Buffer.fromstring("0123456789")
+        w:writestring(4, w)
+        assert(w:tostring() == "01230123456789", "growing self-writestring corrupted the buffer")
+        
+        local o = Buffer.fromstring("0123456789")
+        o:writestring(2, o:slice(0, 5))
+        assert(o:tostring() == "0101234789", "overlapping writestring corrupted the buffer")
+        
+        local a = Buffer.fromstring("abcd")
+        a:append(a:slice(1, 2))
+        assert(a:tostring() == "abcdbc", "append of a slice of itself corrupted the buffer")
+    )", "buf_self") == XORON_OK;
+    record(suite, "Append and writestring into itself", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local base = Buffer.fromstring("0123456789")
+        local s = base:slice(2, 4)
+        assert(s:readu8(3) == string.byte("5"))
+        assert(not pcall(function() return s:readu8(4) end), "read past the slice end accepted")
+        assert(not pcall(function() return s:readu32(1) end), "wide read past the slice end accepted")
+        assert(not pcall(function() return s:readstring(2, 3) end), "readstring past the slice end accepted")
+        assert(not pcall(function() s:writeu8(4, 1) end), "write past the slice end accepted")
+        assert(not pcall(function() s:writestring(3, "xy") end), "writestring past the slice end accepted")
+        assert(not pcall(function() return s:slice(3, 2) end), "slice past the slice end accepted")
+        assert(base:tostring() == "0123456789", "rejected write changed the parent")
+        
+        local nested = s:slice(1, 2)
+        assert(nested:tostring() == "34", "nested slice has the wrong offset")
+        nested:writeu8(0, 0x41)
+        assert(base:tostring() == "012A456789", "nested slice wrote to the wrong offset")
+    )", "buf_range") == XORON_OK;
+    record(suite, "Out-of-range access on slices", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local cases = {
+            {"u8", 1, 200}, {"i8", 1, -100}, {"u16", 2, 65000}, {"i16", 2, -30000},
+            {"u32", 4, 4000000000}, {"i32", 4, -2000000000}, {"f32", 4, 1.5}, {"f64", 8, math.pi},
+        }
+        for _, case in ipairs(cases) do
+            local name, width, value = case[1], case[2], case[3]
+            for _, big in ipairs({false, true}) do
+                local b = Buffer.new(width)
+                b["write" .. name](b, 0, value, big)
+                assert(b["read" .. name](b, 0, big) == value, name .. " round trip failed")
+                local reversed = Buffer.fromstring(b:tostring():reverse())
+                assert(reversed["read" .. name](reversed, 0, width > 1 and not big) == value, name .. " byte order is wrong")
+            end
+        end
+        
+        local b = Buffer.new(4)
+        b:writeu32(0, 0x01020304, true)
+        assert(b:tostring() == "\1\2\3\4", "big-endian layout is wrong")
+        b:writeu32(0, 0x01020304)
+        assert(b:tostring() == "\4\3\2\1", "little-endian layout is wrong")
+        b:writeu8(0, 263)
+        assert(b:readu8(0) == 7, "u8 did not wrap")
+        b:writei16(0, 0xFFFF)
+        assert(b:readi16(0) == -1, "i16 did not wrap")
+        b:writeu32(0, -1)
+        assert(b:readu32(0) == 4294967295, "u32 did not wrap")
+    )", "buf_typed") == XORON_OK;
+    record(suite, "Typed little- and big-endian round trips", ok, timer);
+    
+    // Binary APIs take a Buffer wherever they take a string
+    ok = xoron_dostring(vm, R"(
+        local text = string.rep("xoron buffer ", 64)
+        local b = Buffer.fromstring(text)
+        local packed = lz4compress(b)
+        assert(Buffer.isbuffer(packed) and #packed < #b, "lz4compress did not return a smaller Buffer")
+        local back = lz4decompress(packed, #b)
+        assert(Buffer.isbuffer(back) and back:tostring() == text, "lz4decompress did not restore the Buffer")
+        assert(lz4decompress(packed:tostring(), #text) == text)
+        
+        local doc = Buffer.fromstring('xx{"a": [1, 2, 3]}yy')
+        local decoded = assert(json.decode(doc:slice(2, #doc - 4)))
+        assert(decoded.a[3] == 3, "json.decode of a slice read past its view")
+        assert(json.decode(Buffer.fromstring("[true]"))[1] == true)
+        
+        local data = assert(serialize.pack({blob = Buffer.fromstring("\0\1\2binary")}))
+        local out = assert(serialize.unpack(Buffer.fromstring(data)))
+        assert(out.blob == "\0\1\2binary", "Buffer field did not pack as binary")
+        local whole = Buffer.fromstring("0123456789")
+        assert(serialize.unpack(serialize.pack(whole:slice(3, 4))) == "3456", "slice packed more than its view")
+    )", "buf_apis") == XORON_OK;
+    record(suite, "Buffers through lz4, json and serialize", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - JSON
+
+bool test_json() {
+    TestSuite suite("JSON");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    bool ok = xoron_dostring(vm, R"lua(
+        assert(json.decode([["q\"b\\s\/f\bn\nr\rt\tf\f"]]) == "q\"b\\s/f\bn\nr\rt\tf\f", "simple escapes")
+        assert(json.decode([["\u0041\u00e9\u20AC"]]) == "A\195\169\226\130\172", "\\u escapes")
+        assert(json.decode([["\uD83D\uDE00"]]) == "\240\159\152\128", "surrogate pair")
+        assert(json.decode([["\ud83d\ude00"]]) == "\240\159\152\128", "lower-case surrogate pair")
+        assert(json.decode([["\uD83Dx"]]) == "\239\191\189x", "lone high surrogate")
+        assert(json.decode([["\uDE00"]]) == "\239\191\189", "lone low surrogate")
+        
+        local text = "a\"b\\c\nd\re\tf\bg\fh\1i/j"
+        assert(json.encode(text) == [["a\"b\\c\nd\re\tf\bg\fh\u0001i/j"]], "encoded escapes: " .. json.encode(text))
+        assert(json.decode(json.encode(text)) == text)
+        local long = string.rep("x", 40) .. "\"" .. string.rep("y", 20) .. "\n"
+        assert(json.encode(long) == '"' .. string.rep("x", 40) .. '\\"' .. string.rep("y", 20) .. '\\n"',
+               "escape past the first block")
+        assert(json.decode(json.encode(long)) == long)
+    )lua", "json_escapes") == XORON_OK;
+    record(suite, "Escapes and surrogate pairs", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        assert(json.decode("null") == json.null, "null did not decode as json.null")
+        assert(json.decode("[1,null,3]")[2] == json.null)
+        assert(json.decode('{"a":null}').a == json.null)
+        assert(json.encode(json.null) == "null")
+        assert(json.encode({1, json.null, 3}) == "[1,null,3]")
+        assert(json.encode({a = json.null}) == '{"a":null}')
+    )", "json_null") == XORON_OK;
+    record(suite, "json.null", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local text = string.rep("[", 400) .. string.rep("]", 400)
+        local value = assert(json.decode(text))
+        local depth = 0
+        while value[1] do value, depth = value[1], depth + 1 end
+        assert(depth == 399, "decoded depth " .. depth)
+        assert(json.encode(json.decode(text)) == text, "deep array did not re-encode")
+        
+        local v, err = json.decode(string.rep("[", 600) .. string.rep("]", 600))
+        assert(v == nil and err:find("too deep"), "600 levels decoded")
+        local deep = {}
+        local cur = deep
+        for _ = 1, 600 do cur[1] = {} cur = cur[1] end
+        v, err = json.encode(deep)
+        assert(v == nil and err:find("too deep"), "600 levels encoded")
+        local cyclic = {}
+        cyclic.self = cyclic
+        v, err = json.encode(cyclic)
+        assert(v == nil and err:find("cyclic"), "cyclic table encoded")
+    )", "json_depth") == XORON_OK;
+    record(suite, "Deep nesting", ok, timer);
+    
+    ok = xoron_dostring(vm, R"lua(
+        local cases = {
+            "", "   ", "[1,2", "[1,]", '{"a"}', '{"a":1,}', "{a:1}", "tru", "01", "1.", "-",
+            '"abc', [["a\x"]], [["\u12"]], "[1] 2", '"a\tb"',
+        }
+        for i, text in ipairs(cases) do
+            local ok, v, err = pcall(json.decode, text)
+            assert(ok, "case " .. i .. " raised: " .. tostring(v))
+            assert(v == nil and type(err) == "string", "case " .. i .. " was accepted: " .. text)
+        end
+    )lua", "json_malformed") == XORON_OK;
+    record(suite, "Malformed input", ok, timer);
+    
+    ok = xoron_dostring(vm, R"(
+        local function same(a, b)
+            if type(a) ~= "table" or type(b) ~= "table" then return a == b end
+            for k, v in pairs(a) do
+                if not same(v, b[k]) then return false end
+            end
+            for k in pairs(b) do
+                if a[k] == nil then return false end
+            end
+            return true
+        end
+        
+        local value = {
+            name = "xoron", list = {1, 2.5, -3, 1e300, 0.1},
+            nested = {on = true, off = false, none = json.null, empty = {}},
+            text = "line\nbreak \"quoted\" \226\130\172",
+        }
+        local text = assert(json.encode(value))
+        assert(same(json.decode(text), value), "round trip changed the value: " .. text)
+    )", "json_roundtrip") == XORON_OK;
+    record(suite, "Encode and decode round trip", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Actors
+
+static double metric_value(const char* name) {
+    char* json = xoron_metrics_snapshot();
+    std::string key = std::string("\"") + name + "\":";
+    const char* at = json ? strstr(json, key.c_str()) : nullptr;
+    double value = at ? strtod(at + key.size(), nullptr) : 0.0;
+    xoron_free(json);
+    return value;
+}
+
+bool test_actor() {
+    TestSuite suite("Actors");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    bool ok = xoron_dostring(vm, R"(
+        local worker = assert(actor.spawn([[
+            actor.onmessage(function(job)
+                return {sum = job.a + job.b, tag = job.tag}
+            end)
+        ]], "adder"))
+        assert(worker:send({a = 2, b = 3, tag = "first"}))
+        assert(worker:send({a = 10, b = 20, tag = "second"}))
+        local r1, r2 = worker:receive(5000), worker:receive(5000)
+        assert(r1 and r1.sum == 5 and r1.tag == "first", "first result missing")
+        assert(r2 and r2.sum == 30 and r2.tag == "second", "second result missing or out of order")
+        assert(worker:receive(50) == nil, "unexpected extra result")
+        
+        local poster = assert(actor.spawn([[
+            actor.post("ready")
+            actor.onmessage(function(v)
+                actor.post(v * 2)
+                return v * 3
+            end)
+        ]]))
+        assert(poster:receive(5000) == "ready", "actor.post from the source not received")
+        assert(poster:send(7))
+        assert(poster:receive(5000) == 14 and poster:receive(5000) == 21, "actor.post and the handler result out of order")
+        worker:terminate()
+        poster:terminate()
+    )", "actor_roundtrip") == XORON_OK;
+    record(suite, "Spawn, send and receive", ok, timer);
+    
+    // Errors travel on the same channel as results, so they are delivered first
+    ok = xoron_dostring(vm, R"lua(
+        local errors = {}
+        local failing = assert(actor.spawn([[
+            actor.onmessage(function(v)
+                if v == "boom" then error("exploded on " .. v) end
+                return v
+            end)
+        ]]))
+        failing:onerror(function(message) table.insert(errors, message) end)
+        assert(failing:send("boom"))
+        assert(failing:send("after"))
+        assert(failing:receive(5000) == "after", "actor stopped handling messages after an error")
+        assert(#errors == 1 and errors[1]:find("exploded on boom"), "onerror not called: " .. tostring(errors[1]))
+        failing:terminate()
+        
+        local source_error
+        local bad = assert(actor.spawn("error('source failed')"))
+        bad:onerror(function(message) source_error = message end)
+        for _ = 1, 500 do
+            if source_error then break end
+            bad:receive(10)
+        end
+        assert(source_error and source_error:find("source failed"), "error in the actor source not reported")
+        bad:terminate()
+    )lua", "actor_onerror") == XORON_OK;
+    record(suite, "onerror receives errors raised in the actor", ok, timer);
+    
+    // Each message takes 10ms, so terminate lands while most of them are still queued
+    ok = xoron_dostring(vm, R"(
+        local slow = assert(actor.spawn([[
+            actor.onmessage(function(v)
+                local start = os.clock()
+                while os.clock() - start < 0.01 do end
+                return v
+            end)
+        ]]))
+        for i = 1, 100 do assert(slow:send(i)) end
+        slow:terminate()
+        local ok, err = slow:send(101)
+        assert(ok == nil and err == "Actor is terminated", "send after terminate accepted")
+        local received = 0
+        while slow:receive(300) do received = received + 1 end
+        assert(received < 100, "terminate did not drop queued messages")
+    )", "actor_terminate") == XORON_OK;
+    record(suite, "Terminate with queued messages", ok, timer);
+    
+    // Handles dropped with work in flight: their actors must stop and results for them be discarded
+    ok = xoron_dostring(vm, R"(
+        for i = 1, 20 do
+            local a = assert(actor.spawn([[ actor.onmessage(function(v) return v end) ]]))
+            for n = 1, 5 do a:send(n) end
+        end
+    )", "actor_drop") == XORON_OK;
+    ok = ok && xoron_dostring(vm, "collectgarbage('collect')", "actor_collect") == XORON_OK;
+    Timer deadline;
+    while (ok && metric_value("actor.active") != 0 && deadline.elapsed_ms() < 5000) {
+        xoron_channel_pump(vm, 0);
+        xoron_channel_wait(vm, 10);
+    }
+    xoron_channel_pump(vm, 0);
+    record(suite, "Collected handles stop their actors", ok && metric_value("actor.active") == 0, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Parallel
+
+bool test_parallel() {
+    TestSuite suite("Parallel");
+    Timer timer;
+    xoron_vm_t* vm = xoron_vm_new();
+    if (!vm) {
+        suite.recordResult("VM creation", false, xoron_last_error());
+        g_failed++;
+        return false;
+    }
+    
+    // Small chunks so the results of several workers are merged
+    bool ok = xoron_dostring(vm, R"lua(
+        local items = {}
+        for i = 1, 100 do items[i] = i end
+        local results = parallel.map("function(x) if x % 3 == 0 then return nil end return x * 2 end", items, 7)
+        for i = 1, 100 do
+            local expected = i % 3 ~= 0 and i * 2 or nil
+            assert(results[i] == expected, "result " .. i .. " is " .. tostring(results[i]))
+        end
+        local doubled = parallel.map("function(x) return x * 2 end", items)
+        assert(#doubled == 100 and doubled[1] == 2 and doubled[100] == 200, "default chunking lost results")
+    )lua", "parallel_map") == XORON_OK;
+    record(suite, "map keeps order and nil results", ok, timer);
+    
+    ok = xoron_dostring(vm, R"lua(
+        local items = {}
+        for i = 1, 1000 do items[i] = i end
+        local add = "function(a, b) return a + b end"
+        assert(parallel.reduce(add, items, 0, 64) == 500500, "sum with init")
+        assert(parallel.reduce(add, items, 10, 64) == 500510, "init not folded in once")
+        assert(parallel.reduce(add, items, nil, 64) == 500500, "sum without init")
+        
+        -- Concatenation is associative but not commutative, so chunks must be folded in order
+        local letters = {}
+        for i = 1, 26 do letters[i] = string.char(96 + i) end
+        local concat = "function(a, b) return a .. b end"
+        assert(parallel.reduce(concat, letters, nil, 3) == "abcdefghijklmnopqrstuvwxyz", "chunks folded out of order")
+        assert(parallel.reduce(concat, letters, ">", 3) == ">abcdefghijklmnopqrstuvwxyz", "init not folded first")
+    )lua", "parallel_reduce") == XORON_OK;
+    record(suite, "reduce with and without init", ok, timer);
+    
+    ok = xoron_dostring(vm, R"lua(
+        local scaled = parallel.map("function(x, ctx) return x * ctx.scale + ctx.offset end", {1, 2, 3, 4}, 1,
+                                    {scale = 10, offset = 1})
+        assert(scaled[1] == 11 and scaled[2] == 21 and scaled[3] == 31 and scaled[4] == 41, "map context")
+        local items = {}
+        for i = 1, 10 do items[i] = i end
+        local max = "function(a, b, floor) return math.max(a, b, floor) end"
+        assert(parallel.reduce(max, items, nil, 2, 42) == 42, "reduce context on the workers")
+        assert(parallel.reduce(max, items, nil, 2, 5) == 10)
+    )lua", "parallel_context") == XORON_OK;
+    record(suite, "context reaches every chunk", ok, timer);
+    
+    ok = xoron_dostring(vm, R"lua(
+        local expr = parallel.map("function(x) return x + 1 end", {1, 2, 3}, 1)
+        assert(expr[1] == 2 and expr[3] == 4, "expression source")
+        local stmt = parallel.map("local k = 5\nreturn function(x) return x + k end", {1, 2, 3}, 1)
+        assert(stmt[1] == 6 and stmt[3] == 8, "statement source")
+        
+        local ok, err = pcall(parallel.map, "return 42", {1})
+        assert(not ok and err:find("must evaluate to a function"), "non-function source accepted")
+        ok, err = pcall(parallel.map, function(x) return x end, {1})
+        assert(not ok and err:find("source text"), "closure accepted")
+    )lua", "parallel_source") == XORON_OK;
+    record(suite, "Source as a statement or an expression", ok, timer);
+    
+    ok = xoron_dostring(vm, R"lua(
+        local items = {}
+        for i = 1, 100 do items[i] = i end
+        local ok, err = pcall(parallel.map, "function(x) if x == 50 then error('bad item ' .. x) end return x end", items, 10)
+        assert(not ok and err:sub(1, 10) == "parallel: " and err:find("bad item 50"), "map error: " .. tostring(err))
+        ok, err = pcall(parallel.reduce, "function(a, b) if b == 75 then error('bad fold') end return a + b end", items, 0, 10)
+        assert(not ok and err:sub(1, 10) == "parallel: " and err:find("bad fold"), "reduce error: " .. tostring(err))
+        local after = parallel.map("function(x) return -x end", items, 10)
+        assert(after[100] == -100, "pool unusable after a failed call")
+    )lua", "parallel_error") == XORON_OK;
+    record(suite, "Worker errors surface as parallel: ...", ok, timer);
+    
+    xoron_vm_free(vm);
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Main Test Runner
+
+int main() {
+    char home[] = "/tmp/xoron_test_XXXXXX";
+    if (!mkdtemp(home)) {
+        TEST_LOG("cannot create a temporary HOME");
+        return 1;
+    }
+    setenv("HOME", home, 1);
+    
+    if (xoron_init() != XORON_OK) {
+        TEST_LOG("xoron_init failed: %s", xoron_last_error());
+        return 1;
+    }
+    
+    test_bytecode();
+    test_script_env();
+    test_kv();
+    test_serialize();
+    test_buffer();
+    test_json();
+    test_actor();
+    test_parallel();
+    
+    xoron_shutdown();
+    TEST_LOG("%s", g_failed == 0 ? "ALL TESTS PASSED" : "SOME TESTS FAILED");
+    return g_failed == 0 ? 0 : 1;
+}
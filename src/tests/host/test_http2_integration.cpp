@@ -0,0 +1,566 @@
+/*
+ * test_http2_integration.cpp - HTTP/2 integration tests for Xoron
+ * Tests: Stream multiplexing, ALPN fallback to HTTP/1.1, REFUSED_STREAM retry, redirects
+ * Platform: development build with XORON_HTTP2, registered with ctest
+ *
+ * Runs in-process TLS servers on 127.0.0.1 with a self-signed certificate
+ * generated at startup. Connections that negotiate h2 are served by an
+ * nghttp2 server session; anything else gets a minimal HTTP/1.1 responder,
+ * which is what the fallback path's client talks to. Requests go through the
+ * public xoron_http_* entry points, and the http2.* metrics together with the
+ * servers' own counters show which protocol carried them.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <nghttp2/nghttp2.h>
+
+#include "../../xoron.h"
+#include "../common/test_utils.h"
+
+#define HOLD_STREAMS 4          // /hold answers once this many are open, or after HOLD_TIMEOUT_MS
+#define HOLD_TIMEOUT_MS 3000
+
+static int g_failed = 0;
+
+static void record(TestSuite& suite, const char* name, bool passed, Timer& timer) {
+    suite.recordResult(name, passed, passed ? "" : xoron_last_error(), timer.elapsed_ms());
+    if (!passed) g_failed++;
+    timer.reset();
+}
+
+static double metric_value(const char* name) {
+    char* json = xoron_metrics_snapshot();
+    std::string key = std::string("\"") + name + "\":";
+    const char* at = json ? strstr(json, key.c_str()) : nullptr;
+    double value = at ? strtod(at + key.size(), nullptr) : 0.0;
+    xoron_free(json);
+    return value;
+}
+
+static uint64_t now_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// MARK: - TLS Server
+
+struct TestServer {
+    bool offer_h2 = true;               // false: ALPN never selects h2
+    SSL_CTX* ctx = nullptr;
+    int listen_fd = -1;
+    int port = 0;
+    std::atomic<bool> stop{false};
+    std::thread acceptor;
+    std::mutex mutex;
+    std::vector<std::thread> connections;
+    std::vector<std::string> h2_paths;  // served paths, under mutex
+    std::vector<std::string> h1_paths;
+    
+    std::atomic<int> h2_connections{0};
+    std::atomic<int> h2_offers{0};      // handshakes whose ALPN list included h2
+    std::atomic<int> max_held{0};       // most /hold streams open at once on one connection
+    std::atomic<bool> refused{false};
+    
+    std::string url(const char* path) const {
+        return "https://127.0.0.1:" + std::to_string(port) + path;
+    }
+    
+    bool served(const std::vector<std::string>& paths, const char* path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::count(paths.begin(), paths.end(), path) > 0;
+    }
+};
+
+static int select_alpn(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+                       const unsigned char* in, unsigned int inlen, void* arg) {
+    (void)ssl;
+    TestServer* server = (TestServer*)arg;
+    bool h2 = false, h1 = false;
+    for (unsigned int i = 0; i < inlen && i + 1 + in[i] <= inlen; i += 1 + in[i]) {
+        if (in[i] == 2 && memcmp(in + i + 1, "h2", 2) == 0) h2 = true;
+        if (in[i] == 8 && memcmp(in + i + 1, "http/1.1", 8) == 0) h1 = true;
+    }
+    if (h2) server->h2_offers++;
+    if (h2 && server->offer_h2) {
+        *out = (const unsigned char*)"h2";
+        *outlen = 2;
+        return SSL_TLSEXT_ERR_OK;
+    }
+    if (h1) {
+        *out = (const unsigned char*)"http/1.1";
+        *outlen = 8;
+        return SSL_TLSEXT_ERR_OK;
+    }
+    return SSL_TLSEXT_ERR_NOACK;
+}
+
+// Self-signed P-256 certificate for CN=localhost, valid for an hour
+static bool make_certificate(EVP_PKEY** key_out, X509** cert_out) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool ok = kctx && EVP_PKEY_keygen_init(kctx) > 0 &&
+              EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) > 0 &&
+              EVP_PKEY_keygen(kctx, &key) > 0;
+    EVP_PKEY_CTX_free(kctx);
+    if (!ok) return false;
+    
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    if (X509_sign(cert, key, EVP_sha256()) <= 0) {
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return false;
+    }
+    *key_out = key;
+    *cert_out = cert;
+    return true;
+}
+
+static bool write_all(SSL* ssl, int fd, const char* data, size_t len) {
+    while (len > 0) {
+        int n = SSL_write(ssl, data, (int)len);
+        if (n <= 0) {
+            int e = SSL_get_error(ssl, n);
+            struct pollfd p = {fd, (short)(e == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT), 0};
+            if ((e != SSL_ERROR_WANT_WRITE && e != SSL_ERROR_WANT_READ) || poll(&p, 1, 5000) <= 0) return false;
+            continue;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// MARK: - HTTP/1.1 Responder
+
+// One request per connection: answers GET <path> with "h1:<path>" and closes
+static void serve_h1(TestServer* server, SSL* ssl, int fd) {
+    std::string request;
+    char buf[4096];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 65536) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) return;
+        request.append(buf, (size_t)n);
+    }
+    size_t start = request.find(' ');
+    size_t end = start == std::string::npos ? start : request.find(' ', start + 1);
+    if (end == std::string::npos) return;
+    std::string path = request.substr(start + 1, end - start - 1);
+    {
+        std::lock_guard<std::mutex> lock(server->mutex);
+        server->h1_paths.push_back(path);
+    }
+    
+    std::string body = "h1:" + path;
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    if (write_all(ssl, fd, response.data(), response.size())) SSL_shutdown(ssl);
+}
+
+// MARK: - HTTP/2 Responder
+
+struct H2Body {
+    std::string data;
+    size_t off = 0;
+};
+
+struct H2ServerConnection {
+    TestServer* server;
+    SSL* ssl;
+    int fd;
+    nghttp2_session* session = nullptr;
+    std::unordered_map<int32_t, std::string> paths;     // request path per open stream
+    std::unordered_map<int32_t, H2Body> bodies;         // response bodies being sent
+    std::vector<int32_t> held;
+    uint64_t held_since = 0;
+};
+
+static ssize_t read_response(nghttp2_session* session, int32_t stream_id, uint8_t* buf, size_t length,
+                             uint32_t* data_flags, nghttp2_data_source* source, void* user_data) {
+    (void)session; (void)stream_id; (void)user_data;
+    H2Body* body = (H2Body*)source->ptr;
+    size_t n = std::min(length, body->data.size() - body->off);
+    memcpy(buf, body->data.data() + body->off, n);
+    body->off += n;
+    if (body->off == body->data.size()) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    return (ssize_t)n;
+}
+
+static void respond(H2ServerConnection* c, int32_t id, const char* status, const std::string& body,
+                    const char* location = nullptr) {
+    H2Body& out = c->bodies[id];
+    out.data = body;
+    std::string length = std::to_string(body.size());
+    std::vector<nghttp2_nv> nv = {
+        {(uint8_t*)":status", (uint8_t*)status, 7, strlen(status), NGHTTP2_NV_FLAG_NONE},
+        {(uint8_t*)"content-length", (uint8_t*)length.data(), 14, length.size(), NGHTTP2_NV_FLAG_NONE},
+    };
+    if (location) nv.push_back({(uint8_t*)"location", (uint8_t*)location, 8, strlen(location), NGHTTP2_NV_FLAG_NONE});
+    nghttp2_data_provider provider;
+    provider.source.ptr = &out;
+    provider.read_callback = read_response;
+    nghttp2_submit_response(c->session, id, nv.data(), nv.size(), &provider);
+}
+
+static void release_held(H2ServerConnection* c) {
+    for (int32_t id : c->held) respond(c, id, "200", "h2:/hold");
+    c->held.clear();
+}
+
+// Routes: /refuse-once is refused unprocessed the first time, /hold waits for
+// HOLD_STREAMS concurrent streams, /redirect sends a 302 to /target
+static void handle_request(H2ServerConnection* c, int32_t id) {
+    TestServer* server = c->server;
+    std::string path = c->paths[id];
+    {
+        std::lock_guard<std::mutex> lock(server->mutex);
+        server->h2_paths.push_back(path);
+    }
+    
+    if (path == "/refuse-once" && !server->refused.exchange(true)) {
+        nghttp2_submit_rst_stream(c->session, NGHTTP2_FLAG_NONE, id, NGHTTP2_REFUSED_STREAM);
+    } else if (path == "/hold") {
+        if (c->held.empty()) c->held_since = now_ms();
+        c->held.push_back(id);
+        int held = (int)c->held.size();
+        int prev = server->max_held.load();
+        while (held > prev && !server->max_held.compare_exchange_weak(prev, held)) {}
+        if (held >= HOLD_STREAMS) release_held(c);
+    } else if (path == "/redirect") {
+        respond(c, id, "302", "", "/target");
+    } else {
+        respond(c, id, "200", "h2:" + path);
+    }
+}
+
+static int on_begin_headers(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) {
+    (void)session;
+    H2ServerConnection* c = (H2ServerConnection*)user_data;
+    if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+        c->paths[frame->hd.stream_id] = "";
+    }
+    return 0;
+}
+
+static int on_header(nghttp2_session* session, const nghttp2_frame* frame, const uint8_t* name, size_t namelen,
+                     const uint8_t* value, size_t valuelen, uint8_t flags, void* user_data) {
+    (void)session; (void)flags;
+    H2ServerConnection* c = (H2ServerConnection*)user_data;
+    if (frame->hd.type == NGHTTP2_HEADERS && namelen == 5 && memcmp(name, ":path", 5) == 0) {
+        c->paths[frame->hd.stream_id].assign((const char*)value, valuelen);
+    }
+    return 0;
+}
+
+static int on_frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) {
+    (void)session;
+    H2ServerConnection* c = (H2ServerConnection*)user_data;
+    bool request_done = (frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA) &&
+                        (frame->hd.flags & NGHTTP2_FLAG_END_STREAM);
+    if (request_done && c->paths.count(frame->hd.stream_id)) handle_request(c, frame->hd.stream_id);
+    return 0;
+}
+
+static int on_stream_close(nghttp2_session* session, int32_t stream_id, uint32_t error_code, void* user_data) {
+    (void)session; (void)error_code;
+    H2ServerConnection* c = (H2ServerConnection*)user_data;
+    c->paths.erase(stream_id);
+    c->bodies.erase(stream_id);
+    c->held.erase(std::remove(c->held.begin(), c->held.end(), stream_id), c->held.end());
+    return 0;
+}
+
+static bool h2_flush(H2ServerConnection* c) {
+    while (true) {
+        const uint8_t* data = nullptr;
+        ssize_t n = nghttp2_session_mem_send(c->session, &data);
+        if (n < 0) return false;
+        if (n == 0) return true;
+        if (!write_all(c->ssl, c->fd, (const char*)data, (size_t)n)) return false;
+    }
+}
+
+static void serve_h2(TestServer* server, SSL* ssl, int fd) {
+    server->h2_connections++;
+    H2ServerConnection c;
+    c.server = server;
+    c.ssl = ssl;
+    c.fd = fd;
+    
+    nghttp2_session_callbacks* callbacks;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) return;
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, on_begin_headers);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, on_header);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, on_frame_recv);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, on_stream_close);
+    int rv = nghttp2_session_server_new(&c.session, callbacks, &c);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) return;
+    
+    nghttp2_settings_entry settings[] = {{NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100}};
+    nghttp2_submit_settings(c.session, NGHTTP2_FLAG_NONE, settings, 1);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    
+    bool open = true;
+    while (open && !server->stop.load()) {
+        if (!c.held.empty() && now_ms() - c.held_since > HOLD_TIMEOUT_MS) release_held(&c);
+        if (!h2_flush(&c)) break;
+        if (!nghttp2_session_want_read(c.session) && !nghttp2_session_want_write(c.session)) break;
+        
+        struct pollfd p = {fd, POLLIN, 0};
+        if (!SSL_pending(ssl) && poll(&p, 1, 20) <= 0) continue;
+        char buf[16384];
+        while (true) {
+            int n = SSL_read(ssl, buf, sizeof(buf));
+            if (n <= 0) {
+                int e = SSL_get_error(ssl, n);
+                open = e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE;
+                break;
+            }
+            if (nghttp2_session_mem_recv(c.session, (const uint8_t*)buf, (size_t)n) < 0) {
+                open = false;
+                break;
+            }
+        }
+    }
+    nghttp2_session_del(c.session);
+}
+
+// MARK: - Server Lifecycle
+
+static void serve_connection(TestServer* server, int fd) {
+    // Bounds the blocking handshake and HTTP/1.1 reads
+    struct timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    SSL* ssl = SSL_new(server->ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_accept(ssl) == 1) {
+        const unsigned char* alpn = nullptr;
+        unsigned int alpn_len = 0;
+        SSL_get0_alpn_selected(ssl, &alpn, &alpn_len);
+        if (alpn_len == 2 && memcmp(alpn, "h2", 2) == 0) {
+            serve_h2(server, ssl, fd);
+        } else {
+            serve_h1(server, ssl, fd);
+        }
+    }
+    SSL_free(ssl);
+    close(fd);
+}
+
+static void accept_loop(TestServer* server) {
+    while (!server->stop.load()) {
+        struct pollfd p = {server->listen_fd, POLLIN, 0};
+        if (poll(&p, 1, 50) <= 0) continue;
+        int fd = accept(server->listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::lock_guard<std::mutex> lock(server->mutex);
+        server->connections.emplace_back(serve_connection, server, fd);
+    }
+}
+
+static bool start_server(TestServer* server, EVP_PKEY* key, X509* cert) {
+    server->ctx = SSL_CTX_new(TLS_server_method());
+    if (!server->ctx || SSL_CTX_use_certificate(server->ctx, cert) != 1 ||
+        SSL_CTX_use_PrivateKey(server->ctx, key) != 1) {
+        return false;
+    }
+    SSL_CTX_set_alpn_select_cb(server->ctx, select_alpn, server);
+    
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 16) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        return false;
+    }
+    server->port = ntohs(addr.sin_port);
+    server->acceptor = std::thread(accept_loop, server);
+    return true;
+}
+
+static void stop_server(TestServer* server) {
+    server->stop = true;
+    if (server->acceptor.joinable()) server->acceptor.join();
+    for (auto& t : server->connections) t.join();
+    if (server->listen_fd >= 0) close(server->listen_fd);
+    SSL_CTX_free(server->ctx);
+}
+
+// MARK: - Tests
+
+// Frees the response and reports whether it was `status` with exactly `expected`
+static bool check_response(char* body, int status, size_t len, int expected_status, const char* expected) {
+    bool ok = body && status == expected_status && len == strlen(expected) && memcmp(body, expected, len) == 0;
+    if (body && !ok) {
+        TEST_LOG("got %d '%.*s', expected %d '%s'", status, (int)len, body, expected_status, expected);
+    }
+    xoron_http_free(body);
+    return ok;
+}
+
+bool test_multiplexing(TestServer* server) {
+    TestSuite suite("Multiplexing");
+    Timer timer;
+    xoron_metrics_reset();
+    
+    // The server answers /hold only once HOLD_STREAMS streams are open together
+    std::string url = server->url("/hold");
+    std::atomic<int> ok_count{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < HOLD_STREAMS; i++) {
+        threads.emplace_back([&] {
+            int status = 0;
+            size_t len = 0;
+            char* body = xoron_http_get(url.c_str(), &status, &len);
+            if (check_response(body, status, len, 200, "h2:/hold")) ok_count++;
+        });
+    }
+    for (auto& t : threads) t.join();
+    record(suite, "Concurrent requests succeed", ok_count == HOLD_STREAMS, timer);
+    
+    record(suite, "One connection for the origin",
+           server->h2_connections == 1 && metric_value("http2.connections") == 1, timer);
+    record(suite, "Requests multiplexed as concurrent streams",
+           metric_value("http2.streams") == HOLD_STREAMS && server->max_held >= HOLD_STREAMS, timer);
+    
+    suite.printSummary();
+    return true;
+}
+
+bool test_refused_stream(TestServer* server) {
+    TestSuite suite("REFUSED_STREAM Retry");
+    Timer timer;
+    xoron_metrics_reset();
+    
+    // Refused unprocessed over h2, so the request is safe to resend over HTTP/1.1
+    int status = 0;
+    size_t len = 0;
+    char* body = xoron_http_get(server->url("/refuse-once").c_str(), &status, &len);
+    record(suite, "Refused request retried", check_response(body, status, len, 200, "h1:/refuse-once"), timer);
+    record(suite, "Retry counted as a fallback",
+           server->refused && metric_value("http2.fallbacks") == 1 && server->served(server->h1_paths, "/refuse-once"), timer);
+    
+    // The refusal closed one stream, not the connection
+    body = xoron_http_get(server->url("/after-refusal").c_str(), &status, &len);
+    record(suite, "Connection still serves h2",
+           check_response(body, status, len, 200, "h2:/after-refusal") && server->h2_connections == 1, timer);
+    
+    suite.printSummary();
+    return true;
+}
+
+bool test_redirects(TestServer* server) {
+    TestSuite suite("Redirects");
+    Timer timer;
+    
+    int status = 0;
+    size_t len = 0;
+    char* body = xoron_http_get_conditional(server->url("/redirect").c_str(), nullptr, &status, &len, nullptr, 0);
+    record(suite, "302 followed to the target", check_response(body, status, len, 200, "h2:/target"), timer);
+    record(suite, "Both hops over h2",
+           server->served(server->h2_paths, "/redirect") && server->served(server->h2_paths, "/target"), timer);
+    
+    // xoron_http_get leaves redirects to the caller
+    body = xoron_http_get(server->url("/redirect").c_str(), &status, &len);
+    record(suite, "Unfollowed redirect returned as is", check_response(body, status, len, 302, ""), timer);
+    
+    suite.printSummary();
+    return true;
+}
+
+bool test_alpn_fallback(TestServer* server) {
+    TestSuite suite("ALPN Fallback");
+    Timer timer;
+    xoron_metrics_reset();
+    
+    // The server answers ALPN with http/1.1; the origin is then remembered as HTTP/1.1-only
+    int status = 0;
+    size_t len = 0;
+    char* body = xoron_http_get(server->url("/first").c_str(), &status, &len);
+    record(suite, "First request served over HTTP/1.1", check_response(body, status, len, 200, "h1:/first"), timer);
+    
+    body = xoron_http_get(server->url("/second").c_str(), &status, &len);
+    record(suite, "Second request served over HTTP/1.1", check_response(body, status, len, 200, "h1:/second"), timer);
+    record(suite, "h2 attempted once per origin", server->h2_offers == 1, timer);
+    record(suite, "No h2 connection or stream",
+           server->h2_connections == 0 && metric_value("http2.connections") == 0 &&
+           metric_value("http2.streams") == 0, timer);
+    
+    suite.printSummary();
+    return true;
+}
+
+// MARK: - Main Test Runner
+
+int main() {
+    char home[] = "/tmp/xoron_test_XXXXXX";
+    if (!mkdtemp(home)) {
+        TEST_LOG("cannot create a temporary HOME");
+        return 1;
+    }
+    setenv("HOME", home, 1);
+    signal(SIGPIPE, SIG_IGN);
+    
+    if (xoron_init() != XORON_OK) {
+        TEST_LOG("xoron_init failed: %s", xoron_last_error());
+        return 1;
+    }
+    
+    EVP_PKEY* key = nullptr;
+    X509* cert = nullptr;
+    TestServer h2_server;
+    TestServer h1_server;
+    h1_server.offer_h2 = false;
+    if (!make_certificate(&key, &cert) || !start_server(&h2_server, key, cert) || !start_server(&h1_server, key, cert)) {
+        TEST_LOG("cannot start the test servers");
+        return 1;
+    }
+    
+    test_multiplexing(&h2_server);
+    test_refused_stream(&h2_server);
+    test_redirects(&h2_server);
+    test_alpn_fallback(&h1_server);
+    
+    stop_server(&h2_server);
+    stop_server(&h1_server);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    
+    xoron_shutdown();
+    TEST_LOG("%s", g_failed == 0 ? "ALL TESTS PASSED" : "SOME TESTS FAILED");
+    return g_failed == 0 ? 0 : 1;
+}
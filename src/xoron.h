@@ -178,15 +178,19 @@ void xoron_set_output(xoron_output_fn print_fn, xoron_output_fn error_fn, void*
 xoron_vm_t* xoron_vm_new(void);
 void xoron_vm_free(xoron_vm_t* vm);
 void xoron_vm_reset(xoron_vm_t* vm);
+size_t xoron_vm_memory(xoron_vm_t* vm);
+void xoron_set_lazy_libs(bool enable);
 
 /* ============== Compilation API ============== */
 xoron_bytecode_t* xoron_compile(const char* source, size_t len, const char* name);
 xoron_bytecode_t* xoron_compile_file(const char* path);
 void xoron_bytecode_free(xoron_bytecode_t* bc);
 const char* xoron_bytecode_data(xoron_bytecode_t* bc, size_t* len);
+char* xoron_bytecode_analyze(xoron_bytecode_t* bc);  /* JSON report, free with xoron_free */
 
 /* ============== Execution API ============== */
 int xoron_run(xoron_vm_t* vm, xoron_bytecode_t* bc);
+int xoron_run_bytecode(xoron_vm_t* vm, const char* data, size_t len, const char* name);  /* precompiled blob, loaded in place */
 int xoron_dostring(xoron_vm_t* vm, const char* source, const char* name);
 int xoron_dofile(xoron_vm_t* vm, const char* path);
 
@@ -195,6 +199,10 @@ char* xoron_http_get(const char* url, int* status, size_t* len);
 char* xoron_http_post(const char* url, const char* body, size_t body_len, 
                       const char* content_type, int* status, size_t* len);
 void xoron_http_free(char* response);
+/* Request scheduling, shared by every VM: per-host token buckets (rate in requests/s, 0 = unlimited;
+ * host NULL or "*" sets the default) and a cap on requests in flight */
+void xoron_http_set_rate_limit(const char* host, double rate, double burst);
+void xoron_http_set_concurrency(int max_in_flight);
 
 /* ============== Crypto API ============== */
 void xoron_sha256(const void* data, size_t len, uint8_t out[32]);
@@ -223,10 +231,78 @@ void xoron_console_print(const char* text);
 void xoron_console_warn(const char* text);
 void xoron_console_error(const char* text);
 
+/* ============== Metrics API ============== */
+/* Registration returns a metric id (or -1); the same name always yields the same id */
+int xoron_metric_counter(const char* name);
+int xoron_metric_gauge(const char* name);
+int xoron_metric_histogram(const char* name);
+void xoron_metric_inc(int id, uint64_t n);          /* counter */
+void xoron_metric_set(int id, int64_t value);       /* gauge */
+void xoron_metric_adjust(int id, int64_t delta);    /* gauge */
+void xoron_metric_observe(int id, uint64_t value);  /* histogram, latencies in microseconds */
+uint64_t xoron_metric_now_us(void);
+char* xoron_metrics_snapshot(void);                 /* compact JSON, free with xoron_free */
+void xoron_metrics_reset(void);
+
+/* ============== Startup Trace API ============== */
+/* Phases nest per thread; begin returns -1 (and end ignores it) once the trace is complete */
+int xoron_startup_begin(const char* name);
+void xoron_startup_end(int phase);
+void xoron_startup_complete(void);                  /* called after the first script; logs a summary line */
+char* xoron_startup_trace(void);                    /* JSON, free with xoron_free */
+
+/* ============== JSON API ============== */
+int xoron_json_validate(const char* text, size_t len);                     /* XORON_ERR_INVALID with the byte offset in xoron_last_error */
+char* xoron_json_minify(const char* text, size_t len, size_t* out_len);    /* free with xoron_free */
+
+/* ============== Channel API ============== */
+/* Host threads post messages; the thread that owns the VM handles them at safe points */
+typedef enum {
+    XORON_MSG_SCRIPT = 1,       /* data = source, compiled and run */
+    XORON_MSG_BYTECODE = 2,     /* data = compiled blob */
+    XORON_MSG_TOUCH = 3,        /* x, y, arg = phase (0 down, 1 move, 2 up) */
+    XORON_MSG_UI = 4,
+    XORON_MSG_NETWORK = 5,
+    XORON_MSG_USER = 6,
+    XORON_MSG_REPLY = 7         /* arg = status */
+} xoron_msg_type_t;
+
+typedef struct {
+    int type;
+    int64_t id;                 /* non-zero asks for a XORON_MSG_REPLY with the same id */
+    int64_t arg;
+    double x, y;
+    const char* topic;
+    const char* data;
+    size_t data_len;            /* 0 means strlen(data) */
+} xoron_message_t;
+
+typedef void (*xoron_message_fn)(const xoron_message_t* msg, void* ud);
+typedef void (*xoron_notify_fn)(void* ud);
+
+int xoron_channel_post(xoron_vm_t* vm, const xoron_message_t* msg);   /* any thread, copies msg */
+int xoron_channel_pump(xoron_vm_t* vm, int max);                       /* VM thread, returns handled count */
+int xoron_channel_wait(xoron_vm_t* vm, int timeout_ms);                /* VM thread, -1 waits forever */
+int xoron_channel_drain(xoron_vm_t* vm, xoron_message_fn fn, void* ud, int max);  /* host, replies and channel.post */
+void xoron_channel_set_notify(xoron_vm_t* vm, xoron_notify_fn on_post, xoron_notify_fn on_reply, void* ud);
+
+/* ============== Input API ============== */
+/* Any thread, lock-free; events are timestamped and drained in batches on the VM with Input signal handlers */
+void xoron_input_set_key(int keycode, bool pressed);
+void xoron_input_set_mouse(int button, bool pressed);
+void xoron_input_set_mouse_pos(float x, float y);
+void xoron_input_scroll(float delta);
+void xoron_input_touch(int id, int phase, float x, float y);    /* phase: 0 began, 1 moved, 2 ended */
+
 #ifdef __cplusplus
 }
 
 /* C++ only declarations */
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
 struct lua_State;
 
 /* Library registration functions */
@@ -242,6 +318,165 @@ void xoron_register_crypt(lua_State* L);
 void xoron_register_input(lua_State* L);
 void xoron_register_cache(lua_State* L);
 void xoron_register_ui(lua_State* L);
+void xoron_register_metrics(lua_State* L);
+void xoron_register_channel(lua_State* L);
+void xoron_register_json(lua_State* L);
+void xoron_register_serialize(lua_State* L);
+void xoron_register_buffer(lua_State* L);
+void xoron_register_kv(lua_State* L);
+void xoron_register_actor(lua_State* L);
+void xoron_register_parallel(lua_State* L);
+void xoron_register_loader(lua_State* L);
+void xoron_register_download(lua_State* L);
+
+/* Process-wide setup for libraries that need it (directories, native channel
+ * handlers, platform input hooks). Run once before the first VM registers any
+ * library, so register functions only touch the lua_State they are given */
+void xoron_init_filesystem(void);
+void xoron_init_drawing(void);
+void xoron_init_websocket(void);
+void xoron_init_input(void);
+void xoron_init_ui(void);
+
+/* JSON <-> Lua values; json.null (a NULL lightuserdata) stands for null */
+int xoron_json_decode(lua_State* L, const char* text, size_t len);  /* pushes the value, or nothing on error */
+char* xoron_json_encode(lua_State* L, int idx, size_t* len);        /* free with xoron_free */
+
+/* lz4compress framing (4-byte little-endian size + LZ4 block); results are freed with xoron_free */
+char* xoron_lz4_compress(const char* data, size_t len, size_t* out_len);
+char* xoron_lz4_decompress(const char* data, size_t len, size_t expected_size, size_t* out_len);
+
+/* MessagePack <-> Lua values, as written by serialize.pack with default options */
+char* xoron_serialize_pack(lua_State* L, int idx, size_t* len);           /* free with xoron_free */
+int xoron_serialize_unpack(lua_State* L, const char* data, size_t len);   /* pushes the value, or nothing on error */
+
+/* Loads a chunk into a fresh script environment that reads and writes through
+ * to getgenv(); pushes the function, or the error with a nonzero luau_load status */
+int xoron_load_script(lua_State* L, const char* chunkname, const char* data, size_t len);
+
+/* Conditional GET: sends If-None-Match when etag is set, a 304 has an empty body; etag_out gets the response ETag */
+char* xoron_http_get_conditional(const char* url, const char* etag, int* status, size_t* len,
+                                 char* etag_out, size_t etag_out_len);    /* free with xoron_http_free */
+
+/* HTTP/2 transport for https (builds with XORON_HTTP2): one ALPN-negotiated connection per origin,
+ * concurrent requests from any thread multiplexed as streams. Returns 1 with a response, 0 when the
+ * request belongs on HTTP/1.1 (origin lacks h2, or the server refused the stream unprocessed), -1 on error */
+typedef std::vector<std::pair<std::string, std::string>> XoronHttpHeaders;
+struct XoronHttp2Response {
+    int status = 0;
+    XoronHttpHeaders headers;    /* lowercase names */
+    std::string body;
+};
+
+/* Streamed request body. Both transports read it on the calling thread, in order, so fill may call into Lua */
+struct XoronHttpBodySource {
+    int64_t length = -1;                            /* -1 when unknown: sent chunked over HTTP/1.1 */
+    uint64_t position = 0;                          /* bytes read so far */
+    std::function<long(char* buf, size_t cap)> fill;    /* bytes read, 0 at the end, -1 on error (set error) */
+    std::function<bool()> reset;                    /* optional; lets a redirect or HTTP/1.1 retry resend */
+    std::string error;
+    
+    long read(char* buf, size_t cap) {
+        long n = fill(buf, cap);
+        if (n > 0) position += (uint64_t)n;
+        return n;
+    }
+    bool rewind() {
+        if (position == 0) return true;
+        if (!reset || !reset()) return false;
+        position = 0;
+        return true;
+    }
+};
+
+/* Takes the body of a 2xx response as it arrives, instead of it being buffered; false aborts the request.
+ * It may run on a transport thread, so it must not call into Lua */
+typedef std::function<bool(int status, const char* data, size_t len)> XoronHttpBodySink;
+
+/* body/body_len, or a streamed source when source is set; with a sink, out.body holds only non-2xx bodies */
+int xoron_http2_request(const char* method, const std::string& host, int port, const std::string& path,
+                        const XoronHttpHeaders& headers, const char* body, size_t body_len,
+                        XoronHttpBodySource* source, const XoronHttpBodySink* sink,
+                        XoronHttp2Response& out, std::string& error);
+
+/* Scheduled GET whose 2xx body goes to sink (see http.request's Priority for background); response
+ * headers come back with lowercase names. False with error on transport failure */
+bool xoron_http_fetch(const std::string& url, const XoronHttpHeaders& headers, const XoronHttpBodySink& sink,
+                      bool background, const void* owner, int* status, XoronHttpHeaders* response_headers,
+                      std::string& error);
+
+/* Resolves a path the way the filesystem library does: relative to the workspace, "" if it escapes */
+std::string xoron_workspace_path(const char* path);
+
+/* Buffer userdata; binary APIs accept it wherever they take a string */
+bool xoron_isbuffer(lua_State* L, int idx);
+const char* xoron_tobytes(lua_State* L, int idx, size_t* len);       /* string or Buffer contents, else NULL */
+const char* xoron_checkbytes(lua_State* L, int idx, size_t* len);    /* luaL_checklstring that also takes a Buffer */
+char* xoron_pushbuffer(lua_State* L, size_t len);                    /* pushes a new Buffer, returns its bytes to fill */
+void xoron_pushbuffer_owned(lua_State* L, char* data, size_t len);   /* pushes a Buffer that takes over malloc'd data */
+
+/* String atoms for native object members; every VM installs xoron_useratom, so
+ * __namecall/__index handlers switch on lua_namecallatom/lua_tostringatom */
+#define XORON_ATOMS(X) \
+    /* WebSocket */ X(Send) X(Close) X(OnMessage) X(OnClose) \
+    /* Drawing */ X(Remove) X(Destroy) X(Visible) X(Color) X(Transparency) X(ZIndex) X(From) X(To) \
+    X(Position) X(Radius) X(Size) X(Text) X(TextBounds) X(TextSize) X(Center) X(Outline) \
+    X(OutlineColor) X(Filled) X(Thickness) X(PointA) X(PointB) X(PointC) X(PointD) X(Data) \
+    X(Rounding) X(Font) X(Points) X(PointCount) X(Closed) X(LineJoin) X(SetPoints) \
+    X(Shape) X(InstanceCount) X(SetInstances) X(SetPositions) X(SetColors) X(SetSizes) \
+    X(Layer) X(Static) X(Invalidate) \
+    /* Actor */ X(send) X(receive) X(onmessage) X(onerror) X(terminate) X(id) \
+    /* KVStore */ X(get) X(has) X(set) X(delete) X(batch) X(scan) X(count) X(compact) X(flush) X(close) \
+    /* Buffer */ X(len) X(tostring) X(readstring) X(writestring) X(append) X(slice) X(clone) X(resize) \
+    X(clear) X(fill) X(readu8) X(readi8) X(readu16) X(readi16) X(readu32) X(readi32) X(readf32) \
+    X(readf64) X(writeu8) X(writei8) X(writeu16) X(writei16) X(writeu32) X(writei32) X(writef32) \
+    X(writef64)
+
+enum XoronAtom {
+#define XORON_ATOM_ENUM(name) XORON_ATOM_##name,
+    XORON_ATOMS(XORON_ATOM_ENUM)
+#undef XORON_ATOM_ENUM
+    XORON_ATOM_COUNT
+};
+
+short xoron_useratom(const char* s, size_t len);    /* lua_Callbacks::useratom; -1 for other strings */
+
+/* Message channel internals; a retained channel outlives its VM safely */
+struct XoronChannel;
+typedef void (*XoronChannelHandler)(lua_State* L, const xoron_message_t* msg);
+XoronChannel* xoron_channel_create(void);
+void xoron_channel_attach(XoronChannel* ch, xoron_vm_t* vm, lua_State* L);
+void xoron_channel_close(XoronChannel* ch);
+XoronChannel* xoron_channel_of(lua_State* L);
+XoronChannel* xoron_vm_channel(xoron_vm_t* vm);
+lua_State* xoron_vm_state(xoron_vm_t* vm);     /* only from the thread that runs the VM */
+void xoron_channel_retain(XoronChannel* ch);
+void xoron_channel_release(XoronChannel* ch);
+int xoron_channel_send(XoronChannel* ch, const xoron_message_t* msg);
+/* Blocks until the VM thread handled msg; msg->data is borrowed, never call from the VM thread */
+int xoron_channel_call(XoronChannel* ch, const xoron_message_t* msg, char* error, size_t error_len);
+int xoron_channel_drain_replies(XoronChannel* ch, xoron_message_fn fn, void* ud, int max);
+void xoron_channel_listen(XoronChannel* ch, xoron_notify_fn on_post, xoron_notify_fn on_reply, void* ud);
+void xoron_channel_wake(XoronChannel* ch);
+int xoron_channel_pending(XoronChannel* ch);
+int xoron_channel_await(XoronChannel* ch, int timeout_ms);              /* xoron_channel_wait for a channel */
+int xoron_channel_dispatch(XoronChannel* ch, lua_State* L, int max);    /* handles messages on L; -1 while already pumping */
+void xoron_channel_handle(const char* name, XoronChannelHandler fn);  /* native handler by topic or type name */
+
+/* Records the lifetime of the scope into a histogram metric */
+struct XoronMetricTimer {
+    int id;
+    uint64_t start;
+    explicit XoronMetricTimer(int metric) : id(metric), start(xoron_metric_now_us()) {}
+    ~XoronMetricTimer() { xoron_metric_observe(id, xoron_metric_now_us() - start); }
+};
+
+/* Records the scope as a startup phase while the startup trace is open */
+struct XoronStartupPhase {
+    int id;
+    explicit XoronStartupPhase(const char* name) : id(xoron_startup_begin(name)) {}
+    ~XoronStartupPhase() { xoron_startup_end(id); }
+};
 
 /* Platform-specific registration (iOS only) */
 #if defined(XORON_PLATFORM_IOS) || (defined(__APPLE__) && defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE)
@@ -257,8 +492,6 @@ void xoron_ios_ui_hide(void);
 void xoron_ios_ui_toggle(void);
 void xoron_ios_haptic_feedback(int style);
 void xoron_ios_console_print(const char* message, int type);
-void xoron_ios_set_lua_state(lua_State* L);
-lua_State* xoron_get_lua_state(void);
 #ifdef __cplusplus
 }
 #endif
@@ -285,8 +518,6 @@ void xoron_android_ui_show(void);
 void xoron_android_ui_hide(void);
 void xoron_android_ui_toggle(void);
 void xoron_android_console_print(const char* message, int type);
-void xoron_android_set_lua_state(lua_State* L);
-lua_State* xoron_android_get_lua_state(void);
 
 /* Android initialization */
 void xoron_register_android(lua_State* L);
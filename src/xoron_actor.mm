@@ -0,0 +1,596 @@
+/*
+ * xoron_actor.cpp - Parallel actors on worker VMs
+ * Provides: actor.spawn, Actor:send/receive/onmessage/onerror/terminate, actor.onmessage/post inside actors
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Each actor is its own xoron_vm_t and lua_State. Its mailbox is that VM's
+ * lock-free channel inbox: a send copies the value as MessagePack, pushes
+ * it, and schedules the actor on a shared pool of worker threads. A pool
+ * thread pumps a batch of messages and moves on, so one VM never runs on two
+ * threads at once while many actors use many cores. Results go back through
+ * the spawning VM's channel and are delivered at its safe points
+ * (xoron_run, channel.pump, Actor:receive).
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+
+#include "lua.h"
+#include "lualib.h"
+
+#define ACTOR_MT "XoronActor"
+#define ACTOR_BATCH 32          // messages per turn before the thread moves to another actor
+#define ACTOR_MAX_THREADS 8
+
+static const char* ACTOR_SELF_KEY = "xoron.actor.self";         // Actor* inside a worker VM
+static const char* ACTOR_HANDLER_KEY = "xoron.actor.handler";   // actor.onmessage function
+static const char* ACTOR_HANDLES_KEY = "xoron.actor.handles";   // id -> Actor handle, weak values
+static const char* ACTOR_STATE_KEY = "xoron.actor.state";       // handle -> {message, error, queue}, weak keys
+
+// Metrics
+static const int g_m_actor_spawned = xoron_metric_counter("actor.spawned");
+static const int g_m_actor_active = xoron_metric_gauge("actor.active");
+static const int g_m_actor_messages = xoron_metric_counter("actor.messages");
+static const int g_m_actor_errors = xoron_metric_counter("actor.errors");
+
+struct Actor {
+    std::atomic<int> refs{1};
+    int64_t id = 0;
+    xoron_vm_t* vm = nullptr;           // only touched by the thread that set `scheduled`
+    XoronChannel* inbox = nullptr;      // the worker VM's channel, retained
+    XoronChannel* parent = nullptr;     // the spawning VM's channel, retained
+    std::atomic<bool> scheduled{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> stopped{false};
+};
+
+struct ActorPool {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Actor*> ready;
+};
+
+// Never destroyed: detached pool threads may still be parked on it at exit
+static ActorPool* g_pool = nullptr;
+static std::once_flag g_pool_once;
+static std::atomic<int64_t> g_next_actor_id{0};
+
+// Worker VMs find their Actor by channel, so a forged init message can't name one
+static std::mutex g_actors_mutex;
+static std::unordered_map<XoronChannel*, Actor*> g_actors_by_inbox;
+
+static void actor_release(Actor* a) {
+    if (a->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    {
+        std::lock_guard<std::mutex> lock(g_actors_mutex);
+        g_actors_by_inbox.erase(a->inbox);
+    }
+    xoron_channel_listen(a->inbox, nullptr, nullptr, nullptr);
+    if (a->vm) {
+        xoron_vm_free(a->vm);
+        xoron_metric_adjust(g_m_actor_active, -1);
+    }
+    xoron_channel_release(a->inbox);
+    xoron_channel_release(a->parent);
+    delete a;
+}
+
+static void actor_schedule(Actor* a) {
+    if (a->scheduled.exchange(true, std::memory_order_acq_rel)) return;
+    a->refs.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(g_pool->mutex);
+        g_pool->ready.push_back(a);
+    }
+    g_pool->cv.notify_one();
+}
+
+// Channel on_post hook for an actor's inbox
+static void actor_notify(void* ud) {
+    actor_schedule((Actor*)ud);
+}
+
+static void actor_stop(Actor* a) {
+    a->stopping.store(true, std::memory_order_release);
+    actor_schedule(a);
+}
+
+static void actor_thread_main(void) {
+    for (;;) {
+        Actor* a;
+        {
+            std::unique_lock<std::mutex> lock(g_pool->mutex);
+            g_pool->cv.wait(lock, [] { return !g_pool->ready.empty(); });
+            a = g_pool->ready.front();
+            g_pool->ready.pop_front();
+        }
+        
+        if (a->stopping.load(std::memory_order_acquire)) {
+            if (a->vm) {
+                xoron_vm_free(a->vm);
+                a->vm = nullptr;
+                a->stopped.store(true, std::memory_order_release);
+                xoron_metric_adjust(g_m_actor_active, -1);
+            }
+        } else {
+            xoron_channel_pump(a->vm, ACTOR_BATCH);
+        }
+        
+        a->scheduled.store(false, std::memory_order_release);
+        // A post that raced with the pump saw `scheduled` still set and left the actor to us
+        if (!a->stopped.load(std::memory_order_acquire) &&
+            (a->stopping.load(std::memory_order_acquire) || xoron_channel_pending(a->inbox) > 0)) {
+            actor_schedule(a);
+        }
+        actor_release(a);
+    }
+}
+
+static void post_to_parent(Actor* a, const char* topic, const char* data, size_t len) {
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_USER;
+    msg.arg = a->id;
+    msg.topic = topic;
+    msg.data = data;
+    msg.data_len = len;
+    if (xoron_channel_send(a->parent, &msg) != XORON_OK) {
+        XORON_LOG("actor %lld: dropped %s: %s", (long long)a->id, topic, xoron_last_error());
+    }
+}
+
+static void post_error(Actor* a, const char* error) {
+    xoron_metric_inc(g_m_actor_errors, 1);
+    post_to_parent(a, "actor.error", error, strlen(error));
+}
+
+// Packs the value at idx and posts it to the parent as a result; false if it can't be packed
+static bool post_value(lua_State* L, Actor* a, int idx) {
+    size_t len;
+    char* packed = xoron_serialize_pack(L, idx, &len);
+    if (!packed) return false;
+    post_to_parent(a, "actor.result", packed, len);
+    xoron_free(packed);
+    return true;
+}
+
+static Actor* self_actor(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_SELF_KEY);
+    Actor* a = (Actor*)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return a;
+}
+
+// ==================== Worker side ====================
+
+// First message in every actor: data is the compiled source
+static void on_actor_init(lua_State* L, const xoron_message_t* msg) {
+    Actor* a = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_actors_mutex);
+        auto it = g_actors_by_inbox.find(xoron_channel_of(L));
+        if (it != g_actors_by_inbox.end()) a = it->second;
+    }
+    if (!a || self_actor(L)) return;
+    lua_pushlightuserdata(L, a);
+    lua_setfield(L, LUA_REGISTRYINDEX, ACTOR_SELF_KEY);
+    
+    if (xoron_load_script(L, "actor", msg->data, msg->data_len) != 0 || lua_pcall(L, 0, 0, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        post_error(a, err ? err : "unknown");
+        lua_pop(L, 1);
+    }
+}
+
+// Runs the actor's handler on a copied message; a non-nil result goes back to the parent
+static void on_actor_message(lua_State* L, const xoron_message_t* msg) {
+    Actor* a = self_actor(L);
+    if (!a) return;
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_HANDLER_KEY);
+    if (!lua_isfunction(L, -1)) {
+        lua_pop(L, 1);
+        post_error(a, "Actor has no message handler; call actor.onmessage");
+        return;
+    }
+    if (xoron_serialize_unpack(L, msg->data, msg->data_len) != XORON_OK) {
+        lua_pop(L, 1);
+        post_error(a, xoron_last_error());
+        return;
+    }
+    if (lua_pcall(L, 1, 1, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        post_error(a, err ? err : "unknown");
+        lua_pop(L, 1);
+        return;
+    }
+    if (!lua_isnil(L, -1) && !post_value(L, a, -1)) post_error(a, xoron_last_error());
+    lua_pop(L, 1);
+}
+
+// actor.onmessage(handler) - Inside an actor: handler(value) runs for each message, its result is sent back
+static int lua_actor_onmessage(lua_State* L) {
+    if (!self_actor(L)) luaL_error(L, "actor.onmessage is only available inside an actor");
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    lua_pushvalue(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, ACTOR_HANDLER_KEY);
+    return 0;
+}
+
+// actor.post(value) - Inside an actor: sends a value to the spawning VM
+static int lua_actor_post(lua_State* L) {
+    Actor* a = self_actor(L);
+    if (!a) luaL_error(L, "actor.post is only available inside an actor");
+    luaL_checkany(L, 1);
+    if (!post_value(L, a, 1)) luaL_error(L, "%s", xoron_last_error());
+    return 0;
+}
+
+// ==================== Parent side ====================
+
+static Actor* check_actor(lua_State* L) {
+    Actor** ud = (Actor**)luaL_checkudata(L, 1, ACTOR_MT);
+    return *ud;
+}
+
+// Pushes the state table of the handle at idx, creating it if needed
+static void push_state(lua_State* L, int idx) {
+    idx = lua_absindex(L, idx);
+    lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_STATE_KEY);
+    lua_pushvalue(L, idx);
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, 4);
+        lua_pushvalue(L, idx);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -4);
+    }
+    lua_remove(L, -2);
+}
+
+// Pushes the state table of the actor with this id; false if its handle was collected
+static bool push_state_by_id(lua_State* L, int64_t id) {
+    lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_HANDLES_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_pushnumber(L, (double)id);
+    lua_rawget(L, -2);
+    lua_remove(L, -2);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    push_state(L, -1);
+    lua_remove(L, -2);
+    return true;
+}
+
+static void create_weak_table(lua_State* L, const char* key, const char* mode) {
+    lua_newtable(L);
+    lua_createtable(L, 0, 1);
+    lua_pushstring(L, mode);
+    lua_setfield(L, -2, "__mode");
+    lua_setmetatable(L, -2);
+    lua_setfield(L, LUA_REGISTRYINDEX, key);
+}
+
+// Calls state[field](value) if set, else returns false leaving the stack as it was
+static bool call_callback(lua_State* L, int state, const char* field, int value) {
+    lua_getfield(L, state, field);
+    if (!lua_isfunction(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_pushvalue(L, value);
+    if (lua_pcall(L, 1, 0, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        XORON_LOG("actor %s callback failed: %s", field, err ? err : "unknown");
+        lua_pop(L, 1);
+    }
+    return true;
+}
+
+static void on_actor_result(lua_State* L, const xoron_message_t* msg) {
+    if (!push_state_by_id(L, msg->arg)) return;
+    int state = lua_gettop(L);
+    if (xoron_serialize_unpack(L, msg->data, msg->data_len) != XORON_OK) {
+        XORON_LOG("actor %lld: bad result: %s", (long long)msg->arg, xoron_last_error());
+        lua_pop(L, 1);
+        return;
+    }
+    
+    // Without onmessage the value waits for Actor:receive
+    if (!call_callback(L, state, "message", state + 1)) {
+        lua_getfield(L, state, "queue");
+        if (!lua_istable(L, -1)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, state, "queue");
+        }
+        lua_getfield(L, state, "tail");
+        int tail = (int)lua_tointeger(L, -1) + 1;
+        lua_pop(L, 1);
+        lua_pushvalue(L, state + 1);
+        lua_rawseti(L, -2, tail);
+        lua_pushinteger(L, tail);
+        lua_setfield(L, state, "tail");
+        lua_pop(L, 1);
+    }
+    lua_settop(L, state - 1);
+}
+
+static void on_actor_error(lua_State* L, const xoron_message_t* msg) {
+    if (!push_state_by_id(L, msg->arg)) return;
+    int state = lua_gettop(L);
+    lua_pushlstring(L, msg->data, msg->data_len);
+    if (!call_callback(L, state, "error", state + 1)) {
+        XORON_LOG("actor %lld: %s", (long long)msg->arg, lua_tostring(L, -1));
+    }
+    lua_settop(L, state - 1);
+}
+
+// Pops the oldest queued result of the handle at 1 onto the stack
+static bool pop_result(lua_State* L) {
+    push_state(L, 1);
+    int state = lua_gettop(L);
+    lua_getfield(L, state, "head");
+    lua_getfield(L, state, "tail");
+    int head = (int)lua_tointeger(L, -2);
+    int tail = (int)lua_tointeger(L, -1);
+    lua_pop(L, 2);
+    if (head >= tail) {
+        lua_pop(L, 1);
+        return false;
+    }
+    
+    lua_getfield(L, state, "queue");
+    lua_rawgeti(L, -1, head + 1);
+    lua_pushnil(L);
+    lua_rawseti(L, -3, head + 1);
+    lua_pushinteger(L, head + 1);
+    lua_setfield(L, state, "head");
+    lua_replace(L, state);
+    lua_settop(L, state);
+    return true;
+}
+
+static void actor_init_runtime(void) {
+    g_pool = new ActorPool();
+    unsigned cores = std::thread::hardware_concurrency();
+    int threads = std::max(1, std::min((int)cores - 1, ACTOR_MAX_THREADS));
+    for (int i = 0; i < threads; i++) {
+        std::thread(actor_thread_main).detach();
+    }
+    
+    xoron_channel_handle("actor.init", on_actor_init);
+    xoron_channel_handle("actor.message", on_actor_message);
+    xoron_channel_handle("actor.result", on_actor_result);
+    xoron_channel_handle("actor.error", on_actor_error);
+}
+
+static void actor_dtor(void* ud) {
+    Actor* a = *(Actor**)ud;
+    if (!a) return;
+    if (!a->stopping.load(std::memory_order_acquire)) actor_stop(a);
+    actor_release(a);
+}
+
+// actor.spawn(source, name) - Runs source on a new worker VM; source calls actor.onmessage to receive messages
+static int lua_actor_spawn(lua_State* L) {
+    size_t len;
+    const char* source = luaL_checklstring(L, 1, &len);
+    const char* name = luaL_optstring(L, 2, "actor");
+    XoronChannel* parent = xoron_channel_of(L);
+    if (!parent) luaL_error(L, "No message channel for this VM");
+    
+    std::call_once(g_pool_once, actor_init_runtime);
+    
+    // Compiled here so a failed spawn doesn't cost a VM
+    xoron_bytecode_t* bc = xoron_compile(source, len, name);
+    xoron_vm_t* vm = bc ? xoron_vm_new() : nullptr;
+    if (!vm) {
+        xoron_bytecode_free(bc);
+        lua_pushnil(L);
+        lua_pushstring(L, xoron_last_error());
+        return 2;
+    }
+    
+    Actor* a = new Actor();
+    a->id = ++g_next_actor_id;
+    a->vm = vm;
+    a->inbox = xoron_vm_channel(vm);
+    a->parent = parent;
+    xoron_channel_retain(a->inbox);
+    xoron_channel_retain(a->parent);
+    xoron_channel_listen(a->inbox, actor_notify, nullptr, a);
+    {
+        std::lock_guard<std::mutex> lock(g_actors_mutex);
+        g_actors_by_inbox[a->inbox] = a;
+    }
+    xoron_metric_inc(g_m_actor_spawned, 1);
+    xoron_metric_adjust(g_m_actor_active, 1);
+    
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_USER;
+    msg.topic = "actor.init";
+    msg.data = xoron_bytecode_data(bc, &msg.data_len);
+    xoron_channel_send(a->inbox, &msg);
+    xoron_bytecode_free(bc);
+    
+    Actor** ud = (Actor**)lua_newuserdatadtor(L, sizeof(Actor*), actor_dtor);
+    *ud = a;
+    luaL_getmetatable(L, ACTOR_MT);
+    lua_setmetatable(L, -2);
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_HANDLES_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        create_weak_table(L, ACTOR_HANDLES_KEY, "v");
+        create_weak_table(L, ACTOR_STATE_KEY, "k");
+        lua_getfield(L, LUA_REGISTRYINDEX, ACTOR_HANDLES_KEY);
+    }
+    lua_pushnumber(L, (double)a->id);
+    lua_pushvalue(L, -3);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+    return 1;
+}
+
+// Actor:send(value) - Copies value into the actor's mailbox; nil and an error if it's full or stopped
+static int actor_send(lua_State* L) {
+    Actor* a = check_actor(L);
+    luaL_checkany(L, 2);
+    if (a->stopping.load(std::memory_order_acquire)) {
+        lua_pushnil(L);
+        lua_pushstring(L, "Actor is terminated");
+        return 2;
+    }
+    
+    size_t len;
+    char* packed = xoron_serialize_pack(L, 2, &len);
+    if (!packed) luaL_error(L, "%s", xoron_last_error());
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_USER;
+    msg.topic = "actor.message";
+    msg.data = packed;
+    msg.data_len = len;
+    int result = xoron_channel_send(a->inbox, &msg);
+    xoron_free(packed);
+    
+    if (result != XORON_OK) {
+        lua_pushnil(L);
+        lua_pushstring(L, xoron_last_error());
+        return 2;
+    }
+    xoron_metric_inc(g_m_actor_messages, 1);
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Actor:receive(timeout_ms) - Waits for the next result not taken by onmessage; nil on timeout (-1 waits forever)
+static int actor_receive(lua_State* L) {
+    check_actor(L);
+    int timeout = luaL_optinteger(L, 2, -1);
+    XoronChannel* ch = xoron_channel_of(L);
+    if (!ch) luaL_error(L, "No message channel for this VM");
+    
+    uint64_t deadline = xoron_metric_now_us() + (uint64_t)std::max(timeout, 0) * 1000;
+    for (;;) {
+        if (pop_result(L)) return 1;
+        int handled = xoron_channel_dispatch(ch, L, 0);
+        if (handled < 0) luaL_error(L, "Actor:receive can't wait inside a channel handler");
+        if (handled > 0) continue;
+        
+        int remaining = -1;
+        if (timeout >= 0) {
+            uint64_t now = xoron_metric_now_us();
+            if (now >= deadline) break;
+            remaining = (int)((deadline - now + 999) / 1000);
+        }
+        xoron_channel_await(ch, remaining);
+    }
+    lua_pushnil(L);
+    return 1;
+}
+
+// Actor:onmessage(fn) - Calls fn(value) on this VM for each result; nil goes back to receive
+static int actor_onmessage(lua_State* L) {
+    check_actor(L);
+    if (!lua_isnoneornil(L, 2)) luaL_checktype(L, 2, LUA_TFUNCTION);
+    push_state(L, 1);
+    lua_pushvalue(L, 2);
+    lua_setfield(L, -2, "message");
+    return 0;
+}
+
+// Actor:onerror(fn) - Calls fn(message) for errors raised inside the actor; they are logged otherwise
+static int actor_onerror(lua_State* L) {
+    check_actor(L);
+    if (!lua_isnoneornil(L, 2)) luaL_checktype(L, 2, LUA_TFUNCTION);
+    push_state(L, 1);
+    lua_pushvalue(L, 2);
+    lua_setfield(L, -2, "error");
+    return 0;
+}
+
+// Actor:terminate() - Stops the actor; queued messages are dropped
+static int actor_terminate(lua_State* L) {
+    Actor* a = check_actor(L);
+    if (!a->stopping.load(std::memory_order_acquire)) actor_stop(a);
+    return 0;
+}
+
+// Actor:id() - Process-unique actor id
+static int actor_id(lua_State* L) {
+    lua_pushnumber(L, (double)check_actor(L)->id);
+    return 1;
+}
+
+// __namecall - actor:method(...) dispatched on the method name's atom
+static int actor_namecall(lua_State* L) {
+    int atom = -1;
+    const char* name = lua_namecallatom(L, &atom);
+    switch (atom) {
+    case XORON_ATOM_send: return actor_send(L);
+    case XORON_ATOM_receive: return actor_receive(L);
+    case XORON_ATOM_onmessage: return actor_onmessage(L);
+    case XORON_ATOM_onerror: return actor_onerror(L);
+    case XORON_ATOM_terminate: return actor_terminate(L);
+    case XORON_ATOM_id: return actor_id(L);
+    }
+    luaL_error(L, "%s is not a valid member of Actor", name ? name : "?");
+    return 0;
+}
+
+void xoron_register_actor(lua_State* L) {
+    static const struct {
+        const char* name;
+        lua_CFunction fn;
+    } methods[] = {
+        {"send", actor_send},
+        {"receive", actor_receive},
+        {"onmessage", actor_onmessage},
+        {"onerror", actor_onerror},
+        {"terminate", actor_terminate},
+        {"id", actor_id},
+    };
+    
+    luaL_newmetatable(L, ACTOR_MT);
+    lua_pushstring(L, "Actor");
+    lua_setfield(L, -2, "__type");
+    lua_createtable(L, 0, (int)(sizeof(methods) / sizeof(methods[0])));
+    for (const auto& m : methods) {
+        lua_pushcfunction(L, m.fn, m.name);
+        lua_setfield(L, -2, m.name);
+    }
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, actor_namecall, "__namecall");
+    lua_setfield(L, -2, "__namecall");
+    lua_pop(L, 1);
+    
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_actor_spawn, "spawn");
+    lua_setfield(L, -2, "spawn");
+    
+    lua_pushcfunction(L, lua_actor_onmessage, "onmessage");
+    lua_setfield(L, -2, "onmessage");
+    
+    lua_pushcfunction(L, lua_actor_post, "post");
+    lua_setfield(L, -2, "post");
+    
+    lua_setglobal(L, "actor");
+}
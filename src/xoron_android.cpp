@@ -27,7 +27,7 @@
 static JavaVM* g_jvm = nullptr;
 static jobject g_activity = nullptr;
 static jobject g_vibrator = nullptr;
-static lua_State* g_lua_state = nullptr;
+static XoronChannel* g_channel = nullptr;     // default VM's channel; Java threads never touch lua_State
 static bool g_ui_visible = false;
 static std::mutex g_ui_mutex;
 
@@ -217,19 +217,38 @@ void xoron_android_console_print(const char* message, int type) {
     }
 }
 
-void xoron_android_set_lua_state(lua_State* L) {
-    g_lua_state = L;
+// channel.post events and replies; runs on the JVM-attached VM thread
+static void android_handle_reply(const xoron_message_t* msg, void* ud) {
+    (void)ud;
+    std::string text;
+    if (msg->type == XORON_MSG_REPLY) {
+        if (msg->arg == XORON_OK) return;
+        text = "Error: ";
+    } else {
+        text = std::string("[") + msg->topic + "] ";
+    }
+    text.append(msg->data, msg->data_len);
+    xoron_android_console_print(text.c_str(), msg->type == XORON_MSG_REPLY ? XORON_MESSAGE_ERROR : XORON_MESSAGE_INFO);
 }
 
-lua_State* xoron_android_get_lua_state(void) {
-    return g_lua_state;
+static void android_reply_notify(void* ud) {
+    xoron_channel_drain_replies((XoronChannel*)ud, android_handle_reply, nullptr, 0);
 }
 
 // ============================================================================
 // Lua Registration
 // ============================================================================
 void xoron_register_android(lua_State* L) {
-    g_lua_state = L;
+    // The first VM is the default one JNI_OnLoad pumps; actor and worker VMs keep their own channels
+    XoronChannel* ch = xoron_channel_of(L);
+    {
+        std::lock_guard<std::mutex> lock(g_ui_mutex);
+        if (!g_channel) {
+            xoron_channel_retain(ch);
+            g_channel = ch;
+            xoron_channel_listen(ch, nullptr, android_reply_notify, ch);
+        }
+    }
     
     // Register Android-specific Lua functions
     lua_newtable(L);
@@ -305,6 +324,21 @@ Java_com_xoron_Executor_nativeHandleInput(JNIEnv* env, jobject obj, jobject inpu
     return 0;
 }
 
+// Touch from the Java UI thread; phase is 0 down, 1 move, 2 up
+JNIEXPORT jint JNICALL
+Java_com_xoron_Executor_nativeTouch(JNIEnv* env, jobject obj, jfloat x, jfloat y, jint phase) {
+    (void)env; (void)obj;
+    std::lock_guard<std::mutex> lock(g_ui_mutex);
+    if (!g_channel) return XORON_ERR_INIT;
+    
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_TOUCH;
+    msg.x = x;
+    msg.y = y;
+    msg.arg = phase;
+    return xoron_channel_send(g_channel, &msg);
+}
+
 // UI initialization (called from Java)
 JNIEXPORT void JNICALL
 Java_com_xoron_UI_init(JNIEnv* env, jobject obj, jobject activity, jobject vibrator) {
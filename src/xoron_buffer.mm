@@ -0,0 +1,503 @@
+/*
+ * xoron_buffer.cpp - Mutable byte buffers shared by the binary APIs
+ * Provides: Buffer.new, Buffer.fromstring, Buffer.isbuffer, Buffer methods, xoron_*bytes/xoron_pushbuffer*
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * A Buffer owns growable malloc'd storage; slices are views into the same
+ * storage. crypt, lz4, readfile/writefile, http.request and WebSocket take a
+ * Buffer anywhere they take a string and hand one back when given one, so
+ * binary pipelines never intern intermediate Lua strings.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "lua.h"
+#include "lualib.h"
+
+#define BUFFER_MT "XoronBuffer"
+#define BUFFER_WHOLE SIZE_MAX   // view length of an owning buffer: tracks the storage size
+
+// Metrics
+static const int g_m_buffer_bytes = xoron_metric_gauge("buffer.bytes");
+
+// Storage shared by a Buffer and its slices
+struct BufferStorage {
+    int refs;
+    uint8_t* data;
+    size_t size;
+    size_t cap;
+};
+
+// Userdata payload
+struct XoronBuffer {
+    BufferStorage* store;
+    size_t offset;
+    size_t length;
+};
+
+static BufferStorage* storage_new(uint8_t* data, size_t size, size_t cap) {
+    BufferStorage* s = (BufferStorage*)malloc(sizeof(BufferStorage));
+    if (!s) return nullptr;
+    s->refs = 1;
+    s->data = data;
+    s->size = size;
+    s->cap = cap;
+    xoron_metric_adjust(g_m_buffer_bytes, (int64_t)cap);
+    return s;
+}
+
+static void storage_release(BufferStorage* s) {
+    if (!s || --s->refs > 0) return;
+    xoron_metric_adjust(g_m_buffer_bytes, -(int64_t)s->cap);
+    free(s->data);
+    free(s);
+}
+
+static bool storage_reserve(BufferStorage* s, size_t cap) {
+    if (cap <= s->cap) return true;
+    size_t grown = s->cap < 16 ? 16 : s->cap;
+    while (grown < cap) grown = grown > SIZE_MAX / 2 ? cap : grown * 2;
+    uint8_t* data = (uint8_t*)realloc(s->data, grown);
+    if (!data) return false;
+    xoron_metric_adjust(g_m_buffer_bytes, (int64_t)(grown - s->cap));
+    s->data = data;
+    s->cap = grown;
+    return true;
+}
+
+static void buffer_dtor(void* ud) {
+    storage_release(((XoronBuffer*)ud)->store);
+}
+
+// ==================== Userdata helpers ====================
+
+static void buffer_init_metatable(lua_State* L);
+
+// Pushes the Buffer metatable, creating it on first use so any library can make buffers
+static void push_buffer_metatable(lua_State* L) {
+    if (luaL_newmetatable(L, BUFFER_MT)) buffer_init_metatable(L);
+}
+
+static XoronBuffer* to_buffer(lua_State* L, int idx) {
+    if (lua_type(L, idx) != LUA_TUSERDATA || !lua_getmetatable(L, idx)) return nullptr;
+    luaL_getmetatable(L, BUFFER_MT);
+    bool match = lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+    return match ? (XoronBuffer*)lua_touserdata(L, idx) : nullptr;
+}
+
+static XoronBuffer* check_buffer(lua_State* L, int idx) {
+    return (XoronBuffer*)luaL_checkudata(L, idx, BUFFER_MT);
+}
+
+// Bytes currently visible through b; a slice past the end of shrunk storage is empty
+static uint8_t* buffer_bytes(XoronBuffer* b, size_t* len) {
+    BufferStorage* s = b->store;
+    if (b->length == BUFFER_WHOLE) {
+        *len = s->size;
+        return s->data;
+    }
+    size_t avail = b->offset < s->size ? s->size - b->offset : 0;
+    *len = b->length < avail ? b->length : avail;
+    return s->data + (b->offset < s->size ? b->offset : s->size);
+}
+
+static XoronBuffer* push_buffer(lua_State* L, BufferStorage* store, size_t offset, size_t length) {
+    XoronBuffer* b = (XoronBuffer*)lua_newuserdatadtor(L, sizeof(XoronBuffer), buffer_dtor);
+    b->store = store;
+    b->offset = offset;
+    b->length = length;
+    push_buffer_metatable(L);
+    lua_setmetatable(L, -2);
+    return b;
+}
+
+// Owning buffer of len bytes (uninitialized); raises on allocation failure
+static uint8_t* new_buffer(lua_State* L, size_t len) {
+    XoronBuffer* b = push_buffer(L, nullptr, 0, BUFFER_WHOLE);
+    size_t cap = len < 16 ? 16 : len;
+    uint8_t* data = (uint8_t*)malloc(cap);
+    b->store = data ? storage_new(data, len, cap) : nullptr;
+    if (!b->store) {
+        free(data);
+        luaL_error(L, "Out of memory");
+    }
+    return data;
+}
+
+// Resizes an owning buffer, zero-filling growth
+static void buffer_resize(lua_State* L, XoronBuffer* b, size_t len) {
+    if (b->length != BUFFER_WHOLE) luaL_error(L, "Cannot resize a slice");
+    BufferStorage* s = b->store;
+    if (!storage_reserve(s, len)) luaL_error(L, "Out of memory");
+    if (len > s->size) memset(s->data + s->size, 0, len - s->size);
+    s->size = len;
+}
+
+static size_t check_size(lua_State* L, int idx) {
+    double d = luaL_checknumber(L, idx);
+    if (d < 0 || d != std::floor(d) || d > 9007199254740992.0) luaL_argerror(L, idx, "expected a non-negative integer");
+    return (size_t)d;
+}
+
+// Pointer to width bytes at the offset in argument idx; writes past the end grow owning buffers
+static uint8_t* buffer_span(lua_State* L, XoronBuffer* b, int idx, size_t width, bool write) {
+    size_t offset = check_size(L, idx);
+    size_t len;
+    uint8_t* p = buffer_bytes(b, &len);
+    if (offset + width > len) {
+        if (!write || b->length != BUFFER_WHOLE) {
+            luaL_error(L, "Offset %d out of range (length %d)", (int)offset, (int)len);
+        }
+        buffer_resize(L, b, offset + width);
+        p = buffer_bytes(b, &len);
+    }
+    return p + offset;
+}
+
+// ==================== Shared API ====================
+
+bool xoron_isbuffer(lua_State* L, int idx) {
+    return to_buffer(L, idx) != nullptr;
+}
+
+const char* xoron_tobytes(lua_State* L, int idx, size_t* len) {
+    if (lua_type(L, idx) == LUA_TSTRING) return lua_tolstring(L, idx, len);
+    XoronBuffer* b = to_buffer(L, idx);
+    if (!b) return nullptr;
+    return (const char*)buffer_bytes(b, len);
+}
+
+const char* xoron_checkbytes(lua_State* L, int idx, size_t* len) {
+    XoronBuffer* b = to_buffer(L, idx);
+    if (b) return (const char*)buffer_bytes(b, len);
+    return luaL_checklstring(L, idx, len);
+}
+
+char* xoron_pushbuffer(lua_State* L, size_t len) {
+    return (char*)new_buffer(L, len);
+}
+
+void xoron_pushbuffer_owned(lua_State* L, char* data, size_t len) {
+    XoronBuffer* b = push_buffer(L, nullptr, 0, BUFFER_WHOLE);
+    b->store = storage_new((uint8_t*)data, len, len);
+    if (!b->store) {
+        free(data);
+        luaL_error(L, "Out of memory");
+    }
+}
+
+// ==================== Typed access ====================
+
+static uint64_t load_bytes(const uint8_t* p, size_t width, bool big_endian) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; i++) {
+        size_t shift = big_endian ? (width - 1 - i) * 8 : i * 8;
+        v |= (uint64_t)p[i] << shift;
+    }
+    return v;
+}
+
+static void store_bytes(uint8_t* p, uint64_t v, size_t width, bool big_endian) {
+    for (size_t i = 0; i < width; i++) {
+        size_t shift = big_endian ? (width - 1 - i) * 8 : i * 8;
+        p[i] = (uint8_t)(v >> shift);
+    }
+}
+
+// buffer:readT(offset, bigEndian) - Reads a number; little-endian unless bigEndian
+template <typename T>
+static int buffer_read(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    const uint8_t* p = buffer_span(L, b, 2, sizeof(T), false);
+    uint64_t bits = load_bytes(p, sizeof(T), lua_toboolean(L, 3));
+    T v;
+    if constexpr (std::is_floating_point<T>::value) {
+        typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type raw = bits;
+        memcpy(&v, &raw, sizeof(T));
+    } else {
+        v = (T)bits;
+    }
+    lua_pushnumber(L, (double)v);
+    return 1;
+}
+
+// buffer:writeT(offset, value, bigEndian) - Writes a number; integers wrap like Luau's buffer library
+template <typename T>
+static int buffer_write(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    double d = luaL_checknumber(L, 3);
+    uint8_t* p = buffer_span(L, b, 2, sizeof(T), true);
+    uint64_t bits = 0;
+    if constexpr (std::is_floating_point<T>::value) {
+        T v = (T)d;
+        typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type raw;
+        memcpy(&raw, &v, sizeof(T));
+        bits = raw;
+    } else if (std::fabs(d) < 9.2e18) {
+        bits = (uint64_t)(int64_t)d;
+    }
+    store_bytes(p, bits, sizeof(T), lua_toboolean(L, 4));
+    return 0;
+}
+
+// ==================== Lua bindings ====================
+
+// Buffer.new(size) - Creates a zero-filled buffer of size bytes
+static int lua_buffer_new(lua_State* L) {
+    size_t len = lua_isnoneornil(L, 1) ? 0 : check_size(L, 1);
+    uint8_t* data = new_buffer(L, len);
+    memset(data, 0, len);
+    return 1;
+}
+
+// Buffer.fromstring(data) - Creates a buffer holding a copy of a string or buffer
+static int lua_buffer_fromstring(lua_State* L) {
+    size_t len;
+    const char* src = xoron_checkbytes(L, 1, &len);
+    uint8_t* data = new_buffer(L, len);
+    memcpy(data, src, len);
+    return 1;
+}
+
+// Buffer.isbuffer(value) - Returns true for Buffer objects and slices
+static int lua_buffer_isbuffer(lua_State* L) {
+    lua_pushboolean(L, to_buffer(L, 1) != nullptr);
+    return 1;
+}
+
+// buffer:len() - Number of bytes
+static int buffer_len(lua_State* L) {
+    size_t len;
+    buffer_bytes(check_buffer(L, 1), &len);
+    lua_pushnumber(L, (double)len);
+    return 1;
+}
+
+// buffer:tostring() - Copies the contents into a string
+static int buffer_tostring(lua_State* L) {
+    size_t len;
+    uint8_t* p = buffer_bytes(check_buffer(L, 1), &len);
+    lua_pushlstring(L, (const char*)p, len);
+    return 1;
+}
+
+// __tostring - Short description, never the raw bytes
+static int buffer_describe(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    size_t len;
+    buffer_bytes(b, &len);
+    lua_pushfstring(L, "%s: %d bytes", b->length == BUFFER_WHOLE ? "Buffer" : "Buffer slice", (int)len);
+    return 1;
+}
+
+// buffer:readstring(offset, length) - Copies length bytes at offset into a string
+static int buffer_readstring(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    size_t count = check_size(L, 3);
+    const uint8_t* p = buffer_span(L, b, 2, count, false);
+    lua_pushlstring(L, (const char*)p, count);
+    return 1;
+}
+
+// buffer:writestring(offset, data) - Copies a string or buffer in at offset
+static int buffer_writestring(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    size_t len;
+    const char* src = xoron_checkbytes(L, 3, &len);
+    // src may live in this storage, which growing can move
+    if (to_buffer(L, 3) && to_buffer(L, 3)->store == b->store) {
+        lua_pushlstring(L, src, len);
+        src = lua_tostring(L, -1);
+    }
+    uint8_t* p = buffer_span(L, b, 2, len, true);
+    memmove(p, src, len);
+    return 0;
+}
+
+// buffer:append(data, ...) - Appends strings or buffers; returns the buffer
+static int buffer_append(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    if (b->length != BUFFER_WHOLE) luaL_error(L, "Cannot append to a slice");
+    int top = lua_gettop(L);
+    for (int i = 2; i <= top; i++) {
+        size_t len;
+        const char* src = xoron_checkbytes(L, i, &len);
+        BufferStorage* s = b->store;
+        size_t at = s->size;
+        if (to_buffer(L, i) && to_buffer(L, i)->store == s) {
+            // Appending a buffer to itself: the source moves when storage grows
+            size_t offset = (const uint8_t*)src - s->data;
+            if (!storage_reserve(s, at + len)) luaL_error(L, "Out of memory");
+            memmove(s->data + at, s->data + offset, len);
+        } else {
+            if (!storage_reserve(s, at + len)) luaL_error(L, "Out of memory");
+            memcpy(s->data + at, src, len);
+        }
+        s->size = at + len;
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+// buffer:slice(offset, length) - View sharing this buffer's memory
+static int buffer_slice(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    size_t len;
+    buffer_bytes(b, &len);
+    size_t offset = lua_isnoneornil(L, 2) ? 0 : check_size(L, 2);
+    if (offset > len) luaL_error(L, "Offset %d out of range (length %d)", (int)offset, (int)len);
+    size_t count = lua_isnoneornil(L, 3) ? len - offset : check_size(L, 3);
+    if (count > len - offset) luaL_error(L, "Slice exceeds buffer length %d", (int)len);
+    
+    size_t base = b->length == BUFFER_WHOLE ? 0 : b->offset;
+    b->store->refs++;
+    push_buffer(L, b->store, base + offset, count);
+    return 1;
+}
+
+// buffer:clone() - Owning copy of the visible bytes
+static int buffer_clone(lua_State* L) {
+    size_t len;
+    uint8_t* src = buffer_bytes(check_buffer(L, 1), &len);
+    uint8_t* data = new_buffer(L, len);
+    // new_buffer can't move src: the source buffer is still referenced from the stack
+    memcpy(data, src, len);
+    return 1;
+}
+
+// buffer:resize(length) - Grows (zero-filled) or truncates an owning buffer
+static int buffer_resize_method(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    buffer_resize(L, b, check_size(L, 2));
+    return 0;
+}
+
+// buffer:clear() - Empties an owning buffer, keeping its capacity
+static int buffer_clear(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    buffer_resize(L, b, 0);
+    return 0;
+}
+
+// buffer:fill(byte, offset, length) - Sets a range (default: everything) to byte
+static int buffer_fill(lua_State* L) {
+    XoronBuffer* b = check_buffer(L, 1);
+    int value = luaL_checkinteger(L, 2);
+    size_t len;
+    uint8_t* p = buffer_bytes(b, &len);
+    size_t offset = lua_isnoneornil(L, 3) ? 0 : check_size(L, 3);
+    size_t count = lua_isnoneornil(L, 4) ? (offset < len ? len - offset : 0) : check_size(L, 4);
+    if (offset + count > len) luaL_error(L, "Range exceeds buffer length %d", (int)len);
+    memset(p + offset, value & 0xFF, count);
+    return 0;
+}
+
+// __namecall - buf:method(...) dispatched on the method name's atom
+static int buffer_namecall(lua_State* L) {
+    int atom = -1;
+    const char* name = lua_namecallatom(L, &atom);
+    switch (atom) {
+    case XORON_ATOM_len: return buffer_len(L);
+    case XORON_ATOM_tostring: return buffer_tostring(L);
+    case XORON_ATOM_readstring: return buffer_readstring(L);
+    case XORON_ATOM_writestring: return buffer_writestring(L);
+    case XORON_ATOM_append: return buffer_append(L);
+    case XORON_ATOM_slice: return buffer_slice(L);
+    case XORON_ATOM_clone: return buffer_clone(L);
+    case XORON_ATOM_resize: return buffer_resize_method(L);
+    case XORON_ATOM_clear: return buffer_clear(L);
+    case XORON_ATOM_fill: return buffer_fill(L);
+    case XORON_ATOM_readu8: return buffer_read<uint8_t>(L);
+    case XORON_ATOM_readi8: return buffer_read<int8_t>(L);
+    case XORON_ATOM_readu16: return buffer_read<uint16_t>(L);
+    case XORON_ATOM_readi16: return buffer_read<int16_t>(L);
+    case XORON_ATOM_readu32: return buffer_read<uint32_t>(L);
+    case XORON_ATOM_readi32: return buffer_read<int32_t>(L);
+    case XORON_ATOM_readf32: return buffer_read<float>(L);
+    case XORON_ATOM_readf64: return buffer_read<double>(L);
+    case XORON_ATOM_writeu8: return buffer_write<uint8_t>(L);
+    case XORON_ATOM_writei8: return buffer_write<int8_t>(L);
+    case XORON_ATOM_writeu16: return buffer_write<uint16_t>(L);
+    case XORON_ATOM_writei16: return buffer_write<int16_t>(L);
+    case XORON_ATOM_writeu32: return buffer_write<uint32_t>(L);
+    case XORON_ATOM_writei32: return buffer_write<int32_t>(L);
+    case XORON_ATOM_writef32: return buffer_write<float>(L);
+    case XORON_ATOM_writef64: return buffer_write<double>(L);
+    }
+    luaL_error(L, "%s is not a valid member of Buffer", name ? name : "?");
+    return 0;
+}
+
+static void buffer_init_metatable(lua_State* L) {
+    static const struct {
+        const char* name;
+        lua_CFunction fn;
+    } methods[] = {
+        {"len", buffer_len},
+        {"tostring", buffer_tostring},
+        {"readstring", buffer_readstring},
+        {"writestring", buffer_writestring},
+        {"append", buffer_append},
+        {"slice", buffer_slice},
+        {"clone", buffer_clone},
+        {"resize", buffer_resize_method},
+        {"clear", buffer_clear},
+        {"fill", buffer_fill},
+        {"readu8", buffer_read<uint8_t>},
+        {"readi8", buffer_read<int8_t>},
+        {"readu16", buffer_read<uint16_t>},
+        {"readi16", buffer_read<int16_t>},
+        {"readu32", buffer_read<uint32_t>},
+        {"readi32", buffer_read<int32_t>},
+        {"readf32", buffer_read<float>},
+        {"readf64", buffer_read<double>},
+        {"writeu8", buffer_write<uint8_t>},
+        {"writei8", buffer_write<int8_t>},
+        {"writeu16", buffer_write<uint16_t>},
+        {"writei16", buffer_write<int16_t>},
+        {"writeu32", buffer_write<uint32_t>},
+        {"writei32", buffer_write<int32_t>},
+        {"writef32", buffer_write<float>},
+        {"writef64", buffer_write<double>},
+    };
+    
+    lua_pushcfunction(L, buffer_len, "__len");
+    lua_setfield(L, -2, "__len");
+    lua_pushcfunction(L, buffer_describe, "__tostring");
+    lua_setfield(L, -2, "__tostring");
+    lua_pushstring(L, "Buffer");
+    lua_setfield(L, -2, "__type");
+    
+    lua_createtable(L, 0, (int)(sizeof(methods) / sizeof(methods[0])));
+    for (const auto& m : methods) {
+        lua_pushcfunction(L, m.fn, m.name);
+        lua_setfield(L, -2, m.name);
+    }
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, buffer_namecall, "__namecall");
+    lua_setfield(L, -2, "__namecall");
+}
+
+void xoron_register_buffer(lua_State* L) {
+    push_buffer_metatable(L);
+    lua_pop(L, 1);
+    
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_buffer_new, "new");
+    lua_setfield(L, -2, "new");
+    
+    lua_pushcfunction(L, lua_buffer_fromstring, "fromstring");
+    lua_setfield(L, -2, "fromstring");
+    
+    lua_pushcfunction(L, lua_buffer_isbuffer, "isbuffer");
+    lua_setfield(L, -2, "isbuffer");
+    
+    lua_setglobal(L, "Buffer");
+}
@@ -1,7 +1,7 @@
 /*
  * xoron_cache.cpp - Cache library and instance functions for executor
  * Provides: cache.invalidate, cache.iscached, cache.replace
- * Also includes: decompile, saveinstance, gethiddenproperty, etc.
+ * Also includes: decompile, analyzebytecode, saveinstance, gethiddenproperty, etc.
  */
 
 #include "xoron.h"
@@ -12,6 +12,7 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <algorithm>
 #include <mutex>
 #include <sstream>
 #include <fstream>
@@ -20,6 +21,8 @@
 #include "lua.h"
 #include "lualib.h"
 #include "luacode.h"  // For luau_compile
+#include "Luau/Bytecode.h"  // LBC_VERSION_MIN/MAX, LuauOpcode
+#include "Luau/BytecodeUtils.h"  // Luau::getOpLength
 #include "Luau/Compiler.h"
 #include "Luau/BytecodeBuilder.h"
 
@@ -91,7 +94,7 @@ static int lua_cache_replace(lua_State* L) {
     return 0;
 }
 
-// Luau bytecode opcodes for disassembly
+// Luau bytecode opcode names for disassembly, indexed by LuauOpcode
 static const char* LUAU_OPCODES[] = {
     "NOP", "BREAK", "LOADNIL", "LOADB", "LOADN", "LOADK", "MOVE", "GETGLOBAL",
     "SETGLOBAL", "GETUPVAL", "SETUPVAL", "CLOSEUPVALS", "GETIMPORT", "GETTABLE",
@@ -107,6 +110,430 @@ static const char* LUAU_OPCODES[] = {
     "JUMPXEQKB", "JUMPXEQKN", "JUMPXEQKS", "IDIV", "IDIVK"
 };
 
+static const int LUAU_OPCODE_COUNT = (int)(sizeof(LUAU_OPCODES) / sizeof(LUAU_OPCODES[0]));
+static_assert(LUAU_OPCODE_COUNT == LOP__COUNT, "LUAU_OPCODES is out of date with Luau/Bytecode.h");
+
+// ============================================================================
+// Bytecode analyzer
+// Parses the Luau bytecode container (LBC_VERSION_MIN-MAX) and reports patterns that
+// are slow at runtime: globals that missed the import fast path, closures
+// allocated inside loops, tables created without size hints, and how many
+// calls are covered by FASTCALL builtins.
+// ============================================================================
+
+struct BytecodeFunctionStats {
+    std::string name;
+    int line = 0;
+    int params = 0;
+    int stack = 0;
+    int instructions = 0;
+    int getglobal = 0;
+    int setglobal = 0;
+    int imports = 0;
+    int closures = 0;
+    int closures_in_loops = 0;
+    int tables = 0;
+    int unsized_tables = 0;
+    int calls = 0;
+    int fastcalls = 0;
+    std::vector<std::string> globals;   // names hit by GETGLOBAL/SETGLOBAL
+    std::vector<int> opcodes;           // per-opcode instruction counts
+};
+
+struct BytecodeReport {
+    int version = 0;
+    std::vector<BytecodeFunctionStats> functions;
+};
+
+class BytecodeReader {
+public:
+    BytecodeReader(const uint8_t* data, size_t len) : p(data), end(data + len) {}
+    
+    bool ok() const { return !failed; }
+    
+    uint8_t byte() {
+        if (p >= end) { failed = true; return 0; }
+        return *p++;
+    }
+    
+    uint32_t varint() {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = byte();
+            result |= uint32_t(b & 127) << shift;
+            if (!(b & 128)) break;
+        }
+        return result;
+    }
+    
+    uint32_t u32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= uint32_t(byte()) << (i * 8);
+        return v;
+    }
+    
+    void skip(size_t n) {
+        if ((size_t)(end - p) < n) { failed = true; p = end; return; }
+        p += n;
+    }
+    
+    std::string bytes(size_t n) {
+        if ((size_t)(end - p) < n) { failed = true; p = end; return std::string(); }
+        std::string s((const char*)p, n);
+        p += n;
+        return s;
+    }
+    
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+    bool failed = false;
+};
+
+// Returns the jump offset of a branch instruction, or false if it doesn't branch
+static bool bytecode_jump_offset(int op, uint32_t insn, int& offset) {
+    switch (op) {
+        case LOP_JUMP: case LOP_JUMPBACK: case LOP_JUMPIF: case LOP_JUMPIFNOT:
+        case LOP_JUMPIFEQ: case LOP_JUMPIFLE: case LOP_JUMPIFLT:
+        case LOP_JUMPIFNOTEQ: case LOP_JUMPIFNOTLE: case LOP_JUMPIFNOTLT:
+        case LOP_FORNPREP: case LOP_FORNLOOP: case LOP_FORGLOOP:
+        case LOP_FORGPREP_INEXT: case LOP_FORGPREP_NEXT: case LOP_FORGPREP:
+        case LOP_JUMPXEQKNIL: case LOP_JUMPXEQKB: case LOP_JUMPXEQKN: case LOP_JUMPXEQKS:
+            offset = int32_t(insn) >> 16;
+            return true;
+        case LOP_JUMPX:
+            offset = int32_t(insn) >> 8;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool analyze_bytecode(const char* data, size_t len, BytecodeReport& report, std::string& error) {
+    BytecodeReader r((const uint8_t*)data, len);
+    
+    report.version = r.byte();
+    if (report.version == 0) {
+        error = len > 1 ? std::string(data + 1, len - 1) : "empty bytecode";
+        return false;
+    }
+    if (report.version < LBC_VERSION_MIN || report.version > LBC_VERSION_MAX) {
+        error = "unsupported bytecode version " + std::to_string(report.version);
+        return false;
+    }
+    if (report.version >= 4) r.byte();  // types version
+    
+    std::vector<std::string> strings(r.varint());
+    for (auto& s : strings) s = r.bytes(r.varint());
+    
+    uint32_t proto_count = r.varint();
+    if (!r.ok() || proto_count > len) {
+        error = "truncated bytecode";
+        return false;
+    }
+    
+    for (uint32_t pi = 0; pi < proto_count && r.ok(); pi++) {
+        BytecodeFunctionStats fn;
+        fn.opcodes.assign(LUAU_OPCODE_COUNT, 0);
+        
+        fn.stack = r.byte();
+        fn.params = r.byte();
+        r.byte();  // nups
+        r.byte();  // is_vararg
+        if (report.version >= 4) {
+            r.byte();  // flags
+            r.skip(r.varint());  // type info
+        }
+        
+        uint32_t sizecode = r.varint();
+        if (sizecode > len) { error = "truncated bytecode"; return false; }
+        std::vector<uint32_t> code(sizecode);
+        for (auto& insn : code) insn = r.u32();
+        
+        // Constants: only string constants matter here (global names)
+        uint32_t sizek = r.varint();
+        if (sizek > len) { error = "truncated bytecode"; return false; }
+        std::vector<int> kstring(sizek, -1);
+        for (uint32_t k = 0; k < sizek && r.ok(); k++) {
+            switch (r.byte()) {
+                case 0: break;                          // nil
+                case 1: r.byte(); break;                // boolean
+                case 2: r.skip(8); break;               // number
+                case 3: kstring[k] = (int)r.varint() - 1; break;  // string
+                case 4: r.u32(); break;                 // import
+                case 5: {                               // table shape
+                    uint32_t n = r.varint();
+                    for (uint32_t i = 0; i < n && r.ok(); i++) r.varint();
+                    break;
+                }
+                case 6: r.varint(); break;              // closure
+                case 7: r.skip(16); break;              // vector
+                default: error = "unknown constant type"; return false;
+            }
+        }
+        
+        uint32_t sizep = r.varint();
+        for (uint32_t i = 0; i < sizep && r.ok(); i++) r.varint();
+        
+        fn.line = (int)r.varint();
+        uint32_t debugname = r.varint();
+        if (debugname > 0 && debugname <= strings.size()) fn.name = strings[debugname - 1];
+        
+        if (r.byte()) {  // line info
+            uint8_t gaplog2 = r.byte();
+            size_t intervals = sizecode ? ((sizecode - 1) >> gaplog2) + 1 : 0;
+            r.skip(sizecode);
+            r.skip(intervals * 4);
+        }
+        if (r.byte()) {  // debug info
+            uint32_t locvars = r.varint();
+            for (uint32_t i = 0; i < locvars && r.ok(); i++) { r.varint(); r.varint(); r.varint(); r.byte(); }
+            uint32_t upvals = r.varint();
+            for (uint32_t i = 0; i < upvals && r.ok(); i++) r.varint();
+        }
+        if (!r.ok()) break;
+        
+        // Loop bodies are the ranges covered by backward branches
+        std::vector<int> loop_depth(sizecode + 1, 0);
+        for (uint32_t pc = 0; pc < sizecode; pc += Luau::getOpLength(LuauOpcode(code[pc] & 0xff))) {
+            int op = code[pc] & 0xff;
+            int offset;
+            if (bytecode_jump_offset(op, code[pc], offset) && offset < 0) {
+                int target = (int)pc + 1 + offset;
+                if (target >= 0) {
+                    loop_depth[target]++;
+                    loop_depth[pc + 1]--;
+                }
+            }
+        }
+        for (uint32_t pc = 1; pc < sizecode; pc++) loop_depth[pc] += loop_depth[pc - 1];
+        
+        for (uint32_t pc = 0; pc < sizecode; ) {
+            uint32_t insn = code[pc];
+            int op = insn & 0xff;
+            int oplen = Luau::getOpLength(LuauOpcode(op));
+            uint32_t aux = pc + 1 < sizecode ? code[pc + 1] : 0;
+            bool in_loop = loop_depth[pc] > 0;
+            
+            fn.instructions++;
+            if (op < LUAU_OPCODE_COUNT) fn.opcodes[op]++;
+            
+            switch (op) {
+                case LOP_GETGLOBAL:
+                case LOP_SETGLOBAL: {
+                    (op == LOP_GETGLOBAL ? fn.getglobal : fn.setglobal)++;
+                    int sid = aux < kstring.size() ? kstring[aux] : -1;
+                    if (sid >= 0 && sid < (int)strings.size()) {
+                        const std::string& g = strings[sid];
+                        if (std::find(fn.globals.begin(), fn.globals.end(), g) == fn.globals.end())
+                            fn.globals.push_back(g);
+                    }
+                    break;
+                }
+                case LOP_GETIMPORT: fn.imports++; break;
+                case LOP_NEWCLOSURE:
+                    fn.closures++;
+                    if (in_loop) fn.closures_in_loops++;
+                    break;
+                case LOP_NEWTABLE:
+                    fn.tables++;
+                    // B = encoded hash size, aux = array size
+                    if (((insn >> 16) & 0xff) == 0 && aux == 0) fn.unsized_tables++;
+                    break;
+                case LOP_CALL: fn.calls++; break;
+                case LOP_FASTCALL: case LOP_FASTCALL1: case LOP_FASTCALL2: case LOP_FASTCALL2K:
+                    fn.fastcalls++;
+                    break;
+            }
+            pc += oplen;
+        }
+        
+        report.functions.push_back(std::move(fn));
+    }
+    
+    if (!r.ok()) {
+        error = "truncated bytecode";
+        return false;
+    }
+    return true;
+}
+
+static void json_escape(std::string& out, const std::string& s) {
+    out += '"';
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += '"';
+}
+
+static std::string bytecode_report_json(const BytecodeReport& report) {
+    std::string out = "{\"version\":" + std::to_string(report.version) + ",\"functions\":[";
+    for (size_t i = 0; i < report.functions.size(); i++) {
+        const auto& fn = report.functions[i];
+        if (i) out += ',';
+        out += "{\"name\":";
+        json_escape(out, fn.name.empty() ? "<anonymous>" : fn.name);
+        out += ",\"line\":" + std::to_string(fn.line);
+        out += ",\"instructions\":" + std::to_string(fn.instructions);
+        out += ",\"getglobal\":" + std::to_string(fn.getglobal);
+        out += ",\"setglobal\":" + std::to_string(fn.setglobal);
+        out += ",\"imports\":" + std::to_string(fn.imports);
+        out += ",\"closures\":" + std::to_string(fn.closures);
+        out += ",\"closuresInLoops\":" + std::to_string(fn.closures_in_loops);
+        out += ",\"tables\":" + std::to_string(fn.tables);
+        out += ",\"unsizedTables\":" + std::to_string(fn.unsized_tables);
+        out += ",\"calls\":" + std::to_string(fn.calls);
+        out += ",\"fastcalls\":" + std::to_string(fn.fastcalls);
+        out += ",\"globals\":[";
+        for (size_t g = 0; g < fn.globals.size(); g++) {
+            if (g) out += ',';
+            json_escape(out, fn.globals[g]);
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out;
+}
+
+// analyzebytecode(source_or_bytecode) - Reports slow patterns in compiled code
+static int lua_analyzebytecode(lua_State* L) {
+    size_t len;
+    const char* input = luaL_checklstring(L, 1, &len);
+    
+    // Input is bytecode only if it starts with a version this Luau can load and
+    // the container parses; anything else, including text that happens to start
+    // with a control byte, is compiled as source
+    BytecodeReport report;
+    std::string error;
+    unsigned char version = len > 0 ? (unsigned char)input[0] : 0;
+    bool parsed = version >= LBC_VERSION_MIN && version <= LBC_VERSION_MAX &&
+                  analyze_bytecode(input, len, report, error);
+    if (!parsed) {
+        report = BytecodeReport();
+        std::string bytecode = Luau::compile(std::string(input, len));
+        if (!analyze_bytecode(bytecode.data(), bytecode.size(), report, error)) {
+            lua_pushnil(L);
+            lua_pushstring(L, error.c_str());
+            return 2;
+        }
+    }
+    
+    BytecodeFunctionStats totals;
+    totals.opcodes.assign(LUAU_OPCODE_COUNT, 0);
+    
+    lua_newtable(L);
+    lua_pushinteger(L, report.version);
+    lua_setfield(L, -2, "version");
+    
+    lua_createtable(L, (int)report.functions.size(), 0);
+    for (size_t i = 0; i < report.functions.size(); i++) {
+        const auto& fn = report.functions[i];
+        lua_createtable(L, 0, 16);
+        lua_pushstring(L, fn.name.empty() ? "<anonymous>" : fn.name.c_str()); lua_setfield(L, -2, "name");
+        lua_pushinteger(L, fn.line); lua_setfield(L, -2, "line");
+        lua_pushinteger(L, fn.params); lua_setfield(L, -2, "params");
+        lua_pushinteger(L, fn.stack); lua_setfield(L, -2, "stack");
+        lua_pushinteger(L, fn.instructions); lua_setfield(L, -2, "instructions");
+        lua_pushinteger(L, fn.getglobal); lua_setfield(L, -2, "getglobal");
+        lua_pushinteger(L, fn.setglobal); lua_setfield(L, -2, "setglobal");
+        lua_pushinteger(L, fn.imports); lua_setfield(L, -2, "imports");
+        lua_pushinteger(L, fn.closures); lua_setfield(L, -2, "closures");
+        lua_pushinteger(L, fn.closures_in_loops); lua_setfield(L, -2, "closuresInLoops");
+        lua_pushinteger(L, fn.tables); lua_setfield(L, -2, "tables");
+        lua_pushinteger(L, fn.unsized_tables); lua_setfield(L, -2, "unsizedTables");
+        lua_pushinteger(L, fn.calls); lua_setfield(L, -2, "calls");
+        lua_pushinteger(L, fn.fastcalls); lua_setfield(L, -2, "fastcalls");
+        
+        lua_createtable(L, (int)fn.globals.size(), 0);
+        for (size_t g = 0; g < fn.globals.size(); g++) {
+            lua_pushstring(L, fn.globals[g].c_str());
+            lua_rawseti(L, -2, (int)g + 1);
+        }
+        lua_setfield(L, -2, "globals");
+        
+        lua_newtable(L);
+        for (int op = 0; op < LUAU_OPCODE_COUNT; op++) {
+            if (!fn.opcodes[op]) continue;
+            lua_pushinteger(L, fn.opcodes[op]);
+            lua_setfield(L, -2, LUAU_OPCODES[op]);
+            totals.opcodes[op] += fn.opcodes[op];
+        }
+        lua_setfield(L, -2, "opcodes");
+        
+        lua_rawseti(L, -2, (int)i + 1);
+        
+        totals.instructions += fn.instructions;
+        totals.getglobal += fn.getglobal;
+        totals.setglobal += fn.setglobal;
+        totals.imports += fn.imports;
+        totals.closures += fn.closures;
+        totals.closures_in_loops += fn.closures_in_loops;
+        totals.tables += fn.tables;
+        totals.unsized_tables += fn.unsized_tables;
+        totals.calls += fn.calls;
+        totals.fastcalls += fn.fastcalls;
+    }
+    lua_setfield(L, -2, "functions");
+    
+    lua_createtable(L, 0, 11);
+    lua_pushinteger(L, totals.instructions); lua_setfield(L, -2, "instructions");
+    lua_pushinteger(L, totals.getglobal); lua_setfield(L, -2, "getglobal");
+    lua_pushinteger(L, totals.setglobal); lua_setfield(L, -2, "setglobal");
+    lua_pushinteger(L, totals.imports); lua_setfield(L, -2, "imports");
+    lua_pushinteger(L, totals.closures); lua_setfield(L, -2, "closures");
+    lua_pushinteger(L, totals.closures_in_loops); lua_setfield(L, -2, "closuresInLoops");
+    lua_pushinteger(L, totals.tables); lua_setfield(L, -2, "tables");
+    lua_pushinteger(L, totals.unsized_tables); lua_setfield(L, -2, "unsizedTables");
+    lua_pushinteger(L, totals.calls); lua_setfield(L, -2, "calls");
+    lua_pushinteger(L, totals.fastcalls); lua_setfield(L, -2, "fastcalls");
+    // Builtin calls that took the FASTCALL path, relative to all calls
+    int all_calls = totals.calls;
+    lua_pushnumber(L, all_calls ? (double)totals.fastcalls / all_calls : 0.0);
+    lua_setfield(L, -2, "fastcallCoverage");
+    lua_setfield(L, -2, "totals");
+    
+    return 1;
+}
+
+extern "C" char* xoron_bytecode_analyze(xoron_bytecode_t* bc) {
+    size_t len = 0;
+    const char* data = xoron_bytecode_data(bc, &len);
+    if (!data) {
+        xoron_set_error("Invalid bytecode");
+        return nullptr;
+    }
+    
+    BytecodeReport report;
+    std::string error;
+    if (!analyze_bytecode(data, len, report, error)) {
+        xoron_set_error("Bytecode analysis failed: %s", error.c_str());
+        return nullptr;
+    }
+    
+    std::string json = bytecode_report_json(report);
+    char* result = (char*)malloc(json.size() + 1);
+    if (!result) {
+        xoron_set_error("Failed to allocate report");
+        return nullptr;
+    }
+    memcpy(result, json.c_str(), json.size() + 1);
+    return result;
+}
+
 // decompile(script) - Disassembles bytecode (full decompilation requires external tools)
 static int lua_decompile(lua_State* L) {
     luaL_checkany(L, 1);
@@ -622,6 +1049,9 @@ void xoron_register_cache(lua_State* L) {
     lua_pushcfunction(L, lua_getscriptclosure, "getscriptclosure");
     lua_setglobal(L, "getscriptclosure");
     
+    lua_pushcfunction(L, lua_analyzebytecode, "analyzebytecode");
+    lua_setglobal(L, "analyzebytecode");
+    
     // Save instance
     lua_pushcfunction(L, lua_saveinstance, "saveinstance");
     lua_setglobal(L, "saveinstance");
@@ -0,0 +1,647 @@
+/*
+ * xoron_channel.cpp - Host<->VM message channel
+ * Provides: per-VM lock-free MPSC inbox/outbox, xoron_channel_* API, channel library
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Host threads (UI, touch, network) never touch a lua_State. They post typed
+ * messages into the VM's inbox; the thread that owns the VM drains them in
+ * batches at safe points (xoron_run, xoron_channel_pump, channel.pump) and
+ * replies flow back through the outbox, drained by the host.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+#include "lua.h"
+#include "lualib.h"
+
+extern void xoron_set_error(const char* fmt, ...);
+
+#define XORON_CHANNEL_CAPACITY 4096
+#define XORON_CHANNEL_BATCH 64
+
+static const char* CHANNEL_KEY = "xoron.channel";
+static const char* CHANNEL_HANDLERS_KEY = "xoron.channel.handlers";
+
+static const char* const g_message_type_names[] = {
+    "", "script", "bytecode", "touch", "ui", "network", "user", "reply"
+};
+
+// Metrics
+static const int g_m_channel_posted = xoron_metric_counter("channel.posted");
+static const int g_m_channel_dropped = xoron_metric_counter("channel.dropped");
+static const int g_m_channel_handled = xoron_metric_counter("channel.handled");
+static const int g_m_channel_replies = xoron_metric_counter("channel.replies");
+
+// Completion slot for xoron_channel_call, on the blocked caller's stack
+struct ChannelWaiter {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    int status = XORON_OK;
+    std::string error;
+};
+
+struct ChannelNode {
+    std::atomic<ChannelNode*> next{nullptr};
+    int type = 0;
+    int64_t id = 0;
+    int64_t arg = 0;
+    double x = 0.0;
+    double y = 0.0;
+    std::string topic;
+    std::string data;
+    const char* borrowed = nullptr;     // xoron_channel_call payload, kept alive by the caller
+    size_t borrowed_len = 0;
+    ChannelWaiter* waiter = nullptr;
+    
+    const char* payload() const { return borrowed ? borrowed : data.c_str(); }
+    size_t payload_len() const { return borrowed ? borrowed_len : data.size(); }
+};
+
+/*
+ * Vyukov intrusive MPSC queue. push is one exchange and one store from any
+ * thread; pop is for a single consumer and may return nullptr while a push
+ * is half done, in which case the node shows up on a later pop.
+ */
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+    
+    void push(ChannelNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        ChannelNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+    
+    ChannelNode* pop() {
+        ChannelNode* tail = tail_;
+        ChannelNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) return nullptr;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+        push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+private:
+    std::atomic<ChannelNode*> head_;
+    ChannelNode* tail_;
+    ChannelNode stub_;
+};
+
+struct XoronChannel {
+    std::atomic<int> refs{1};
+    std::atomic<bool> closed{false};
+    
+    // Owned by the VM thread
+    xoron_vm_t* vm = nullptr;
+    lua_State* L = nullptr;
+    bool pumping = false;
+    
+    MpscQueue inbox;                    // host -> VM
+    MpscQueue outbox;                   // VM -> host
+    std::atomic<int> inbox_size{0};
+    std::atomic<int> outbox_size{0};
+    std::atomic<bool> draining{false};
+    
+    std::atomic<xoron_notify_fn> on_post{nullptr};
+    std::atomic<xoron_notify_fn> on_reply{nullptr};
+    std::atomic<void*> notify_ud{nullptr};
+    
+    // Blocking calls are serialized against close so none can be stranded
+    std::mutex call_mutex;
+    
+    // xoron_channel_wait; posters only take the lock when someone sleeps
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+    std::atomic<int> sleepers{0};
+    std::atomic<bool> woken{false};
+};
+
+static std::mutex g_native_mutex;
+static std::unordered_map<std::string, XoronChannelHandler> g_native_handlers;
+
+static const char* message_type_name(int type) {
+    if (type < XORON_MSG_SCRIPT || type > XORON_MSG_REPLY) return "user";
+    return g_message_type_names[type];
+}
+
+static ChannelNode* node_from_message(const xoron_message_t* msg, bool borrow) {
+    ChannelNode* node = new (std::nothrow) ChannelNode();
+    if (!node) return nullptr;
+    node->type = msg->type;
+    node->id = msg->id;
+    node->arg = msg->arg;
+    node->x = msg->x;
+    node->y = msg->y;
+    if (msg->topic) node->topic = msg->topic;
+    if (msg->data) {
+        size_t len = msg->data_len ? msg->data_len : strlen(msg->data);
+        if (borrow) {
+            node->borrowed = msg->data;
+            node->borrowed_len = len;
+        } else {
+            node->data.assign(msg->data, len);
+        }
+    }
+    return node;
+}
+
+static void message_from_node(const ChannelNode* node, xoron_message_t* out) {
+    out->type = node->type;
+    out->id = node->id;
+    out->arg = node->arg;
+    out->x = node->x;
+    out->y = node->y;
+    out->topic = node->topic.c_str();
+    out->data = node->payload();
+    out->data_len = node->payload_len();
+}
+
+static void complete_waiter(ChannelNode* node, int status, const std::string& error) {
+    ChannelWaiter* waiter = node->waiter;
+    std::lock_guard<std::mutex> lock(waiter->mutex);
+    waiter->status = status;
+    waiter->error = error;
+    waiter->done = true;
+    waiter->cv.notify_one();
+}
+
+static void wake_sleepers(XoronChannel* ch) {
+    if (ch->sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(ch->wait_mutex);
+        ch->wait_cv.notify_all();
+    }
+}
+
+static int channel_push(XoronChannel* ch, ChannelNode* node) {
+    if (ch->closed.load(std::memory_order_acquire)) {
+        delete node;
+        xoron_set_error("Channel is closed");
+        return XORON_ERR_INVALID;
+    }
+    if (ch->inbox_size.fetch_add(1) >= XORON_CHANNEL_CAPACITY) {
+        ch->inbox_size.fetch_sub(1);
+        xoron_metric_inc(g_m_channel_dropped, 1);
+        delete node;
+        xoron_set_error("Channel is full");
+        return XORON_ERR_MEMORY;
+    }
+    ch->inbox.push(node);
+    xoron_metric_inc(g_m_channel_posted, 1);
+    
+    wake_sleepers(ch);
+    if (xoron_notify_fn fn = ch->on_post.load(std::memory_order_acquire)) {
+        fn(ch->notify_ud.load(std::memory_order_acquire));
+    }
+    return XORON_OK;
+}
+
+static void channel_reply(XoronChannel* ch, int type, int64_t id, int64_t status,
+                          const std::string& topic, const char* data, size_t len) {
+    if (ch->outbox_size.fetch_add(1) >= XORON_CHANNEL_CAPACITY) {
+        ch->outbox_size.fetch_sub(1);
+        xoron_metric_inc(g_m_channel_dropped, 1);
+        return;
+    }
+    ChannelNode* node = new (std::nothrow) ChannelNode();
+    if (!node) {
+        ch->outbox_size.fetch_sub(1);
+        return;
+    }
+    node->type = type;
+    node->id = id;
+    node->arg = status;
+    node->topic = topic;
+    if (data) node->data.assign(data, len);
+    ch->outbox.push(node);
+    xoron_metric_inc(g_m_channel_replies, 1);
+    
+    if (xoron_notify_fn fn = ch->on_reply.load(std::memory_order_acquire)) {
+        fn(ch->notify_ud.load(std::memory_order_acquire));
+    }
+}
+
+static void push_message_table(lua_State* L, const ChannelNode* node) {
+    lua_createtable(L, 0, 7);
+    lua_pushstring(L, message_type_name(node->type)); lua_setfield(L, -2, "type");
+    lua_pushnumber(L, (double)node->id); lua_setfield(L, -2, "id");
+    lua_pushnumber(L, (double)node->arg); lua_setfield(L, -2, "arg");
+    lua_pushnumber(L, node->x); lua_setfield(L, -2, "x");
+    lua_pushnumber(L, node->y); lua_setfield(L, -2, "y");
+    lua_pushlstring(L, node->topic.data(), node->topic.size()); lua_setfield(L, -2, "topic");
+    lua_pushlstring(L, node->payload(), node->payload_len()); lua_setfield(L, -2, "data");
+}
+
+static XoronChannelHandler find_native_handler(const ChannelNode* node) {
+    std::lock_guard<std::mutex> lock(g_native_mutex);
+    if (!node->topic.empty()) {
+        auto it = g_native_handlers.find(node->topic);
+        if (it != g_native_handlers.end()) return it->second;
+    }
+    auto it = g_native_handlers.find(message_type_name(node->type));
+    return it != g_native_handlers.end() ? it->second : nullptr;
+}
+
+// Native handler, then channel.on(topic) or else channel.on(type); the Lua handler's result is the reply
+static int dispatch_event(lua_State* L, const ChannelNode* node, std::string& reply) {
+    XoronChannelHandler native = find_native_handler(node);
+    if (native) {
+        xoron_message_t msg;
+        message_from_node(node, &msg);
+        native(L, &msg);
+    }
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, CHANNEL_HANDLERS_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        if (native) return XORON_OK;
+        reply = "No handler";
+        return XORON_ERR_INVALID;
+    }
+    lua_getfield(L, -1, node->topic.c_str());
+    if (!lua_isfunction(L, -1)) {
+        lua_pop(L, 1);
+        lua_getfield(L, -1, message_type_name(node->type));
+    }
+    lua_remove(L, -2);
+    if (!lua_isfunction(L, -1)) {
+        lua_pop(L, 1);
+        if (native) return XORON_OK;
+        reply = "No handler";
+        return XORON_ERR_INVALID;
+    }
+    
+    push_message_table(L, node);
+    if (lua_pcall(L, 1, 1, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        reply = err ? err : "unknown";
+        lua_pop(L, 1);
+        return XORON_ERR_RUNTIME;
+    }
+    if (!lua_isnil(L, -1)) {
+        size_t len;
+        const char* s = luaL_tolstring(L, -1, &len);
+        reply.assign(s, len);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return XORON_OK;
+}
+
+// channel.pump() inside a coroutine must not run chunks on the suspended main thread
+static int run_chunk(XoronChannel* ch, lua_State* L, const char* data, size_t len) {
+    if (L == ch->L) return xoron_run_bytecode(ch->vm, data, len, "channel");
+    if (xoron_load_script(L, "channel", data, len) != 0 || lua_pcall(L, 0, 0, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        xoron_set_error("Runtime error: %s", err ? err : "unknown");
+        lua_pop(L, 1);
+        return XORON_ERR_RUNTIME;
+    }
+    return XORON_OK;
+}
+
+static void handle_node(XoronChannel* ch, lua_State* L, ChannelNode* node) {
+    int status = XORON_OK;
+    std::string reply;
+    
+    if (node->type == XORON_MSG_SCRIPT) {
+        const char* source = node->payload_len() ? node->payload() : "";
+        xoron_bytecode_t* bc = xoron_compile(source, node->payload_len(), "channel");
+        status = XORON_ERR_COMPILE;
+        if (bc) {
+            size_t len = 0;
+            const char* data = xoron_bytecode_data(bc, &len);
+            status = run_chunk(ch, L, data, len);
+            xoron_bytecode_free(bc);
+        }
+        if (status != XORON_OK) reply = xoron_last_error();
+    } else if (node->type == XORON_MSG_BYTECODE) {
+        status = run_chunk(ch, L, node->payload(), node->payload_len());
+        if (status != XORON_OK) reply = xoron_last_error();
+    } else {
+        status = dispatch_event(L, node, reply);
+    }
+    
+    if (node->waiter) {
+        complete_waiter(node, status, reply);
+    } else if (node->id != 0) {
+        channel_reply(ch, XORON_MSG_REPLY, node->id, status, node->topic, reply.data(), reply.size());
+    } else if (status != XORON_OK && status != XORON_ERR_INVALID) {
+        XORON_LOG("channel %s handler failed: %s", message_type_name(node->type), reply.c_str());
+    }
+}
+
+static int channel_pump(XoronChannel* ch, lua_State* L, int max) {
+    if (!ch || !ch->vm || !L || ch->pumping) return 0;
+    if (max <= 0) max = XORON_CHANNEL_BATCH;
+    
+    ch->pumping = true;
+    int handled = 0;
+    while (handled < max) {
+        ChannelNode* node = ch->inbox.pop();
+        if (!node) break;
+        ch->inbox_size.fetch_sub(1);
+        handle_node(ch, L, node);
+        delete node;
+        handled++;
+    }
+    ch->pumping = false;
+    
+    if (handled) xoron_metric_inc(g_m_channel_handled, handled);
+    return handled;
+}
+
+static XoronChannel* check_channel(lua_State* L) {
+    XoronChannel* ch = xoron_channel_of(L);
+    if (!ch) luaL_error(L, "No message channel for this VM");
+    return ch;
+}
+
+// channel.on(name, handler) - Handles a topic or message type ("touch", "ui", "network", "user"); nil removes
+static int lua_channel_on(lua_State* L) {
+    const char* name = luaL_checkstring(L, 1);
+    if (!lua_isnoneornil(L, 2)) luaL_checktype(L, 2, LUA_TFUNCTION);
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, CHANNEL_HANDLERS_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, CHANNEL_HANDLERS_KEY);
+    }
+    lua_pushvalue(L, 2);
+    lua_setfield(L, -2, name);
+    lua_pop(L, 1);
+    return 0;
+}
+
+// channel.post(topic, data) - Sends an event to the host
+static int lua_channel_post(lua_State* L) {
+    XoronChannel* ch = check_channel(L);
+    const char* topic = luaL_checkstring(L, 1);
+    size_t len = 0;
+    const char* data = luaL_optlstring(L, 2, "", &len);
+    channel_reply(ch, XORON_MSG_USER, 0, 0, topic, data, len);
+    return 0;
+}
+
+// channel.reply(id, data, status) - Answers a host message by id
+static int lua_channel_reply(lua_State* L) {
+    XoronChannel* ch = check_channel(L);
+    int64_t id = (int64_t)luaL_checknumber(L, 1);
+    size_t len = 0;
+    const char* data = luaL_optlstring(L, 2, "", &len);
+    int64_t status = (int64_t)luaL_optinteger(L, 3, XORON_OK);
+    channel_reply(ch, XORON_MSG_REPLY, id, status, std::string(), data, len);
+    return 0;
+}
+
+// channel.pump(max) - Handles up to max pending host messages, returns the count
+static int lua_channel_pump(lua_State* L) {
+    XoronChannel* ch = check_channel(L);
+    int max = luaL_optinteger(L, 1, XORON_CHANNEL_BATCH);
+    lua_pushinteger(L, channel_pump(ch, L, max));
+    return 1;
+}
+
+// channel.pending() - Number of host messages waiting
+static int lua_channel_pending(lua_State* L) {
+    XoronChannel* ch = check_channel(L);
+    lua_pushinteger(L, ch->inbox_size.load(std::memory_order_relaxed));
+    return 1;
+}
+
+void xoron_register_channel(lua_State* L) {
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_channel_on, "on");
+    lua_setfield(L, -2, "on");
+    
+    lua_pushcfunction(L, lua_channel_post, "post");
+    lua_setfield(L, -2, "post");
+    
+    lua_pushcfunction(L, lua_channel_reply, "reply");
+    lua_setfield(L, -2, "reply");
+    
+    lua_pushcfunction(L, lua_channel_pump, "pump");
+    lua_setfield(L, -2, "pump");
+    
+    lua_pushcfunction(L, lua_channel_pending, "pending");
+    lua_setfield(L, -2, "pending");
+    
+    lua_setglobal(L, "channel");
+}
+
+// ==================== Internal API ====================
+
+XoronChannel* xoron_channel_create(void) {
+    return new (std::nothrow) XoronChannel();
+}
+
+void xoron_channel_attach(XoronChannel* ch, xoron_vm_t* vm, lua_State* L) {
+    if (!ch) return;
+    ch->vm = vm;
+    ch->L = L;
+    if (L) {
+        lua_pushlightuserdata(L, ch);
+        lua_setfield(L, LUA_REGISTRYINDEX, CHANNEL_KEY);
+    }
+}
+
+void xoron_channel_close(XoronChannel* ch) {
+    if (!ch) return;
+    {
+        std::lock_guard<std::mutex> lock(ch->call_mutex);
+        ch->closed.store(true, std::memory_order_release);
+    }
+    
+    // Fail whatever is still queued; nothing can be added from here on
+    while (ChannelNode* node = ch->inbox.pop()) {
+        ch->inbox_size.fetch_sub(1);
+        if (node->waiter) complete_waiter(node, XORON_ERR_INVALID, "VM closed");
+        delete node;
+    }
+    ch->vm = nullptr;
+    ch->L = nullptr;
+    xoron_channel_wake(ch);
+}
+
+XoronChannel* xoron_channel_of(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, CHANNEL_KEY);
+    XoronChannel* ch = (XoronChannel*)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return ch;
+}
+
+void xoron_channel_retain(XoronChannel* ch) {
+    if (ch) ch->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void xoron_channel_release(XoronChannel* ch) {
+    if (!ch || ch->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    while (ChannelNode* node = ch->inbox.pop()) {
+        if (node->waiter) complete_waiter(node, XORON_ERR_INVALID, "VM closed");
+        delete node;
+    }
+    while (ChannelNode* node = ch->outbox.pop()) delete node;
+    delete ch;
+}
+
+int xoron_channel_send(XoronChannel* ch, const xoron_message_t* msg) {
+    if (!ch || !msg) {
+        xoron_set_error("Invalid arguments");
+        return XORON_ERR_INVALID;
+    }
+    ChannelNode* node = node_from_message(msg, false);
+    if (!node) {
+        xoron_set_error("Failed to allocate message");
+        return XORON_ERR_MEMORY;
+    }
+    return channel_push(ch, node);
+}
+
+int xoron_channel_call(XoronChannel* ch, const xoron_message_t* msg, char* error, size_t error_len) {
+    if (error && error_len) error[0] = '\0';
+    if (!ch || !msg) {
+        xoron_set_error("Invalid arguments");
+        return XORON_ERR_INVALID;
+    }
+    ChannelNode* node = node_from_message(msg, true);
+    if (!node) {
+        xoron_set_error("Failed to allocate message");
+        return XORON_ERR_MEMORY;
+    }
+    
+    ChannelWaiter waiter;
+    node->waiter = &waiter;
+    {
+        std::lock_guard<std::mutex> lock(ch->call_mutex);
+        int result = channel_push(ch, node);
+        if (result != XORON_OK) return result;
+    }
+    
+    std::unique_lock<std::mutex> lock(waiter.mutex);
+    waiter.cv.wait(lock, [&] { return waiter.done; });
+    if (waiter.status != XORON_OK) {
+        xoron_set_error("%s", waiter.error.c_str());
+        if (error && error_len) snprintf(error, error_len, "%s", waiter.error.c_str());
+    }
+    return waiter.status;
+}
+
+int xoron_channel_drain_replies(XoronChannel* ch, xoron_message_fn fn, void* ud, int max) {
+    if (!ch || !fn || ch->draining.exchange(true, std::memory_order_acquire)) return 0;
+    
+    int drained = 0;
+    while (max <= 0 || drained < max) {
+        ChannelNode* node = ch->outbox.pop();
+        if (!node) break;
+        ch->outbox_size.fetch_sub(1);
+        xoron_message_t msg;
+        message_from_node(node, &msg);
+        fn(&msg, ud);
+        delete node;
+        drained++;
+    }
+    ch->draining.store(false, std::memory_order_release);
+    return drained;
+}
+
+void xoron_channel_listen(XoronChannel* ch, xoron_notify_fn on_post, xoron_notify_fn on_reply, void* ud) {
+    if (!ch) return;
+    ch->notify_ud.store(ud, std::memory_order_release);
+    ch->on_post.store(on_post, std::memory_order_release);
+    ch->on_reply.store(on_reply, std::memory_order_release);
+}
+
+int xoron_channel_pending(XoronChannel* ch) {
+    return ch ? ch->inbox_size.load(std::memory_order_relaxed) : 0;
+}
+
+int xoron_channel_dispatch(XoronChannel* ch, lua_State* L, int max) {
+    if (!ch || ch->pumping) return -1;
+    return channel_pump(ch, L, max);
+}
+
+int xoron_channel_await(XoronChannel* ch, int timeout_ms) {
+    if (!ch) return 0;
+    if (ch->inbox_size.load() > 0) return 1;
+    
+    ch->sleepers.fetch_add(1);
+    {
+        std::unique_lock<std::mutex> lock(ch->wait_mutex);
+        auto ready = [ch] { return ch->inbox_size.load() > 0 || ch->woken.load(); };
+        if (timeout_ms < 0) {
+            ch->wait_cv.wait(lock, ready);
+        } else {
+            ch->wait_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+        }
+    }
+    ch->sleepers.fetch_sub(1);
+    ch->woken.store(false);
+    return ch->inbox_size.load() > 0 ? 1 : 0;
+}
+
+void xoron_channel_wake(XoronChannel* ch) {
+    if (!ch) return;
+    ch->woken.store(true);
+    std::lock_guard<std::mutex> lock(ch->wait_mutex);
+    ch->wait_cv.notify_all();
+}
+
+void xoron_channel_handle(const char* name, XoronChannelHandler fn) {
+    if (!name) return;
+    std::lock_guard<std::mutex> lock(g_native_mutex);
+    if (fn) g_native_handlers[name] = fn;
+    else g_native_handlers.erase(name);
+}
+
+// ==================== C API ====================
+
+extern "C" {
+
+int xoron_channel_post(xoron_vm_t* vm, const xoron_message_t* msg) {
+    return xoron_channel_send(xoron_vm_channel(vm), msg);
+}
+
+int xoron_channel_pump(xoron_vm_t* vm, int max) {
+    XoronChannel* ch = xoron_vm_channel(vm);
+    return ch ? channel_pump(ch, ch->L, max) : 0;
+}
+
+int xoron_channel_wait(xoron_vm_t* vm, int timeout_ms) {
+    return xoron_channel_await(xoron_vm_channel(vm), timeout_ms);
+}
+
+int xoron_channel_drain(xoron_vm_t* vm, xoron_message_fn fn, void* ud, int max) {
+    return xoron_channel_drain_replies(xoron_vm_channel(vm), fn, ud, max);
+}
+
+void xoron_channel_set_notify(xoron_vm_t* vm, xoron_notify_fn on_post, xoron_notify_fn on_reply, void* ud) {
+    xoron_channel_listen(xoron_vm_channel(vm), on_post, on_reply, ud);
+}
+
+} // extern "C"
@@ -45,6 +45,10 @@
 
 extern void xoron_set_error(const char* fmt, ...);
 
+// Metrics
+static const int g_m_console_lines = xoron_metric_counter("console.lines");
+static const int g_m_console_bytes = xoron_metric_counter("console.bytes");
+
 // Console state
 static std::mutex g_console_mutex;
 static std::atomic<bool> g_console_created{false};
@@ -83,6 +87,8 @@ static void console_output(const char* text, ConsoleColor color = COLOR_DEFAULT)
     }
     
     g_console_buffer.push_back(output);
+    xoron_metric_inc(g_m_console_lines, 1);
+    xoron_metric_inc(g_m_console_bytes, output.size());
     
     if (g_print_callback) {
         g_print_callback(output.c_str(), g_callback_userdata);
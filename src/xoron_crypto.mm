@@ -22,6 +22,10 @@
 
 extern void xoron_set_error(const char* fmt, ...);
 
+// Metrics
+static const int g_m_crypto_hashes = xoron_metric_counter("crypto.hashes");
+static const int g_m_crypto_hash_bytes = xoron_metric_counter("crypto.hash_bytes");
+
 // ==================== C API ====================
 
 extern "C" {
@@ -181,7 +185,7 @@ static int lua_crypt_generatekey(lua_State* L) {
 // crypt.hash(data, algorithm) - Hash data with specified algorithm
 static int lua_crypt_hash(lua_State* L) {
     size_t data_len;
-    const char* data = luaL_checklstring(L, 1, &data_len);
+    const char* data = xoron_checkbytes(L, 1, &data_len);
     const char* algorithm = luaL_optstring(L, 2, "sha256");
     
     const EVP_MD* md = nullptr;
@@ -221,6 +225,8 @@ static int lua_crypt_hash(lua_State* L) {
     }
     
     EVP_MD_CTX_free(ctx);
+    xoron_metric_inc(g_m_crypto_hashes, 1);
+    xoron_metric_inc(g_m_crypto_hash_bytes, data_len);
     
     std::string hex = bytes_to_hex(hash, hash_len);
     lua_pushstring(L, hex.c_str());
@@ -230,8 +236,8 @@ static int lua_crypt_hash(lua_State* L) {
 // crypt.hmac(data, key, algorithm) - HMAC
 static int lua_crypt_hmac(lua_State* L) {
     size_t data_len, key_len;
-    const char* data = luaL_checklstring(L, 1, &data_len);
-    const char* key = luaL_checklstring(L, 2, &key_len);
+    const char* data = xoron_checkbytes(L, 1, &data_len);
+    const char* key = xoron_checkbytes(L, 2, &key_len);
     const char* algorithm = luaL_optstring(L, 3, "sha256");
     
     const EVP_MD* md = nullptr;
@@ -261,10 +267,11 @@ static int lua_crypt_hmac(lua_State* L) {
     return 1;
 }
 
-// crypt.encrypt(data, key, iv, algorithm) - AES encryption
+// crypt.encrypt(data, key, iv, algorithm) - AES encryption; a Buffer gives a raw IV+ciphertext Buffer instead of base64
 static int lua_crypt_encrypt(lua_State* L) {
     size_t data_len, key_len;
-    const char* data = luaL_checklstring(L, 1, &data_len);
+    const char* data = xoron_checkbytes(L, 1, &data_len);
+    bool raw = xoron_isbuffer(L, 1);
     const char* key_b64 = luaL_checklstring(L, 2, &key_len);
     const char* iv_b64 = luaL_optstring(L, 3, nullptr);
     const char* algorithm = luaL_optstring(L, 4, "aes-cbc");
@@ -350,6 +357,13 @@ static int lua_crypt_encrypt(lua_State* L) {
     EVP_CIPHER_CTX_free(ctx);
     free(key_decoded);
     
+    if (raw) {
+        char* out = xoron_pushbuffer(L, iv_len + ciphertext_len);
+        memcpy(out, iv.data(), iv_len);
+        memcpy(out + iv_len, ciphertext.data(), ciphertext_len);
+        return 1;
+    }
+    
     // Prepend IV to ciphertext and encode as base64
     std::vector<uint8_t> result(iv_len + ciphertext_len);
     memcpy(result.data(), iv.data(), iv_len);
@@ -366,20 +380,26 @@ static int lua_crypt_encrypt(lua_State* L) {
     return 1;
 }
 
-// crypt.decrypt(data, key, iv, algorithm) - AES decryption
+// crypt.decrypt(data, key, iv, algorithm) - AES decryption; a Buffer is read as raw IV+ciphertext and gives a Buffer
 static int lua_crypt_decrypt(lua_State* L) {
     size_t data_len, key_len;
-    const char* data_b64 = luaL_checklstring(L, 1, &data_len);
+    bool raw = xoron_isbuffer(L, 1);
+    const char* data_b64 = xoron_checkbytes(L, 1, &data_len);
     const char* key_b64 = luaL_checklstring(L, 2, &key_len);
     const char* iv_b64 = luaL_optstring(L, 3, nullptr);
     const char* algorithm = luaL_optstring(L, 4, "aes-cbc");
     
-    // Decode data from base64
-    size_t data_decoded_len;
-    uint8_t* data_decoded = xoron_base64_decode(data_b64, &data_decoded_len);
-    if (!data_decoded) {
-        luaL_error(L, "Invalid encrypted data");
-        return 0;
+    // Decode data from base64; a Buffer already holds the raw bytes (and is not freed)
+    size_t data_decoded_len = data_len;
+    uint8_t* data_decoded = nullptr;
+    const uint8_t* data_raw = (const uint8_t*)data_b64;
+    if (!raw) {
+        data_decoded = xoron_base64_decode(data_b64, &data_decoded_len);
+        if (!data_decoded) {
+            luaL_error(L, "Invalid encrypted data");
+            return 0;
+        }
+        data_raw = data_decoded;
     }
     
     // Decode key from base64
@@ -428,7 +448,7 @@ static int lua_crypt_decrypt(lua_State* L) {
             luaL_error(L, "Invalid IV");
             return 0;
         }
-        ciphertext = data_decoded;
+        ciphertext = data_raw;
         ciphertext_len = data_decoded_len;
     } else {
         // IV is prepended to ciphertext
@@ -438,8 +458,8 @@ static int lua_crypt_decrypt(lua_State* L) {
             luaL_error(L, "Data too short");
             return 0;
         }
-        memcpy(iv.data(), data_decoded, iv_len);
-        ciphertext = data_decoded + iv_len;
+        memcpy(iv.data(), data_raw, iv_len);
+        ciphertext = data_raw + iv_len;
         ciphertext_len = data_decoded_len - iv_len;
     }
     
@@ -485,6 +505,10 @@ static int lua_crypt_decrypt(lua_State* L) {
     free(key_decoded);
     free(data_decoded);
     
+    if (raw) {
+        memcpy(xoron_pushbuffer(L, plaintext_len), plaintext.data(), plaintext_len);
+        return 1;
+    }
     lua_pushlstring(L, (const char*)plaintext.data(), plaintext_len);
     return 1;
 }
@@ -513,7 +537,7 @@ static int lua_crypt_random(lua_State* L) {
 // crypt.base64encode(data) - Base64 encode
 static int lua_crypt_base64encode(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     char* encoded = xoron_base64_encode(data, len);
     if (encoded) {
@@ -545,7 +569,7 @@ static int lua_crypt_base64decode(lua_State* L) {
 // crypt.sha256(data) - SHA256 hash
 static int lua_crypt_sha256(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     uint8_t hash[32];
     xoron_sha256(data, len, hash);
@@ -558,7 +582,7 @@ static int lua_crypt_sha256(lua_State* L) {
 // crypt.sha384(data) - SHA384 hash
 static int lua_crypt_sha384(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     uint8_t hash[48];
     xoron_sha384(data, len, hash);
@@ -571,7 +595,7 @@ static int lua_crypt_sha384(lua_State* L) {
 // crypt.sha512(data) - SHA512 hash
 static int lua_crypt_sha512(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     uint8_t hash[64];
     xoron_sha512(data, len, hash);
@@ -584,7 +608,7 @@ static int lua_crypt_sha512(lua_State* L) {
 // crypt.md5(data) - MD5 hash
 static int lua_crypt_md5(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     uint8_t hash[16];
     xoron_md5(data, len, hash);
@@ -597,7 +621,7 @@ static int lua_crypt_md5(lua_State* L) {
 // crypt.hexencode(data) - Hex encode
 static int lua_crypt_hexencode(lua_State* L) {
     size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
+    const char* data = xoron_checkbytes(L, 1, &len);
     
     char* encoded = xoron_hex_encode(data, len);
     if (encoded) {
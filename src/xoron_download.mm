@@ -0,0 +1,619 @@
+/*
+ * xoron_download.cpp - Segmented, resumable file downloads
+ * Provides: downloadfile
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * A download starts by asking for byte 0 alone. When the server answers 206
+ * with the file size, the file is split into up to 16 ranges. Each range is
+ * fetched by its own worker through the HTTP scheduler and written with
+ * pwrite straight into a preallocated <path>.part. Over HTTP/2 the workers
+ * share one connection per origin. About once a second the file is synced
+ * and how far each range got is saved in <path>.xdl. A later call with the
+ * same URL and path continues from there when the size and ETag (or
+ * Last-Modified) still match, and If-Range makes the server send the whole
+ * file instead if it changed. A server that answers 200 is read front to back
+ * by that first request. The finished file is checked against an optional
+ * sha256 before it is renamed into place.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lua.h"
+#include "lualib.h"
+
+#define DL_MAGIC "XDL1"
+#define DL_DEFAULT_SEGMENTS 4
+#define DL_MAX_SEGMENTS 16
+#define DL_MIN_SEGMENT (1ull << 20)     // smaller files get fewer segments
+#define DL_VALIDATOR_MAX 256
+#define DL_RETRIES 3                    // per segment, counted since its last progress
+#define DL_BACKOFF_MS 250               // doubled on each retry
+#define DL_PROGRESS_MS 100
+#define DL_SAVE_MS 1000
+
+// Metrics
+static const int g_m_dl_started = xoron_metric_counter("download.started");
+static const int g_m_dl_completed = xoron_metric_counter("download.completed");
+static const int g_m_dl_resumed = xoron_metric_counter("download.resumed");
+static const int g_m_dl_retries = xoron_metric_counter("download.retries");
+static const int g_m_dl_bytes = xoron_metric_counter("download.bytes");
+static const int g_m_dl_segments = xoron_metric_histogram("download.segments");
+
+// Progress file: header, validator, then (next, end) per segment
+struct DlHeader {
+    char magic[4];
+    uint32_t segments;
+    uint64_t total;
+    uint8_t url_sha[32];
+    uint32_t validator_len;
+    uint32_t reserved;
+};
+
+struct DlSegment {
+    uint64_t start = 0;
+    std::atomic<uint64_t> next{0};  // first byte not yet on disk
+    uint64_t end = 0;               // exclusive
+};
+
+struct Download {
+    std::string url;
+    XoronHttpHeaders headers;       // extra request headers from the script
+    bool background = true;
+    const void* owner = nullptr;
+    int requested_segments = DL_DEFAULT_SEGMENTS;
+    bool pinned = false;
+    uint8_t sha256[32];
+    
+    std::string path, part_path, state_path;
+    int fd = -1;
+    std::string validator;          // ETag or Last-Modified, "" when the server sent neither
+    std::vector<DlSegment> segments;
+    std::atomic<int64_t> total{-1};
+    std::atomic<uint64_t> received{0};  // bytes on disk, counting resumed ones
+    std::atomic<bool> stop{false};      // set on failure or cancel; workers wind down
+    
+    std::mutex mutex;
+    std::condition_variable cv;
+    int running = 0;                // segment workers
+    bool done = false;
+    bool cancelled = false;
+    bool discard = false;           // the progress file no longer describes the server's file
+    std::string error;              // the first failure
+    
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty()) error = message;
+        stop = true;
+        cv.notify_all();
+    }
+    
+    // Sleeps for a retry backoff; false if the download stopped meanwhile
+    bool backoff(int attempt) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto delay = std::chrono::milliseconds(DL_BACKOFF_MS << (attempt - 1));
+        return !cv.wait_for(lock, delay, [&] { return stop.load(); });
+    }
+};
+
+// One download per destination at a time
+static std::mutex g_active_mutex;
+static std::unordered_set<std::string> g_active;
+
+static bool write_at(int fd, const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static const std::string* find_header(const XoronHttpHeaders& headers, const char* name) {
+    for (const auto& h : headers) {
+        if (h.first == name) return &h.second;
+    }
+    return nullptr;
+}
+
+// Total size from "bytes 0-0/1234" or "bytes */1234"; -1 if the server didn't say
+static int64_t content_range_total(const XoronHttpHeaders& headers) {
+    const std::string* range = find_header(headers, "content-range");
+    if (!range) return -1;
+    size_t slash = range->rfind('/');
+    if (slash == std::string::npos || slash + 1 >= range->size() || (*range)[slash + 1] == '*') return -1;
+    char* end = nullptr;
+    unsigned long long total = strtoull(range->c_str() + slash + 1, &end, 10);
+    return *end == '\0' ? (int64_t)total : -1;
+}
+
+// A strong ETag, else Last-Modified; weak ETags can't be used with If-Range
+static std::string pick_validator(const XoronHttpHeaders& headers) {
+    const std::string* etag = find_header(headers, "etag");
+    if (etag && etag->compare(0, 2, "W/") != 0) return *etag;
+    const std::string* modified = find_header(headers, "last-modified");
+    return modified ? *modified : std::string();
+}
+
+static void url_digest(const std::string& url, uint8_t out[32]) {
+    xoron_sha256(url.data(), url.size(), out);
+}
+
+// Loads the segments saved by an earlier attempt at the same URL, size and validator
+static bool load_state(Download& dl, uint64_t total) {
+    struct stat st;
+    if (dl.validator.empty() || fstat(dl.fd, &st) != 0 || (uint64_t)st.st_size != total) return false;
+    FILE* f = fopen(dl.state_path.c_str(), "rb");
+    if (!f) return false;
+    
+    DlHeader header;
+    uint8_t url_sha[32];
+    url_digest(dl.url, url_sha);
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, DL_MAGIC, 4) == 0 &&
+              memcmp(header.url_sha, url_sha, 32) == 0 && header.total == total &&
+              header.validator_len == dl.validator.size() && header.segments >= 1 &&
+              header.segments <= DL_MAX_SEGMENTS;
+    std::string validator(ok ? header.validator_len : 0, '\0');
+    std::vector<uint64_t> ranges(ok ? header.segments * 2 : 0);
+    ok = ok && fread(&validator[0], 1, validator.size(), f) == validator.size() && validator == dl.validator &&
+         fread(ranges.data(), sizeof(uint64_t), ranges.size(), f) == ranges.size();
+    fclose(f);
+    if (!ok) return false;
+    
+    // The ranges must tile [0, total) with each next inside its range
+    uint64_t start = 0;
+    for (size_t i = 0; i < ranges.size(); i += 2) {
+        if (ranges[i] < start || ranges[i] > ranges[i + 1] || ranges[i + 1] > total) return false;
+        start = ranges[i + 1];
+    }
+    if (start != total) return false;
+    
+    dl.segments = std::vector<DlSegment>(header.segments);
+    start = 0;
+    for (uint32_t i = 0; i < header.segments; i++) {
+        dl.segments[i].start = start;
+        dl.segments[i].next = ranges[i * 2];
+        dl.segments[i].end = ranges[i * 2 + 1];
+        start = dl.segments[i].end;
+    }
+    return true;
+}
+
+// Records how far each segment got. The data is synced first, so the file never claims bytes that
+// a crash could lose; it is replaced with a rename, so a crash mid-write leaves the previous one
+static void save_state(Download& dl) {
+    if (dl.segments.empty() || dl.validator.empty()) return;
+    std::vector<uint64_t> ranges;
+    for (const DlSegment& seg : dl.segments) {
+        ranges.push_back(seg.next.load(std::memory_order_acquire));
+        ranges.push_back(seg.end);
+    }
+    if (fdatasync(dl.fd) != 0) return;
+    
+    DlHeader header = {};
+    memcpy(header.magic, DL_MAGIC, 4);
+    header.segments = (uint32_t)dl.segments.size();
+    header.total = (uint64_t)dl.total.load();
+    url_digest(dl.url, header.url_sha);
+    header.validator_len = (uint32_t)dl.validator.size();
+    
+    std::string tmp = dl.state_path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(dl.validator.data(), 1, dl.validator.size(), f) == dl.validator.size() &&
+              fwrite(ranges.data(), sizeof(uint64_t), ranges.size(), f) == ranges.size();
+    ok = fflush(f) == 0 && ok && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), dl.state_path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        XORON_LOG("downloadfile: failed to save progress to %s", dl.state_path.c_str());
+    }
+}
+
+// Reserves the whole file up front, so a full disk fails now rather than halfway through
+static bool preallocate(int fd, uint64_t total, std::string& error) {
+#if defined(__APPLE__)
+    fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)total, 0};
+    if (total > 0 && fcntl(fd, F_PREALLOCATE, &store) != 0) {
+        error = std::string("Can't reserve space for the download: ") + strerror(errno);
+        return false;
+    }
+#else
+    int rc = total > 0 ? posix_fallocate(fd, 0, (off_t)total) : 0;
+    if (rc != 0 && rc != EOPNOTSUPP && rc != EINVAL) {
+        error = std::string("Can't reserve space for the download: ") + strerror(rc);
+        return false;
+    }
+#endif
+    if (ftruncate(fd, (off_t)total) != 0) {
+        error = std::string("Can't size the download file: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// Splits [0, total) into equal ranges of at least DL_MIN_SEGMENT bytes
+static void plan_segments(Download& dl, uint64_t total) {
+    uint64_t count = std::max<uint64_t>(1, std::min<uint64_t>(dl.requested_segments, total / DL_MIN_SEGMENT));
+    dl.segments = std::vector<DlSegment>(count);
+    for (uint64_t i = 0; i < count; i++) {
+        dl.segments[i].start = total * i / count;
+        dl.segments[i].next = dl.segments[i].start;
+        dl.segments[i].end = total * (i + 1) / count;
+    }
+}
+
+static bool retryable(int status) {
+    return status == 408 || status == 429 || status >= 500;
+}
+
+// Asks for byte 0. A 206 tells the size; a server that ignores Range answers 200, and then this
+// request carries the whole file, written front to back. Returns the status, or 0 on failure
+static int probe(Download& dl, XoronHttpHeaders& response) {
+    for (int attempt = 0;; attempt++) {
+        bool whole = false;
+        bool disk_error = false;
+        dl.received = 0;
+        XoronHttpBodySink sink = [&](int status, const char* data, size_t len) {
+            if (dl.stop) return false;
+            if (status != 200) return true;     // the 206's single byte is fetched again with segment 0
+            if (!whole) {
+                whole = true;
+                unlink(dl.state_path.c_str());
+                if (ftruncate(dl.fd, 0) != 0) return !(disk_error = true);
+            }
+            if (!write_at(dl.fd, data, len, dl.received)) return !(disk_error = true);
+            dl.received += len;
+            xoron_metric_inc(g_m_dl_bytes, len);
+            return true;
+        };
+        XoronHttpHeaders headers = dl.headers;
+        headers.emplace_back("Range", "bytes=0-0");
+        int status = 0;
+        std::string error;
+        bool ok = xoron_http_fetch(dl.url, headers, sink, dl.background, dl.owner, &status, &response, error);
+        if (dl.stop) return 0;
+        if (disk_error) {
+            dl.fail(std::string("Can't write the download file: ") + strerror(errno));
+            return 0;
+        }
+        if (ok && !retryable(status)) return status;
+        if (attempt == DL_RETRIES) {
+            dl.fail(ok ? "HTTP " + std::to_string(status) : error);
+            return 0;
+        }
+        xoron_metric_inc(g_m_dl_retries, 1);
+        if (!dl.backoff(attempt + 1)) return 0;
+    }
+}
+
+// Fetches one range with If-Range, retrying from wherever the last attempt stopped
+static void segment_main(Download* dl, DlSegment* seg) {
+    int attempt = 0;
+    while (!dl->stop && seg->next < seg->end) {
+        uint64_t before = seg->next;
+        bool changed = false;
+        bool disk_error = false;
+        XoronHttpBodySink sink = [&](int status, const char* data, size_t len) {
+            if (status != 206) return !(changed = true);
+            if (dl->stop) return false;
+            uint64_t at = seg->next.load(std::memory_order_relaxed);
+            size_t n = (size_t)std::min<uint64_t>(len, seg->end - at);
+            if (!write_at(dl->fd, data, n, at)) return !(disk_error = true);
+            seg->next.store(at + n, std::memory_order_release);
+            dl->received += n;
+            xoron_metric_inc(g_m_dl_bytes, n);
+            return n == len;
+        };
+        XoronHttpHeaders headers = dl->headers;
+        headers.emplace_back("Range", "bytes=" + std::to_string(before) + "-" + std::to_string(seg->end - 1));
+        if (!dl->validator.empty()) headers.emplace_back("If-Range", dl->validator);
+        int status = 0;
+        std::string error;
+        bool ok = xoron_http_fetch(dl->url, headers, sink, dl->background, dl->owner, &status, nullptr, error);
+        
+        if (seg->next >= seg->end || dl->stop) return;
+        if (changed || (ok && status >= 200 && status < 300 && status != 206)) {
+            {
+                std::lock_guard<std::mutex> lock(dl->mutex);
+                dl->discard = true;
+            }
+            dl->fail("The file changed on the server; the download will start over");
+            return;
+        }
+        if (disk_error) {
+            dl->fail(std::string("Can't write the download file: ") + strerror(errno));
+            return;
+        }
+        if (ok && status != 206 && !retryable(status)) {
+            dl->fail("HTTP " + std::to_string(status));
+            return;
+        }
+        if (seg->next > before) attempt = 0;
+        if (++attempt > DL_RETRIES) {
+            dl->fail(ok ? (status == 206 ? "Connection closed mid-range" : "HTTP " + std::to_string(status)) : error);
+            return;
+        }
+        xoron_metric_inc(g_m_dl_retries, 1);
+        if (!dl->backoff(attempt)) return;
+    }
+}
+
+// Checks the finished file against the pinned digest
+static bool verify(Download& dl, uint64_t total) {
+    uint8_t digest[32];
+    if (total == 0) {
+        xoron_sha256("", 0, digest);
+    } else {
+        void* map = mmap(nullptr, (size_t)total, PROT_READ, MAP_SHARED, dl.fd, 0);
+        if (map == MAP_FAILED) {
+            dl.fail(std::string("Can't read the download back: ") + strerror(errno));
+            return false;
+        }
+        xoron_sha256(map, (size_t)total, digest);
+        munmap(map, (size_t)total);
+    }
+    if (memcmp(digest, dl.sha256, 32) != 0) {
+        {
+            std::lock_guard<std::mutex> lock(dl.mutex);
+            dl.discard = true;
+        }
+        dl.fail("sha256 mismatch for " + dl.url);
+        return false;
+    }
+    return true;
+}
+
+// Runs a download on its own thread, so the script's thread is free to report progress
+static void download_main(Download* dl) {
+    XoronHttpHeaders response;
+    int status = probe(*dl, response);
+    int64_t total = status == 206 || status == 416 ? content_range_total(response) : -1;
+    bool ok = status != 0;
+    
+    if (ok && status == 206 && total >= 0) {
+        dl->validator = pick_validator(response);
+        if (dl->validator.size() > DL_VALIDATOR_MAX) dl->validator.clear();
+        if (load_state(*dl, (uint64_t)total)) {
+            xoron_metric_inc(g_m_dl_resumed, 1);
+        } else {
+            std::string error;
+            ok = preallocate(dl->fd, (uint64_t)total, error);
+            if (ok) {
+                plan_segments(*dl, (uint64_t)total);
+            } else {
+                dl->fail(error);
+            }
+        }
+        dl->total = total;
+    } else if (ok && status == 416 && total == 0) {
+        // An empty file has no byte 0 to ask for
+        ok = ftruncate(dl->fd, 0) == 0;
+        if (!ok) dl->fail(std::string("Can't size the download file: ") + strerror(errno));
+        dl->total = 0;
+    } else if (ok && status == 200) {
+        ok = ftruncate(dl->fd, (off_t)dl->received.load()) == 0;
+        if (!ok) dl->fail(std::string("Can't size the download file: ") + strerror(errno));
+        dl->total = (int64_t)dl->received.load();
+    } else if (ok) {
+        dl->fail(status == 206 ? "The server didn't report the file size" : "HTTP " + std::to_string(status));
+        ok = false;
+    }
+    
+    if (ok && !dl->segments.empty()) {
+        uint64_t on_disk = 0;
+        for (const DlSegment& seg : dl->segments) on_disk += seg.next - seg.start;
+        dl->received = on_disk;
+        xoron_metric_observe(g_m_dl_segments, dl->segments.size());
+        save_state(*dl);
+        
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(dl->mutex);
+            for (DlSegment& seg : dl->segments) {
+                if (seg.next >= seg.end) continue;
+                dl->running++;
+                workers.emplace_back([dl, &seg] {
+                    segment_main(dl, &seg);
+                    std::lock_guard<std::mutex> lock(dl->mutex);
+                    dl->running--;
+                    dl->cv.notify_all();
+                });
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(dl->mutex);
+            while (!dl->cv.wait_for(lock, std::chrono::milliseconds(DL_SAVE_MS), [&] { return dl->running == 0; })) {
+                lock.unlock();
+                save_state(*dl);
+                lock.lock();
+            }
+        }
+        for (std::thread& t : workers) t.join();
+        ok = !dl->stop;
+    }
+    
+    ok = ok && !dl->stop && (!dl->pinned || verify(*dl, (uint64_t)dl->total.load()));
+    if (ok && (fdatasync(dl->fd) != 0 || rename(dl->part_path.c_str(), dl->path.c_str()) != 0)) {
+        dl->fail(std::string("Can't move the download into place: ") + strerror(errno));
+        ok = false;
+    }
+    
+    std::lock_guard<std::mutex> lock(dl->mutex);
+    if (ok || dl->discard) {
+        unlink(dl->state_path.c_str());
+        if (!ok) unlink(dl->part_path.c_str());
+    } else {
+        save_state(*dl);
+    }
+    dl->done = true;
+    dl->cv.notify_all();
+}
+
+static int push_error(lua_State* L, const std::string& message) {
+    lua_pushnil(L);
+    lua_pushstring(L, message.c_str());
+    return 2;
+}
+
+static void read_options(lua_State* L, int idx, Download& dl, int& progress_idx) {
+    if (!lua_istable(L, idx)) return;
+    
+    lua_getfield(L, idx, "segments");
+    dl.requested_segments = std::clamp((int)luaL_optinteger(L, -1, DL_DEFAULT_SEGMENTS), 1, DL_MAX_SEGMENTS);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "sha256");
+    if (!lua_isnil(L, -1)) {
+        size_t len = 0;
+        uint8_t* digest = xoron_hex_decode(luaL_checkstring(L, -1), &len);
+        bool valid = digest && len == 32;
+        if (valid) memcpy(dl.sha256, digest, 32);
+        xoron_free(digest);
+        if (!valid) luaL_error(L, "sha256 must be 64 hex digits");
+        dl.pinned = true;
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "priority");
+    if (lua_isstring(L, -1)) {
+        const char* p = lua_tostring(L, -1);
+        if (strcmp(p, "interactive") == 0) {
+            dl.background = false;
+        } else if (strcmp(p, "background") != 0) {
+            luaL_error(L, "priority must be \"interactive\" or \"background\"");
+        }
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "headers");
+    if (lua_istable(L, -1)) {
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            if (lua_type(L, -2) == LUA_TSTRING && lua_isstring(L, -1)) {
+                dl.headers.emplace_back(lua_tostring(L, -2), lua_tostring(L, -1));
+            }
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "onProgress");
+    if (lua_isfunction(L, -1)) {
+        progress_idx = lua_gettop(L);
+    } else {
+        lua_pop(L, 1);
+    }
+}
+
+// Calls onProgress(received, total); false if it asked to cancel. A callback error is left on the stack
+static bool report_progress(lua_State* L, int progress_idx, Download& dl, bool* failed) {
+    int64_t total = dl.total.load();
+    lua_pushvalue(L, progress_idx);
+    lua_pushnumber(L, (double)dl.received.load());
+    if (total >= 0) {
+        lua_pushnumber(L, (double)total);
+    } else {
+        lua_pushnil(L);
+    }
+    if (lua_pcall(L, 2, 1, 0) != 0) {
+        *failed = true;
+        return false;
+    }
+    bool keep = !(lua_isboolean(L, -1) && !lua_toboolean(L, -1));
+    lua_pop(L, 1);
+    return keep;
+}
+
+// downloadfile(url, path, options) - Downloads url to a workspace file, resuming an earlier attempt
+// options: segments (parallel ranges, 4 by default, up to 16), sha256 (hex digest the file must match),
+//          priority ("background" by default, or "interactive"), headers (extra request headers),
+//          onProgress(received, total) (about every 100 ms; total is nil until known; returning false cancels)
+static int lua_downloadfile(lua_State* L) {
+    Download dl;
+    dl.url = luaL_checkstring(L, 1);
+    const char* path = luaL_checkstring(L, 2);
+    int progress_idx = 0;
+    read_options(L, 3, dl, progress_idx);
+    
+    dl.path = xoron_workspace_path(path);
+    if (dl.path.empty()) {
+        luaL_error(L, "Invalid path");
+        return 0;
+    }
+    dl.part_path = dl.path + ".part";
+    dl.state_path = dl.path + ".xdl";
+    dl.owner = lua_mainthread(L);
+    {
+        std::lock_guard<std::mutex> lock(g_active_mutex);
+        if (!g_active.insert(dl.path).second) return push_error(L, "Already downloading " + std::string(path));
+    }
+    
+    dl.fd = open(dl.part_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (dl.fd < 0) {
+        std::string error = std::string("Can't open ") + path + ".part: " + strerror(errno);
+        std::lock_guard<std::mutex> lock(g_active_mutex);
+        g_active.erase(dl.path);
+        return push_error(L, error);
+    }
+    xoron_metric_inc(g_m_dl_started, 1);
+    
+    std::thread worker(download_main, &dl);
+    bool callback_failed = false;
+    {
+        std::unique_lock<std::mutex> lock(dl.mutex);
+        while (!dl.cv.wait_for(lock, std::chrono::milliseconds(DL_PROGRESS_MS), [&] { return dl.done; })) {
+            if (!progress_idx || dl.stop) continue;
+            lock.unlock();
+            bool keep = report_progress(L, progress_idx, dl, &callback_failed);
+            lock.lock();
+            if (!keep) {
+                dl.cancelled = true;
+                dl.stop = true;
+                dl.cv.notify_all();
+            }
+        }
+    }
+    worker.join();
+    close(dl.fd);
+    {
+        std::lock_guard<std::mutex> lock(g_active_mutex);
+        g_active.erase(dl.path);
+    }
+    
+    if (callback_failed) lua_error(L);
+    if (dl.cancelled) return push_error(L, "Download cancelled");
+    if (!dl.error.empty()) return push_error(L, dl.error);
+    xoron_metric_inc(g_m_dl_completed, 1);
+    if (progress_idx) report_progress(L, progress_idx, dl, &callback_failed);
+    if (callback_failed) lua_error(L);
+    
+    lua_pushboolean(L, 1);
+    lua_pushnumber(L, (double)dl.total.load());
+    return 2;
+}
+
+void xoron_register_download(lua_State* L) {
+    lua_pushcfunction(L, lua_downloadfile, "downloadfile");
+    lua_setglobal(L, "downloadfile");
+}
@@ -1,6 +1,19 @@
 /*
  * xoron_drawing.cpp - Drawing library for executor
- * Provides: Drawing.new, Line, Circle, Square, Text, Triangle, Quad, Image
+ * Provides: Drawing.new, Line, Circle, Square, Text, Triangle, Quad, Image, Polyline, Polygon, Instanced, Layer
+ *
+ * Polyline and Polygon hold a whole point array and render as one path. The
+ * platform path object is cached on the drawing and rebuilt only after the
+ * points change, so a static 1000-point graph costs one draw call a frame.
+ * Instanced draws one shape at many positions, with optional per-instance
+ * colors and sizes, each set from an array or a Buffer in one call. Runs of
+ * instances that share a color are drawn together in one platform call.
+ * Drawing.tween animates properties natively: each frame the renderer
+ * advances every tween from the frame's timestamp, and only the completion
+ * callback is queued back to the script's VM through its channel.
+ * A static Layer caches its member drawings in an offscreen bitmap (a CGLayer,
+ * or an Android Bitmap) that is blitted each frame. Any change to a member
+ * marks the layer dirty, and only a dirty layer is rasterized again.
  * 
  * iOS: Uses CoreGraphics for rendering
  * Android: Uses native canvas rendering
@@ -16,6 +29,7 @@
 #include <mutex>
 #include <atomic>
 #include <cmath>
+#include <algorithm>
 
 #include "lua.h"
 #include "lualib.h"
@@ -30,18 +44,27 @@
         #include <objc/objc.h>
         #include <objc/runtime.h>
         #include <objc/message.h>
-        #include <algorithm>
         #define XORON_IOS_DRAWING 1
     #endif
 #elif defined(__ANDROID__)
     #include <android/native_window.h>
     #include <jni.h>
-    #include <algorithm>
     #define XORON_ANDROID_DRAWING 1
 #endif
 
 extern void xoron_set_error(const char* fmt, ...);
 
+// Metrics
+static const int g_m_drawing_created = xoron_metric_counter("drawing.created");
+static const int g_m_drawing_frames = xoron_metric_counter("drawing.frames");
+static const int g_m_drawing_render_us = xoron_metric_histogram("drawing.render_us");
+static const int g_m_drawing_path_builds = xoron_metric_counter("drawing.path_builds");
+static const int g_m_drawing_instance_batches = xoron_metric_counter("drawing.instance_batches");
+static const int g_m_drawing_tweens = xoron_metric_gauge("drawing.tweens");
+static const int g_m_drawing_tweens_completed = xoron_metric_counter("drawing.tweens_completed");
+static const int g_m_drawing_layer_rasters = xoron_metric_counter("drawing.layer_rasters");
+static const int g_m_drawing_layer_bytes = xoron_metric_gauge("drawing.layer_bytes");
+
 // Drawing object types
 enum DrawingType {
     DRAWING_LINE = 0,
@@ -50,7 +73,24 @@ enum DrawingType {
     DRAWING_TEXT,
     DRAWING_TRIANGLE,
     DRAWING_QUAD,
-    DRAWING_IMAGE
+    DRAWING_IMAGE,
+    DRAWING_POLYLINE,
+    DRAWING_POLYGON,
+    DRAWING_INSTANCED,
+    DRAWING_LAYER
+};
+
+// Instanced shapes; values of Drawing.Shapes
+enum InstanceShape {
+    INSTANCE_CIRCLE = 0,
+    INSTANCE_SQUARE
+};
+
+// Stroke joins for Polyline and Polygon; values of Drawing.LineJoins
+enum LineJoin {
+    LINE_JOIN_MITER = 0,
+    LINE_JOIN_ROUND,
+    LINE_JOIN_BEVEL
 };
 
 // Color structure
@@ -92,10 +132,29 @@ struct DrawingObject {
     std::string imageData;      // Image
     float rounding;             // Square
     std::string font;           // Text
+    std::vector<float> points;  // Polyline, Polygon: x0, y0, x1, y1, ...; Instanced: positions
+    std::vector<float> instanceColors;  // Instanced: r, g, b per instance; Color past the end
+    std::vector<float> instanceSizes;   // Instanced: radius or half-width per instance; Radius past the end
+    int shape;                  // Instanced
+    bool closed;                // Polyline; a Polygon is always closed
+    int lineJoin;               // Polyline, Polygon
+    void* platformPath;         // Polyline, Polygon: cached CGPathRef or Path global ref
+    bool pathDirty;             // points changed since platformPath was built
+    uint32_t layer;             // id of the Layer this drawing is cached in, or 0
+    int layerRef;               // ref keeping that Layer's userdata alive, or LUA_NOREF
+    bool isStatic;              // Layer: cached in a bitmap rather than drawn live
+    bool layerDirty;            // Layer: a member changed since the bitmap was rasterized
+    void* platformLayer;        // Layer: cached CGLayerRef or Bitmap global ref
+    int layerWidth, layerHeight;    // Layer: size of platformLayer in points
+    size_t layerBytes;          // Layer: pixel memory of platformLayer
     
     DrawingObject() : type(DRAWING_LINE), visible(true), transparency(0), 
                       zindex(0), id(0), radius(0), textSize(16), center(false),
-                      outline(false), filled(false), thickness(1), rounding(0) {}
+                      outline(false), filled(false), thickness(1), rounding(0),
+                      shape(INSTANCE_CIRCLE), closed(false), lineJoin(LINE_JOIN_MITER),
+                      platformPath(nullptr), pathDirty(true), layer(0), layerRef(LUA_NOREF),
+                      isStatic(true), layerDirty(true), platformLayer(nullptr),
+                      layerWidth(0), layerHeight(0), layerBytes(0) {}
 };
 
 // Drawing state
@@ -108,6 +167,236 @@ static std::vector<std::string> g_fonts = {"UI", "System", "RobotoMono", "Legacy
 static float g_screen_width = 844.0f;
 static float g_screen_height = 390.0f;
 
+static Color3 instance_color(const DrawingObject* obj, size_t i) {
+    if ((i + 1) * 3 > obj->instanceColors.size()) return obj->color;
+    const float* c = &obj->instanceColors[i * 3];
+    return Color3(c[0], c[1], c[2]);
+}
+
+static float instance_size(const DrawingObject* obj, size_t i) {
+    return i < obj->instanceSizes.size() ? obj->instanceSizes[i] : obj->radius;
+}
+
+// ==================== Layers ====================
+//
+// Members of a Layer are drawn at the layer's ZIndex, ordered among themselves
+// by their own. Everything that changes a member marks its layer dirty, so a
+// static layer is rasterized once and then only blitted. A member whose layer
+// was removed draws on its own again.
+
+// Marks the layer obj is cached in for rasterizing again; the caller holds g_drawing_mutex
+static void invalidate_layer(const DrawingObject* obj) {
+    if (!obj->layer) return;
+    auto it = g_drawings.find(obj->layer);
+    if (it != g_drawings.end()) it->second->layerDirty = true;
+}
+
+// Region a layer caches, in points: Position and Size, or the whole screen while Size is zero
+static void layer_bounds(const DrawingObject* layer, float* x, float* y, float* w, float* h) {
+    if (layer->size.x <= 0 || layer->size.y <= 0) {
+        *x = 0;
+        *y = 0;
+        *w = g_screen_width;
+        *h = g_screen_height;
+    } else {
+        *x = layer->position.x;
+        *y = layer->position.y;
+        *w = layer->size.x;
+        *h = layer->size.y;
+    }
+}
+
+// Visible drawings in ZIndex order, with layer members grouped by layer id; the caller holds g_drawing_mutex
+static void collect_drawings(std::vector<DrawingObject*>& sorted,
+                             std::unordered_map<uint32_t, std::vector<DrawingObject*>>& members) {
+    for (auto& pair : g_drawings) {
+        DrawingObject* obj = pair.second;
+        if (!obj || !obj->visible) continue;
+        if (obj->layer && g_drawings.count(obj->layer)) {
+            members[obj->layer].push_back(obj);
+        } else {
+            sorted.push_back(obj);
+        }
+    }
+    auto by_zindex = [](DrawingObject* a, DrawingObject* b) {
+        return a->zindex < b->zindex;
+    };
+    std::sort(sorted.begin(), sorted.end(), by_zindex);
+    for (auto& group : members) {
+        std::sort(group.second.begin(), group.second.end(), by_zindex);
+    }
+}
+
+// ==================== Tweens ====================
+//
+// A tween holds one track per property, from the value when it was created to
+// the goal. Tracks point at the drawing by id, so a tween whose drawing was
+// removed is dropped on the next frame. A newer tween of the same property
+// takes it over from an older one; a tween left with no tracks is cancelled.
+
+enum EasingStyle {
+    EASE_LINEAR = 0,
+    EASE_QUAD_IN, EASE_QUAD_OUT, EASE_QUAD_IN_OUT,
+    EASE_CUBIC_IN, EASE_CUBIC_OUT, EASE_CUBIC_IN_OUT,
+    EASE_SINE_IN, EASE_SINE_OUT, EASE_SINE_IN_OUT,
+    EASE_BACK_IN, EASE_BACK_OUT,
+    EASE_ELASTIC_OUT,
+    EASE_BOUNCE_OUT,
+    EASE_COUNT
+};
+
+// Names in Drawing.Easing, indexed by EasingStyle
+static const char* const g_easing_names[EASE_COUNT] = {
+    "Linear", "QuadIn", "QuadOut", "QuadInOut", "CubicIn", "CubicOut", "CubicInOut",
+    "SineIn", "SineOut", "SineInOut", "BackIn", "BackOut", "ElasticOut", "BounceOut"
+};
+
+struct TweenTrack {
+    int atom;                   // property
+    int components;             // 1 for numbers, 2 for Vector2, 3 for Color3
+    float from[3];
+    float to[3];
+};
+
+struct Tween {
+    uint32_t id;
+    uint32_t drawing;
+    int easing;
+    uint64_t start_us;
+    uint64_t duration_us;
+    std::vector<TweenTrack> tracks;
+    XoronChannel* channel;      // retained; where the callback runs
+    int callback;               // ref in the channel's VM, or LUA_NOREF
+};
+
+static std::vector<Tween> g_tweens;     // guarded by g_drawing_mutex
+static uint32_t g_next_tween_id = 1;
+
+static float ease(int style, float t) {
+    const float pi = 3.14159265f;
+    switch (style) {
+    case EASE_QUAD_IN: return t * t;
+    case EASE_QUAD_OUT: return t * (2 - t);
+    case EASE_QUAD_IN_OUT: return t < 0.5f ? 2 * t * t : 1 - 2 * (1 - t) * (1 - t);
+    case EASE_CUBIC_IN: return t * t * t;
+    case EASE_CUBIC_OUT: { float u = 1 - t; return 1 - u * u * u; }
+    case EASE_CUBIC_IN_OUT: return t < 0.5f ? 4 * t * t * t : 1 - 4 * (1 - t) * (1 - t) * (1 - t);
+    case EASE_SINE_IN: return 1 - cosf(t * pi / 2);
+    case EASE_SINE_OUT: return sinf(t * pi / 2);
+    case EASE_SINE_IN_OUT: return (1 - cosf(t * pi)) / 2;
+    case EASE_BACK_IN: return t * t * (2.70158f * t - 1.70158f);
+    case EASE_BACK_OUT: { float u = t - 1; return 1 + u * u * (2.70158f * u + 1.70158f); }
+    case EASE_ELASTIC_OUT:
+        return t <= 0 || t >= 1 ? t : powf(2, -10 * t) * sinf((t * 10 - 0.75f) * (2 * pi / 3)) + 1;
+    case EASE_BOUNCE_OUT:
+        if (t < 1 / 2.75f) return 7.5625f * t * t;
+        if (t < 2 / 2.75f) { t -= 1.5f / 2.75f; return 7.5625f * t * t + 0.75f; }
+        if (t < 2.5f / 2.75f) { t -= 2.25f / 2.75f; return 7.5625f * t * t + 0.9375f; }
+        t -= 2.625f / 2.75f;
+        return 7.5625f * t * t + 0.984375f;
+    default: return t;
+    }
+}
+
+// The floats behind a tweenable property, or null; Vector2 and Color3 are stored as consecutive floats
+static float* tween_field(DrawingObject* obj, int atom, int* components) {
+    *components = 2;
+    switch (atom) {
+    case XORON_ATOM_Position: return &obj->position.x;
+    case XORON_ATOM_Size: return &obj->size.x;
+    case XORON_ATOM_From: return &obj->from.x;
+    case XORON_ATOM_To: return &obj->to.x;
+    case XORON_ATOM_PointA: return &obj->pointA.x;
+    case XORON_ATOM_PointB: return &obj->pointB.x;
+    case XORON_ATOM_PointC: return &obj->pointC.x;
+    case XORON_ATOM_PointD: return &obj->pointD.x;
+    }
+    *components = 3;
+    switch (atom) {
+    case XORON_ATOM_Color: return &obj->color.r;
+    case XORON_ATOM_OutlineColor: return &obj->outlineColor.r;
+    }
+    *components = 1;
+    switch (atom) {
+    case XORON_ATOM_Transparency: return &obj->transparency;
+    case XORON_ATOM_Radius: return &obj->radius;
+    case XORON_ATOM_Thickness: return &obj->thickness;
+    case XORON_ATOM_TextSize: return &obj->textSize;
+    case XORON_ATOM_Rounding: return &obj->rounding;
+    }
+    return nullptr;
+}
+
+// Queues the callback, if any, with whether the tween ran to the end; call without g_drawing_mutex
+static void finish_tween(Tween& tween, bool completed) {
+    if (completed) xoron_metric_inc(g_m_drawing_tweens_completed, 1);
+    if (tween.callback != LUA_NOREF) {
+        xoron_message_t msg = {};
+        msg.type = XORON_MSG_UI;
+        msg.topic = "drawing.tween";
+        msg.arg = tween.callback;
+        msg.x = completed ? 1 : 0;
+        xoron_channel_send(tween.channel, &msg);
+    }
+    xoron_channel_release(tween.channel);
+}
+
+// Moves every tween to the frame time; called by the renderers before they draw
+static void advance_tweens(uint64_t now_us) {
+    std::vector<std::pair<Tween, bool>> finished;
+    {
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        if (g_tweens.empty()) return;
+        for (size_t i = 0; i < g_tweens.size();) {
+            Tween& tween = g_tweens[i];
+            auto it = g_drawings.find(tween.drawing);
+            if (it == g_drawings.end()) {
+                finished.emplace_back(std::move(tween), false);
+                g_tweens.erase(g_tweens.begin() + i);
+                continue;
+            }
+            
+            uint64_t elapsed = now_us > tween.start_us ? now_us - tween.start_us : 0;
+            bool done = elapsed >= tween.duration_us;
+            float k = done ? 1.0f : ease(tween.easing, (float)((double)elapsed / tween.duration_us));
+            for (const TweenTrack& track : tween.tracks) {
+                int components = 0;
+                float* field = tween_field(it->second, track.atom, &components);
+                for (int c = 0; c < track.components; c++) {
+                    field[c] = done ? track.to[c] : track.from[c] + (track.to[c] - track.from[c]) * k;
+                }
+                if (it->second->type == DRAWING_LAYER &&
+                    (track.atom == XORON_ATOM_Position || track.atom == XORON_ATOM_Size)) {
+                    it->second->layerDirty = true;
+                }
+            }
+            invalidate_layer(it->second);
+            if (done) {
+                finished.emplace_back(std::move(tween), true);
+                g_tweens.erase(g_tweens.begin() + i);
+                continue;
+            }
+            i++;
+        }
+        xoron_metric_set(g_m_drawing_tweens, (int64_t)g_tweens.size());
+    }
+    for (auto& f : finished) finish_tween(f.first, f.second);
+}
+
+// End of the run of instances from start that share a color, and the size too when same_size is set
+static size_t instance_run_end(const DrawingObject* obj, size_t start, size_t count, bool same_size) {
+    Color3 c = instance_color(obj, start);
+    float size = instance_size(obj, start);
+    size_t end = start + 1;
+    while (end < count) {
+        Color3 next = instance_color(obj, end);
+        if (next.r != c.r || next.g != c.g || next.b != c.b) break;
+        if (same_size && instance_size(obj, end) != size) break;
+        end++;
+    }
+    return end;
+}
+
 #ifdef XORON_IOS_DRAWING
 // iOS CoreGraphics rendering context
 static CGContextRef g_cg_context = nullptr;
@@ -358,35 +647,170 @@ static void ios_draw_image(const DrawingObject* obj) {
     CFRelease(base64Data);
 }
 
+static void ios_draw_path(DrawingObject* obj) {
+    if (!g_cg_context || !obj->visible || obj->points.size() < 4) return;
+    
+    if (obj->pathDirty || !obj->platformPath) {
+        if (obj->platformPath) CGPathRelease((CGPathRef)obj->platformPath);
+        std::vector<CGPoint> points(obj->points.size() / 2);
+        for (size_t i = 0; i < points.size(); i++) {
+            points[i] = CGPointMake(obj->points[i * 2], obj->points[i * 2 + 1]);
+        }
+        CGMutablePathRef path = CGPathCreateMutable();
+        CGPathAddLines(path, NULL, points.data(), points.size());
+        if (obj->closed || obj->type == DRAWING_POLYGON) CGPathCloseSubpath(path);
+        obj->platformPath = path;
+        obj->pathDirty = false;
+        xoron_metric_inc(g_m_drawing_path_builds, 1);
+    }
+    
+    CGContextSaveGState(g_cg_context);
+    CGContextAddPath(g_cg_context, (CGPathRef)obj->platformPath);
+    if (obj->filled && obj->type == DRAWING_POLYGON) {
+        CGContextSetRGBFillColor(g_cg_context, obj->color.r, obj->color.g, obj->color.b, 1.0 - obj->transparency);
+        CGContextFillPath(g_cg_context);
+    } else {
+        static const CGLineJoin joins[] = {kCGLineJoinMiter, kCGLineJoinRound, kCGLineJoinBevel};
+        CGContextSetRGBStrokeColor(g_cg_context, obj->color.r, obj->color.g, obj->color.b, 1.0 - obj->transparency);
+        CGContextSetLineWidth(g_cg_context, obj->thickness);
+        CGContextSetLineJoin(g_cg_context, joins[obj->lineJoin]);
+        CGContextStrokePath(g_cg_context);
+    }
+    CGContextRestoreGState(g_cg_context);
+}
+
+static void ios_draw_instances(const DrawingObject* obj) {
+    if (!g_cg_context || !obj->visible) return;
+    
+    size_t count = obj->points.size() / 2;
+    CGContextSaveGState(g_cg_context);
+    CGContextSetLineWidth(g_cg_context, obj->thickness);
+    for (size_t i = 0; i < count;) {
+        size_t end = instance_run_end(obj, i, count, false);
+        Color3 c = instance_color(obj, i);
+        CGMutablePathRef path = CGPathCreateMutable();
+        for (; i < end; i++) {
+            float r = instance_size(obj, i);
+            CGRect rect = CGRectMake(obj->points[i * 2] - r, obj->points[i * 2 + 1] - r, r * 2, r * 2);
+            if (obj->shape == INSTANCE_CIRCLE) {
+                CGPathAddEllipseInRect(path, NULL, rect);
+            } else {
+                CGPathAddRect(path, NULL, rect);
+            }
+        }
+        CGContextAddPath(g_cg_context, path);
+        if (obj->filled) {
+            CGContextSetRGBFillColor(g_cg_context, c.r, c.g, c.b, 1.0 - obj->transparency);
+            CGContextFillPath(g_cg_context);
+        } else {
+            CGContextSetRGBStrokeColor(g_cg_context, c.r, c.g, c.b, 1.0 - obj->transparency);
+            CGContextStrokePath(g_cg_context);
+        }
+        CGPathRelease(path);
+        xoron_metric_inc(g_m_drawing_instance_batches, 1);
+    }
+    CGContextRestoreGState(g_cg_context);
+}
+
+static void ios_draw_object(DrawingObject* obj) {
+    switch (obj->type) {
+        case DRAWING_LINE: ios_draw_line(obj); break;
+        case DRAWING_CIRCLE: ios_draw_circle(obj); break;
+        case DRAWING_SQUARE: ios_draw_rect(obj); break;
+        case DRAWING_TEXT: ios_draw_text(obj); break;
+        case DRAWING_TRIANGLE: ios_draw_triangle(obj); break;
+        case DRAWING_QUAD: ios_draw_quad(obj); break;
+        case DRAWING_IMAGE: ios_draw_image(obj); break;
+        case DRAWING_POLYLINE:
+        case DRAWING_POLYGON: ios_draw_path(obj); break;
+        case DRAWING_INSTANCED: ios_draw_instances(obj); break;
+        case DRAWING_LAYER: break;
+    }
+}
+
+// Frees a layer's cached CGLayer; the caller holds g_drawing_mutex
+static void ios_release_layer(DrawingObject* layer) {
+    if (!layer->platformLayer) return;
+    CGLayerRelease((CGLayerRef)layer->platformLayer);
+    xoron_metric_adjust(g_m_drawing_layer_bytes, -(int64_t)layer->layerBytes);
+    layer->platformLayer = nullptr;
+    layer->layerBytes = 0;
+}
+
+// Blits a static layer from its CGLayer, rasterizing the members into it first when it is dirty or resized
+static void ios_draw_layer(DrawingObject* layer, const std::vector<DrawingObject*>& members) {
+    if (!layer->isStatic) {
+        ios_release_layer(layer);
+        for (DrawingObject* obj : members) ios_draw_object(obj);
+        return;
+    }
+    
+    float x, y, w, h;
+    layer_bounds(layer, &x, &y, &w, &h);
+    int width = (int)ceilf(w), height = (int)ceilf(h);
+    if (width < 1 || height < 1) return;
+    
+    CGContextRef ctx = g_cg_context;
+    if (layer->platformLayer && (layer->layerWidth != width || layer->layerHeight != height)) {
+        ios_release_layer(layer);
+    }
+    if (!layer->platformLayer) {
+        // Created from the frame's context, so it matches its pixel format and scale
+        CGLayerRef cgLayer = CGLayerCreateWithContext(ctx, CGSizeMake(width, height), NULL);
+        if (!cgLayer) return;
+        CGSize pixels = CGSizeApplyAffineTransform(CGSizeMake(width, height),
+            CGContextGetUserSpaceToDeviceSpaceTransform(ctx));
+        layer->platformLayer = cgLayer;
+        layer->layerWidth = width;
+        layer->layerHeight = height;
+        layer->layerBytes = (size_t)ceil(fabs(pixels.width)) * (size_t)ceil(fabs(pixels.height)) * 4;
+        layer->layerDirty = true;
+        xoron_metric_adjust(g_m_drawing_layer_bytes, (int64_t)layer->layerBytes);
+    }
+    
+    CGLayerRef cgLayer = (CGLayerRef)layer->platformLayer;
+    if (layer->layerDirty) {
+        CGContextRef layerContext = CGLayerGetContext(cgLayer);
+        CGContextClearRect(layerContext, CGRectMake(0, 0, width, height));
+        CGContextSaveGState(layerContext);
+        CGContextSetTextMatrix(layerContext, CGContextGetTextMatrix(ctx));
+        CGContextTranslateCTM(layerContext, -x, -y);
+        g_cg_context = layerContext;
+        for (DrawingObject* obj : members) ios_draw_object(obj);
+        g_cg_context = ctx;
+        CGContextRestoreGState(layerContext);
+        layer->layerDirty = false;
+        xoron_metric_inc(g_m_drawing_layer_rasters, 1);
+    }
+    
+    CGContextSaveGState(ctx);
+    CGContextSetAlpha(ctx, 1.0 - layer->transparency);
+    CGContextDrawLayerAtPoint(ctx, CGPointMake(x, y), cgLayer);
+    CGContextRestoreGState(ctx);
+}
+
 // Render all drawing objects (called from render loop)
 extern "C" void xoron_drawing_render_ios(CGContextRef ctx) {
     if (!ctx) return;
     
     g_cg_context = ctx;
+    XoronMetricTimer timer(g_m_drawing_render_us);
+    xoron_metric_inc(g_m_drawing_frames, 1);
+    advance_tweens(xoron_metric_now_us());
     
     std::lock_guard<std::mutex> lock(g_drawing_mutex);
     
     // Sort by zindex
     std::vector<DrawingObject*> sorted;
-    for (auto& pair : g_drawings) {
-        if (pair.second && pair.second->visible) {
-            sorted.push_back(pair.second);
-        }
-    }
-    std::sort(sorted.begin(), sorted.end(), [](DrawingObject* a, DrawingObject* b) {
-        return a->zindex < b->zindex;
-    });
+    std::unordered_map<uint32_t, std::vector<DrawingObject*>> members;
+    collect_drawings(sorted, members);
     
     // Render each object
     for (DrawingObject* obj : sorted) {
-        switch (obj->type) {
-            case DRAWING_LINE: ios_draw_line(obj); break;
-            case DRAWING_CIRCLE: ios_draw_circle(obj); break;
-            case DRAWING_SQUARE: ios_draw_rect(obj); break;
-            case DRAWING_TEXT: ios_draw_text(obj); break;
-            case DRAWING_TRIANGLE: ios_draw_triangle(obj); break;
-            case DRAWING_QUAD: ios_draw_quad(obj); break;
-            case DRAWING_IMAGE: ios_draw_image(obj); break;
+        if (obj->type == DRAWING_LAYER) {
+            ios_draw_layer(obj, members[obj->id]);
+        } else {
+            ios_draw_object(obj);
         }
     }
     
@@ -400,6 +824,7 @@ static JavaVM* g_android_jvm = nullptr;
 static jobject g_android_canvas = nullptr;
 static jclass g_paint_class = nullptr;
 static jclass g_canvas_class = nullptr;
+static std::vector<jobject> g_android_stale_refs;  // cached Paths and Bitmaps no longer used, freed by the next render
 
 // Initialize Android drawing (called from JNI)
 extern "C" JNIEXPORT void JNICALL
@@ -615,10 +1040,224 @@ static void android_draw_image(JNIEnv* env, jobject canvas, jobject paint, const
     env->DeleteLocalRef(bitmap);
 }
 
+static void android_draw_path(JNIEnv* env, jobject canvas, jobject paint, DrawingObject* obj) {
+    if (!obj->visible || obj->points.size() < 4) return;
+    
+    jclass pathClass = env->FindClass("android/graphics/Path");
+    if (obj->pathDirty || !obj->platformPath) {
+        jobject path = (jobject)obj->platformPath;
+        if (path) {
+            jmethodID rewind = env->GetMethodID(pathClass, "rewind", "()V");
+            env->CallVoidMethod(path, rewind);
+        } else {
+            jmethodID pathInit = env->GetMethodID(pathClass, "<init>", "()V");
+            jobject local = env->NewObject(pathClass, pathInit);
+            path = env->NewGlobalRef(local);
+            env->DeleteLocalRef(local);
+            obj->platformPath = path;
+        }
+        
+        jmethodID moveTo = env->GetMethodID(pathClass, "moveTo", "(FF)V");
+        jmethodID lineTo = env->GetMethodID(pathClass, "lineTo", "(FF)V");
+        env->CallVoidMethod(path, moveTo, obj->points[0], obj->points[1]);
+        for (size_t i = 2; i + 1 < obj->points.size(); i += 2) {
+            env->CallVoidMethod(path, lineTo, obj->points[i], obj->points[i + 1]);
+        }
+        if (obj->closed || obj->type == DRAWING_POLYGON) {
+            jmethodID close = env->GetMethodID(pathClass, "close", "()V");
+            env->CallVoidMethod(path, close);
+        }
+        obj->pathDirty = false;
+        xoron_metric_inc(g_m_drawing_path_builds, 1);
+    }
+    env->DeleteLocalRef(pathClass);
+    
+    jmethodID setColor = env->GetMethodID(g_paint_class, "setColor", "(I)V");
+    int color = (int)(obj->color.r * 255) << 16 | (int)(obj->color.g * 255) << 8 | (int)(obj->color.b * 255);
+    color |= (int)((1.0f - obj->transparency) * 255) << 24;
+    env->CallVoidMethod(paint, setColor, color);
+    
+    bool fill = obj->filled && obj->type == DRAWING_POLYGON;
+    jmethodID setStyle = env->GetMethodID(g_paint_class, "setStyle", "(Landroid/graphics/Paint$Style;)V");
+    jclass styleClass = env->FindClass("android/graphics/Paint$Style");
+    jfieldID styleField = env->GetStaticFieldID(styleClass, fill ? "FILL" : "STROKE", "Landroid/graphics/Paint$Style;");
+    jobject style = env->GetStaticObjectField(styleClass, styleField);
+    env->CallVoidMethod(paint, setStyle, style);
+    
+    // The paint is shared by every object, so the join goes back to the default afterwards
+    static const char* const joins[] = {"MITER", "ROUND", "BEVEL"};
+    jmethodID setStrokeJoin = env->GetMethodID(g_paint_class, "setStrokeJoin", "(Landroid/graphics/Paint$Join;)V");
+    jclass joinClass = env->FindClass("android/graphics/Paint$Join");
+    if (!fill) {
+        jmethodID setStrokeWidth = env->GetMethodID(g_paint_class, "setStrokeWidth", "(F)V");
+        env->CallVoidMethod(paint, setStrokeWidth, obj->thickness);
+        jfieldID joinField = env->GetStaticFieldID(joinClass, joins[obj->lineJoin], "Landroid/graphics/Paint$Join;");
+        env->CallVoidMethod(paint, setStrokeJoin, env->GetStaticObjectField(joinClass, joinField));
+    }
+    
+    jmethodID drawPath = env->GetMethodID(g_canvas_class, "drawPath", "(Landroid/graphics/Path;Landroid/graphics/Paint;)V");
+    env->CallVoidMethod(canvas, drawPath, (jobject)obj->platformPath, paint);
+    
+    if (!fill && obj->lineJoin != LINE_JOIN_MITER) {
+        jfieldID miterField = env->GetStaticFieldID(joinClass, joins[LINE_JOIN_MITER], "Landroid/graphics/Paint$Join;");
+        env->CallVoidMethod(paint, setStrokeJoin, env->GetStaticObjectField(joinClass, miterField));
+    }
+}
+
+// Filled instances go through drawPoints: the positions are copied to Java once, and each run of
+// instances sharing a color and size is one call, drawn with a round or square cap as wide as the
+// shape. Outlines have no such call and are drawn one by one
+static void android_draw_instances(JNIEnv* env, jobject canvas, jobject paint, const DrawingObject* obj) {
+    size_t count = obj->points.size() / 2;
+    if (!obj->visible || count == 0) return;
+    
+    jmethodID setColor = env->GetMethodID(g_paint_class, "setColor", "(I)V");
+    jmethodID setStrokeWidth = env->GetMethodID(g_paint_class, "setStrokeWidth", "(F)V");
+    jmethodID setStyle = env->GetMethodID(g_paint_class, "setStyle", "(Landroid/graphics/Paint$Style;)V");
+    jclass styleClass = env->FindClass("android/graphics/Paint$Style");
+    jfieldID styleField = env->GetStaticFieldID(styleClass, obj->filled ? "FILL" : "STROKE", "Landroid/graphics/Paint$Style;");
+    env->CallVoidMethod(paint, setStyle, env->GetStaticObjectField(styleClass, styleField));
+    auto argb = [&](const Color3& c) {
+        int color = (int)(c.r * 255) << 16 | (int)(c.g * 255) << 8 | (int)(c.b * 255);
+        return color | (int)((1.0f - obj->transparency) * 255) << 24;
+    };
+    
+    if (obj->filled) {
+        jmethodID setStrokeCap = env->GetMethodID(g_paint_class, "setStrokeCap", "(Landroid/graphics/Paint$Cap;)V");
+        jclass capClass = env->FindClass("android/graphics/Paint$Cap");
+        const char* cap = obj->shape == INSTANCE_CIRCLE ? "ROUND" : "SQUARE";
+        jfieldID capField = env->GetStaticFieldID(capClass, cap, "Landroid/graphics/Paint$Cap;");
+        env->CallVoidMethod(paint, setStrokeCap, env->GetStaticObjectField(capClass, capField));
+        
+        jfloatArray positions = env->NewFloatArray((jsize)obj->points.size());
+        env->SetFloatArrayRegion(positions, 0, (jsize)obj->points.size(), obj->points.data());
+        jmethodID drawPoints = env->GetMethodID(g_canvas_class, "drawPoints", "([FIILandroid/graphics/Paint;)V");
+        for (size_t i = 0; i < count;) {
+            size_t end = instance_run_end(obj, i, count, true);
+            env->CallVoidMethod(paint, setColor, argb(instance_color(obj, i)));
+            env->CallVoidMethod(paint, setStrokeWidth, instance_size(obj, i) * 2);
+            env->CallVoidMethod(canvas, drawPoints, positions, (jint)(i * 2), (jint)((end - i) * 2), paint);
+            xoron_metric_inc(g_m_drawing_instance_batches, 1);
+            i = end;
+        }
+        env->DeleteLocalRef(positions);
+        
+        // The paint is shared by every object, so the cap goes back to the default
+        jfieldID buttField = env->GetStaticFieldID(capClass, "BUTT", "Landroid/graphics/Paint$Cap;");
+        env->CallVoidMethod(paint, setStrokeCap, env->GetStaticObjectField(capClass, buttField));
+        return;
+    }
+    
+    env->CallVoidMethod(paint, setStrokeWidth, obj->thickness);
+    jmethodID drawCircle = env->GetMethodID(g_canvas_class, "drawCircle", "(FFFP)V");
+    jmethodID drawRect = env->GetMethodID(g_canvas_class, "drawRect", "(FFFFP)V");
+    for (size_t i = 0; i < count;) {
+        size_t end = instance_run_end(obj, i, count, false);
+        env->CallVoidMethod(paint, setColor, argb(instance_color(obj, i)));
+        for (; i < end; i++) {
+            float x = obj->points[i * 2], y = obj->points[i * 2 + 1], r = instance_size(obj, i);
+            if (obj->shape == INSTANCE_CIRCLE) {
+                env->CallVoidMethod(canvas, drawCircle, x, y, r, paint);
+            } else {
+                env->CallVoidMethod(canvas, drawRect, x - r, y - r, x + r, y + r, paint);
+            }
+        }
+        xoron_metric_inc(g_m_drawing_instance_batches, 1);
+    }
+}
+
+static void android_draw_object(JNIEnv* env, jobject canvas, jobject paint, DrawingObject* obj) {
+    switch (obj->type) {
+        case DRAWING_LINE: android_draw_line(env, canvas, paint, obj); break;
+        case DRAWING_CIRCLE: android_draw_circle(env, canvas, paint, obj); break;
+        case DRAWING_SQUARE: android_draw_rect(env, canvas, paint, obj); break;
+        case DRAWING_TEXT: android_draw_text(env, canvas, paint, obj); break;
+        case DRAWING_TRIANGLE: android_draw_triangle(env, canvas, paint, obj); break;
+        case DRAWING_QUAD: android_draw_quad(env, canvas, paint, obj); break;
+        case DRAWING_IMAGE: android_draw_image(env, canvas, paint, obj); break;
+        case DRAWING_POLYLINE:
+        case DRAWING_POLYGON: android_draw_path(env, canvas, paint, obj); break;
+        case DRAWING_INSTANCED: android_draw_instances(env, canvas, paint, obj); break;
+        case DRAWING_LAYER: break;
+    }
+}
+
+// Drops a layer's cached Bitmap; the caller holds g_drawing_mutex
+static void android_release_layer(DrawingObject* layer) {
+    if (!layer->platformLayer) return;
+    g_android_stale_refs.push_back((jobject)layer->platformLayer);
+    xoron_metric_adjust(g_m_drawing_layer_bytes, -(int64_t)layer->layerBytes);
+    layer->platformLayer = nullptr;
+    layer->layerBytes = 0;
+}
+
+// Blits a static layer from its Bitmap, rasterizing the members into it first when it is dirty or resized
+static void android_draw_layer(JNIEnv* env, jobject canvas, jobject paint, DrawingObject* layer,
+                               const std::vector<DrawingObject*>& members) {
+    if (!layer->isStatic) {
+        android_release_layer(layer);
+        for (DrawingObject* obj : members) android_draw_object(env, canvas, paint, obj);
+        return;
+    }
+    
+    float x, y, w, h;
+    layer_bounds(layer, &x, &y, &w, &h);
+    int width = (int)ceilf(w), height = (int)ceilf(h);
+    if (width < 1 || height < 1) return;
+    
+    jclass bitmapClass = env->FindClass("android/graphics/Bitmap");
+    if (layer->platformLayer && (layer->layerWidth != width || layer->layerHeight != height)) {
+        android_release_layer(layer);
+    }
+    if (!layer->platformLayer) {
+        jclass configClass = env->FindClass("android/graphics/Bitmap$Config");
+        jfieldID argbField = env->GetStaticFieldID(configClass, "ARGB_8888", "Landroid/graphics/Bitmap$Config;");
+        jobject config = env->GetStaticObjectField(configClass, argbField);
+        jmethodID createBitmap = env->GetStaticMethodID(bitmapClass, "createBitmap",
+            "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
+        jobject bitmap = env->CallStaticObjectMethod(bitmapClass, createBitmap, width, height, config);
+        env->DeleteLocalRef(config);
+        if (!bitmap) return;
+        
+        layer->platformLayer = env->NewGlobalRef(bitmap);
+        env->DeleteLocalRef(bitmap);
+        layer->layerWidth = width;
+        layer->layerHeight = height;
+        layer->layerBytes = (size_t)width * height * 4;
+        layer->layerDirty = true;
+        xoron_metric_adjust(g_m_drawing_layer_bytes, (int64_t)layer->layerBytes);
+    }
+    
+    jobject bitmap = (jobject)layer->platformLayer;
+    if (layer->layerDirty) {
+        jmethodID eraseColor = env->GetMethodID(bitmapClass, "eraseColor", "(I)V");
+        env->CallVoidMethod(bitmap, eraseColor, 0);
+        
+        jmethodID canvasInit = env->GetMethodID(g_canvas_class, "<init>", "(Landroid/graphics/Bitmap;)V");
+        jobject layerCanvas = env->NewObject(g_canvas_class, canvasInit, bitmap);
+        jmethodID translate = env->GetMethodID(g_canvas_class, "translate", "(FF)V");
+        env->CallVoidMethod(layerCanvas, translate, -x, -y);
+        for (DrawingObject* obj : members) android_draw_object(env, layerCanvas, paint, obj);
+        env->DeleteLocalRef(layerCanvas);
+        layer->layerDirty = false;
+        xoron_metric_inc(g_m_drawing_layer_rasters, 1);
+    }
+    
+    jmethodID setAlpha = env->GetMethodID(g_paint_class, "setAlpha", "(I)V");
+    env->CallVoidMethod(paint, setAlpha, (int)((1.0f - layer->transparency) * 255));
+    jmethodID drawBitmap = env->GetMethodID(g_canvas_class, "drawBitmap",
+        "(Landroid/graphics/Bitmap;FFLandroid/graphics/Paint;)V");
+    env->CallVoidMethod(canvas, drawBitmap, bitmap, x, y, paint);
+    env->CallVoidMethod(paint, setAlpha, 255);
+}
+
 // Render all drawing objects for Android (called from render loop)
 extern "C" JNIEXPORT void JNICALL
 Java_com_xoron_Drawing_render(JNIEnv* env, jobject obj, jobject canvas) {
     if (!canvas) return;
+    XoronMetricTimer timer(g_m_drawing_render_us);
+    xoron_metric_inc(g_m_drawing_frames, 1);
+    advance_tweens(xoron_metric_now_us());
     
     // Create paint object
     jmethodID paintInit = env->GetMethodID(g_paint_class, "<init>", "()V");
@@ -629,28 +1268,20 @@ Java_com_xoron_Drawing_render(JNIEnv* env, jobject obj, jobject canvas) {
     env->CallVoidMethod(paint, setAntiAlias, JNI_TRUE);
     
     std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    for (jobject ref : g_android_stale_refs) env->DeleteGlobalRef(ref);
+    g_android_stale_refs.clear();
     
     // Sort by zindex
     std::vector<DrawingObject*> sorted;
-    for (auto& pair : g_drawings) {
-        if (pair.second && pair.second->visible) {
-            sorted.push_back(pair.second);
-        }
-    }
-    std::sort(sorted.begin(), sorted.end(), [](DrawingObject* a, DrawingObject* b) {
-        return a->zindex < b->zindex;
-    });
+    std::unordered_map<uint32_t, std::vector<DrawingObject*>> members;
+    collect_drawings(sorted, members);
     
     // Render each object
     for (DrawingObject* drawObj : sorted) {
-        switch (drawObj->type) {
-            case DRAWING_LINE: android_draw_line(env, canvas, paint, drawObj); break;
-            case DRAWING_CIRCLE: android_draw_circle(env, canvas, paint, drawObj); break;
-            case DRAWING_SQUARE: android_draw_rect(env, canvas, paint, drawObj); break;
-            case DRAWING_TEXT: android_draw_text(env, canvas, paint, drawObj); break;
-            case DRAWING_TRIANGLE: android_draw_triangle(env, canvas, paint, drawObj); break;
-            case DRAWING_QUAD: android_draw_quad(env, canvas, paint, drawObj); break;
-            case DRAWING_IMAGE: android_draw_image(env, canvas, paint, drawObj); break;
+        if (drawObj->type == DRAWING_LAYER) {
+            android_draw_layer(env, canvas, paint, drawObj, members[drawObj->id]);
+        } else {
+            android_draw_object(env, canvas, paint, drawObj);
         }
     }
     
@@ -671,6 +1302,24 @@ extern "C" void xoron_drawing_set_screen_size(float width, float height) {
     g_screen_height = height;
 }
 
+// Frees an object and its cached path or layer bitmap; the caller holds g_drawing_mutex
+static void destroy_drawing(DrawingObject* obj) {
+#if defined(XORON_IOS_DRAWING)
+    ios_release_layer(obj);
+#elif defined(XORON_ANDROID_DRAWING)
+    android_release_layer(obj);
+#endif
+    if (obj->platformPath) {
+#if defined(XORON_IOS_DRAWING)
+        CGPathRelease((CGPathRef)obj->platformPath);
+#elif defined(XORON_ANDROID_DRAWING)
+        // Global refs are freed on the render thread, which has a JNIEnv
+        g_android_stale_refs.push_back((jobject)obj->platformPath);
+#endif
+    }
+    delete obj;
+}
+
 // Metatable name
 static const char* DRAWING_MT = "XoronDrawing";
 
@@ -738,136 +1387,297 @@ static Vector2 get_vector2(lua_State* L, int idx) {
     return v;
 }
 
-// Drawing object __index
+// Drawing:Remove() / Drawing:Destroy() - Deletes the object; later use raises "Invalid drawing object"
+static int drawing_remove(lua_State* L) {
+    DrawingObject** ud = (DrawingObject**)luaL_checkudata(L, 1, DRAWING_MT);
+    if (*ud) {
+        if ((*ud)->layerRef != LUA_NOREF) lua_unref(L, (*ud)->layerRef);
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        invalidate_layer(*ud);
+        g_drawings.erase((*ud)->id);
+        destroy_drawing(*ud);
+        *ud = nullptr;
+    }
+    return 0;
+}
+
+// Pushes a flat {x0, y0, x1, y1, ...} array of the points
+static void push_points(lua_State* L, const DrawingObject* obj) {
+    lua_createtable(L, (int)obj->points.size(), 0);
+    for (size_t i = 0; i < obj->points.size(); i++) {
+        lua_pushnumber(L, obj->points[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+}
+
+// Reads a flat number array, or a Buffer of float32 values (a plain memcpy), in groups of stride;
+// nil reads as empty
+static std::vector<float> read_floats(lua_State* L, int idx, size_t stride, const char* what) {
+    std::vector<float> values;
+    if (lua_isnil(L, idx)) return values;
+    if (xoron_isbuffer(L, idx)) {
+        size_t len = 0;
+        const char* data = xoron_tobytes(L, idx, &len);
+        if (len % (stride * sizeof(float)) != 0) {
+            luaL_error(L, "%s buffer must hold groups of %d float32 values", what, (int)stride);
+        }
+        values.resize(len / sizeof(float));
+        if (len) memcpy(values.data(), data, len);
+    } else {
+        luaL_checktype(L, idx, LUA_TTABLE);
+        int n = lua_objlen(L, idx);
+        if (n % stride != 0) luaL_error(L, "%s must be a flat array of groups of %d numbers", what, (int)stride);
+        values.resize(n);
+        for (int i = 0; i < n; i++) {
+            lua_rawgeti(L, idx, i + 1);
+            if (!lua_isnumber(L, -1)) luaL_error(L, "%s[%d] is not a number", what, i + 1);
+            values[i] = (float)lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+    }
+    return values;
+}
+
+// Replaces the points from a flat {x0, y0, x1, y1, ...} array or a Buffer of float32 x, y pairs
+static void set_points(lua_State* L, DrawingObject* obj, int idx) {
+    std::vector<float> points = read_floats(L, idx, 2, "Points");
+    
+    // The renderer may be reading the old points
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    obj->points.swap(points);
+    obj->pathDirty = true;
+    invalidate_layer(obj);
+}
+
+// Moves obj into a Layer drawing, or out of its layer for nil; the old and new layers both redraw.
+// The member holds a ref to the layer's userdata so reading Layer returns it
+static void set_layer(lua_State* L, DrawingObject* obj, int idx) {
+    uint32_t layer = 0;
+    if (!lua_isnil(L, idx)) {
+        DrawingObject* target = get_drawing(L, idx);
+        if (target->type != DRAWING_LAYER) luaL_error(L, "Layer must be a Layer drawing");
+        if (obj->type == DRAWING_LAYER) luaL_error(L, "A Layer can't be placed in another layer");
+        layer = target->id;
+    }
+    if (obj->layerRef != LUA_NOREF) lua_unref(L, obj->layerRef);
+    obj->layerRef = layer ? lua_ref(L, idx) : LUA_NOREF;
+    
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    invalidate_layer(obj);
+    obj->layer = layer;
+    invalidate_layer(obj);
+}
+
+// Drawing object __index - properties and methods resolved by the key's atom
 static int drawing_index(lua_State* L) {
     DrawingObject* obj = get_drawing(L, 1);
-    const char* key = luaL_checkstring(L, 2);
-    
-    if (strcmp(key, "Visible") == 0) {
-        lua_pushboolean(L, obj->visible);
-    } else if (strcmp(key, "Color") == 0) {
-        push_color3(L, obj->color);
-    } else if (strcmp(key, "Transparency") == 0) {
-        lua_pushnumber(L, obj->transparency);
-    } else if (strcmp(key, "ZIndex") == 0) {
-        lua_pushinteger(L, obj->zindex);
-    } else if (strcmp(key, "From") == 0) {
-        push_vector2(L, obj->from);
-    } else if (strcmp(key, "To") == 0) {
-        push_vector2(L, obj->to);
-    } else if (strcmp(key, "Position") == 0) {
-        push_vector2(L, obj->position);
-    } else if (strcmp(key, "Radius") == 0) {
-        lua_pushnumber(L, obj->radius);
-    } else if (strcmp(key, "Size") == 0) {
-        push_vector2(L, obj->size);
-    } else if (strcmp(key, "Text") == 0) {
-        lua_pushstring(L, obj->text.c_str());
-    } else if (strcmp(key, "TextBounds") == 0) {
+    int atom = -1;
+    luaL_checktype(L, 2, LUA_TSTRING);
+    lua_tostringatom(L, 2, &atom);
+    
+    // Tweens write these fields while the renderer advances them; copy them out under the lock
+    int components = 0;
+    if (const float* field = tween_field(obj, atom, &components)) {
+        float v[3];
+        {
+            std::lock_guard<std::mutex> lock(g_drawing_mutex);
+            memcpy(v, field, components * sizeof(float));
+        }
+        if (components == 1) lua_pushnumber(L, v[0]);
+        else if (components == 2) push_vector2(L, Vector2(v[0], v[1]));
+        else push_color3(L, Color3(v[0], v[1], v[2]));
+        return 1;
+    }
+    
+    switch (atom) {
+    case XORON_ATOM_Visible: lua_pushboolean(L, obj->visible); break;
+    case XORON_ATOM_ZIndex: lua_pushinteger(L, obj->zindex); break;
+    case XORON_ATOM_Text: lua_pushstring(L, obj->text.c_str()); break;
+    case XORON_ATOM_TextBounds: {
         // Calculate text bounds
-        Vector2 bounds;
-        bounds.x = obj->text.length() * obj->textSize * 0.6f;
-        bounds.y = obj->textSize;
-        push_vector2(L, bounds);
-    } else if (strcmp(key, "TextSize") == 0 || strcmp(key, "Size") == 0) {
-        lua_pushnumber(L, obj->textSize);
-    } else if (strcmp(key, "Center") == 0) {
-        lua_pushboolean(L, obj->center);
-    } else if (strcmp(key, "Outline") == 0) {
-        lua_pushboolean(L, obj->outline);
-    } else if (strcmp(key, "OutlineColor") == 0) {
-        push_color3(L, obj->outlineColor);
-    } else if (strcmp(key, "Filled") == 0) {
-        lua_pushboolean(L, obj->filled);
-    } else if (strcmp(key, "Thickness") == 0) {
-        lua_pushnumber(L, obj->thickness);
-    } else if (strcmp(key, "PointA") == 0) {
-        push_vector2(L, obj->pointA);
-    } else if (strcmp(key, "PointB") == 0) {
-        push_vector2(L, obj->pointB);
-    } else if (strcmp(key, "PointC") == 0) {
-        push_vector2(L, obj->pointC);
-    } else if (strcmp(key, "PointD") == 0) {
-        push_vector2(L, obj->pointD);
-    } else if (strcmp(key, "Data") == 0) {
-        lua_pushstring(L, obj->imageData.c_str());
-    } else if (strcmp(key, "Rounding") == 0) {
-        lua_pushnumber(L, obj->rounding);
-    } else if (strcmp(key, "Font") == 0) {
-        lua_pushinteger(L, 0); // Font enum
-    } else if (strcmp(key, "Remove") == 0 || strcmp(key, "Destroy") == 0) {
-        // Return the remove function
-        lua_pushvalue(L, 1);
-        lua_pushcclosure(L, [](lua_State* L) -> int {
-            DrawingObject* obj = get_drawing(L, lua_upvalueindex(1));
-            if (obj) {
-                std::lock_guard<std::mutex> lock(g_drawing_mutex);
-                g_drawings.erase(obj->id);
-                delete obj;
-            }
-            return 0;
-        }, "Remove", 1);
-    } else {
-        lua_pushnil(L);
+        float textSize;
+        {
+            std::lock_guard<std::mutex> lock(g_drawing_mutex);
+            textSize = obj->textSize;
+        }
+        push_vector2(L, Vector2(obj->text.length() * textSize * 0.6f, textSize));
+        break;
+    }
+    case XORON_ATOM_Center: lua_pushboolean(L, obj->center); break;
+    case XORON_ATOM_Outline: lua_pushboolean(L, obj->outline); break;
+    case XORON_ATOM_Filled: lua_pushboolean(L, obj->filled); break;
+    case XORON_ATOM_Data: lua_pushstring(L, obj->imageData.c_str()); break;
+    case XORON_ATOM_Font: lua_pushinteger(L, 0); break; // Font enum
+    case XORON_ATOM_Points: push_points(L, obj); break;
+    case XORON_ATOM_PointCount: lua_pushinteger(L, (int)(obj->points.size() / 2)); break;
+    case XORON_ATOM_Closed: lua_pushboolean(L, obj->closed); break;
+    case XORON_ATOM_LineJoin: lua_pushinteger(L, obj->lineJoin); break;
+    case XORON_ATOM_Remove:
+    case XORON_ATOM_Destroy:
+        // Shared function kept on the metatable, so reading it allocates nothing
+        luaL_getmetafield(L, 1, "Remove");
+        break;
+    case XORON_ATOM_Shape: lua_pushinteger(L, obj->shape); break;
+    case XORON_ATOM_InstanceCount: lua_pushinteger(L, (int)(obj->points.size() / 2)); break;
+    case XORON_ATOM_SetPoints:
+        luaL_getmetafield(L, 1, "SetPoints");
+        break;
+    case XORON_ATOM_SetInstances:
+        luaL_getmetafield(L, 1, "SetInstances");
+        break;
+    case XORON_ATOM_SetPositions:
+        luaL_getmetafield(L, 1, "SetPositions");
+        break;
+    case XORON_ATOM_SetColors:
+        luaL_getmetafield(L, 1, "SetColors");
+        break;
+    case XORON_ATOM_SetSizes:
+        luaL_getmetafield(L, 1, "SetSizes");
+        break;
+    case XORON_ATOM_Layer:
+        if (obj->layerRef != LUA_NOREF) {
+            lua_getref(L, obj->layerRef);
+        } else {
+            lua_pushnil(L);
+        }
+        break;
+    case XORON_ATOM_Static: lua_pushboolean(L, obj->isStatic); break;
+    case XORON_ATOM_Invalidate:
+        luaL_getmetafield(L, 1, "Invalidate");
+        break;
+    default: lua_pushnil(L); break;
     }
     
     return 1;
 }
 
+// Drawing:SetPoints(points) - Same as setting Points: a flat {x0, y0, x1, y1, ...} array or a Buffer of float32 pairs
+static int drawing_setpoints(lua_State* L) {
+    set_points(L, get_drawing(L, 1), 2);
+    return 0;
+}
+
+// Instanced:SetColors(colors) - Flat {r0, g0, b0, ...} array or Buffer of float32 triples; nil uses Color
+static int drawing_setcolors(lua_State* L) {
+    DrawingObject* obj = get_drawing(L, 1);
+    std::vector<float> colors = read_floats(L, 2, 3, "Colors");
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    obj->instanceColors.swap(colors);
+    invalidate_layer(obj);
+    return 0;
+}
+
+// Instanced:SetSizes(sizes) - Radius (half-width for squares) per instance, array or float32 Buffer; nil uses Radius
+static int drawing_setsizes(lua_State* L) {
+    DrawingObject* obj = get_drawing(L, 1);
+    std::vector<float> sizes = read_floats(L, 2, 1, "Sizes");
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    obj->instanceSizes.swap(sizes);
+    invalidate_layer(obj);
+    return 0;
+}
+
+// Instanced:SetInstances(positions, colors, sizes) - All three at once, swapped in together
+static int drawing_setinstances(lua_State* L) {
+    DrawingObject* obj = get_drawing(L, 1);
+    std::vector<float> positions = read_floats(L, 2, 2, "Positions");
+    std::vector<float> colors = read_floats(L, 3, 3, "Colors");
+    std::vector<float> sizes = read_floats(L, 4, 1, "Sizes");
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    obj->points.swap(positions);
+    obj->instanceColors.swap(colors);
+    obj->instanceSizes.swap(sizes);
+    invalidate_layer(obj);
+    return 0;
+}
+
+// Layer:Invalidate() - Rasterizes the layer again on the next frame
+static int drawing_invalidate(lua_State* L) {
+    DrawingObject* obj = get_drawing(L, 1);
+    std::lock_guard<std::mutex> lock(g_drawing_mutex);
+    obj->layerDirty = true;
+    return 0;
+}
+
+// Drawing object __namecall - obj:Remove() / obj:Destroy() without the __index lookup
+static int drawing_namecall(lua_State* L) {
+    int atom = -1;
+    const char* name = lua_namecallatom(L, &atom);
+    switch (atom) {
+    case XORON_ATOM_Remove:
+    case XORON_ATOM_Destroy:
+        return drawing_remove(L);
+    case XORON_ATOM_SetPoints:
+    case XORON_ATOM_SetPositions:
+        return drawing_setpoints(L);
+    case XORON_ATOM_SetInstances:
+        return drawing_setinstances(L);
+    case XORON_ATOM_SetColors:
+        return drawing_setcolors(L);
+    case XORON_ATOM_SetSizes:
+        return drawing_setsizes(L);
+    case XORON_ATOM_Invalidate:
+        return drawing_invalidate(L);
+    }
+    luaL_error(L, "%s is not a valid member of Drawing", name ? name : "?");
+    return 0;
+}
+
 // Drawing object __newindex
 static int drawing_newindex(lua_State* L) {
     DrawingObject* obj = get_drawing(L, 1);
-    const char* key = luaL_checkstring(L, 2);
-    
-    if (strcmp(key, "Visible") == 0) {
-        obj->visible = lua_toboolean(L, 3);
-    } else if (strcmp(key, "Color") == 0) {
-        obj->color = get_color3(L, 3);
-    } else if (strcmp(key, "Transparency") == 0) {
-        obj->transparency = lua_tonumber(L, 3);
-    } else if (strcmp(key, "ZIndex") == 0) {
-        obj->zindex = lua_tointeger(L, 3);
-    } else if (strcmp(key, "From") == 0) {
-        obj->from = get_vector2(L, 3);
-    } else if (strcmp(key, "To") == 0) {
-        obj->to = get_vector2(L, 3);
-    } else if (strcmp(key, "Position") == 0) {
-        obj->position = get_vector2(L, 3);
-    } else if (strcmp(key, "Radius") == 0) {
-        obj->radius = lua_tonumber(L, 3);
-    } else if (strcmp(key, "Size") == 0) {
-        if (lua_istable(L, 3)) {
-            obj->size = get_vector2(L, 3);
+    int atom = -1;
+    luaL_checktype(L, 2, LUA_TSTRING);
+    lua_tostringatom(L, 2, &atom);
+    
+    // Tweenable fields: read the value first, since reading it can raise, then write under the lock.
+    // Size given a number sets TextSize
+    int components = 0;
+    int field_atom = atom == XORON_ATOM_Size && !lua_istable(L, 3) ? XORON_ATOM_TextSize : atom;
+    if (float* field = tween_field(obj, field_atom, &components)) {
+        float v[3];
+        if (components == 1) {
+            v[0] = (float)lua_tonumber(L, 3);
+        } else if (components == 2) {
+            Vector2 p = get_vector2(L, 3);
+            v[0] = p.x;
+            v[1] = p.y;
         } else {
-            obj->textSize = lua_tonumber(L, 3);
+            Color3 c = get_color3(L, 3);
+            v[0] = c.r;
+            v[1] = c.g;
+            v[2] = c.b;
         }
-    } else if (strcmp(key, "Text") == 0) {
-        obj->text = luaL_checkstring(L, 3);
-    } else if (strcmp(key, "TextSize") == 0) {
-        obj->textSize = lua_tonumber(L, 3);
-    } else if (strcmp(key, "Center") == 0) {
-        obj->center = lua_toboolean(L, 3);
-    } else if (strcmp(key, "Outline") == 0) {
-        obj->outline = lua_toboolean(L, 3);
-    } else if (strcmp(key, "OutlineColor") == 0) {
-        obj->outlineColor = get_color3(L, 3);
-    } else if (strcmp(key, "Filled") == 0) {
-        obj->filled = lua_toboolean(L, 3);
-    } else if (strcmp(key, "Thickness") == 0) {
-        obj->thickness = lua_tonumber(L, 3);
-    } else if (strcmp(key, "PointA") == 0) {
-        obj->pointA = get_vector2(L, 3);
-    } else if (strcmp(key, "PointB") == 0) {
-        obj->pointB = get_vector2(L, 3);
-    } else if (strcmp(key, "PointC") == 0) {
-        obj->pointC = get_vector2(L, 3);
-    } else if (strcmp(key, "PointD") == 0) {
-        obj->pointD = get_vector2(L, 3);
-    } else if (strcmp(key, "Data") == 0) {
-        obj->imageData = luaL_checkstring(L, 3);
-    } else if (strcmp(key, "Rounding") == 0) {
-        obj->rounding = lua_tonumber(L, 3);
-    } else if (strcmp(key, "Font") == 0) {
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        memcpy(field, v, components * sizeof(float));
+    }
+    
+    switch (atom) {
+    case XORON_ATOM_Visible: obj->visible = lua_toboolean(L, 3); break;
+    case XORON_ATOM_ZIndex: obj->zindex = lua_tointeger(L, 3); break;
+    case XORON_ATOM_Text: obj->text = luaL_checkstring(L, 3); break;
+    case XORON_ATOM_Center: obj->center = lua_toboolean(L, 3); break;
+    case XORON_ATOM_Outline: obj->outline = lua_toboolean(L, 3); break;
+    case XORON_ATOM_Filled: obj->filled = lua_toboolean(L, 3); break;
+    case XORON_ATOM_Data: obj->imageData = luaL_checkstring(L, 3); break;
+    case XORON_ATOM_Points: set_points(L, obj, 3); break;
+    case XORON_ATOM_Closed:
+        obj->closed = lua_toboolean(L, 3);
+        obj->pathDirty = true;
+        break;
+    case XORON_ATOM_Shape: {
+        int shape = (int)luaL_checkinteger(L, 3);
+        if (shape < INSTANCE_CIRCLE || shape > INSTANCE_SQUARE) luaL_error(L, "Invalid Shape: %d", shape);
+        obj->shape = shape;
+        break;
+    }
+    case XORON_ATOM_LineJoin: {
+        int join = (int)luaL_checkinteger(L, 3);
+        if (join < LINE_JOIN_MITER || join > LINE_JOIN_BEVEL) luaL_error(L, "Invalid LineJoin: %d", join);
+        obj->lineJoin = join;
+        break;
+    }
+    case XORON_ATOM_Font:
         // Font enum or index
         if (lua_isnumber(L, 3)) {
             int idx = lua_tointeger(L, 3);
@@ -875,6 +1685,18 @@ static int drawing_newindex(lua_State* L) {
                 obj->font = g_fonts[idx];
             }
         }
+        break;
+    case XORON_ATOM_Layer: set_layer(L, obj, 3); break;
+    case XORON_ATOM_Static: obj->isStatic = lua_toboolean(L, 3); break;
+    }
+    
+    // A cached layer redraws when a member changes, or when its own region or Static does
+    if (obj->layer || obj->type == DRAWING_LAYER) {
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        invalidate_layer(obj);
+        if (atom == XORON_ATOM_Position || atom == XORON_ATOM_Size || atom == XORON_ATOM_Static) {
+            obj->layerDirty = true;
+        }
     }
     
     return 0;
@@ -884,9 +1706,11 @@ static int drawing_newindex(lua_State* L) {
 static int drawing_gc(lua_State* L) {
     DrawingObject** ud = (DrawingObject**)lua_touserdata(L, 1);
     if (ud && *ud) {
+        if ((*ud)->layerRef != LUA_NOREF) lua_unref(L, (*ud)->layerRef);
         std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        invalidate_layer(*ud);
         g_drawings.erase((*ud)->id);
-        delete *ud;
+        destroy_drawing(*ud);
         *ud = nullptr;
     }
     return 0;
@@ -902,6 +1726,7 @@ static DrawingObject* create_drawing(lua_State* L, DrawingType type) {
         std::lock_guard<std::mutex> lock(g_drawing_mutex);
         g_drawings[obj->id] = obj;
     }
+    xoron_metric_inc(g_m_drawing_created, 1);
     
     // Create userdata
     DrawingObject** ud = (DrawingObject**)lua_newuserdata(L, sizeof(DrawingObject*));
@@ -933,6 +1758,14 @@ static int lua_drawing_new(lua_State* L) {
         type = DRAWING_QUAD;
     } else if (strcmp(type_str, "Image") == 0) {
         type = DRAWING_IMAGE;
+    } else if (strcmp(type_str, "Polyline") == 0) {
+        type = DRAWING_POLYLINE;
+    } else if (strcmp(type_str, "Polygon") == 0) {
+        type = DRAWING_POLYGON;
+    } else if (strcmp(type_str, "Instanced") == 0) {
+        type = DRAWING_INSTANCED;
+    } else if (strcmp(type_str, "Layer") == 0) {
+        type = DRAWING_LAYER;
     } else {
         luaL_error(L, "Invalid drawing type: %s", type_str);
         return 0;
@@ -942,6 +1775,138 @@ static int lua_drawing_new(lua_State* L) {
     return 1;
 }
 
+// Channel handler for "drawing.tween"; runs the completion callback on the VM thread
+static void tween_dispatch(lua_State* L, const xoron_message_t* msg) {
+    int ref = (int)msg->arg;
+    lua_getref(L, ref);
+    lua_unref(L, ref);
+    lua_pushboolean(L, msg->x != 0);
+    if (lua_pcall(L, 1, 0, 0) != 0) {
+        xoron_set_error("Tween callback error: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+}
+
+static int check_easing(lua_State* L, int idx) {
+    if (lua_isnoneornil(L, idx)) return EASE_LINEAR;
+    if (lua_type(L, idx) == LUA_TSTRING) {
+        const char* name = lua_tostring(L, idx);
+        for (int i = 0; i < EASE_COUNT; i++) {
+            if (strcmp(name, g_easing_names[i]) == 0) return i;
+        }
+        luaL_error(L, "Unknown easing: %s", name);
+    }
+    int style = (int)luaL_checkinteger(L, idx);
+    if (style < 0 || style >= EASE_COUNT) luaL_error(L, "Unknown easing: %d", style);
+    return style;
+}
+
+// Drawing.tween(obj, goals, duration, easing, onComplete) - Animates properties natively; returns a tween id
+// goals: {Property = target, ...} for Position, Size, From, To, PointA-D, Color, OutlineColor, Transparency,
+//        Radius, Thickness, TextSize and Rounding. onComplete(completed) runs on this VM; completed is false
+//        when the tween was cancelled, taken over, or its drawing removed
+static int lua_drawing_tween(lua_State* L) {
+    DrawingObject* obj = get_drawing(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    double duration = luaL_checknumber(L, 3);
+    int easing = check_easing(L, 4);
+    if (!lua_isnoneornil(L, 5)) luaL_checktype(L, 5, LUA_TFUNCTION);
+    
+    Tween tween;
+    tween.drawing = obj->id;
+    tween.easing = easing;
+    tween.duration_us = duration > 0 ? (uint64_t)(duration * 1e6) : 0;
+    std::vector<float*> fields;
+    lua_pushnil(L);
+    while (lua_next(L, 2) != 0) {
+        int atom = -1;
+        if (lua_type(L, -2) == LUA_TSTRING) lua_tostringatom(L, -2, &atom);
+        TweenTrack track;
+        track.atom = atom;
+        float* field = tween_field(obj, atom, &track.components);
+        if (!field) {
+            luaL_error(L, "%s can't be tweened", lua_type(L, -2) == LUA_TSTRING ? lua_tostring(L, -2) : "?");
+        }
+        fields.push_back(field);
+        if (track.components == 1) {
+            track.to[0] = (float)luaL_checknumber(L, -1);
+        } else if (track.components == 2) {
+            Vector2 v = get_vector2(L, -1);
+            track.to[0] = v.x;
+            track.to[1] = v.y;
+        } else {
+            Color3 c = get_color3(L, -1);
+            track.to[0] = c.r;
+            track.to[1] = c.g;
+            track.to[2] = c.b;
+        }
+        tween.tracks.push_back(track);
+        lua_pop(L, 1);
+    }
+    tween.channel = xoron_channel_of(L);
+    xoron_channel_retain(tween.channel);
+    tween.callback = lua_isfunction(L, 5) ? lua_ref(L, 5) : LUA_NOREF;
+    tween.start_us = xoron_metric_now_us();
+    
+    // Older tweens of the same properties hand them over; the starting values are
+    // read after that, under the lock the ticker writes them with
+    std::vector<Tween> replaced;
+    {
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        for (size_t i = 0; i < g_tweens.size();) {
+            Tween& old = g_tweens[i];
+            if (old.drawing == tween.drawing) {
+                auto& tracks = old.tracks;
+                tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [&](const TweenTrack& t) {
+                    for (const TweenTrack& n : tween.tracks) {
+                        if (n.atom == t.atom) return true;
+                    }
+                    return false;
+                }), tracks.end());
+                if (tracks.empty()) {
+                    replaced.push_back(std::move(old));
+                    g_tweens.erase(g_tweens.begin() + i);
+                    continue;
+                }
+            }
+            i++;
+        }
+        for (size_t i = 0; i < tween.tracks.size(); i++) {
+            TweenTrack& track = tween.tracks[i];
+            memcpy(track.from, fields[i], track.components * sizeof(float));
+        }
+        tween.id = g_next_tween_id++;
+        g_tweens.push_back(tween);
+        xoron_metric_set(g_m_drawing_tweens, (int64_t)g_tweens.size());
+    }
+    for (Tween& old : replaced) finish_tween(old, false);
+    
+    lua_pushinteger(L, (int)tween.id);
+    return 1;
+}
+
+// Drawing.canceltween(id) - Stops a tween where it is; true if it was running
+static int lua_drawing_canceltween(lua_State* L) {
+    uint32_t id = (uint32_t)luaL_checkinteger(L, 1);
+    Tween cancelled;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(g_drawing_mutex);
+        for (size_t i = 0; i < g_tweens.size(); i++) {
+            if (g_tweens[i].id == id) {
+                cancelled = std::move(g_tweens[i]);
+                g_tweens.erase(g_tweens.begin() + i);
+                found = true;
+                break;
+            }
+        }
+        xoron_metric_set(g_m_drawing_tweens, (int64_t)g_tweens.size());
+    }
+    if (found) finish_tween(cancelled, false);
+    lua_pushboolean(L, found);
+    return 1;
+}
+
 // Drawing.Fonts - Table of available fonts
 static int lua_drawing_fonts(lua_State* L) {
     lua_newtable(L);
@@ -958,7 +1923,7 @@ static int lua_cleardrawcache(lua_State* L) {
     
     std::lock_guard<std::mutex> lock(g_drawing_mutex);
     for (auto& pair : g_drawings) {
-        delete pair.second;
+        destroy_drawing(pair.second);
     }
     g_drawings.clear();
     
@@ -1061,7 +2026,7 @@ static int lua_getscreensize(lua_State* L) {
         }
     }
 #endif
-    
+
     lua_newtable(L);
     lua_pushnumber(L, g_screen_width);
     lua_setfield(L, -2, "X");
@@ -1070,6 +2035,10 @@ static int lua_getscreensize(lua_State* L) {
     return 1;
 }
 
+void xoron_init_drawing(void) {
+    xoron_channel_handle("drawing.tween", tween_dispatch);
+}
+
 // Register drawing library
 void xoron_register_drawing(lua_State* L) {
     // Create metatable for drawing objects
@@ -1081,6 +2050,30 @@ void xoron_register_drawing(lua_State* L) {
     lua_pushcfunction(L, drawing_newindex, "__newindex");
     lua_setfield(L, -2, "__newindex");
     
+    lua_pushcfunction(L, drawing_namecall, "__namecall");
+    lua_setfield(L, -2, "__namecall");
+    
+    lua_pushcfunction(L, drawing_remove, "Remove");
+    lua_setfield(L, -2, "Remove");
+    
+    lua_pushcfunction(L, drawing_setpoints, "SetPoints");
+    lua_setfield(L, -2, "SetPoints");
+    
+    lua_pushcfunction(L, drawing_setpoints, "SetPositions");
+    lua_setfield(L, -2, "SetPositions");
+    
+    lua_pushcfunction(L, drawing_setinstances, "SetInstances");
+    lua_setfield(L, -2, "SetInstances");
+    
+    lua_pushcfunction(L, drawing_setcolors, "SetColors");
+    lua_setfield(L, -2, "SetColors");
+    
+    lua_pushcfunction(L, drawing_setsizes, "SetSizes");
+    lua_setfield(L, -2, "SetSizes");
+    
+    lua_pushcfunction(L, drawing_invalidate, "Invalidate");
+    lua_setfield(L, -2, "Invalidate");
+    
     lua_pushcfunction(L, drawing_gc, "__gc");
     lua_setfield(L, -2, "__gc");
     
@@ -1095,6 +2088,12 @@ void xoron_register_drawing(lua_State* L) {
     lua_pushcfunction(L, lua_drawing_clear, "clear");
     lua_setfield(L, -2, "clear");
     
+    lua_pushcfunction(L, lua_drawing_tween, "tween");
+    lua_setfield(L, -2, "tween");
+    
+    lua_pushcfunction(L, lua_drawing_canceltween, "canceltween");
+    lua_setfield(L, -2, "canceltween");
+    
     // Add Fonts table
     lua_newtable(L);
     for (size_t i = 0; i < g_fonts.size(); i++) {
@@ -1103,6 +2102,31 @@ void xoron_register_drawing(lua_State* L) {
     }
     lua_setfield(L, -2, "Fonts");
     
+    // Add LineJoins table
+    static const char* const joins[] = {"Miter", "Round", "Bevel"};
+    lua_newtable(L);
+    for (int i = LINE_JOIN_MITER; i <= LINE_JOIN_BEVEL; i++) {
+        lua_pushinteger(L, i);
+        lua_setfield(L, -2, joins[i]);
+    }
+    lua_setfield(L, -2, "LineJoins");
+    
+    // Add Shapes table
+    lua_newtable(L);
+    lua_pushinteger(L, INSTANCE_CIRCLE);
+    lua_setfield(L, -2, "Circle");
+    lua_pushinteger(L, INSTANCE_SQUARE);
+    lua_setfield(L, -2, "Square");
+    lua_setfield(L, -2, "Shapes");
+    
+    // Add Easing table
+    lua_newtable(L);
+    for (int i = 0; i < EASE_COUNT; i++) {
+        lua_pushinteger(L, i);
+        lua_setfield(L, -2, g_easing_names[i]);
+    }
+    lua_setfield(L, -2, "Easing");
+    
     lua_setglobal(L, "Drawing");
     
     // Global functions
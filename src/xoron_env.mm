@@ -90,21 +90,13 @@ static std::mutex g_connection_mutex;
 
 extern void xoron_set_error(const char* fmt, ...);
 
-// Internal: Get or create global environment table with proper metatable
+// Internal: Push the global executor environment, the plain table every
+// script environment reads and writes through to.
 static void push_global_env(lua_State* L) {
     lua_getfield(L, LUA_REGISTRYINDEX, "_XORON_GENV");
     if (lua_isnil(L, -1)) {
         lua_pop(L, 1);
-        lua_newtable(L);
-        
-        // Create metatable that falls back to _G
-        lua_newtable(L);
         lua_pushvalue(L, LUA_GLOBALSINDEX);
-        lua_setfield(L, -2, "__index");
-        lua_setmetatable(L, -2);
-        
-        lua_pushvalue(L, -1);
-        lua_setfield(L, LUA_REGISTRYINDEX, "_XORON_GENV");
     }
 }
 
@@ -538,7 +530,9 @@ static int lua_loadstring_custom(lua_State* L) {
         return 2;
     }
     
-    int result = luau_load(L, chunkname, bytecode.data(), bytecode.size(), 0);
+    // Each chunk gets its own script environment over getgenv(); imports
+    // resolve at load time, where a later lua_setfenv would leave the chunk on the slow paths
+    int result = xoron_load_script(L, chunkname, bytecode.data(), bytecode.size());
     
     if (result != 0) {
         lua_pushnil(L);
@@ -546,10 +540,6 @@ static int lua_loadstring_custom(lua_State* L) {
         return 2;
     }
     
-    // Set environment to global env
-    push_global_env(L);
-    lua_setfenv(L, -2);
-    
     return 1;
 }
 
@@ -1295,75 +1285,114 @@ static int lua_getclipboard(lua_State* L) {
     return 1;
 }
 
-// lz4compress(data) - Compresses data with LZ4
-static int lua_lz4compress(lua_State* L) {
-    size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
-    
-    // Calculate max compressed size
+// LZ4 block prefixed with the original size (4 bytes, little endian)
+char* xoron_lz4_compress(const char* data, size_t len, size_t* out_len) {
     int max_compressed = LZ4_compressBound((int)len);
-    if (max_compressed <= 0) {
-        luaL_error(L, "Data too large to compress");
-        return 0;
+    if (len > LZ4_MAX_INPUT_SIZE || max_compressed <= 0) {
+        xoron_set_error("Data too large to compress");
+        return nullptr;
     }
     
-    // Allocate buffer with 4 bytes for original size header
-    std::vector<char> compressed(max_compressed + 4);
+    char* compressed = (char*)malloc((size_t)max_compressed + 4);
+    if (!compressed) {
+        xoron_set_error("Out of memory");
+        return nullptr;
+    }
     
-    // Store original size (4 bytes, little endian)
+    // Store original size
     compressed[0] = (len >> 0) & 0xFF;
     compressed[1] = (len >> 8) & 0xFF;
     compressed[2] = (len >> 16) & 0xFF;
     compressed[3] = (len >> 24) & 0xFF;
     
-    // Compress
-    int compressed_size = LZ4_compress_default(data, compressed.data() + 4, (int)len, max_compressed);
+    int compressed_size = LZ4_compress_default(data, compressed + 4, (int)len, max_compressed);
     if (compressed_size <= 0) {
-        luaL_error(L, "LZ4 compression failed");
-        return 0;
+        free(compressed);
+        xoron_set_error("LZ4 compression failed");
+        return nullptr;
     }
-    
-    lua_pushlstring(L, compressed.data(), compressed_size + 4);
-    return 1;
+    *out_len = (size_t)compressed_size + 4;
+    return compressed;
 }
 
-// lz4decompress(data, size) - Decompresses LZ4 data
-static int lua_lz4decompress(lua_State* L) {
-    size_t len;
-    const char* data = luaL_checklstring(L, 1, &len);
-    size_t expected_size = luaL_optinteger(L, 2, 0);
-    
+// Inverse of xoron_lz4_compress; expected_size overrides the header when non-zero
+char* xoron_lz4_decompress(const char* data, size_t len, size_t expected_size, size_t* out_len) {
     if (len < 4) {
-        luaL_error(L, "Invalid compressed data");
-        return 0;
+        xoron_set_error("Invalid compressed data");
+        return nullptr;
     }
     
     // Read original size from header
     size_t orig_size = ((unsigned char)data[0]) |
                        ((unsigned char)data[1] << 8) |
                        ((unsigned char)data[2] << 16) |
-                       ((unsigned char)data[3] << 24);
-    
-    // Use expected_size if provided and different
+                       ((size_t)(unsigned char)data[3] << 24);
     if (expected_size > 0) {
         orig_size = expected_size;
     }
     
     // Safety check
     if (orig_size > 100 * 1024 * 1024) { // 100MB limit
-        luaL_error(L, "Decompressed size too large");
-        return 0;
+        xoron_set_error("Decompressed size too large");
+        return nullptr;
     }
     
-    std::vector<char> decompressed(orig_size);
+    char* decompressed = (char*)malloc(orig_size + 1);
+    if (!decompressed) {
+        xoron_set_error("Out of memory");
+        return nullptr;
+    }
     
-    int decompressed_size = LZ4_decompress_safe(data + 4, decompressed.data(), (int)(len - 4), (int)orig_size);
+    int decompressed_size = LZ4_decompress_safe(data + 4, decompressed, (int)(len - 4), (int)orig_size);
     if (decompressed_size < 0) {
-        luaL_error(L, "LZ4 decompression failed");
+        free(decompressed);
+        xoron_set_error("LZ4 decompression failed");
+        return nullptr;
+    }
+    *out_len = (size_t)decompressed_size;
+    return decompressed;
+}
+
+// lz4compress(data) - Compresses data with LZ4; a Buffer gives a Buffer
+static int lua_lz4compress(lua_State* L) {
+    size_t len;
+    const char* data = xoron_checkbytes(L, 1, &len);
+    
+    size_t compressed_len = 0;
+    char* compressed = xoron_lz4_compress(data, len, &compressed_len);
+    if (!compressed) {
+        luaL_error(L, "%s", xoron_last_error());
+        return 0;
+    }
+    
+    if (xoron_isbuffer(L, 1)) {
+        xoron_pushbuffer_owned(L, compressed, compressed_len);
+        return 1;
+    }
+    lua_pushlstring(L, compressed, compressed_len);
+    free(compressed);
+    return 1;
+}
+
+// lz4decompress(data, size) - Decompresses LZ4 data; a Buffer gives a Buffer
+static int lua_lz4decompress(lua_State* L) {
+    size_t len;
+    const char* data = xoron_checkbytes(L, 1, &len);
+    size_t expected_size = luaL_optinteger(L, 2, 0);
+    
+    size_t decompressed_len = 0;
+    char* decompressed = xoron_lz4_decompress(data, len, expected_size, &decompressed_len);
+    if (!decompressed) {
+        luaL_error(L, "%s", xoron_last_error());
         return 0;
     }
     
-    lua_pushlstring(L, decompressed.data(), decompressed_size);
+    if (xoron_isbuffer(L, 1)) {
+        xoron_pushbuffer_owned(L, decompressed, decompressed_len);
+        return 1;
+    }
+    lua_pushlstring(L, decompressed, decompressed_len);
+    free(decompressed);
     return 1;
 }
 
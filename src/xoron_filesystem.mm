@@ -70,6 +70,12 @@ static bool g_use_external_storage = false;
 
 extern void xoron_set_error(const char* fmt, ...);
 
+// Metrics
+static const int g_m_fs_reads = xoron_metric_counter("fs.reads");
+static const int g_m_fs_writes = xoron_metric_counter("fs.writes");
+static const int g_m_fs_bytes_read = xoron_metric_counter("fs.bytes_read");
+static const int g_m_fs_bytes_written = xoron_metric_counter("fs.bytes_written");
+
 /* Platform-specific path initialization */
 static std::string get_platform_base_path() {
 #if defined(XORON_PLATFORM_ANDROID) || defined(__ANDROID__)
@@ -168,6 +174,7 @@ static std::string get_platform_base_path() {
 /* Initialize all executor directories */
 static void ensure_directories() {
     std::lock_guard<std::mutex> lock(g_fs_mutex);
+    XoronStartupPhase phase(g_base_path.empty() ? "ensure_directories" : nullptr);
     
     if (g_base_path.empty()) {
         g_base_path = get_platform_base_path();
@@ -286,7 +293,7 @@ static std::string resolve_path(const char* path) {
     return g_workspace_path + "/" + p;
 }
 
-// readfile(path) - Reads file contents
+// readfile(path, asBuffer) - Reads file contents as a string, or a Buffer when asBuffer
 static int lua_readfile(lua_State* L) {
     const char* path = luaL_checkstring(L, 1);
     std::string resolved = resolve_path(path);
@@ -302,19 +309,41 @@ static int lua_readfile(lua_State* L) {
         return 0;
     }
     
+    if (lua_toboolean(L, 2)) {
+        // Read straight into the Buffer's storage
+        file.seekg(0, std::ios::end);
+        std::streamoff size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        if (size < 0) {
+            luaL_error(L, "Unable to read file: %s", path);
+            return 0;
+        }
+        char* data = xoron_pushbuffer(L, (size_t)size);
+        file.read(data, size);
+        if (file.gcount() != size) {
+            luaL_error(L, "Unable to read file: %s", path);
+            return 0;
+        }
+        xoron_metric_inc(g_m_fs_reads, 1);
+        xoron_metric_inc(g_m_fs_bytes_read, (uint64_t)size);
+        return 1;
+    }
+    
     std::stringstream buffer;
     buffer << file.rdbuf();
     std::string content = buffer.str();
     
+    xoron_metric_inc(g_m_fs_reads, 1);
+    xoron_metric_inc(g_m_fs_bytes_read, content.size());
     lua_pushlstring(L, content.c_str(), content.size());
     return 1;
 }
 
-// writefile(path, content) - Writes content to file
+// writefile(path, content) - Writes a string or Buffer to file
 static int lua_writefile(lua_State* L) {
     const char* path = luaL_checkstring(L, 1);
     size_t len;
-    const char* content = luaL_checklstring(L, 2, &len);
+    const char* content = xoron_checkbytes(L, 2, &len);
     
     std::string resolved = resolve_path(path);
     if (resolved.empty()) {
@@ -335,14 +364,16 @@ static int lua_writefile(lua_State* L) {
     }
     
     file.write(content, len);
+    xoron_metric_inc(g_m_fs_writes, 1);
+    xoron_metric_inc(g_m_fs_bytes_written, len);
     return 0;
 }
 
-// appendfile(path, content) - Appends content to file
+// appendfile(path, content) - Appends a string or Buffer to file
 static int lua_appendfile(lua_State* L) {
     const char* path = luaL_checkstring(L, 1);
     size_t len;
-    const char* content = luaL_checklstring(L, 2, &len);
+    const char* content = xoron_checkbytes(L, 2, &len);
     
     std::string resolved = resolve_path(path);
     if (resolved.empty()) {
@@ -357,6 +388,8 @@ static int lua_appendfile(lua_State* L) {
     }
     
     file.write(content, len);
+    xoron_metric_inc(g_m_fs_writes, 1);
+    xoron_metric_inc(g_m_fs_bytes_written, len);
     return 0;
 }
 
@@ -395,7 +428,7 @@ static int lua_loadfile_custom(lua_State* L) {
         return 2;
     }
     
-    int result = luau_load(L, path, bytecode.data(), bytecode.size(), 0);
+    int result = xoron_load_script(L, path, bytecode.data(), bytecode.size());
     
     if (result != 0) {
         lua_pushnil(L);
@@ -438,7 +471,7 @@ static int lua_dofile_custom(lua_State* L) {
         return 0;
     }
     
-    int result = luau_load(L, path, bytecode.data(), bytecode.size(), 0);
+    int result = xoron_load_script(L, path, bytecode.data(), bytecode.size());
     
     if (result != 0) {
         lua_error(L);
@@ -891,6 +924,7 @@ static int lua_deletescript(lua_State* L) {
 
 // runautoexecute() - Runs all scripts in the autoexecute folder
 static int lua_runautoexecute(lua_State* L) {
+    XoronStartupPhase phase("autoexecute");
     ensure_directories();
     
     std::error_code ec;
@@ -922,21 +956,27 @@ static int lua_runautoexecute(lua_State* L) {
         buffer << file.rdbuf();
         std::string source = buffer.str();
         
+        // Get script name for error reporting
+        std::string name = fs::path(script_path).filename().string();
+        XoronStartupPhase script_phase(name.c_str());
+        
         // Compile the script
-        std::string bytecode = Luau::compile(source);
+        std::string bytecode;
+        {
+            XoronStartupPhase compile_phase("compile");
+            bytecode = Luau::compile(source);
+        }
         
         if (bytecode.empty() || bytecode[0] == 0) {
             // Compilation error - skip this script
             continue;
         }
         
-        // Get script name for error reporting
-        std::string name = fs::path(script_path).filename().string();
-        
         // Load and execute
-        int result = luau_load(L, name.c_str(), bytecode.data(), bytecode.size(), 0);
+        int result = xoron_load_script(L, name.c_str(), bytecode.data(), bytecode.size());
         if (result == 0) {
             // Execute with pcall to catch errors
+            XoronStartupPhase run_phase("run");
             if (lua_pcall(L, 0, 0, 0) == 0) {
                 executed++;
             } else {
@@ -953,11 +993,12 @@ static int lua_runautoexecute(lua_State* L) {
     return 1;
 }
 
+void xoron_init_filesystem(void) {
+    ensure_directories();
+}
+
 // Register all filesystem functions
 void xoron_register_filesystem(lua_State* L) {
-    // Initialize directories on registration
-    ensure_directories();
-    
     // Basic file operations
     lua_pushcfunction(L, lua_readfile, "readfile");
     lua_setglobal(L, "readfile");
@@ -1046,6 +1087,10 @@ void xoron_register_filesystem(lua_State* L) {
     lua_setglobal(L, "runautoexecute");
 }
 
+std::string xoron_workspace_path(const char* path) {
+    return resolve_path(path ? path : "");
+}
+
 // C API for workspace path
 extern "C" {
 
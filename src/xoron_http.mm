@@ -1,18 +1,51 @@
 /*
  * xoron_http.cpp - HTTP client using cpp-httplib
  * Platforms: iOS (.dylib) and Android (.so)
+ *
+ * Every request goes through http_perform. With XORON_HTTP2, https origins
+ * are tried over HTTP/2 first (xoron_http2.cpp) and fall back to cpp-httplib
+ * when the server only speaks HTTP/1.1.
  */
 
 #include "xoron.h"
 #include <string>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <memory>
+#include <random>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 // OpenSSL support is defined via CMake (CPPHTTPLIB_OPENSSL_SUPPORT)
 #include "httplib.h"
 
 extern void xoron_set_error(const char* fmt, ...);
 
+#define HTTP_UPLOAD_CHUNK 65536
+
+// Metrics
+static const int g_m_http_requests = xoron_metric_counter("http.requests");
+static const int g_m_http_errors = xoron_metric_counter("http.errors");
+static const int g_m_http_bytes_sent = xoron_metric_counter("http.bytes_sent");
+static const int g_m_http_bytes_received = xoron_metric_counter("http.bytes_received");
+static const int g_m_http_request_us = xoron_metric_histogram("http.request_us");
+static const int g_m_http_queue_wait_us = xoron_metric_histogram("http.queue_wait_us");
+static const int g_m_http_wait_interactive_us = xoron_metric_histogram("http.queue_wait_interactive_us");
+static const int g_m_http_wait_background_us = xoron_metric_histogram("http.queue_wait_background_us");
+static const int g_m_http_in_flight = xoron_metric_gauge("http.in_flight");
+static const int g_m_http_queued = xoron_metric_gauge("http.queued");
+
 static bool parse_url(const char* url, std::string& scheme, std::string& host, int& port, std::string& path) {
     std::string u = url;
     
@@ -40,105 +73,475 @@ static bool parse_url(const char* url, std::string& scheme, std::string& host, i
     return !host.empty();
 }
 
-extern "C" {
+enum HttpPriority { HTTP_INTERACTIVE, HTTP_BACKGROUND, HTTP_PRIORITY_COUNT };
 
-char* xoron_http_get(const char* url, int* status, size_t* len) {
-    if (!url) { xoron_set_error("URL is null"); return nullptr; }
+struct HttpRequest {
+    const char* method = "GET";
+    std::string url;
+    httplib::Headers headers;
+    const char* body = nullptr;     // borrowed
+    size_t body_len = 0;
+    XoronHttpBodySource* source = nullptr;  // streamed instead of body; POST, PUT or PATCH only
+    const XoronHttpBodySink* sink = nullptr;    // takes 2xx bodies instead of response.body
+    std::string content_type;       // sent when there is a body
+    bool follow_location = false;
+    HttpPriority priority = HTTP_INTERACTIVE;
+    const void* owner = nullptr;    // fairness key: the calling VM, or null for C callers
+};
+
+struct HttpResponse {
+    int status = 0;
+    std::string reason;
+    httplib::Headers headers;
+    std::string body;
+};
+
+// Sends a streamed body with cpp-httplib's content providers; Content-Length when known, chunked otherwise
+template <typename Client>
+static httplib::Result send_streamed(Client& cli, const HttpRequest& request, const std::string& path) {
+    XoronHttpBodySource* src = request.source;
+    httplib::Headers headers = request.headers;
+    std::string content_type = request.content_type;
+    auto ct = headers.find("Content-Type");
+    if (ct != headers.end()) {
+        content_type = ct->second;
+        headers.erase(ct);
+    }
+    std::string method = request.method;
+    std::string buf(HTTP_UPLOAD_CHUNK, '\0');
     
-    std::string scheme, host, path;
-    int port;
-    if (!parse_url(url, scheme, host, port, path)) {
-        xoron_set_error("Invalid URL");
-        return nullptr;
+    if (src->length >= 0) {
+        httplib::ContentProvider provider = [&](size_t, size_t length, httplib::DataSink& sink) {
+            long n = src->read(&buf[0], std::min(length, buf.size()));
+            if (n == 0 && src->error.empty()) src->error = "Body ended before its declared length";
+            return n > 0 && sink.write(buf.data(), (size_t)n);
+        };
+        size_t length = (size_t)src->length;
+        if (method == "PUT") return cli.Put(path, headers, length, provider, content_type);
+        if (method == "PATCH") return cli.Patch(path, headers, length, provider, content_type);
+        return cli.Post(path, headers, length, provider, content_type);
     }
     
-    try {
-        httplib::Result res;
-        if (scheme == "https") {
+    httplib::ContentProviderWithoutLength provider = [&](size_t, httplib::DataSink& sink) {
+        long n = src->read(&buf[0], buf.size());
+        if (n == 0) sink.done();
+        return n == 0 || (n > 0 && sink.write(buf.data(), (size_t)n));
+    };
+    if (method == "PUT") return cli.Put(path, headers, provider, content_type);
+    if (method == "PATCH") return cli.Patch(path, headers, provider, content_type);
+    return cli.Post(path, headers, provider, content_type);
+}
+
+static bool http1_perform(const HttpRequest& request, const std::string& scheme, const std::string& host,
+                          int port, const std::string& path, HttpResponse& response, std::string& error) {
+    int sink_status = 0;
+    bool sink_failed = false;
+    std::string other_body;     // non-2xx bodies when a sink takes the 2xx ones
+    auto perform = [&](auto& cli) -> httplib::Result {
+        cli.set_connection_timeout(30, 0);
+        cli.set_read_timeout(30, 0);
+        if (request.source) return send_streamed(cli, request, path);
+        
+        httplib::Request req;
+        req.method = request.method;
+        req.path = path;
+        req.headers = request.headers;
+        if (request.body_len) {
+            req.body.assign(request.body, request.body_len);
+            if (!req.has_header("Content-Type")) req.set_header("Content-Type", request.content_type);
+        }
+        if (request.sink) {
+            req.response_handler = [&](const httplib::Response& res) {
+                sink_status = res.status;
+                return true;
+            };
+            req.content_receiver = [&](const char* data, size_t len, uint64_t, uint64_t) {
+                if (sink_status < 200 || sink_status >= 300) {
+                    other_body.append(data, len);
+                    return true;
+                }
+                if ((*request.sink)(sink_status, data, len)) return true;
+                sink_failed = true;
+                return false;
+            };
+        }
+        return cli.send(req);
+    };
+    
+    httplib::Result res;
+    if (scheme == "https") {
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-            httplib::SSLClient cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            cli.enable_server_certificate_verification(false);
-            res = cli.Get(path);
+        httplib::SSLClient cli(host, port);
+        cli.enable_server_certificate_verification(false);
+        res = perform(cli);
 #else
-            xoron_set_error("HTTPS not supported (OpenSSL not available)");
-            return nullptr;
+        error = "HTTPS not supported (OpenSSL not available)";
+        return false;
 #endif
+    } else {
+        httplib::Client cli(host, port);
+        res = perform(cli);
+    }
+    
+    if (!res) {
+        if (sink_failed) {
+            error = "Response body rejected";
+        } else if (request.source && !request.source->error.empty()) {
+            error = request.source->error;
         } else {
-            httplib::Client cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            res = cli.Get(path);
+            error = "HTTP request failed: " + httplib::to_string(res.error());
         }
+        return false;
+    }
+    response.status = res->status;
+    response.reason = res->reason;
+    response.headers = std::move(res->headers);
+    response.body = request.sink ? std::move(other_body) : std::move(res->body);
+    return true;
+}
+
+#ifdef XORON_HTTP2
+// 1 with a response, 0 when the origin doesn't speak h2, -1 on error
+static int http2_perform(const HttpRequest& request, const std::string& host, int port, const std::string& path,
+                         HttpResponse& response, std::string& error) {
+    XoronHttpHeaders headers(request.headers.begin(), request.headers.end());
+    if ((request.body_len || request.source) && !request.headers.count("Content-Type")) {
+        headers.emplace_back("content-type", request.content_type);
+    }
+    XoronHttp2Response res;
+    int rc = xoron_http2_request(request.method, host, port, path, headers, request.body, request.body_len,
+                                 request.source, request.sink, res, error);
+    if (rc == 1) {
+        response.status = res.status;
+        response.reason = httplib::status_message(res.status);
+        response.headers = httplib::Headers(res.headers.begin(), res.headers.end());
+        response.body = std::move(res.body);
+    }
+    return rc;
+}
+#endif
+
+// parse_url that also rejects malformed ports instead of throwing
+static bool split_url(const std::string& url, std::string& scheme, std::string& host, int& port, std::string& path) {
+    try {
+        return parse_url(url.c_str(), scheme, host, port, path);
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Resolves a Location header against the URL that returned it
+static std::string resolve_location(const std::string& scheme, const std::string& host, int port,
+                                    const std::string& path, const std::string& location) {
+    if (location.find("://") != std::string::npos) return location;
+    if (location.compare(0, 2, "//") == 0) return scheme + ":" + location;
+    
+    bool default_port = port == (scheme == "https" ? 443 : 80);
+    std::string origin = scheme + "://" + host + (default_port ? "" : ":" + std::to_string(port));
+    if (!location.empty() && location[0] == '/') return origin + location;
+    std::string dir = path.substr(0, path.find_first_of("?#"));
+    return origin + dir.substr(0, dir.rfind('/') + 1) + location;
+}
+
+// ==================== Request scheduler ====================
+//
+// Requests wait here for a slot under the global in-flight cap and a token
+// from their host's bucket. Waiting requests are queued per priority class and
+// per owner (one per VM, plus one for C callers); owners take turns, so a
+// script that queues a hundred requests doesn't hold up another's single one.
+// Interactive requests are always picked first, and background requests leave
+// HTTP_RESERVED_INTERACTIVE slots free for them.
+
+#define HTTP_DEFAULT_CONCURRENCY 8
+#define HTTP_RESERVED_INTERACTIVE 2
+#define HTTP_DEFAULT_RATE 20.0          // requests per second per host
+#define HTTP_DEFAULT_BURST 40.0
+
+struct HttpTicket {
+    std::string host;
+    bool granted = false;
+};
+
+struct HttpOwnerQueue {
+    const void* owner;
+    std::deque<HttpTicket*> tickets;
+};
+
+struct HttpBucket {
+    double rate;
+    double burst;
+    double tokens;
+    uint64_t refilled_us;
+};
+
+struct HttpLimit {
+    double rate;
+    double burst;
+};
+
+static std::mutex g_sched_mutex;
+static std::condition_variable g_sched_cv;
+static std::deque<HttpOwnerQueue> g_sched_queues[HTTP_PRIORITY_COUNT];     // owners in turn order
+static std::unordered_map<std::string, HttpBucket> g_sched_buckets;
+static std::unordered_map<std::string, HttpLimit> g_sched_limits;          // per-host overrides
+static HttpLimit g_sched_default_limit = {HTTP_DEFAULT_RATE, HTTP_DEFAULT_BURST};
+static int g_sched_concurrency = HTTP_DEFAULT_CONCURRENCY;
+static int g_sched_in_flight = 0;
+static int g_sched_queued = 0;
+
+static HttpBucket& host_bucket(const std::string& host, uint64_t now) {
+    auto it = g_sched_buckets.find(host);
+    if (it != g_sched_buckets.end()) return it->second;
+    auto limit = g_sched_limits.find(host);
+    const HttpLimit& l = limit != g_sched_limits.end() ? limit->second : g_sched_default_limit;
+    return g_sched_buckets[host] = {l.rate, l.burst, l.burst, now};
+}
+
+// Takes a token if one is available; otherwise lowers *wake_us to when one will be
+static bool take_token(HttpBucket& b, uint64_t now, uint64_t* wake_us) {
+    if (b.rate <= 0) return true;
+    b.tokens = std::min(b.burst, b.tokens + (now - b.refilled_us) * b.rate / 1e6);
+    b.refilled_us = now;
+    if (b.tokens >= 1.0) {
+        b.tokens -= 1.0;
+        return true;
+    }
+    uint64_t ready = now + (uint64_t)((1.0 - b.tokens) / b.rate * 1e6) + 1;
+    *wake_us = std::min(*wake_us, ready);
+    return false;
+}
+
+// Grants every ticket that can run now, owners in turn; caller holds g_sched_mutex
+static int sched_dispatch(uint64_t now, uint64_t* wake_us) {
+    int granted = 0;
+    for (int cls = 0; cls < HTTP_PRIORITY_COUNT; cls++) {
+        int cap = cls == HTTP_INTERACTIVE ? g_sched_concurrency
+                                          : std::max(1, g_sched_concurrency - HTTP_RESERVED_INTERACTIVE);
+        std::deque<HttpOwnerQueue>& owners = g_sched_queues[cls];
         
-        if (!res) {
-            xoron_set_error("HTTP request failed: %s", httplib::to_string(res.error()).c_str());
-            return nullptr;
+        // An owner whose next request is rate limited keeps its turn order but is skipped
+        size_t blocked = 0;
+        while (!owners.empty() && blocked < owners.size() && g_sched_in_flight < cap) {
+            HttpOwnerQueue queue = std::move(owners.front());
+            owners.pop_front();
+            HttpTicket* t = queue.tickets.front();
+            if (take_token(host_bucket(t->host, now), now, wake_us)) {
+                t->granted = true;
+                queue.tickets.pop_front();
+                g_sched_in_flight++;
+                g_sched_queued--;
+                granted++;
+                blocked = 0;
+            } else {
+                blocked++;
+            }
+            if (!queue.tickets.empty()) owners.push_back(std::move(queue));
         }
-        
-        if (status) *status = res->status;
-        if (len) *len = res->body.size();
-        
-        char* body = (char*)malloc(res->body.size() + 1);
-        if (body) {
-            memcpy(body, res->body.c_str(), res->body.size());
-            body[res->body.size()] = '\0';
+    }
+    xoron_metric_set(g_m_http_in_flight, g_sched_in_flight);
+    xoron_metric_set(g_m_http_queued, g_sched_queued);
+    return granted;
+}
+
+// Blocks until the request may start
+static void sched_acquire(const std::string& host, HttpPriority priority, const void* owner) {
+    uint64_t start = xoron_metric_now_us();
+    HttpTicket ticket;
+    ticket.host = host;
+    
+    std::unique_lock<std::mutex> lock(g_sched_mutex);
+    std::deque<HttpOwnerQueue>& owners = g_sched_queues[priority];
+    auto it = std::find_if(owners.begin(), owners.end(), [&](const HttpOwnerQueue& q) { return q.owner == owner; });
+    if (it != owners.end()) {
+        it->tickets.push_back(&ticket);
+    } else {
+        owners.push_back({owner, {&ticket}});
+    }
+    g_sched_queued++;
+    
+    while (true) {
+        uint64_t now = xoron_metric_now_us();
+        uint64_t wake_us = UINT64_MAX;
+        if (sched_dispatch(now, &wake_us) > 0) g_sched_cv.notify_all();
+        if (ticket.granted) break;
+        if (wake_us == UINT64_MAX) {
+            g_sched_cv.wait(lock);
+        } else {
+            g_sched_cv.wait_for(lock, std::chrono::microseconds(wake_us - now));
         }
-        return body;
-    } catch (const std::exception& e) {
-        xoron_set_error("HTTP exception: %s", e.what());
-        return nullptr;
     }
+    lock.unlock();
+    
+    uint64_t waited = xoron_metric_now_us() - start;
+    xoron_metric_observe(g_m_http_queue_wait_us, waited);
+    xoron_metric_observe(priority == HTTP_INTERACTIVE ? g_m_http_wait_interactive_us : g_m_http_wait_background_us,
+                         waited);
 }
 
-char* xoron_http_post(const char* url, const char* body, size_t body_len,
-                      const char* content_type, int* status, size_t* len) {
-    if (!url) { xoron_set_error("URL is null"); return nullptr; }
+static void sched_release() {
+    std::lock_guard<std::mutex> lock(g_sched_mutex);
+    g_sched_in_flight--;
+    xoron_metric_set(g_m_http_in_flight, g_sched_in_flight);
+    g_sched_cv.notify_all();
+}
+
+// Holds a scheduler slot for the lifetime of a request
+struct HttpSlot {
+    HttpSlot(const std::string& host, HttpPriority priority, const void* owner) {
+        sched_acquire(host, priority, owner);
+    }
+    ~HttpSlot() { sched_release(); }
+};
+
+extern "C" {
+
+void xoron_http_set_rate_limit(const char* host, double rate, double burst) {
+    HttpLimit limit = {std::max(0.0, rate), std::max(1.0, burst)};
+    std::lock_guard<std::mutex> lock(g_sched_mutex);
+    if (!host || strcmp(host, "*") == 0) {
+        g_sched_default_limit = limit;
+        // Buckets without an override pick the new default up when next used
+        for (auto it = g_sched_buckets.begin(); it != g_sched_buckets.end();) {
+            it = g_sched_limits.count(it->first) ? std::next(it) : g_sched_buckets.erase(it);
+        }
+    } else {
+        g_sched_limits[host] = limit;
+        g_sched_buckets.erase(host);
+    }
+    g_sched_cv.notify_all();
+}
+
+void xoron_http_set_concurrency(int max_in_flight) {
+    std::lock_guard<std::mutex> lock(g_sched_mutex);
+    g_sched_concurrency = std::max(1, max_in_flight);
+    g_sched_cv.notify_all();
+}
+
+}
+
+// Every request goes through here: https tries HTTP/2 first and falls back to HTTP/1.1
+static bool http_perform(HttpRequest request, HttpResponse& response, std::string& error) {
+    xoron_metric_inc(g_m_http_requests, 1);
+    xoron_metric_inc(g_m_http_bytes_sent, request.body_len);
     
     std::string scheme, host, path;
-    int port;
-    if (!parse_url(url, scheme, host, port, path)) {
-        xoron_set_error("Invalid URL");
-        return nullptr;
+    int port = 0;
+    if (!split_url(request.url, scheme, host, port, path)) {
+        error = "Invalid URL";
+        xoron_metric_inc(g_m_http_errors, 1);
+        return false;
+    }
+    std::string method = request.method;
+    if (request.source && method != "POST" && method != "PUT" && method != "PATCH") {
+        error = "Streamed bodies need POST, PUT or PATCH";
+        xoron_metric_inc(g_m_http_errors, 1);
+        return false;
     }
     
-    std::string req_body = body ? std::string(body, body_len) : "";
-    std::string ct = content_type ? content_type : "application/json";
+    // The slot and the token are for the first host; redirects run inside them
+    HttpSlot slot(host, request.priority, request.owner);
+    XoronMetricTimer timer(g_m_http_request_us);
     
-    try {
-        httplib::Result res;
-        if (scheme == "https") {
-            httplib::SSLClient cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            cli.enable_server_certificate_verification(false);
-            res = cli.Post(path, req_body, ct);
-        } else {
-            httplib::Client cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            res = cli.Post(path, req_body, ct);
+    for (int redirects = 0;; redirects++) {
+        response = HttpResponse();
+        bool ok;
+        try {
+            int h2 = 0;
+#ifdef XORON_HTTP2
+            if (scheme == "https") h2 = http2_perform(request, host, port, path, response, error);
+            if (h2 == 0 && request.source && !request.source->rewind()) {
+                error = "The server refused the request, and its body source can't be resent";
+                h2 = -1;
+            }
+#endif
+            ok = h2 == 1 || (h2 == 0 && http1_perform(request, scheme, host, port, path, response, error));
+        } catch (const std::exception& e) {
+            error = std::string("HTTP exception: ") + e.what();
+            ok = false;
         }
-        
-        if (!res) {
-            xoron_set_error("HTTP request failed: %s", httplib::to_string(res.error()).c_str());
-            return nullptr;
+        if (!ok) {
+            xoron_metric_inc(g_m_http_errors, 1);
+            return false;
         }
         
-        if (status) *status = res->status;
-        if (len) *len = res->body.size();
-        
-        char* resp_body = (char*)malloc(res->body.size() + 1);
-        if (resp_body) {
-            memcpy(resp_body, res->body.c_str(), res->body.size());
-            resp_body[res->body.size()] = '\0';
+        int s = response.status;
+        bool redirect = s == 301 || s == 302 || s == 303 || s == 307 || s == 308;
+        auto location = response.headers.find("Location");
+        if (!request.follow_location || !redirect || location == response.headers.end()) break;
+        if (redirects == 10) {
+            error = "Too many redirects";
+            xoron_metric_inc(g_m_http_errors, 1);
+            return false;
         }
-        return resp_body;
-    } catch (const std::exception& e) {
-        xoron_set_error("HTTP exception: %s", e.what());
+        // A source that can't start over ends the chain at the redirect response
+        if (s != 303 && request.source && !request.source->rewind()) break;
+        request.url = resolve_location(scheme, host, port, path, location->second);
+        if (s == 303) {
+            request.method = "GET";
+            request.body = nullptr;
+            request.body_len = 0;
+            request.source = nullptr;
+        }
+        if (!split_url(request.url, scheme, host, port, path)) {
+            error = "Invalid redirect URL";
+            xoron_metric_inc(g_m_http_errors, 1);
+            return false;
+        }
+    }
+    
+    if (request.source) xoron_metric_inc(g_m_http_bytes_sent, request.source->position);
+    xoron_metric_inc(g_m_http_bytes_received, response.body.size());
+    return true;
+}
+
+static char* copy_body(const std::string& body) {
+    char* out = (char*)malloc(body.size() + 1);
+    if (out) {
+        memcpy(out, body.data(), body.size());
+        out[body.size()] = '\0';
+    }
+    return out;
+}
+
+extern "C" {
+
+char* xoron_http_get(const char* url, int* status, size_t* len) {
+    if (!url) { xoron_set_error("URL is null"); return nullptr; }
+    
+    HttpRequest request;
+    request.url = url;
+    HttpResponse response;
+    std::string error;
+    if (!http_perform(std::move(request), response, error)) {
+        xoron_set_error("%s", error.c_str());
         return nullptr;
     }
+    
+    if (status) *status = response.status;
+    if (len) *len = response.body.size();
+    return copy_body(response.body);
+}
+
+char* xoron_http_post(const char* url, const char* body, size_t body_len,
+                      const char* content_type, int* status, size_t* len) {
+    if (!url) { xoron_set_error("URL is null"); return nullptr; }
+    
+    HttpRequest request;
+    request.method = "POST";
+    request.url = url;
+    request.body = body;
+    request.body_len = body ? body_len : 0;
+    request.content_type = content_type ? content_type : "application/json";
+    HttpResponse response;
+    std::string error;
+    if (!http_perform(std::move(request), response, error)) {
+        xoron_set_error("%s", error.c_str());
+        return nullptr;
+    }
+    
+    if (status) *status = response.status;
+    if (len) *len = response.body.size();
+    return copy_body(response.body);
 }
 
 void xoron_http_free(char* response) {
@@ -147,91 +550,286 @@ void xoron_http_free(char* response) {
 
 }
 
-// Additional HTTP methods for Lua bindings
-static char* http_request_method(const char* method, const char* url, const char* body, 
-                                  size_t body_len, const char* content_type, 
-                                  int* status, size_t* len) {
+// Conditional GET for loadurl; follows redirects, and a 304 comes back with an empty body
+char* xoron_http_get_conditional(const char* url, const char* etag, int* status, size_t* len,
+                                 char* etag_out, size_t etag_out_len) {
+    if (etag_out && etag_out_len) etag_out[0] = '\0';
     if (!url) { xoron_set_error("URL is null"); return nullptr; }
     
-    std::string scheme, host, path;
-    int port;
-    if (!parse_url(url, scheme, host, port, path)) {
-        xoron_set_error("Invalid URL");
+    HttpRequest request;
+    request.url = url;
+    request.follow_location = true;
+    if (etag && *etag) request.headers.emplace("If-None-Match", etag);
+    HttpResponse response;
+    std::string error;
+    if (!http_perform(std::move(request), response, error)) {
+        xoron_set_error("%s", error.c_str());
         return nullptr;
     }
     
-    std::string req_body = body ? std::string(body, body_len) : "";
-    std::string ct = content_type ? content_type : "application/json";
+    if (status) *status = response.status;
+    if (len) *len = response.body.size();
+    if (etag_out && etag_out_len) {
+        auto it = response.headers.find("ETag");
+        snprintf(etag_out, etag_out_len, "%s", it != response.headers.end() ? it->second.c_str() : "");
+    }
+    return copy_body(response.body);
+}
+
+// Streaming GET for the download library; follows redirects
+bool xoron_http_fetch(const std::string& url, const XoronHttpHeaders& headers, const XoronHttpBodySink& sink,
+                      bool background, const void* owner, int* status, XoronHttpHeaders* response_headers,
+                      std::string& error) {
+    size_t received = 0;
+    XoronHttpBodySink counted = [&](int code, const char* data, size_t len) {
+        received += len;
+        return sink(code, data, len);
+    };
+    HttpRequest request;
+    request.url = url;
+    request.headers = httplib::Headers(headers.begin(), headers.end());
+    request.sink = &counted;
+    request.follow_location = true;
+    request.priority = background ? HTTP_BACKGROUND : HTTP_INTERACTIVE;
+    request.owner = owner;
+    HttpResponse response;
+    bool ok = http_perform(std::move(request), response, error);
+    xoron_metric_inc(g_m_http_bytes_received, received);
+    if (!ok) return false;
     
-    try {
-        httplib::Result res;
-        
-        auto make_request = [&](auto& cli) -> httplib::Result {
-            if (strcmp(method, "PUT") == 0) {
-                return cli.Put(path, req_body, ct);
-            } else if (strcmp(method, "DELETE") == 0) {
-                if (req_body.empty()) {
-                    return cli.Delete(path);
-                } else {
-                    return cli.Delete(path, req_body, ct);
-                }
-            } else if (strcmp(method, "PATCH") == 0) {
-                return cli.Patch(path, req_body, ct);
-            } else if (strcmp(method, "HEAD") == 0) {
-                return cli.Head(path);
-            } else if (strcmp(method, "OPTIONS") == 0) {
-                return cli.Options(path);
+    if (status) *status = response.status;
+    if (response_headers) {
+        response_headers->clear();
+        for (const auto& h : response.headers) {
+            std::string name = h.first;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            response_headers->emplace_back(std::move(name), h.second);
+        }
+    }
+    return true;
+}
+
+// Lua HTTP request function with full options
+#include "lua.h"
+#include "lualib.h"
+
+// ==================== Streamed bodies ====================
+
+typedef std::unique_ptr<XoronHttpBodySource> HttpSourcePtr;
+
+// Streams a workspace file with a known Content-Length
+static HttpSourcePtr file_source(const char* path, std::string& error) {
+    std::string resolved = xoron_workspace_path(path);
+    int fd = resolved.empty() ? -1 : open(resolved.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0) close(fd);
+        error = std::string("Cannot open ") + path;
+        return nullptr;
+    }
+    
+    HttpSourcePtr src(new XoronHttpBodySource());
+    XoronHttpBodySource* raw = src.get();
+    std::shared_ptr<int> file(new int(fd), [](int* f) { close(*f); delete f; });
+    std::string name = path;
+    src->length = (int64_t)st.st_size;
+    src->fill = [file, raw, name](char* buf, size_t cap) -> long {
+        ssize_t n;
+        do {
+            n = read(*file, buf, cap);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) raw->error = "Read failed: " + name;
+        return (long)n;
+    };
+    src->reset = [file] { return lseek(*file, 0, SEEK_SET) == 0; };
+    return src;
+}
+
+// Owned bytes; multipart boundaries and small fields
+static HttpSourcePtr bytes_source(std::string bytes) {
+    HttpSourcePtr src(new XoronHttpBodySource());
+    auto data = std::make_shared<std::string>(std::move(bytes));
+    auto offset = std::make_shared<size_t>(0);
+    src->length = (int64_t)data->size();
+    src->fill = [data, offset](char* buf, size_t cap) -> long {
+        size_t n = std::min(cap, data->size() - *offset);
+        memcpy(buf, data->data() + *offset, n);
+        *offset += n;
+        return (long)n;
+    };
+    src->reset = [offset] {
+        *offset = 0;
+        return true;
+    };
+    return src;
+}
+
+// Calls a Lua function for each chunk until it returns nil or ""; length unknown, can't rewind
+struct LuaChunkGenerator {
+    lua_State* L;
+    int ref;
+    std::string pending;
+    size_t offset = 0;
+    
+    ~LuaChunkGenerator() { lua_unref(L, ref); }
+};
+
+static HttpSourcePtr generator_source(lua_State* L, int idx) {
+    HttpSourcePtr src(new XoronHttpBodySource());
+    XoronHttpBodySource* raw = src.get();
+    auto gen = std::make_shared<LuaChunkGenerator>();
+    gen->L = L;
+    gen->ref = lua_ref(L, idx);
+    src->fill = [gen, raw](char* buf, size_t cap) -> long {
+        lua_State* L = gen->L;
+        if (gen->offset == gen->pending.size()) {
+            lua_getref(L, gen->ref);
+            if (lua_pcall(L, 0, 1, 0) != 0) {
+                raw->error = std::string("Body function failed: ") + (lua_isstring(L, -1) ? lua_tostring(L, -1) : "error");
+                lua_pop(L, 1);
+                return -1;
             }
-            return httplib::Result{nullptr, httplib::Error::Unknown};
-        };
-        
-        if (scheme == "https") {
-            httplib::SSLClient cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            cli.enable_server_certificate_verification(false);
-            res = make_request(cli);
-        } else {
-            httplib::Client cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            res = make_request(cli);
+            size_t len = 0;
+            const char* chunk = xoron_tobytes(L, -1, &len);
+            if (!chunk && !lua_isnil(L, -1)) {
+                raw->error = "Body function must return a string, Buffer or nil";
+                lua_pop(L, 1);
+                return -1;
+            }
+            gen->pending.assign(chunk ? chunk : "", len);
+            gen->offset = 0;
+            lua_pop(L, 1);
         }
-        
-        if (!res) {
-            xoron_set_error("HTTP request failed: %s", httplib::to_string(res.error()).c_str());
-            return nullptr;
+        size_t n = std::min(cap, gen->pending.size() - gen->offset);
+        memcpy(buf, gen->pending.data() + gen->offset, n);
+        gen->offset += n;
+        return (long)n;
+    };
+    return src;
+}
+
+// Parts read one after another; the length is known only if every part's is
+static HttpSourcePtr concat_source(std::vector<HttpSourcePtr> parts) {
+    HttpSourcePtr src(new XoronHttpBodySource());
+    XoronHttpBodySource* raw = src.get();
+    auto list = std::make_shared<std::vector<HttpSourcePtr>>(std::move(parts));
+    auto current = std::make_shared<size_t>(0);
+    src->length = 0;
+    for (const auto& part : *list) {
+        src->length = part->length < 0 || src->length < 0 ? -1 : src->length + part->length;
+    }
+    src->fill = [list, current, raw](char* buf, size_t cap) -> long {
+        while (*current < list->size()) {
+            XoronHttpBodySource& part = *(*list)[*current];
+            long n = part.read(buf, cap);
+            if (n < 0) raw->error = part.error;
+            if (n != 0) return n;
+            (*current)++;
+        }
+        return 0;
+    };
+    src->reset = [list, current] {
+        for (auto& part : *list) {
+            if (!part->rewind()) return false;
+        }
+        *current = 0;
+        return true;
+    };
+    return src;
+}
+
+// Multipart field names and file names go inside quotes
+static std::string multipart_quote(const char* s) {
+    std::string out;
+    for (; *s; s++) {
+        if (*s == '"') {
+            out += "%22";
+        } else if (*s != '\r' && *s != '\n') {
+            out += *s;
         }
+    }
+    return out;
+}
+
+// multipart/form-data from the Multipart array at idx; each part is
+// {Name, Value | File | Source, FileName?, ContentType?}, and Value is copied
+static HttpSourcePtr multipart_source(lua_State* L, int idx, std::string& content_type, std::string& error) {
+    static thread_local std::mt19937_64 rng(std::random_device{}());
+    char boundary[48];
+    snprintf(boundary, sizeof(boundary), "XoronFormBoundary%016llx", (unsigned long long)rng());
+    content_type = std::string("multipart/form-data; boundary=") + boundary;
+    
+    std::vector<HttpSourcePtr> parts;
+    int n = lua_objlen(L, idx);
+    for (int i = 1; i <= n; i++) {
+        lua_rawgeti(L, idx, i);
+        if (!lua_istable(L, -1)) luaL_error(L, "Multipart part %d must be a table", i);
+        int part = lua_gettop(L);
         
-        if (status) *status = res->status;
-        if (len) *len = res->body.size();
+        lua_getfield(L, part, "Name");
+        if (!lua_isstring(L, -1)) luaL_error(L, "Multipart part %d needs a Name", i);
+        std::string head = std::string("--") + boundary + "\r\nContent-Disposition: form-data; name=\"" +
+                           multipart_quote(lua_tostring(L, -1)) + "\"";
+        lua_getfield(L, part, "File");
+        lua_getfield(L, part, "Source");
+        lua_getfield(L, part, "Value");
+        lua_getfield(L, part, "FileName");
+        lua_getfield(L, part, "ContentType");
+        const char* file = lua_isstring(L, part + 2) ? lua_tostring(L, part + 2) : nullptr;
+        bool has_source = lua_isfunction(L, part + 3);
         
-        char* resp_body = (char*)malloc(res->body.size() + 1);
-        if (resp_body) {
-            memcpy(resp_body, res->body.c_str(), res->body.size());
-            resp_body[res->body.size()] = '\0';
+        const char* file_name = lua_isstring(L, part + 5) ? lua_tostring(L, part + 5) : nullptr;
+        if (!file_name && file) {
+            file_name = strrchr(file, '/');
+            file_name = file_name ? file_name + 1 : file;
         }
-        return resp_body;
-    } catch (const std::exception& e) {
-        xoron_set_error("HTTP exception: %s", e.what());
-        return nullptr;
+        if (file_name) head += std::string("; filename=\"") + multipart_quote(file_name) + "\"";
+        head += "\r\n";
+        if (lua_isstring(L, part + 6)) {
+            head += std::string("Content-Type: ") + lua_tostring(L, part + 6) + "\r\n";
+        } else if (file || has_source) {
+            head += "Content-Type: application/octet-stream\r\n";
+        }
+        head += "\r\n";
+        parts.push_back(bytes_source(std::move(head)));
+        
+        if (file) {
+            HttpSourcePtr body = file_source(file, error);
+            if (!body) return nullptr;
+            parts.push_back(std::move(body));
+        } else if (has_source) {
+            parts.push_back(generator_source(L, part + 3));
+        } else {
+            size_t len = 0;
+            const char* value = xoron_tobytes(L, part + 4, &len);
+            if (!value && lua_isnumber(L, part + 4)) value = lua_tolstring(L, part + 4, &len);
+            if (!value) luaL_error(L, "Multipart part %d needs a Value, File or Source", i);
+            parts.push_back(bytes_source(std::string(value, len)));
+        }
+        parts.push_back(bytes_source("\r\n"));
+        lua_settop(L, part - 1);
     }
+    parts.push_back(bytes_source(std::string("--") + boundary + "--\r\n"));
+    return concat_source(std::move(parts));
 }
 
-// Lua HTTP request function with full options
-#include "lua.h"
-#include "lualib.h"
-
 static int lua_http_request_full(lua_State* L) {
     // Accept either a table or URL string
     std::string url;
     std::string method = "GET";
-    std::string body;
-    std::string content_type = "application/json";
+    const char* body = "";      // points into the request table's string or Buffer
+    size_t body_len = 0;
+    std::string body_number;
+    bool body_as_buffer = false;
+    std::string content_type;
     httplib::Headers headers;
+    HttpPriority priority = HTTP_INTERACTIVE;
+    HttpSourcePtr source;       // BodyFile, a Body function or Multipart
+    std::string source_content_type = "application/octet-stream";
+    bool multipart = false;
     
     if (lua_istable(L, 1)) {
-        // Table format: {Url = "...", Method = "...", Body = "...", Headers = {...}}
+        // Table format: {Url = "...", Method = "...", Body = "..." or Buffer, Headers = {...}, BodyAsBuffer = bool}
         lua_getfield(L, 1, "Url");
         if (lua_isstring(L, -1)) url = lua_tostring(L, -1);
         lua_pop(L, 1);
@@ -241,11 +839,42 @@ static int lua_http_request_full(lua_State* L) {
         lua_pop(L, 1);
         
         lua_getfield(L, 1, "Body");
-        if (lua_isstring(L, -1)) {
-            size_t len;
-            const char* b = lua_tolstring(L, -1, &len);
-            body = std::string(b, len);
+        if (const char* b = xoron_tobytes(L, -1, &body_len)) {
+            body = b;
+        } else if (lua_isnumber(L, -1)) {
+            body_number = lua_tostring(L, -1);
+            body = body_number.c_str();
+            body_len = body_number.size();
+        } else if (lua_isfunction(L, -1)) {
+            source = generator_source(L, -1);
+        }
+        lua_pop(L, 1);
+        
+        lua_getfield(L, 1, "BodyFile");
+        lua_getfield(L, 1, "Multipart");
+        bool has_file = !lua_isnil(L, -2);
+        bool has_multipart = !lua_isnil(L, -1);
+        if ((body_len || source) + has_file + has_multipart > 1) {
+            luaL_error(L, "Use only one of Body, BodyFile and Multipart");
+            return 0;
+        }
+        std::string source_error;
+        if (has_file) {
+            source = file_source(luaL_checkstring(L, -2), source_error);
+        } else if (has_multipart) {
+            luaL_checktype(L, -1, LUA_TTABLE);
+            multipart = true;
+            source = multipart_source(L, lua_gettop(L), source_content_type, source_error);
+        }
+        lua_pop(L, 2);
+        if (!source && !source_error.empty()) {
+            lua_pushnil(L);
+            lua_pushstring(L, source_error.c_str());
+            return 2;
         }
+        
+        lua_getfield(L, 1, "BodyAsBuffer");
+        body_as_buffer = lua_toboolean(L, -1);
         lua_pop(L, 1);
         
         lua_getfield(L, 1, "Headers");
@@ -264,6 +893,18 @@ static int lua_http_request_full(lua_State* L) {
         lua_getfield(L, 1, "ContentType");
         if (lua_isstring(L, -1)) content_type = lua_tostring(L, -1);
         lua_pop(L, 1);
+        
+        lua_getfield(L, 1, "Priority");
+        if (lua_isstring(L, -1)) {
+            const char* p = lua_tostring(L, -1);
+            if (strcmp(p, "background") == 0) {
+                priority = HTTP_BACKGROUND;
+            } else if (strcmp(p, "interactive") != 0) {
+                luaL_error(L, "Priority must be \"interactive\" or \"background\"");
+                return 0;
+            }
+        }
+        lua_pop(L, 1);
     } else {
         url = luaL_checkstring(L, 1);
     }
@@ -274,94 +915,73 @@ static int lua_http_request_full(lua_State* L) {
         return 2;
     }
     
-    // Parse URL
-    std::string scheme, host, path;
-    int port;
-    if (!parse_url(url.c_str(), scheme, host, port, path)) {
+    HttpRequest request;
+    request.method = method.c_str();
+    request.url = url;
+    request.headers = std::move(headers);
+    request.body = body;
+    request.body_len = body_len;
+    if (multipart) {
+        // The boundary is in the content type, so it can't be overridden
+        request.headers.erase("Content-Type");
+        content_type = source_content_type;
+    }
+    request.content_type = !content_type.empty() ? content_type
+                           : source ? source_content_type : "application/json";
+    request.source = source.get();
+    request.priority = priority;
+    request.owner = lua_mainthread(L);
+    HttpResponse res;
+    std::string error;
+    if (!http_perform(std::move(request), res, error)) {
         lua_pushnil(L);
-        lua_pushstring(L, "Invalid URL");
+        lua_pushstring(L, error.c_str());
         return 2;
     }
     
-    try {
-        httplib::Result res;
-        
-        auto make_request = [&](auto& cli) -> httplib::Result {
-            // Set headers
-            for (const auto& h : headers) {
-                cli.set_default_headers({{h.first, h.second}});
-            }
-            
-            if (method == "GET") {
-                return cli.Get(path);
-            } else if (method == "POST") {
-                return cli.Post(path, body, content_type);
-            } else if (method == "PUT") {
-                return cli.Put(path, body, content_type);
-            } else if (method == "DELETE") {
-                if (body.empty()) {
-                    return cli.Delete(path);
-                } else {
-                    return cli.Delete(path, body, content_type);
-                }
-            } else if (method == "PATCH") {
-                return cli.Patch(path, body, content_type);
-            } else if (method == "HEAD") {
-                return cli.Head(path);
-            } else if (method == "OPTIONS") {
-                return cli.Options(path);
-            }
-            return httplib::Result{nullptr, httplib::Error::Unknown};
-        };
-        
-        if (scheme == "https") {
-            httplib::SSLClient cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            cli.enable_server_certificate_verification(false);
-            res = make_request(cli);
-        } else {
-            httplib::Client cli(host, port);
-            cli.set_connection_timeout(30, 0);
-            cli.set_read_timeout(30, 0);
-            res = make_request(cli);
-        }
-        
-        if (!res) {
-            lua_pushnil(L);
-            lua_pushstring(L, httplib::to_string(res.error()).c_str());
-            return 2;
-        }
-        
-        // Return response table
-        lua_newtable(L);
-        
-        lua_pushboolean(L, res->status >= 200 && res->status < 300);
-        lua_setfield(L, -2, "Success");
-        
-        lua_pushinteger(L, res->status);
-        lua_setfield(L, -2, "StatusCode");
-        
-        lua_pushstring(L, res->reason.c_str());
-        lua_setfield(L, -2, "StatusMessage");
-        
-        lua_pushlstring(L, res->body.c_str(), res->body.size());
-        lua_setfield(L, -2, "Body");
-        
-        // Headers table
-        lua_newtable(L);
-        for (const auto& h : res->headers) {
-            lua_pushstring(L, h.second.c_str());
-            lua_setfield(L, -2, h.first.c_str());
-        }
-        lua_setfield(L, -2, "Headers");
-        
-        return 1;
-    } catch (const std::exception& e) {
-        lua_pushnil(L);
-        lua_pushstring(L, e.what());
-        return 2;
+    // Return response table
+    lua_newtable(L);
+    
+    lua_pushboolean(L, res.status >= 200 && res.status < 300);
+    lua_setfield(L, -2, "Success");
+    
+    lua_pushinteger(L, res.status);
+    lua_setfield(L, -2, "StatusCode");
+    
+    lua_pushstring(L, res.reason.c_str());
+    lua_setfield(L, -2, "StatusMessage");
+    
+    if (body_as_buffer) {
+        memcpy(xoron_pushbuffer(L, res.body.size()), res.body.data(), res.body.size());
+    } else {
+        lua_pushlstring(L, res.body.c_str(), res.body.size());
+    }
+    lua_setfield(L, -2, "Body");
+    
+    // Headers table
+    lua_newtable(L);
+    for (const auto& h : res.headers) {
+        lua_pushstring(L, h.second.c_str());
+        lua_setfield(L, -2, h.first.c_str());
     }
+    lua_setfield(L, -2, "Headers");
+    
+    return 1;
+}
+
+// http.setratelimit(host, rate, burst) - Requests per second allowed to host ("*" for the default), 0 for no limit
+static int lua_http_setratelimit(lua_State* L) {
+    const char* host = luaL_checkstring(L, 1);
+    double rate = luaL_checknumber(L, 2);
+    double burst = luaL_optnumber(L, 3, std::max(1.0, rate));
+    xoron_http_set_rate_limit(host, rate, burst);
+    return 0;
+}
+
+// http.setconcurrency(n) - Maximum requests in flight across all scripts
+static int lua_http_setconcurrency(lua_State* L) {
+    xoron_http_set_concurrency(luaL_checkinteger(L, 1));
+    return 0;
 }
 
 // Register HTTP functions in Lua
@@ -372,6 +992,12 @@ void xoron_register_http(lua_State* L) {
     lua_pushcfunction(L, lua_http_request_full, "request");
     lua_setfield(L, -2, "request");
     
+    lua_pushcfunction(L, lua_http_setratelimit, "setratelimit");
+    lua_setfield(L, -2, "setratelimit");
+    
+    lua_pushcfunction(L, lua_http_setconcurrency, "setconcurrency");
+    lua_setfield(L, -2, "setconcurrency");
+    
     lua_setglobal(L, "http");
     
     // Also register as global request function
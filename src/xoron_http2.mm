@@ -0,0 +1,686 @@
+/*
+ * xoron_http2.cpp - HTTP/2 client transport
+ * Provides: xoron_http2_request (https requests from xoron_http.cpp)
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Each origin gets one TLS connection, negotiated to h2 through ALPN, and
+ * concurrent requests from any thread become streams on it. nghttp2 does the
+ * framing, HPACK header compression and flow control; a per-connection I/O
+ * thread owns the session and the socket while callers block on their
+ * stream. Origins that answer ALPN with http/1.1 are remembered for a while
+ * and handed back to cpp-httplib, as are streams the server refused unread.
+ *
+ * Streamed bodies are read by the waiting caller, never the I/O thread, so a
+ * source may call into Lua. The data provider defers until the caller has
+ * filled the stream's chunk, so one chunk per upload is held in memory.
+ */
+
+#include "xoron.h"
+
+#ifdef XORON_HTTP2
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <openssl/ssl.h>
+#include <nghttp2/nghttp2.h>
+
+#define H2_TIMEOUT_MS 30000             // connect, handshake and read, as the HTTP/1.1 client
+#define H2_IDLE_MS 60000                // an unused connection closes after this
+#define H2_H1_ORIGIN_TTL 600            // seconds an http/1.1-only origin skips the h2 attempt
+#define H2_STREAM_WINDOW (1 << 20)
+#define H2_CONNECTION_WINDOW (16 << 20)
+#define H2_WRITE_BATCH 16384
+#define H2_UPLOAD_CHUNK 65536
+
+// Metrics
+static const int g_m_h2_connections = xoron_metric_counter("http2.connections");
+static const int g_m_h2_streams = xoron_metric_counter("http2.streams");
+static const int g_m_h2_active = xoron_metric_gauge("http2.active_streams");
+static const int g_m_h2_fallbacks = xoron_metric_counter("http2.fallbacks");
+
+// One request; it lives on the caller's stack, and the caller blocks until done
+struct H2Stream {
+    const char* method;
+    const std::string* path;
+    const XoronHttpHeaders* headers;
+    const char* body;
+    size_t body_len;
+    size_t body_sent = 0;
+    XoronHttpBodySource* source;
+    const XoronHttpBodySink* sink;      // called on the I/O thread
+    bool sink_failed = false;
+    XoronHttp2Response* out;
+    int32_t id = 0;
+    
+    // Streamed body, under the connection mutex: the caller refills chunk when need_data is set
+    std::string chunk;
+    size_t chunk_off = 0;
+    bool need_data = false;
+    bool source_done = false;
+    bool source_failed = false;
+    
+    bool done = false;
+    bool retry = false;     // never processed by the server; safe to send over HTTP/1.1
+    std::string error;
+};
+
+struct H2Connection {
+    std::string host;
+    int port = 0;
+    
+    // Shared with callers
+    std::mutex mutex;
+    std::condition_variable cv;         // signalled as streams finish
+    std::vector<H2Stream*> queued;      // not yet handed to nghttp2
+    std::vector<int32_t> resume;        // streams whose body chunk was refilled
+    bool closing = false;               // takes no new streams
+    int wake[2] = {-1, -1};
+    
+    // I/O thread only
+    int fd = -1;
+    SSL* ssl = nullptr;
+    nghttp2_session* session = nullptr;
+    std::unordered_set<H2Stream*> streams;
+    std::string out;
+    size_t out_off = 0;
+    
+    ~H2Connection() {
+        if (wake[0] >= 0) close(wake[0]);
+        if (wake[1] >= 0) close(wake[1]);
+    }
+};
+
+static std::mutex g_h2_mutex;
+static std::unordered_map<std::string, std::shared_ptr<H2Connection>> g_h2_connections;
+static std::unordered_map<std::string, time_t> g_h1_origins;    // origin -> retry h2 after
+
+static uint64_t now_ms() {
+    return xoron_metric_now_us() / 1000;
+}
+
+static std::string origin_key(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+static void finish_stream(H2Connection* c, H2Stream* s, bool retry, const char* error) {
+    std::lock_guard<std::mutex> lock(c->mutex);
+    s->retry = retry;
+    if (error) s->error = error;
+    s->done = true;
+    c->cv.notify_all();
+}
+
+static void wake_connection(H2Connection* c) {
+    char b = 1;
+    if (write(c->wake[1], &b, 1) < 0) {
+        // Full pipe: the I/O thread is already due to wake
+    }
+}
+
+static bool wait_fd(int fd, short events, int timeout_ms) {
+    struct pollfd p = {fd, events, 0};
+    return poll(&p, 1, timeout_ms) > 0;
+}
+
+// ==================== TLS connection ====================
+
+static SSL_CTX* tls_context() {
+    static SSL_CTX* ctx = [] {
+        SSL_CTX* c = SSL_CTX_new(TLS_client_method());
+        if (c) {
+            static const unsigned char alpn[] = "\x02h2\x08http/1.1";
+            SSL_CTX_set_min_proto_version(c, TLS1_2_VERSION);
+            SSL_CTX_set_alpn_protos(c, alpn, sizeof(alpn) - 1);
+            // Same policy as the HTTP/1.1 client, which doesn't verify certificates either
+            SSL_CTX_set_verify(c, SSL_VERIFY_NONE, nullptr);
+            SSL_CTX_set_mode(c, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        }
+        return c;
+    }();
+    return ctx;
+}
+
+static int connect_tcp(const std::string& host, int port) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return -1;
+    
+    int fd = -1;
+    for (struct addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        bool ok = connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 ||
+                  (errno == EINPROGRESS && wait_fd(fd, POLLOUT, H2_TIMEOUT_MS) &&
+                   getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0);
+        if (!ok) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+    return fd;
+}
+
+// Connects and handshakes; false with an empty error when the server didn't pick h2
+static bool connect_tls(H2Connection* c, std::string& error) {
+    SSL_CTX* ctx = tls_context();
+    if (!ctx) {
+        error = "TLS unavailable";
+        return false;
+    }
+    c->fd = connect_tcp(c->host, c->port);
+    if (c->fd < 0) {
+        error = "Connection failed";
+        return false;
+    }
+    
+    c->ssl = SSL_new(ctx);
+    if (!c->ssl) {
+        error = "TLS unavailable";
+        return false;
+    }
+    SSL_set_fd(c->ssl, c->fd);
+    SSL_set_tlsext_host_name(c->ssl, c->host.c_str());
+    
+    uint64_t deadline = now_ms() + H2_TIMEOUT_MS;
+    int r;
+    while ((r = SSL_connect(c->ssl)) != 1) {
+        int e = SSL_get_error(c->ssl, r);
+        uint64_t now = now_ms();
+        short events = e == SSL_ERROR_WANT_READ ? POLLIN : e == SSL_ERROR_WANT_WRITE ? POLLOUT : 0;
+        if (!events || now >= deadline || !wait_fd(c->fd, events, (int)(deadline - now))) {
+            error = events ? "TLS handshake timed out" : "TLS handshake failed";
+            return false;
+        }
+    }
+    
+    const unsigned char* alpn = nullptr;
+    unsigned int alpn_len = 0;
+    SSL_get0_alpn_selected(c->ssl, &alpn, &alpn_len);
+    return alpn_len == 2 && memcmp(alpn, "h2", 2) == 0;
+}
+
+// ==================== nghttp2 callbacks ====================
+
+static int on_header(nghttp2_session* session, const nghttp2_frame* frame, const uint8_t* name, size_t namelen,
+                     const uint8_t* value, size_t valuelen, uint8_t flags, void* user_data) {
+    (void)flags; (void)user_data;
+    if (frame->hd.type != NGHTTP2_HEADERS) return 0;
+    H2Stream* s = (H2Stream*)nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+    if (!s) return 0;
+    
+    if (namelen == 7 && memcmp(name, ":status", 7) == 0) {
+        // Interim 1xx responses come first; only the final status and its headers are kept
+        s->out->status = atoi(std::string((const char*)value, valuelen).c_str());
+        s->out->headers.clear();
+    } else if (namelen > 0 && name[0] != ':') {
+        s->out->headers.emplace_back(std::string((const char*)name, namelen),
+                                     std::string((const char*)value, valuelen));
+    }
+    return 0;
+}
+
+static int on_data_chunk(nghttp2_session* session, uint8_t flags, int32_t stream_id,
+                         const uint8_t* data, size_t len, void* user_data) {
+    (void)flags; (void)user_data;
+    H2Stream* s = (H2Stream*)nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!s || s->sink_failed) return 0;
+    if (s->sink && s->out->status >= 200 && s->out->status < 300) {
+        if (!(*s->sink)(s->out->status, (const char*)data, len)) {
+            s->sink_failed = true;
+            nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+        }
+    } else {
+        s->out->body.append((const char*)data, len);
+    }
+    return 0;
+}
+
+static int on_stream_close(nghttp2_session* session, int32_t stream_id, uint32_t error_code, void* user_data) {
+    H2Connection* c = (H2Connection*)user_data;
+    H2Stream* s = (H2Stream*)nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!s || !c->streams.erase(s)) return 0;
+    xoron_metric_adjust(g_m_h2_active, -1);
+    
+    if (s->sink_failed) {
+        finish_stream(c, s, false, "Response body rejected");
+    } else if (error_code == NGHTTP2_REFUSED_STREAM) {
+        finish_stream(c, s, true, nullptr);
+    } else if (error_code != NGHTTP2_NO_ERROR) {
+        finish_stream(c, s, false, nghttp2_http2_strerror(error_code));
+    } else {
+        finish_stream(c, s, false, s->out->status ? nullptr : "Stream closed without a response");
+    }
+    return 0;
+}
+
+static int on_frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) {
+    (void)session;
+    if (frame->hd.type == NGHTTP2_GOAWAY) {
+        // Streams past last_stream_id are closed as refused; new requests need a new connection
+        H2Connection* c = (H2Connection*)user_data;
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->closing = true;
+    }
+    return 0;
+}
+
+static ssize_t read_body(nghttp2_session* session, int32_t stream_id, uint8_t* buf, size_t length,
+                         uint32_t* data_flags, nghttp2_data_source* source, void* user_data) {
+    (void)session; (void)stream_id; (void)user_data;
+    H2Stream* s = (H2Stream*)source->ptr;
+    size_t n = std::min(length, s->body_len - s->body_sent);
+    memcpy(buf, s->body + s->body_sent, n);
+    s->body_sent += n;
+    if (s->body_sent == s->body_len) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    return (ssize_t)n;
+}
+
+// Streamed bodies: hands out the caller's chunk and asks for the next one as it runs dry
+static ssize_t read_source(nghttp2_session* session, int32_t stream_id, uint8_t* buf, size_t length,
+                           uint32_t* data_flags, nghttp2_data_source* source, void* user_data) {
+    (void)session; (void)stream_id;
+    H2Connection* c = (H2Connection*)user_data;
+    H2Stream* s = (H2Stream*)source->ptr;
+    std::lock_guard<std::mutex> lock(c->mutex);
+    if (s->source_failed) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    
+    size_t n = std::min(length, s->chunk.size() - s->chunk_off);
+    memcpy(buf, s->chunk.data() + s->chunk_off, n);
+    s->chunk_off += n;
+    s->body_sent += n;
+    if (s->chunk_off == s->chunk.size()) {
+        if (s->source_done) {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        } else if (!s->need_data) {
+            s->need_data = true;
+            c->cv.notify_all();
+        }
+    }
+    if (n == 0 && !(*data_flags & NGHTTP2_DATA_FLAG_EOF)) return NGHTTP2_ERR_DEFERRED;
+    return (ssize_t)n;
+}
+
+// ==================== I/O thread ====================
+
+static bool is_connection_header(const std::string& name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade" || name == "host" || name == "content-length";
+}
+
+static nghttp2_nv make_nv(const std::string& name, const std::string& value) {
+    return {(uint8_t*)name.data(), (uint8_t*)value.data(), name.size(), value.size(), NGHTTP2_NV_FLAG_NONE};
+}
+
+static bool submit_stream(H2Connection* c, H2Stream* s) {
+    std::string method = s->method;
+    std::string scheme = "https";
+    std::string authority = c->port == 443 ? c->host : origin_key(c->host, c->port);
+    bool has_body = s->source || s->body_len;
+    int64_t body_len = s->source ? s->source->length : (int64_t)s->body_len;
+    std::string length = std::to_string(body_len);
+    
+    // HTTP/2 header names are lowercase; hop-by-hop headers don't exist there
+    std::vector<std::string> names;
+    names.reserve(s->headers->size());
+    for (const auto& h : *s->headers) {
+        names.push_back(h.first);
+        std::transform(names.back().begin(), names.back().end(), names.back().begin(), ::tolower);
+    }
+    
+    static const std::string k_method = ":method", k_scheme = ":scheme", k_authority = ":authority",
+                             k_path = ":path", k_length = "content-length";
+    std::vector<nghttp2_nv> nv;
+    nv.reserve(names.size() + 5);
+    nv.push_back(make_nv(k_method, method));
+    nv.push_back(make_nv(k_scheme, scheme));
+    nv.push_back(make_nv(k_authority, authority));
+    nv.push_back(make_nv(k_path, *s->path));
+    if (has_body && body_len >= 0) nv.push_back(make_nv(k_length, length));
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!is_connection_header(names[i])) nv.push_back(make_nv(names[i], (*s->headers)[i].second));
+    }
+    
+    nghttp2_data_provider provider;
+    provider.source.ptr = s;
+    provider.read_callback = s->source ? read_source : read_body;
+    int32_t id = nghttp2_submit_request(c->session, nullptr, nv.data(), nv.size(),
+                                        has_body ? &provider : nullptr, s);
+    if (id < 0) return false;
+    
+    s->id = id;
+    c->streams.insert(s);
+    xoron_metric_inc(g_m_h2_streams, 1);
+    xoron_metric_adjust(g_m_h2_active, 1);
+    return true;
+}
+
+static void submit_queued(H2Connection* c) {
+    std::vector<H2Stream*> queued;
+    std::vector<int32_t> resume;
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        queued.swap(c->queued);
+        resume.swap(c->resume);
+    }
+    // Fails harmlessly for streams that closed in the meantime
+    for (int32_t id : resume) nghttp2_session_resume_data(c->session, id);
+    
+    for (H2Stream* s : queued) {
+        // Out of stream ids: this connection is done, the request goes over HTTP/1.1
+        if (!submit_stream(c, s)) {
+            {
+                std::lock_guard<std::mutex> lock(c->mutex);
+                c->closing = true;
+            }
+            finish_stream(c, s, true, nullptr);
+        }
+    }
+}
+
+// Writes whatever nghttp2 has queued; true unless the connection failed
+static bool flush(H2Connection* c, std::string& error) {
+    while (true) {
+        if (c->out_off == c->out.size()) {
+            c->out.clear();
+            c->out_off = 0;
+            while (c->out.size() < H2_WRITE_BATCH) {
+                const uint8_t* data = nullptr;
+                ssize_t n = nghttp2_session_mem_send(c->session, &data);
+                if (n < 0) {
+                    error = nghttp2_strerror((int)n);
+                    return false;
+                }
+                if (n == 0) break;
+                c->out.append((const char*)data, (size_t)n);
+            }
+            if (c->out.empty()) return true;
+        }
+        
+        int n = SSL_write(c->ssl, c->out.data() + c->out_off, (int)(c->out.size() - c->out_off));
+        if (n <= 0) {
+            int e = SSL_get_error(c->ssl, n);
+            if (e == SSL_ERROR_WANT_WRITE || e == SSL_ERROR_WANT_READ) return true;
+            error = "Connection lost";
+            return false;
+        }
+        c->out_off += (size_t)n;
+    }
+}
+
+// Feeds everything readable to nghttp2; true unless the connection failed or closed
+static bool receive(H2Connection* c, std::string& error) {
+    uint8_t buf[16384];
+    while (true) {
+        int n = SSL_read(c->ssl, buf, sizeof(buf));
+        if (n <= 0) {
+            int e = SSL_get_error(c->ssl, n);
+            if (e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE) return true;
+            error = e == SSL_ERROR_ZERO_RETURN ? "Connection closed by server" : "Connection lost";
+            return false;
+        }
+        ssize_t r = nghttp2_session_mem_recv(c->session, buf, (size_t)n);
+        if (r < 0) {
+            error = nghttp2_strerror((int)r);
+            return false;
+        }
+    }
+}
+
+static bool start_session(H2Connection* c) {
+    nghttp2_session_callbacks* callbacks;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) return false;
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, on_header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, on_data_chunk);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, on_stream_close);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, on_frame_recv);
+    int rv = nghttp2_session_client_new(&c->session, callbacks, c);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) return false;
+    
+    nghttp2_settings_entry settings[] = {
+        {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100},
+        {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, H2_STREAM_WINDOW},
+        {NGHTTP2_SETTINGS_ENABLE_PUSH, 0},
+    };
+    nghttp2_submit_settings(c->session, NGHTTP2_FLAG_NONE, settings, sizeof(settings) / sizeof(settings[0]));
+    nghttp2_session_set_local_window_size(c->session, NGHTTP2_FLAG_NONE, 0, H2_CONNECTION_WINDOW);
+    return true;
+}
+
+// Unregisters the connection and fails whatever it still holds
+static void shutdown_connection(const std::shared_ptr<H2Connection>& c, bool retry, const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(g_h2_mutex);
+        auto it = g_h2_connections.find(origin_key(c->host, c->port));
+        if (it != g_h2_connections.end() && it->second == c) g_h2_connections.erase(it);
+    }
+    std::vector<H2Stream*> queued;
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->closing = true;
+        queued.swap(c->queued);
+    }
+    
+    if (c->session) nghttp2_session_del(c->session);
+    c->session = nullptr;
+    if (c->ssl) SSL_free(c->ssl);
+    c->ssl = nullptr;
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    
+    const char* message = error.empty() ? "Connection closed" : error.c_str();
+    for (H2Stream* s : queued) finish_stream(c.get(), s, retry, retry ? nullptr : message);
+    xoron_metric_adjust(g_m_h2_active, -(int64_t)c->streams.size());
+    for (H2Stream* s : c->streams) finish_stream(c.get(), s, false, message);
+    c->streams.clear();
+}
+
+static void connection_main(std::shared_ptr<H2Connection> c) {
+    std::string error;
+    if (!connect_tls(c.get(), error)) {
+        if (error.empty()) {
+            std::lock_guard<std::mutex> lock(g_h2_mutex);
+            g_h1_origins[origin_key(c->host, c->port)] = time(nullptr) + H2_H1_ORIGIN_TTL;
+        }
+        // No h2: queued requests go over HTTP/1.1; connect errors are reported as they are
+        shutdown_connection(c, error.empty(), error);
+        return;
+    }
+    if (!start_session(c.get())) {
+        shutdown_connection(c, true, error);
+        return;
+    }
+    xoron_metric_inc(g_m_h2_connections, 1);
+    
+    uint64_t last_read = now_ms();
+    uint64_t idle_since = last_read;
+    while (true) {
+        submit_queued(c.get());
+        if (!flush(c.get(), error)) break;
+        if (!nghttp2_session_want_read(c->session) && !nghttp2_session_want_write(c->session)) break;
+        
+        // The read timeout only runs while a response is outstanding
+        uint64_t now = now_ms();
+        if (c->streams.empty()) {
+            last_read = now;
+        } else {
+            idle_since = now;
+        }
+        if (now - last_read > H2_TIMEOUT_MS) {
+            error = "Read timeout";
+            break;
+        } else if (now - idle_since > H2_IDLE_MS) {
+            std::lock_guard<std::mutex> lock(c->mutex);
+            if (c->queued.empty()) {
+                c->closing = true;
+                break;
+            }
+        } else if (c->streams.empty()) {
+            // After a GOAWAY, the connection ends once the streams it left us have finished
+            std::lock_guard<std::mutex> lock(c->mutex);
+            if (c->closing && c->queued.empty()) break;
+        }
+        
+        struct pollfd fds[2] = {
+            {c->fd, (short)(POLLIN | (c->out_off < c->out.size() ? POLLOUT : 0)), 0},
+            {c->wake[0], POLLIN, 0},
+        };
+        if (poll(fds, 2, 1000) < 0 && errno != EINTR) {
+            error = "poll failed";
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(c->wake[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (!receive(c.get(), error)) break;
+            last_read = now_ms();
+        }
+    }
+    
+    if (c->session && error.empty()) {
+        nghttp2_session_terminate_session(c->session, NGHTTP2_NO_ERROR);
+        std::string ignored;
+        flush(c.get(), ignored);
+    }
+    shutdown_connection(c, true, error);
+}
+
+// ==================== Public entry ====================
+
+static std::shared_ptr<H2Connection> new_connection(const std::string& host, int port) {
+    auto c = std::make_shared<H2Connection>();
+    c->host = host;
+    c->port = port;
+    if (pipe(c->wake) != 0) return nullptr;
+    for (int fd : c->wake) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return c;
+}
+
+static bool enqueue(H2Connection* c, H2Stream* s) {
+    std::lock_guard<std::mutex> lock(c->mutex);
+    if (c->closing) return false;
+    c->queued.push_back(s);
+    return true;
+}
+
+int xoron_http2_request(const char* method, const std::string& host, int port, const std::string& path,
+                        const XoronHttpHeaders& headers, const char* body, size_t body_len,
+                        XoronHttpBodySource* source, const XoronHttpBodySink* sink,
+                        XoronHttp2Response& out, std::string& error) {
+    H2Stream s;
+    s.method = method;
+    s.path = &path;
+    s.headers = &headers;
+    s.body = body;
+    s.body_len = body ? body_len : 0;
+    s.source = source;
+    s.sink = sink;
+    s.out = &out;
+    
+    std::string origin = origin_key(host, port);
+    std::shared_ptr<H2Connection> conn;
+    {
+        std::lock_guard<std::mutex> lock(g_h2_mutex);
+        auto h1 = g_h1_origins.find(origin);
+        if (h1 != g_h1_origins.end()) {
+            if (time(nullptr) < h1->second) return 0;
+            g_h1_origins.erase(h1);
+        }
+        
+        auto it = g_h2_connections.find(origin);
+        if (it != g_h2_connections.end() && enqueue(it->second.get(), &s)) {
+            conn = it->second;
+        } else {
+            conn = new_connection(host, port);
+            if (!conn) {
+                error = "Failed to create connection";
+                return -1;
+            }
+            enqueue(conn.get(), &s);
+            g_h2_connections[origin] = conn;
+            std::thread(connection_main, conn).detach();
+        }
+    }
+    wake_connection(conn.get());
+    
+    std::unique_lock<std::mutex> lock(conn->mutex);
+    std::string buf;
+    while (true) {
+        conn->cv.wait(lock, [&] { return s.done || s.need_data; });
+        if (s.done) break;
+        
+        // Refill outside the lock; the I/O thread won't touch the chunk until need_data clears
+        lock.unlock();
+        buf.resize(H2_UPLOAD_CHUNK);
+        long n = source->read(&buf[0], buf.size());
+        lock.lock();
+        if (n > 0) {
+            buf.resize((size_t)n);
+            s.chunk.swap(buf);
+        } else {
+            s.chunk.clear();
+            s.source_failed = n < 0;
+            s.source_done = n == 0;
+        }
+        s.chunk_off = 0;
+        s.need_data = false;
+        conn->resume.push_back(s.id);
+        wake_connection(conn.get());
+    }
+    if (s.source_failed) {
+        error = source->error.empty() ? "Body source failed" : source->error;
+        return -1;
+    }
+    if (s.retry) {
+        xoron_metric_inc(g_m_h2_fallbacks, 1);
+        out = XoronHttp2Response();
+        return 0;
+    }
+    if (!s.error.empty()) {
+        error = s.error;
+        return -1;
+    }
+    return 1;
+}
+
+#endif // XORON_HTTP2
@@ -1,11 +1,17 @@
 /*
  * xoron_input.cpp - Input library for executor
- * Provides: mouse/keyboard input functions, keypress detection
+ * Provides: mouse/keyboard input functions, keypress detection, Input event signals
  *
  * On iOS, input simulation requires integration with the game's input system.
  * The functions track state locally and can be connected to actual input
  * handlers when injected into the game process.
  *
+ * Host threads report input through xoron_input_*. Each report flips a bit
+ * in an atomic key/button bitset, so state queries never take a lock, and
+ * is appended with a timestamp to a bounded lock-free ring. The VM that
+ * connected Input signals drains the ring in one batch per channel message,
+ * so presses shorter than a frame still reach scripts, in order.
+ *
  * Platform-specific implementations:
  *   - iOS: Uses UIKit for touch simulation and game controller support
  *   - Android: Uses Android input system and game controller support
@@ -17,8 +23,8 @@
 #include <cstdio>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <mutex>
+#include <atomic>
 
 #include "lua.h"
 #include "lualib.h"
@@ -34,13 +40,98 @@ extern void xoron_set_error(const char* fmt, ...);
 #include <android/keycodes.h>
 #endif
 
+#define INPUT_KEY_LIMIT 512             // keycodes at or above this are not tracked
+#define INPUT_RING_SIZE 1024            // power of two
+
+static const char* INPUT_HANDLERS_KEY = "xoron.input.handlers";
+
+typedef enum {
+    INPUT_KEY_DOWN = 0,
+    INPUT_KEY_UP,
+    INPUT_MOUSE_DOWN,
+    INPUT_MOUSE_UP,
+    INPUT_MOUSE_MOVE,
+    INPUT_SCROLL,
+    INPUT_TOUCH_BEGAN,
+    INPUT_TOUCH_MOVED,
+    INPUT_TOUCH_ENDED,
+    INPUT_EVENT_COUNT
+} input_event_type_t;
+
+// Signal names on the Input table, by event type
+static const char* const g_input_signals[INPUT_EVENT_COUNT] = {
+    "KeyDown", "KeyUp", "MouseButtonDown", "MouseButtonUp", "MouseMoved",
+    "MouseScroll", "TouchBegan", "TouchMoved", "TouchEnded"
+};
+
+struct InputEvent {
+    uint64_t time_us;
+    int type;
+    int code;           // keycode, mouse button or touch id
+    float x, y;         // position, or scroll delta in x
+};
+
+// Vyukov bounded queue; any thread pushes, the subscribed VM thread pops
+struct InputSlot {
+    std::atomic<uint32_t> seq;
+    InputEvent event;
+};
+
+struct InputRing {
+    InputSlot slots[INPUT_RING_SIZE];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;
+    
+    InputRing() {
+        for (uint32_t i = 0; i < INPUT_RING_SIZE; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    
+    bool push(const InputEvent& event) {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        InputSlot* slot;
+        for (;;) {
+            slot = &slots[pos & (INPUT_RING_SIZE - 1)];
+            int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->event = event;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(InputEvent* out) {
+        InputSlot* slot = &slots[tail & (INPUT_RING_SIZE - 1)];
+        if ((int32_t)(slot->seq.load(std::memory_order_acquire) - (tail + 1)) < 0) return false;
+        *out = slot->event;
+        slot->seq.store(tail + INPUT_RING_SIZE, std::memory_order_release);
+        tail++;
+        return true;
+    }
+};
+
 // Input state tracking
-static std::mutex g_input_mutex;
-static std::unordered_set<int> g_pressed_keys;
-static std::unordered_set<int> g_pressed_mouse;
-static float g_mouse_x = 0;
-static float g_mouse_y = 0;
-static float g_scroll_delta = 0;
+static std::atomic<uint64_t> g_key_bits[INPUT_KEY_LIMIT / 64];
+static std::atomic<uint32_t> g_mouse_bits{0};
+static std::atomic<uint64_t> g_mouse_pos{0};    // x and y floats packed together so reads are consistent
+static std::atomic<float> g_scroll_delta{0};
+
+static InputRing g_input_ring;
+static std::atomic<bool> g_input_subscribed{false};
+static std::atomic<bool> g_drain_posted{false};
+static std::atomic<bool> g_draining{false};
+static std::mutex g_subscriber_mutex;
+static XoronChannel* g_subscriber = nullptr;    // channel of the VM with Input signals, retained
+
+// Metrics
+static const int g_m_input_events = xoron_metric_counter("input.events");
+static const int g_m_input_dropped = xoron_metric_counter("input.dropped");
+static const int g_m_input_batches = xoron_metric_counter("input.batches");
 
 // Key code mapping (Roblox Enum.KeyCode values)
 static std::unordered_map<std::string, int> g_keycode_map = {
@@ -213,12 +304,258 @@ static int get_keycode(lua_State* L, int idx) {
     return 0;
 }
 
+
+// ==================== State and events ====================
+
+static uint64_t pack_pos(float x, float y) {
+    uint32_t xi, yi;
+    memcpy(&xi, &x, 4);
+    memcpy(&yi, &y, 4);
+    return ((uint64_t)yi << 32) | xi;
+}
+
+static void unpack_pos(uint64_t packed, float* x, float* y) {
+    uint32_t xi = (uint32_t)packed, yi = (uint32_t)(packed >> 32);
+    memcpy(x, &xi, 4);
+    memcpy(y, &yi, 4);
+}
+
+// Asks the subscribed VM to drain the ring, once per batch
+static void post_drain(void) {
+    if (g_drain_posted.exchange(true, std::memory_order_acq_rel)) return;
+    std::lock_guard<std::mutex> lock(g_subscriber_mutex);
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_USER;
+    msg.topic = "input.events";
+    if (!g_subscriber || xoron_channel_send(g_subscriber, &msg) != XORON_OK) {
+        g_drain_posted.store(false, std::memory_order_release);
+    }
+}
+
+// Timestamps an event and queues it for the VM with Input signals, if any
+static void emit_event(int type, int code, float x, float y) {
+    if (!g_input_subscribed.load(std::memory_order_acquire)) return;
+    InputEvent event = {xoron_metric_now_us(), type, code, x, y};
+    if (!g_input_ring.push(event)) {
+        xoron_metric_inc(g_m_input_dropped, 1);
+        return;
+    }
+    xoron_metric_inc(g_m_input_events, 1);
+    post_drain();
+}
+
+// Repeated reports of the same state (controller handlers send every button) raise no event
+static void input_key(int keycode, bool pressed) {
+    if (keycode >= 0 && keycode < INPUT_KEY_LIMIT) {
+        uint64_t mask = 1ull << (keycode & 63);
+        std::atomic<uint64_t>& word = g_key_bits[keycode >> 6];
+        uint64_t old = pressed ? word.fetch_or(mask) : word.fetch_and(~mask);
+        if (((old & mask) != 0) == pressed) return;
+    }
+    emit_event(pressed ? INPUT_KEY_DOWN : INPUT_KEY_UP, keycode, 0, 0);
+}
+
+static bool key_pressed(int keycode) {
+    if (keycode < 0 || keycode >= INPUT_KEY_LIMIT) return false;
+    return (g_key_bits[keycode >> 6].load(std::memory_order_relaxed) >> (keycode & 63)) & 1;
+}
+
+static void input_mouse(int button, bool pressed) {
+    float x, y;
+    unpack_pos(g_mouse_pos.load(std::memory_order_relaxed), &x, &y);
+    if (button >= 0 && button < 32) {
+        uint32_t mask = 1u << button;
+        uint32_t old = pressed ? g_mouse_bits.fetch_or(mask) : g_mouse_bits.fetch_and(~mask);
+        if (((old & mask) != 0) == pressed) return;
+    }
+    emit_event(pressed ? INPUT_MOUSE_DOWN : INPUT_MOUSE_UP, button, x, y);
+}
+
+static bool mouse_pressed(int button) {
+    if (button < 0 || button >= 32) return false;
+    return (g_mouse_bits.load(std::memory_order_relaxed) >> button) & 1;
+}
+
+static void input_mouse_move(float x, float y, bool relative) {
+    uint64_t old = g_mouse_pos.load(std::memory_order_relaxed);
+    float nx, ny;
+    do {
+        unpack_pos(old, &nx, &ny);
+        nx = relative ? nx + x : x;
+        ny = relative ? ny + y : y;
+    } while (!g_mouse_pos.compare_exchange_weak(old, pack_pos(nx, ny), std::memory_order_relaxed));
+    emit_event(INPUT_MOUSE_MOVE, 0, nx, ny);
+}
+
+static void input_scroll(float delta) {
+    g_scroll_delta.store(delta, std::memory_order_relaxed);
+    emit_event(INPUT_SCROLL, 0, delta, 0);
+}
+
+// Pushes the signal arguments of an event, returns their count
+static int push_event_args(lua_State* L, const InputEvent& event) {
+    double time = (double)event.time_us / 1e6;
+    switch (event.type) {
+        case INPUT_KEY_DOWN:
+        case INPUT_KEY_UP:
+            lua_pushinteger(L, event.code);
+            lua_pushnumber(L, time);
+            return 2;
+        case INPUT_MOUSE_DOWN:
+        case INPUT_MOUSE_UP:
+            lua_pushinteger(L, event.code);
+            lua_pushnumber(L, event.x);
+            lua_pushnumber(L, event.y);
+            lua_pushnumber(L, time);
+            return 4;
+        case INPUT_MOUSE_MOVE:
+            lua_pushnumber(L, event.x);
+            lua_pushnumber(L, event.y);
+            lua_pushnumber(L, time);
+            return 3;
+        case INPUT_SCROLL:
+            lua_pushnumber(L, event.x);
+            lua_pushnumber(L, time);
+            return 2;
+        default:
+            lua_pushnumber(L, event.x);
+            lua_pushnumber(L, event.y);
+            lua_pushinteger(L, event.code);
+            lua_pushnumber(L, time);
+            return 4;
+    }
+}
+
+// Channel handler on the subscribed VM: runs every queued event through its signal handlers
+static void on_input_events(lua_State* L, const xoron_message_t* msg) {
+    (void)msg;
+    g_drain_posted.store(false, std::memory_order_release);
+    // A handler pumping the channel could land here again; the outer drain finishes the batch
+    if (g_draining.exchange(true, std::memory_order_acquire)) return;
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, INPUT_HANDLERS_KEY);
+    int handlers = lua_gettop(L);
+    InputEvent event;
+    while (g_input_ring.pop(&event)) {
+        if (!lua_istable(L, handlers)) continue;
+        lua_rawgeti(L, handlers, event.type + 1);
+        int list = lua_gettop(L);
+        int n = lua_istable(L, list) ? lua_objlen(L, list) : 0;
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, list, i);
+            if (!lua_isfunction(L, -1)) {
+                lua_pop(L, 1);
+                continue;
+            }
+            int nargs = push_event_args(L, event);
+            if (lua_pcall(L, nargs, 0, 0) != 0) {
+                XORON_LOG("Input.%s handler failed: %s", g_input_signals[event.type], lua_tostring(L, -1));
+                lua_pop(L, 1);
+            }
+        }
+        lua_settop(L, handlers);
+    }
+    lua_settop(L, handlers - 1);
+    g_draining.store(false, std::memory_order_release);
+    xoron_metric_inc(g_m_input_batches, 1);
+}
+
+// Makes the VM of L the one that receives input events
+static void subscribe(lua_State* L) {
+    static std::once_flag once;
+    std::call_once(once, [] { xoron_channel_handle("input.events", on_input_events); });
+    
+    XoronChannel* ch = xoron_channel_of(L);
+    if (!ch) luaL_error(L, "No message channel for this VM");
+    std::lock_guard<std::mutex> lock(g_subscriber_mutex);
+    if (g_subscriber == ch) return;
+    xoron_channel_retain(ch);
+    xoron_channel_release(g_subscriber);
+    g_subscriber = ch;
+    g_input_subscribed.store(true, std::memory_order_release);
+}
+
+// Connection:Disconnect() - Stops calling the handler
+static int lua_connection_disconnect(lua_State* L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int type = lua_tointeger(L, lua_upvalueindex(1));
+    lua_getfield(L, LUA_REGISTRYINDEX, INPUT_HANDLERS_KEY);
+    if (lua_istable(L, -1)) {
+        lua_rawgeti(L, -1, type + 1);
+        int list = lua_gettop(L);
+        int n = lua_istable(L, list) ? lua_objlen(L, list) : 0;
+        // Left as a hole so a drain in progress doesn't skip the next handler
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, list, i);
+            bool match = lua_rawequal(L, -1, lua_upvalueindex(2));
+            lua_pop(L, 1);
+            if (match) {
+                lua_pushboolean(L, 0);
+                lua_rawseti(L, list, i);
+                break;
+            }
+        }
+    }
+    lua_pushboolean(L, 0);
+    lua_setfield(L, 1, "Connected");
+    return 0;
+}
+
+// Input.<Signal>:Connect(handler) - Calls handler for each event of this kind; returns a connection
+static int lua_signal_connect(lua_State* L) {
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    int type = lua_tointeger(L, lua_upvalueindex(1));
+    subscribe(L);
+    
+    lua_getfield(L, LUA_REGISTRYINDEX, INPUT_HANDLERS_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_createtable(L, INPUT_EVENT_COUNT, 0);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, INPUT_HANDLERS_KEY);
+    }
+    lua_rawgeti(L, -1, type + 1);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, type + 1);
+    }
+    
+    // Compact holes left by Disconnect, then append
+    int list = lua_gettop(L);
+    int n = lua_objlen(L, list);
+    int kept = 0;
+    for (int i = 1; i <= n; i++) {
+        lua_rawgeti(L, list, i);
+        if (lua_isfunction(L, -1)) {
+            lua_rawseti(L, list, ++kept);
+        } else {
+            lua_pop(L, 1);
+        }
+    }
+    for (int i = kept + 1; i <= n; i++) {
+        lua_pushnil(L);
+        lua_rawseti(L, list, i);
+    }
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, list, kept + 1);
+    
+    lua_createtable(L, 0, 2);
+    lua_pushboolean(L, 1);
+    lua_setfield(L, -2, "Connected");
+    lua_pushinteger(L, type);
+    lua_pushvalue(L, 2);
+    lua_pushcclosure(L, lua_connection_disconnect, "Disconnect", 2);
+    lua_setfield(L, -2, "Disconnect");
+    return 1;
+}
+
+// ==================== Lua bindings ====================
+
 // iskeypressed(keycode) - Check if a key is currently pressed
 static int lua_iskeypressed(lua_State* L) {
-    int keycode = get_keycode(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    lua_pushboolean(L, g_pressed_keys.count(keycode) > 0);
+    lua_pushboolean(L, key_pressed(get_keycode(L, 1)));
     return 1;
 }
 
@@ -231,50 +568,44 @@ static int lua_iskeydown(lua_State* L) {
 // Performs a press and release sequence for left mouse button
 static int lua_mouse1click(lua_State* L) {
     (void)L;
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    // Simulate click by briefly pressing and releasing
-    g_pressed_mouse.insert(1);
-    // In actual game integration, this would trigger the input event
-    // The release happens immediately for a click
-    g_pressed_mouse.erase(1);
+    input_mouse(1, true);
+    input_mouse(1, false);
     return 0;
 }
 
 // mouse1press() - Simulate left mouse press
 static int lua_mouse1press(lua_State* L) {
     (void)L;
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_mouse.insert(1);
+    input_mouse(1, true);
     return 0;
 }
 
 // mouse1release() - Simulate left mouse release
 static int lua_mouse1release(lua_State* L) {
     (void)L;
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_mouse.erase(1);
+    input_mouse(1, false);
     return 0;
 }
 
 // mouse2click() - Simulate right mouse click
 static int lua_mouse2click(lua_State* L) {
     (void)L;
+    input_mouse(2, true);
+    input_mouse(2, false);
     return 0;
 }
 
 // mouse2press() - Simulate right mouse press
 static int lua_mouse2press(lua_State* L) {
     (void)L;
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_mouse.insert(2);
+    input_mouse(2, true);
     return 0;
 }
 
 // mouse2release() - Simulate right mouse release
 static int lua_mouse2release(lua_State* L) {
     (void)L;
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_mouse.erase(2);
+    input_mouse(2, false);
     return 0;
 }
 
@@ -282,10 +613,7 @@ static int lua_mouse2release(lua_State* L) {
 static int lua_mousemoverel(lua_State* L) {
     float dx = (float)luaL_checknumber(L, 1);
     float dy = (float)luaL_checknumber(L, 2);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_mouse_x += dx;
-    g_mouse_y += dy;
+    input_mouse_move(dx, dy, true);
     return 0;
 }
 
@@ -293,30 +621,25 @@ static int lua_mousemoverel(lua_State* L) {
 static int lua_mousemoveabs(lua_State* L) {
     float x = (float)luaL_checknumber(L, 1);
     float y = (float)luaL_checknumber(L, 2);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_mouse_x = x;
-    g_mouse_y = y;
+    input_mouse_move(x, y, false);
     return 0;
 }
 
 // mousescroll(delta) - Scroll mouse wheel
 static int lua_mousescroll(lua_State* L) {
-    float delta = (float)luaL_checknumber(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_scroll_delta = delta;
+    input_scroll((float)luaL_checknumber(L, 1));
     return 0;
 }
 
 // getmouseposition() - Get current mouse position
 static int lua_getmouseposition(lua_State* L) {
-    std::lock_guard<std::mutex> lock(g_input_mutex);
+    float x, y;
+    unpack_pos(g_mouse_pos.load(std::memory_order_relaxed), &x, &y);
     
     lua_newtable(L);
-    lua_pushnumber(L, g_mouse_x);
+    lua_pushnumber(L, x);
     lua_setfield(L, -2, "X");
-    lua_pushnumber(L, g_mouse_y);
+    lua_pushnumber(L, y);
     lua_setfield(L, -2, "Y");
     
     return 1;
@@ -324,64 +647,52 @@ static int lua_getmouseposition(lua_State* L) {
 
 // keypress(keycode) - Simulate key press
 static int lua_keypress(lua_State* L) {
-    int keycode = get_keycode(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_keys.insert(keycode);
+    input_key(get_keycode(L, 1), true);
     return 0;
 }
 
 // keyrelease(keycode) - Simulate key release
 static int lua_keyrelease(lua_State* L) {
-    int keycode = get_keycode(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_keys.erase(keycode);
+    input_key(get_keycode(L, 1), false);
     return 0;
 }
 
 // keyclick(keycode) - Simulate key click (press + release)
 static int lua_keyclick(lua_State* L) {
     int keycode = get_keycode(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_pressed_keys.insert(keycode);
-    g_pressed_keys.erase(keycode);
+    input_key(keycode, true);
+    input_key(keycode, false);
     return 0;
 }
 
 // ismousebuttonpressed(button) - Check if mouse button is pressed
 static int lua_ismousebuttonpressed(lua_State* L) {
-    int button = luaL_checkinteger(L, 1);
-    
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    lua_pushboolean(L, g_pressed_mouse.count(button) > 0);
+    lua_pushboolean(L, mouse_pressed(luaL_checkinteger(L, 1)));
     return 1;
 }
 
-// Internal: Update input state (called from game integration)
+// ==================== Host API ====================
+
 extern "C" void xoron_input_set_key(int keycode, bool pressed) {
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    if (pressed) {
-        g_pressed_keys.insert(keycode);
-    } else {
-        g_pressed_keys.erase(keycode);
-    }
+    input_key(keycode, pressed);
 }
 
 extern "C" void xoron_input_set_mouse(int button, bool pressed) {
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    if (pressed) {
-        g_pressed_mouse.insert(button);
-    } else {
-        g_pressed_mouse.erase(button);
-    }
+    input_mouse(button, pressed);
 }
 
 extern "C" void xoron_input_set_mouse_pos(float x, float y) {
-    std::lock_guard<std::mutex> lock(g_input_mutex);
-    g_mouse_x = x;
-    g_mouse_y = y;
+    input_mouse_move(x, y, false);
+}
+
+extern "C" void xoron_input_scroll(float delta) {
+    input_scroll(delta);
+}
+
+extern "C" void xoron_input_touch(int id, int phase, float x, float y) {
+    g_mouse_pos.store(pack_pos(x, y), std::memory_order_relaxed);
+    int type = phase == 0 ? INPUT_TOUCH_BEGAN : phase == 1 ? INPUT_TOUCH_MOVED : INPUT_TOUCH_ENDED;
+    emit_event(type, id, x, y);
 }
 
 // Platform-specific input simulation
@@ -391,13 +702,8 @@ extern "C" void xoron_input_set_mouse_pos(float x, float y) {
 static void simulate_iOS_touch(float x, float y, bool press) {
     // This would be implemented when injected into a game
     // For now, we just track the state
-    if (press) {
-        g_pressed_mouse.insert(1); // Left mouse button
-    } else {
-        g_pressed_mouse.erase(1);
-    }
-    g_mouse_x = x;
-    g_mouse_y = y;
+    input_mouse_move(x, y, false);
+    input_mouse(1, press); // Left mouse button
 }
 
 // iOS game controller support
@@ -443,13 +749,8 @@ static void setup_iOS_game_controller() {
 static void simulate_android_touch(float x, float y, bool press) {
     // This would be implemented when injected into a game
     // For now, we just track the state
-    if (press) {
-        g_pressed_mouse.insert(1); // Left mouse button
-    } else {
-        g_pressed_mouse.erase(1);
-    }
-    g_mouse_x = x;
-    g_mouse_y = y;
+    input_mouse_move(x, y, false);
+    input_mouse(1, press); // Left mouse button
 }
 
 // Android game controller support
@@ -461,7 +762,7 @@ static void setup_android_game_controller() {
 #endif
 
 // Initialize platform-specific input
-static void init_platform_input() {
+void xoron_init_input(void) {
 #if defined(XORON_PLATFORM_IOS)
     setup_iOS_game_controller();
 #elif defined(XORON_PLATFORM_ANDROID)
@@ -471,9 +772,6 @@ static void init_platform_input() {
 
 // Register input library
 void xoron_register_input(lua_State* L) {
-    // Initialize platform-specific input
-    init_platform_input();
-    
     // Key functions
     lua_pushcfunction(L, lua_iskeypressed, "iskeypressed");
     lua_setglobal(L, "iskeypressed");
@@ -536,6 +834,15 @@ void xoron_register_input(lua_State* L) {
     lua_pushcfunction(L, lua_getmouseposition, "GetMouseLocation");
     lua_setfield(L, -2, "GetMouseLocation");
     
+    // Event signals: Input.KeyDown:Connect(fn) and so on
+    for (int type = 0; type < INPUT_EVENT_COUNT; type++) {
+        lua_createtable(L, 0, 1);
+        lua_pushinteger(L, type);
+        lua_pushcclosure(L, lua_signal_connect, "Connect", 1);
+        lua_setfield(L, -2, "Connect");
+        lua_setfield(L, -2, g_input_signals[type]);
+    }
+    
     lua_setglobal(L, "Input");
     
     // Platform-specific input functions
@@ -549,7 +856,7 @@ void xoron_register_input(lua_State* L) {
         return 0;
     }, "simulateTouch");
     lua_setglobal(L, "simulateTouch");
-    
+
 #elif defined(XORON_PLATFORM_ANDROID)
     // Android-specific touch simulation
     lua_pushcfunction(L, [](lua_State* L) -> int {
@@ -16,6 +16,13 @@
 #include "xoron.h"
 #include "lua.h"
 #include "lualib.h"
+#include <mutex>
+#include <atomic>
+
+extern void xoron_set_error(const char* fmt, ...);
+
+// The UI runs on the main thread and never touches the lua_State; see xoron_ios_post_script
+static int xoron_ios_post_script(const char* source);
 
 // ============================================================================
 // Theme Colors - Purple & Black
@@ -455,25 +462,9 @@ typedef NS_ENUM(NSInteger, XoronMessageType) {
     
     [self addConsoleMessage:@"Executing script..." type:XoronMessageTypeInfo];
     
-    // Call the Lua execution function
-    lua_State* L = xoron_get_lua_state();
-    if (L) {
-        lua_getglobal(L, "xoron_execute");
-        if (lua_isfunction(L, -1)) {
-            lua_pushstring(L, [code UTF8String]);
-            if (lua_pcall(L, 1, 0, 0) == 0) {
-                [self addConsoleMessage:@"Script executed successfully" type:XoronMessageTypeSuccess];
-            } else {
-                NSString *error = [NSString stringWithUTF8String:lua_tostring(L, -1)];
-                [self addConsoleMessage:[NSString stringWithFormat:@"Error: %@", error] type:XoronMessageTypeError];
-                lua_pop(L, 1);
-            }
-        } else {
-            lua_pop(L, 1);
-            [self addConsoleMessage:@"Execution function not available" type:XoronMessageTypeError];
-        }
-    } else {
-        [self addConsoleMessage:@"Lua state not initialized" type:XoronMessageTypeError];
+    // Queue the script for the VM thread; the result arrives as a channel reply
+    if (xoron_ios_post_script([code UTF8String]) != XORON_OK) {
+        [self addConsoleMessage:[NSString stringWithFormat:@"Error: %s", xoron_last_error()] type:XoronMessageTypeError];
     }
 }
 
@@ -635,16 +626,46 @@ typedef NS_ENUM(NSInteger, XoronMessageType) {
 static XoronToggleButton *g_toggleButton = nil;
 static XoronExecutorViewController *g_executorVC = nil;
 static UIWindow *g_overlayWindow = nil;
-static lua_State *g_lua_state = nil;
+static XoronChannel *g_channel = nullptr;
+static std::mutex g_channel_mutex;
+static std::atomic<int64_t> g_next_script_id{1};
+
+// Replies and channel.post events, drained on the main thread
+static void ios_handle_reply(const xoron_message_t* msg, void* ud) {
+    (void)ud;
+    if (!g_executorVC) return;
+    NSString *data = [[NSString alloc] initWithBytes:msg->data length:msg->data_len encoding:NSUTF8StringEncoding] ?: @"";
+    if (msg->type == XORON_MSG_REPLY) {
+        if (msg->arg == XORON_OK) {
+            [g_executorVC addConsoleMessage:@"Script executed successfully" type:XoronMessageTypeSuccess];
+        } else {
+            [g_executorVC addConsoleMessage:[NSString stringWithFormat:@"Error: %@", data] type:XoronMessageTypeError];
+        }
+    } else {
+        [g_executorVC addConsoleMessage:[NSString stringWithFormat:@"[%s] %@", msg->topic, data] type:XoronMessageTypeInfo];
+    }
+}
 
-// Get Lua state
-extern "C" lua_State* xoron_get_lua_state(void) {
-    return g_lua_state;
+// Called on the VM thread whenever it replies
+static void ios_reply_notify(void* ud) {
+    (void)ud;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        std::lock_guard<std::mutex> lock(g_channel_mutex);
+        xoron_channel_drain_replies(g_channel, ios_handle_reply, nullptr, 0);
+    });
 }
 
-// Set Lua state
-extern "C" void xoron_ios_set_lua_state(lua_State* L) {
-    g_lua_state = L;
+static int xoron_ios_post_script(const char* source) {
+    std::lock_guard<std::mutex> lock(g_channel_mutex);
+    if (!g_channel) {
+        xoron_set_error("Lua state not initialized");
+        return XORON_ERR_INIT;
+    }
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_SCRIPT;
+    msg.id = g_next_script_id.fetch_add(1);
+    msg.data = source;
+    return xoron_channel_send(g_channel, &msg);
 }
 
 // Initialize the iOS UI
@@ -774,7 +795,16 @@ extern "C" void xoron_ios_console_print(const char* message, int type) {
 
 // Register iOS-specific Lua functions
 void xoron_register_ios(lua_State* L) {
-    g_lua_state = L;
+    // The first VM is the default one created at load; actor and worker VMs keep their own channels
+    XoronChannel* ch = xoron_channel_of(L);
+    {
+        std::lock_guard<std::mutex> lock(g_channel_mutex);
+        if (!g_channel) {
+            xoron_channel_retain(ch);
+            g_channel = ch;
+            xoron_channel_listen(ch, nullptr, ios_reply_notify, nullptr);
+        }
+    }
     
     // Initialize UI on main thread
     xoron_ios_ui_init();
@@ -0,0 +1,952 @@
+/*
+ * xoron_json.cpp - Native JSON encode/decode
+ * Provides: json.encode, json.decode, json.null, xoron_json_* API
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Decoding is two-pass. A SIMD scan (NEON on arm64, SSE2 on x86, scalar
+ * elsewhere) indexes every structural character and scalar start outside
+ * strings and counts the elements of each container; the parser then walks
+ * that index and builds tables pre-sized with lua_createtable.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define XORON_JSON_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define XORON_JSON_SSE2 1
+#endif
+
+#include "lua.h"
+#include "lualib.h"
+
+extern void xoron_set_error(const char* fmt, ...);
+
+#define JSON_MAX_DEPTH 512
+#define JSON_KEY_CACHE 256
+
+// Metrics
+static const int g_m_json_decodes = xoron_metric_counter("json.decodes");
+static const int g_m_json_decode_bytes = xoron_metric_counter("json.decode_bytes");
+static const int g_m_json_encodes = xoron_metric_counter("json.encodes");
+static const int g_m_json_encode_bytes = xoron_metric_counter("json.encode_bytes");
+
+// ==================== SIMD scanning ====================
+
+// One bit per byte of a 16-byte block
+struct BlockMasks {
+    uint32_t quote;
+    uint32_t backslash;
+    uint32_t space;
+    uint32_t op;        // [ ] { } : ,
+};
+
+#if XORON_JSON_NEON
+static inline uint32_t movemask(uint8x16_t v) {
+    static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t m = vandq_u8(v, vld1q_u8(kBits));
+    return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+}
+
+static inline void classify_block(const uint8_t* p, BlockMasks& m) {
+    uint8x16_t v = vld1q_u8(p);
+    // Clearing bit 5 folds '{' '}' onto '[' ']'
+    uint8x16_t folded = vandq_u8(v, vdupq_n_u8(0xDF));
+    m.quote = movemask(vceqq_u8(v, vdupq_n_u8('"')));
+    m.backslash = movemask(vceqq_u8(v, vdupq_n_u8('\\')));
+    m.space = movemask(vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t'))),
+                                vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r')))));
+    m.op = movemask(vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('[')), vceqq_u8(folded, vdupq_n_u8(']'))),
+                             vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(',')))));
+}
+
+// Mask of bytes that end a plain string run: '"', '\\' or a control character
+static inline uint32_t string_stops(const uint8_t* p) {
+    uint8x16_t v = vld1q_u8(p);
+    return movemask(vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))),
+                             vcltq_u8(v, vdupq_n_u8(0x20))));
+}
+#elif XORON_JSON_SSE2
+static inline void classify_block(const uint8_t* p, BlockMasks& m) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i folded = _mm_and_si128(v, _mm_set1_epi8((char)0xDF));
+    m.quote = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    m.backslash = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    m.space = (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+    m.op = (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('[')), _mm_cmpeq_epi8(folded, _mm_set1_epi8(']'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))));
+}
+
+static inline uint32_t string_stops(const uint8_t* p) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))), control));
+}
+#else
+static inline void classify_block(const uint8_t* p, BlockMasks& m) {
+    m.quote = m.backslash = m.space = m.op = 0;
+    for (int i = 0; i < 16; i++) {
+        uint32_t bit = 1u << i;
+        switch (p[i]) {
+            case '"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case ' ': case '\t': case '\n': case '\r': m.space |= bit; break;
+            case '[': case ']': case '{': case '}': case ':': case ',': m.op |= bit; break;
+            default: break;
+        }
+    }
+}
+
+static inline uint32_t string_stops(const uint8_t* p) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; i++) {
+        if (p[i] == '"' || p[i] == '\\' || p[i] < 0x20) mask |= 1u << i;
+    }
+    return mask;
+}
+#endif
+
+// First '"', '\\' or control character in [p, end), or end
+static inline const char* scan_string(const char* p, const char* end) {
+    while (end - p >= 16) {
+        uint32_t mask = string_stops((const uint8_t*)p);
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) p++;
+    return p;
+}
+
+// Bit i set when an odd number of quotes precede or sit at byte i
+static inline uint32_t prefix_xor(uint32_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    return x & 0xFFFF;
+}
+
+static inline bool is_delimiter(char c) {
+    return c == ',' || c == ']' || c == '}' || c == ':' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// ==================== Stage 1: structural index ====================
+
+struct JsonIndex {
+    std::vector<uint32_t> pos;      // structural characters, opening quotes and scalar starts
+    std::vector<uint32_t> counts;   // element count per container, in document order
+};
+
+static bool json_index(const char* text, size_t len, JsonIndex& index, std::string& error) {
+    index.pos.clear();
+    index.counts.clear();
+    if (len >= 0xFFFFFFF0u) {
+        error = "Input too large";
+        return false;
+    }
+    
+    struct Open { uint32_t slot; uint32_t commas; bool empty; };
+    std::vector<Open> stack;
+    bool escape_next = false;
+    uint32_t in_string = 0;         // 0xFFFF while a string spans the block boundary
+    uint32_t prev_separator = 1;    // start of input acts as a separator
+    uint32_t prev_close = 0;
+    uint8_t tail[16];
+    
+    for (size_t base = 0; base < len; base += 16) {
+        const uint8_t* p = (const uint8_t*)text + base;
+        if (len - base < 16) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, len - base);
+            p = tail;
+        }
+        BlockMasks m;
+        classify_block(p, m);
+        
+        // Bytes escaped by a backslash; backslash runs are rare, walk them
+        uint32_t escaped = 0;
+        uint32_t bs = m.backslash;
+        if (escape_next) {
+            escaped = 1;
+            bs &= ~1u;
+        }
+        escape_next = false;
+        while (bs) {
+            int i = __builtin_ctz(bs);
+            bs &= bs - 1;
+            if (i == 15) {
+                escape_next = true;
+                break;
+            }
+            escaped |= 1u << (i + 1);
+            bs &= ~(1u << (i + 1));
+        }
+        
+        uint32_t quote = m.quote & ~escaped;
+        uint32_t str = prefix_xor(quote) ^ in_string;   // opening quote and string body
+        in_string = (str & 0x8000) ? 0xFFFF : 0;
+        uint32_t op = m.op & ~str;
+        uint32_t separator = op | (m.space & ~str);
+        uint32_t scalar = ((separator << 1) | prev_separator) & ~(m.space | m.op | m.quote | str) & 0xFFFF;
+        prev_separator = separator >> 15;
+        
+        // A closing quote must be followed by whitespace, an operator or another quote
+        uint32_t close = quote & ~str;
+        uint32_t bad = ((close << 1) | prev_close) & ~(m.space | m.op | m.quote) & 0xFFFF;
+        prev_close = close >> 15;
+        if (bad) {
+            error = "Unexpected character after string at byte " + std::to_string(base + __builtin_ctz(bad));
+            return false;
+        }
+        
+        uint32_t bits = op | (quote & str) | scalar;
+        while (bits) {
+            uint32_t offset = (uint32_t)base + __builtin_ctz(bits);
+            bits &= bits - 1;
+            index.pos.push_back(offset);
+            switch (text[offset]) {
+                case '[':
+                case '{':
+                    if (!stack.empty()) stack.back().empty = false;
+                    if (stack.size() >= JSON_MAX_DEPTH) {
+                        error = "Nesting too deep at byte " + std::to_string(offset);
+                        return false;
+                    }
+                    stack.push_back({(uint32_t)index.counts.size(), 0, true});
+                    index.counts.push_back(0);
+                    break;
+                case ']':
+                case '}':
+                    if (!stack.empty()) {
+                        const Open& open = stack.back();
+                        index.counts[open.slot] = open.empty ? 0 : open.commas + 1;
+                        stack.pop_back();
+                    }
+                    break;
+                case ',':
+                    if (!stack.empty()) stack.back().commas++;
+                    break;
+                case ':':
+                    break;
+                default:
+                    if (!stack.empty()) stack.back().empty = false;
+                    break;
+            }
+        }
+    }
+    
+    if (in_string) {
+        error = "Unterminated string";
+        return false;
+    }
+    return true;
+}
+
+// ==================== Stage 2: parser ====================
+
+struct KeySlot {
+    const char* p;
+    uint32_t len;
+};
+
+// Walks the index; with kBuild it pushes the decoded value onto L
+template <bool kBuild>
+class JsonParser {
+public:
+    JsonParser(lua_State* L, const char* text, size_t len, const JsonIndex& index)
+        : L_(L), text_(text), len_(len), pos_(index.pos.data()), n_(index.pos.size()),
+          counts_(index.counts.data()) {}
+    
+    bool parse(std::string& error) {
+        bool ok;
+        if (kBuild) {
+            lua_createtable(L_, JSON_KEY_CACHE, 0);
+            key_table_ = lua_gettop(L_);
+            memset(keys_, 0, sizeof(keys_));
+        }
+        if (n_ == 0) {
+            ok = fail(len_, "Empty input");
+        } else {
+            ok = value();
+            if (ok && i_ != n_) ok = fail(pos_[i_], "Unexpected trailing characters");
+        }
+        if (kBuild) {
+            if (ok) lua_remove(L_, key_table_);
+            else lua_settop(L_, key_table_ - 1);
+        }
+        if (!ok) error = error_;
+        return ok;
+    }
+
+private:
+    bool fail(size_t offset, const char* msg) {
+        error_ = std::string(msg) + " at byte " + std::to_string(offset);
+        return false;
+    }
+    
+    size_t current() const { return i_ < n_ ? pos_[i_] : len_; }
+    bool peek(char c) const { return i_ < n_ && text_[pos_[i_]] == c; }
+    
+    bool value() {
+        if (i_ >= n_) return fail(len_, "Unexpected end of input");
+        uint32_t at = pos_[i_];
+        switch (text_[at]) {
+            case '{': return object();
+            case '[': return array();
+            case '"': i_++; return string(at + 1, false);
+            case 't': return literal(at, "true", 4);
+            case 'f': return literal(at, "false", 5);
+            case 'n': return literal(at, "null", 4);
+            case ']': case '}': case ',': case ':': return fail(at, "Unexpected operator");
+            default: return number(at);
+        }
+    }
+    
+    bool object() {
+        uint32_t count = counts_[container_++];
+        if (kBuild) {
+            if (!lua_checkstack(L_, 4)) return fail(current(), "Nesting too deep");
+            lua_createtable(L_, 0, (int)count);
+        }
+        i_++;
+        if (peek('}')) { i_++; return true; }
+        for (;;) {
+            if (!peek('"')) return fail(current(), "Expected string key");
+            uint32_t at = pos_[i_++];
+            if (!string(at + 1, true)) return false;
+            if (!peek(':')) return fail(current(), "Expected ':'");
+            i_++;
+            if (!value()) return false;
+            if (kBuild) lua_rawset(L_, -3);
+            if (peek(',')) { i_++; continue; }
+            if (peek('}')) { i_++; return true; }
+            return fail(current(), "Expected ',' or '}'");
+        }
+    }
+    
+    bool array() {
+        uint32_t count = counts_[container_++];
+        if (kBuild) {
+            if (!lua_checkstack(L_, 3)) return fail(current(), "Nesting too deep");
+            lua_createtable(L_, (int)count, 0);
+        }
+        i_++;
+        if (peek(']')) { i_++; return true; }
+        for (int n = 1;; n++) {
+            if (!value()) return false;
+            if (kBuild) lua_rawseti(L_, -2, n);
+            if (peek(',')) { i_++; continue; }
+            if (peek(']')) { i_++; return true; }
+            return fail(current(), "Expected ',' or ']'");
+        }
+    }
+    
+    // Repeated keys are fetched from a per-decode table instead of being re-interned
+    void push_key(const char* s, size_t len) {
+        uint32_t h = (uint32_t)len * 0x9E3779B1u;
+        if (len) h ^= (uint8_t)s[0] * 0x85EBCA6Bu ^ (uint8_t)s[len / 2] * 0xC2B2AE35u ^ (uint8_t)s[len - 1];
+        h = (h ^ (h >> 16)) & (JSON_KEY_CACHE - 1);
+        KeySlot& slot = keys_[h];
+        if (slot.p && slot.len == len && memcmp(slot.p, s, len) == 0) {
+            lua_rawgeti(L_, key_table_, (int)h + 1);
+            return;
+        }
+        lua_pushlstring(L_, s, len);
+        lua_pushvalue(L_, -1);
+        lua_rawseti(L_, key_table_, (int)h + 1);
+        slot.p = s;
+        slot.len = (uint32_t)len;
+    }
+    
+    static int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+    
+    bool read_hex4(const char* p, uint32_t& out) {
+        if (text_ + len_ - p < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            int d = hex(p[i]);
+            if (d < 0) return false;
+            out = (out << 4) | (uint32_t)d;
+        }
+        return true;
+    }
+    
+    void append_utf8(uint32_t cp) {
+        if (cp < 0x80) {
+            scratch_ += (char)cp;
+        } else if (cp < 0x800) {
+            scratch_ += (char)(0xC0 | (cp >> 6));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            scratch_ += (char)(0xE0 | (cp >> 12));
+            scratch_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        } else {
+            scratch_ += (char)(0xF0 | (cp >> 18));
+            scratch_ += (char)(0x80 | ((cp >> 12) & 0x3F));
+            scratch_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+    
+    bool string(uint32_t start, bool key) {
+        const char* s = text_ + start;
+        const char* end = text_ + len_;
+        const char* p = scan_string(s, end);
+        
+        // Fast path: no escapes, push straight from the input
+        if (p < end && *p == '"') {
+            if (kBuild) {
+                if (key) push_key(s, p - s);
+                else lua_pushlstring(L_, s, p - s);
+            }
+            return true;
+        }
+        
+        scratch_.assign(s, p - s);
+        while (p < end) {
+            unsigned char c = (unsigned char)*p;
+            if (c == '"') {
+                if (kBuild) lua_pushlstring(L_, scratch_.data(), scratch_.size());
+                return true;
+            }
+            if (c < 0x20) return fail(p - text_, "Control character in string");
+            if (c != '\\') {
+                const char* run = scan_string(p, end);
+                scratch_.append(p, run - p);
+                p = run;
+                continue;
+            }
+            if (++p >= end) break;
+            switch (*p) {
+                case '"': scratch_ += '"'; break;
+                case '\\': scratch_ += '\\'; break;
+                case '/': scratch_ += '/'; break;
+                case 'b': scratch_ += '\b'; break;
+                case 'f': scratch_ += '\f'; break;
+                case 'n': scratch_ += '\n'; break;
+                case 'r': scratch_ += '\r'; break;
+                case 't': scratch_ += '\t'; break;
+                case 'u': {
+                    uint32_t cp;
+                    if (!read_hex4(p + 1, cp)) return fail(p - text_, "Invalid \\u escape");
+                    p += 4;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        uint32_t low;
+                        if (end - p >= 7 && p[1] == '\\' && p[2] == 'u' && read_hex4(p + 3, low) &&
+                            low >= 0xDC00 && low <= 0xDFFF) {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            p += 6;
+                        } else {
+                            cp = 0xFFFD;
+                        }
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        cp = 0xFFFD;
+                    }
+                    append_utf8(cp);
+                    break;
+                }
+                default:
+                    return fail(p - text_, "Invalid escape");
+            }
+            p++;
+        }
+        return fail(len_, "Unterminated string");
+    }
+    
+    bool literal(uint32_t at, const char* word, size_t n) {
+        if (len_ - at < n || memcmp(text_ + at, word, n) != 0 ||
+            (at + n < len_ && !is_delimiter(text_[at + n]))) {
+            return fail(at, "Invalid literal");
+        }
+        i_++;
+        if (kBuild) {
+            if (word[0] == 'n') lua_pushlightuserdata(L_, nullptr);
+            else lua_pushboolean(L_, word[0] == 't');
+        }
+        return true;
+    }
+    
+    bool number(uint32_t at) {
+        const char* start = text_ + at;
+        const char* end = text_ + len_;
+        const char* p = start;
+        bool negative = false;
+        if (*p == '-') {
+            negative = true;
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') return fail(at, "Unexpected character");
+        
+        uint64_t mantissa = 0;
+        int digits = 0;
+        if (*p == '0') {
+            p++;
+        } else {
+            while (p < end && *p >= '0' && *p <= '9') {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits++;
+                p++;
+            }
+        }
+        bool integral = true;
+        if (p < end && *p == '.') {
+            integral = false;
+            if (++p >= end || *p < '0' || *p > '9') return fail(p - text_, "Invalid number");
+            while (p < end && *p >= '0' && *p <= '9') p++;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            integral = false;
+            if (++p < end && (*p == '+' || *p == '-')) p++;
+            if (p >= end || *p < '0' || *p > '9') return fail(p - text_, "Invalid number");
+            while (p < end && *p >= '0' && *p <= '9') p++;
+        }
+        if (p < end && !is_delimiter(*p)) return fail(p - text_, "Invalid number");
+        i_++;
+        if (!kBuild) return true;
+        
+        // Up to 15 digits are exact in a double; everything else goes through strtod
+        if (integral && digits <= 15) {
+            double d = (double)mantissa;
+            lua_pushnumber(L_, negative ? -d : d);
+        } else {
+            char buf[64];
+            size_t n = p - start;
+            std::string big;
+            const char* token = buf;
+            if (n < sizeof(buf)) {
+                memcpy(buf, start, n);
+                buf[n] = '\0';
+            } else {
+                big.assign(start, n);
+                token = big.c_str();
+            }
+            lua_pushnumber(L_, strtod(token, nullptr));
+        }
+        return true;
+    }
+    
+    lua_State* L_;
+    const char* text_;
+    size_t len_;
+    const uint32_t* pos_;
+    size_t n_;
+    const uint32_t* counts_;
+    size_t i_ = 0;
+    size_t container_ = 0;
+    int key_table_ = 0;
+    KeySlot keys_[JSON_KEY_CACHE];
+    std::string scratch_;
+    std::string error_;
+};
+
+// Reused across decodes on the same thread; a nested decode gets its own
+static thread_local JsonIndex t_index;
+static thread_local bool t_index_busy = false;
+
+static bool json_decode(lua_State* L, const char* text, size_t len, std::string& error) {
+    JsonIndex local;
+    bool shared = !t_index_busy;
+    JsonIndex& index = shared ? t_index : local;
+    t_index_busy = true;
+    
+    bool ok = json_index(text, len, index, error) &&
+              JsonParser<true>(L, text, len, index).parse(error);
+    
+    if (shared) t_index_busy = false;
+    xoron_metric_inc(g_m_json_decodes, 1);
+    xoron_metric_inc(g_m_json_decode_bytes, len);
+    return ok;
+}
+
+static bool json_validate(const char* text, size_t len, JsonIndex& index, std::string& error) {
+    return json_index(text, len, index, error) &&
+           JsonParser<false>(nullptr, text, len, index).parse(error);
+}
+
+// ==================== Encoder ====================
+
+// Growable output buffer; appends are no-ops once an allocation fails
+class JsonBuffer {
+public:
+    ~JsonBuffer() { free(data_); }
+    
+    bool reserve(size_t extra) {
+        if (size_ + extra <= cap_) return true;
+        if (oom_) return false;
+        size_t cap = cap_ ? cap_ : 256;
+        while (cap < size_ + extra + 1) cap *= 2;
+        char* data = (char*)realloc(data_, cap);
+        if (!data) {
+            oom_ = true;
+            return false;
+        }
+        data_ = data;
+        cap_ = cap;
+        return true;
+    }
+    
+    void append(const char* s, size_t n) {
+        if (!reserve(n)) return;
+        memcpy(data_ + size_, s, n);
+        size_ += n;
+    }
+    
+    void put(char c) {
+        if (!reserve(1)) return;
+        data_[size_++] = c;
+    }
+    
+    // Hands the NUL-terminated buffer to the caller (free with xoron_free)
+    char* release(size_t* len) {
+        if (!reserve(1)) return nullptr;
+        data_[size_] = '\0';
+        if (len) *len = size_;
+        char* out = data_;
+        data_ = nullptr;
+        size_ = cap_ = 0;
+        return out;
+    }
+    
+    const char* data() const { return data_ ? data_ : ""; }
+    size_t size() const { return size_; }
+    bool failed() const { return oom_; }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t cap_ = 0;
+    bool oom_ = false;
+};
+
+class JsonEncoder {
+public:
+    explicit JsonEncoder(lua_State* L) : L_(L) {}
+    
+    bool encode(int idx) {
+        bool ok = value(lua_absindex(L_, idx), 0);
+        if (ok && out.failed()) {
+            error = "Out of memory";
+            ok = false;
+        }
+        return ok;
+    }
+    
+    JsonBuffer out;
+    std::string error;
+
+private:
+    bool value(int idx, int depth) {
+        switch (lua_type(L_, idx)) {
+            case LUA_TNIL:
+                out.append("null", 4);
+                return true;
+            case LUA_TBOOLEAN:
+                if (lua_toboolean(L_, idx)) out.append("true", 4);
+                else out.append("false", 5);
+                return true;
+            case LUA_TNUMBER:
+                return number(lua_tonumber(L_, idx));
+            case LUA_TSTRING: {
+                size_t len;
+                const char* s = lua_tolstring(L_, idx, &len);
+                string(s, len);
+                return true;
+            }
+            case LUA_TTABLE:
+                return table(idx, depth);
+            case LUA_TLIGHTUSERDATA:
+                if (lua_touserdata(L_, idx) == nullptr) {
+                    out.append("null", 4);
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+        error = std::string("Cannot encode ") + luaL_typename(L_, idx);
+        return false;
+    }
+    
+    bool number(double d) {
+        if (!std::isfinite(d)) {
+            error = "Cannot encode NaN or infinity";
+            return false;
+        }
+        char buf[32];
+        if (d == std::floor(d) && std::fabs(d) < 1e15) {
+            // Integers are by far the common case; skip printf
+            long long v = (long long)d;
+            char* p = buf + sizeof(buf);
+            unsigned long long u = v < 0 ? 0ull - (unsigned long long)v : (unsigned long long)v;
+            do {
+                *--p = (char)('0' + u % 10);
+                u /= 10;
+            } while (u);
+            if (v < 0) *--p = '-';
+            out.append(p, buf + sizeof(buf) - p);
+            return true;
+        }
+        // Shortest of %.15g / %.17g that round-trips
+        int n = snprintf(buf, sizeof(buf), "%.15g", d);
+        if (strtod(buf, nullptr) != d) n = snprintf(buf, sizeof(buf), "%.17g", d);
+        out.append(buf, (size_t)n);
+        return true;
+    }
+    
+    void string(const char* s, size_t len) {
+        static const char kHex[] = "0123456789abcdef";
+        const char* end = s + len;
+        out.reserve(len + 2);
+        out.put('"');
+        while (s < end) {
+            const char* run = scan_string(s, end);
+            out.append(s, run - s);
+            if (run == end) break;
+            unsigned char c = (unsigned char)*run;
+            switch (c) {
+                case '"': out.append("\\\"", 2); break;
+                case '\\': out.append("\\\\", 2); break;
+                case '\n': out.append("\\n", 2); break;
+                case '\r': out.append("\\r", 2); break;
+                case '\t': out.append("\\t", 2); break;
+                case '\b': out.append("\\b", 2); break;
+                case '\f': out.append("\\f", 2); break;
+                default: {
+                    char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+                    out.append(esc, 6);
+                    break;
+                }
+            }
+            s = run + 1;
+        }
+        out.put('"');
+    }
+    
+    bool key(int idx) {
+        if (lua_type(L_, idx) == LUA_TSTRING) {
+            size_t len;
+            const char* s = lua_tolstring(L_, idx, &len);
+            string(s, len);
+            return true;
+        }
+        if (lua_type(L_, idx) == LUA_TNUMBER) {
+            // Converting the key in place would break lua_next
+            out.put('"');
+            bool ok = number(lua_tonumber(L_, idx));
+            out.put('"');
+            return ok;
+        }
+        error = std::string("Cannot encode ") + luaL_typename(L_, idx) + " key";
+        return false;
+    }
+    
+    bool table(int idx, int depth) {
+        if (depth >= JSON_MAX_DEPTH) {
+            error = "Nesting too deep (cyclic table?)";
+            return false;
+        }
+        if (!lua_checkstack(L_, 3)) {
+            error = "Stack overflow";
+            return false;
+        }
+        
+        // An array is a table whose keys all lie in 1..#t (holes encode as null)
+        int n = lua_objlen(L_, idx);
+        bool array = true;
+        lua_pushnil(L_);
+        while (lua_next(L_, idx)) {
+            lua_pop(L_, 1);
+            if (array) {
+                double k = lua_type(L_, -1) == LUA_TNUMBER ? lua_tonumber(L_, -1) : 0.0;
+                array = k >= 1 && k <= n && k == std::floor(k);
+            }
+        }
+        
+        if (array) {
+            out.put('[');
+            for (int i = 1; i <= n; i++) {
+                if (i > 1) out.put(',');
+                lua_rawgeti(L_, idx, i);
+                bool ok = value(lua_gettop(L_), depth + 1);
+                lua_pop(L_, 1);
+                if (!ok) return false;
+            }
+            out.put(']');
+            return true;
+        }
+        
+        out.put('{');
+        bool first = true;
+        lua_pushnil(L_);
+        while (lua_next(L_, idx)) {
+            if (!first) out.put(',');
+            first = false;
+            int top = lua_gettop(L_);
+            if (!key(top - 1)) {
+                lua_pop(L_, 2);
+                return false;
+            }
+            out.put(':');
+            if (!value(top, depth + 1)) {
+                lua_pop(L_, 2);
+                return false;
+            }
+            lua_pop(L_, 1);
+        }
+        out.put('}');
+        return true;
+    }
+    
+    lua_State* L_;
+};
+
+// ==================== Lua bindings ====================
+
+// json.encode(value) - Encodes a value as compact JSON; json.null encodes as null
+static int lua_json_encode(lua_State* L) {
+    luaL_checkany(L, 1);
+    JsonEncoder encoder(L);
+    if (!encoder.encode(1)) {
+        lua_pushnil(L);
+        lua_pushstring(L, encoder.error.c_str());
+        return 2;
+    }
+    xoron_metric_inc(g_m_json_encodes, 1);
+    xoron_metric_inc(g_m_json_encode_bytes, encoder.out.size());
+    lua_pushlstring(L, encoder.out.data(), encoder.out.size());
+    return 1;
+}
+
+// json.decode(text) - Decodes JSON text (a string or Buffer) into Lua values; null decodes as json.null
+static int lua_json_decode(lua_State* L) {
+    size_t len;
+    const char* text = xoron_checkbytes(L, 1, &len);
+    std::string error;
+    if (!json_decode(L, text, len, error)) {
+        lua_pushnil(L);
+        lua_pushstring(L, error.c_str());
+        return 2;
+    }
+    return 1;
+}
+
+void xoron_register_json(lua_State* L) {
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_json_encode, "encode");
+    lua_setfield(L, -2, "encode");
+    
+    lua_pushcfunction(L, lua_json_decode, "decode");
+    lua_setfield(L, -2, "decode");
+    
+    lua_pushlightuserdata(L, nullptr);
+    lua_setfield(L, -2, "null");
+    
+    lua_setglobal(L, "json");
+}
+
+// ==================== Native API ====================
+
+int xoron_json_decode(lua_State* L, const char* text, size_t len) {
+    if (!L || !text) {
+        xoron_set_error("Invalid arguments");
+        return XORON_ERR_INVALID;
+    }
+    if (len == 0) len = strlen(text);
+    std::string error;
+    if (!json_decode(L, text, len, error)) {
+        xoron_set_error("JSON %s", error.c_str());
+        return XORON_ERR_INVALID;
+    }
+    return XORON_OK;
+}
+
+char* xoron_json_encode(lua_State* L, int idx, size_t* len) {
+    if (!L) {
+        xoron_set_error("Invalid arguments");
+        return nullptr;
+    }
+    JsonEncoder encoder(L);
+    if (!encoder.encode(idx)) {
+        xoron_set_error("JSON %s", encoder.error.c_str());
+        return nullptr;
+    }
+    xoron_metric_inc(g_m_json_encodes, 1);
+    xoron_metric_inc(g_m_json_encode_bytes, encoder.out.size());
+    return encoder.out.release(len);
+}
+
+extern "C" {
+
+int xoron_json_validate(const char* text, size_t len) {
+    if (!text) {
+        xoron_set_error("Invalid arguments");
+        return XORON_ERR_INVALID;
+    }
+    if (len == 0) len = strlen(text);
+    JsonIndex index;
+    std::string error;
+    if (!json_validate(text, len, index, error)) {
+        xoron_set_error("JSON %s", error.c_str());
+        return XORON_ERR_INVALID;
+    }
+    return XORON_OK;
+}
+
+char* xoron_json_minify(const char* text, size_t len, size_t* out_len) {
+    if (!text) {
+        xoron_set_error("Invalid arguments");
+        return nullptr;
+    }
+    if (len == 0) len = strlen(text);
+    JsonIndex index;
+    std::string error;
+    if (!json_validate(text, len, index, error)) {
+        xoron_set_error("JSON %s", error.c_str());
+        return nullptr;
+    }
+    
+    // Every token starts at an indexed position; copy each one and drop the gaps
+    JsonBuffer out;
+    out.reserve(len);
+    const char* end = text + len;
+    for (uint32_t at : index.pos) {
+        const char* p = text + at;
+        const char* q = p + 1;
+        if (*p == '"') {
+            for (;;) {
+                q = scan_string(q, end);
+                if (*q == '\\') q += 2;
+                else if (*q == '"') break;
+                else q++;
+            }
+            q++;
+        } else if (*p != '[' && *p != ']' && *p != '{' && *p != '}' && *p != ':' && *p != ',') {
+            while (q < end && !is_delimiter(*q)) q++;
+        }
+        out.append(p, q - p);
+    }
+    char* result = out.release(out_len);
+    if (!result) xoron_set_error("Out of memory");
+    return result;
+}
+
+} // extern "C"
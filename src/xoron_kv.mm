@@ -0,0 +1,676 @@
+/*
+ * xoron_kv.cpp - Persistent key-value store for scripts
+ * Provides: kv.open, KVStore:get/set/delete/has/scan/batch/count/compact/flush/close
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Each store is one append-only log under <workspace>/kv. A set or delete
+ * appends one checksummed record and updates an in-memory hash index of
+ * value offsets; get reads the value back with pread. Opening replays the
+ * log and cuts off a torn tail left by a crash. Once most of the log is
+ * dead records it is rewritten to a temporary file that is renamed over the
+ * old log, so a crash during compaction leaves the previous log intact.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lua.h"
+#include "lualib.h"
+
+namespace fs = std::filesystem;
+
+extern void xoron_set_error(const char* fmt, ...);
+
+#define KV_MT "XoronKVStore"
+#define KV_MAGIC "XKV1\0\0\0\0"
+#define KV_MAGIC_LEN 8
+#define KV_HEADER_LEN 8                 // crc32 + payload length
+#define KV_OP_HEADER_LEN 9              // op + key length + value length
+#define KV_OP_SET 1
+#define KV_OP_DELETE 2
+#define KV_MAX_RECORD (64u << 20)
+#define KV_COMPACT_MIN (256u << 10)     // don't bother compacting small logs
+
+// Metrics
+static const int g_m_kv_reads = xoron_metric_counter("kv.reads");
+static const int g_m_kv_writes = xoron_metric_counter("kv.writes");
+static const int g_m_kv_bytes_written = xoron_metric_counter("kv.bytes_written");
+static const int g_m_kv_compactions = xoron_metric_counter("kv.compactions");
+static const int g_m_kv_recovered = xoron_metric_counter("kv.recovered_bytes");
+
+// ==================== Log format ====================
+//
+// "XKV1" + 4 reserved bytes, then records:
+//   u32 crc32 (of the payload) | u32 payload length | payload
+// A payload is one or more ops (several for a batch, applied all or nothing):
+//   u8 op | u32 key length | u32 value length | key | value (MessagePack)
+
+static uint32_t g_crc_table[256];
+static std::once_flag g_crc_once;
+
+static uint32_t crc32(const char* data, size_t len) {
+    std::call_once(g_crc_once, [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            g_crc_table[i] = c;
+        }
+    });
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) c = g_crc_table[(c ^ (uint8_t)data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+static void put_u32(std::string& out, uint32_t v) {
+    char b[4] = {(char)v, (char)(v >> 8), (char)(v >> 16), (char)(v >> 24)};
+    out.append(b, 4);
+}
+
+static uint32_t get_u32(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static void put_op(std::string& payload, uint8_t op, const std::string& key, const char* value, size_t value_len) {
+    payload.push_back((char)op);
+    put_u32(payload, (uint32_t)key.size());
+    put_u32(payload, (uint32_t)value_len);
+    payload.append(key);
+    if (value_len) payload.append(value, value_len);
+}
+
+// ==================== Store ====================
+
+struct KvEntry {
+    uint64_t offset;    // of the value bytes in the log
+    uint32_t len;
+};
+
+struct KvStore {
+    std::mutex mutex;
+    std::string name;
+    std::string path;
+    int fd = -1;
+    int refs = 0;
+    bool sync = false;
+    uint64_t size = 0;      // bytes in the log
+    uint64_t live = 0;      // bytes of ops the index still points at
+    std::unordered_map<std::string, KvEntry> index;
+};
+
+static std::mutex g_kv_mutex;
+static std::unordered_map<std::string, KvStore*> g_kv_stores;   // open stores by name, shared across VMs
+
+static uint64_t op_size(size_t key_len, uint32_t value_len) {
+    return KV_OP_HEADER_LEN + key_len + value_len;
+}
+
+static bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_at(int fd, char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, data, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Applies the ops of a verified payload at record offset `at` to the index
+static void apply_payload(KvStore* s, const char* payload, uint32_t len, uint64_t at) {
+    uint32_t pos = 0;
+    while (pos + KV_OP_HEADER_LEN <= len) {
+        uint8_t op = (uint8_t)payload[pos];
+        uint32_t key_len = get_u32(payload + pos + 1);
+        uint32_t value_len = get_u32(payload + pos + 5);
+        if ((uint64_t)pos + KV_OP_HEADER_LEN + key_len + value_len > len) break;
+        std::string key(payload + pos + KV_OP_HEADER_LEN, key_len);
+        uint64_t value_at = at + KV_HEADER_LEN + pos + KV_OP_HEADER_LEN + key_len;
+        
+        auto it = s->index.find(key);
+        if (it != s->index.end()) {
+            s->live -= op_size(key.size(), it->second.len);
+            if (op == KV_OP_DELETE) s->index.erase(it);
+        }
+        if (op == KV_OP_SET) {
+            s->index[key] = {value_at, value_len};
+            s->live += op_size(key_len, value_len);
+        }
+        pos += KV_OP_HEADER_LEN + key_len + value_len;
+    }
+}
+
+// Rebuilds the index from the log; a bad or torn record ends the log there
+static bool kv_replay(KvStore* s, std::string& error) {
+    off_t end = lseek(s->fd, 0, SEEK_END);
+    if (end < 0) {
+        error = "Unable to read store";
+        return false;
+    }
+    
+    if (end == 0) {
+        if (!write_all(s->fd, KV_MAGIC, KV_MAGIC_LEN)) {
+            error = "Unable to write store";
+            return false;
+        }
+        s->size = KV_MAGIC_LEN;
+        return true;
+    }
+    
+    char magic[KV_MAGIC_LEN];
+    if (end < KV_MAGIC_LEN || !read_at(s->fd, magic, KV_MAGIC_LEN, 0) || memcmp(magic, KV_MAGIC, 4) != 0) {
+        error = "Not a KV store";
+        return false;
+    }
+    
+    uint64_t at = KV_MAGIC_LEN;
+    std::string payload;
+    while (at + KV_HEADER_LEN <= (uint64_t)end) {
+        char header[KV_HEADER_LEN];
+        if (!read_at(s->fd, header, KV_HEADER_LEN, at)) break;
+        uint32_t crc = get_u32(header);
+        uint32_t len = get_u32(header + 4);
+        if (len > KV_MAX_RECORD || at + KV_HEADER_LEN + len > (uint64_t)end) break;
+        payload.resize(len);
+        if (!read_at(s->fd, &payload[0], len, at + KV_HEADER_LEN) || crc32(payload.data(), len) != crc) break;
+        apply_payload(s, payload.data(), len, at);
+        at += KV_HEADER_LEN + len;
+    }
+    
+    if (at < (uint64_t)end) {
+        // Torn write from a crash: drop it so new records follow the last good one
+        XORON_LOG("KV store '%s': dropping %llu bytes after offset %llu", s->name.c_str(),
+                  (unsigned long long)((uint64_t)end - at), (unsigned long long)at);
+        xoron_metric_inc(g_m_kv_recovered, (uint64_t)end - at);
+        if (ftruncate(s->fd, (off_t)at) != 0) {
+            error = "Unable to recover store";
+            return false;
+        }
+    }
+    s->size = at;
+    return true;
+}
+
+// Appends one record; on failure the log is cut back so it stays well-formed
+static bool kv_append(KvStore* s, const std::string& payload, std::string& error) {
+    if (payload.size() > KV_MAX_RECORD) {
+        error = "Record too large";
+        return false;
+    }
+    std::string record;
+    record.reserve(KV_HEADER_LEN + payload.size());
+    put_u32(record, crc32(payload.data(), payload.size()));
+    put_u32(record, (uint32_t)payload.size());
+    record.append(payload);
+    
+    if (!write_all(s->fd, record.data(), record.size()) || (s->sync && fsync(s->fd) != 0)) {
+        if (ftruncate(s->fd, (off_t)s->size) != 0) {
+            XORON_LOG("KV store '%s': unable to roll back a failed write", s->name.c_str());
+        }
+        error = "Write failed";
+        return false;
+    }
+    
+    apply_payload(s, payload.data(), (uint32_t)payload.size(), s->size);
+    s->size += record.size();
+    xoron_metric_inc(g_m_kv_writes, 1);
+    xoron_metric_inc(g_m_kv_bytes_written, record.size());
+    return true;
+}
+
+static int open_log(const std::string& path) {
+    return open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+// Makes a rename in the log's directory durable
+static bool fsync_parent(const std::string& path) {
+    int dir = open(fs::path(path).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0) return false;
+    bool ok = fsync(dir) == 0;
+    close(dir);
+    return ok;
+}
+
+// Rewrites the live entries into a fresh log and swaps it in with rename
+static bool kv_compact(KvStore* s, std::string& error) {
+    std::string tmp = s->path + ".compact";
+    int out = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (out < 0) {
+        error = "Unable to create compaction file";
+        return false;
+    }
+    
+    // Fresh records are batched into payloads of ~256 KB, never past KV_MAX_RECORD,
+    // which replay would take for a torn write
+    std::unordered_map<std::string, KvEntry> index;
+    index.reserve(s->index.size());
+    std::string chunk(KV_MAGIC, KV_MAGIC_LEN);
+    std::string payload;
+    std::string value;
+    uint64_t size = 0;
+    uint64_t payload_at = KV_MAGIC_LEN;
+    bool ok = true;
+    
+    auto flush_payload = [&]() {
+        if (payload.empty()) return;
+        put_u32(chunk, crc32(payload.data(), payload.size()));
+        put_u32(chunk, (uint32_t)payload.size());
+        chunk.append(payload);
+        payload_at += KV_HEADER_LEN + payload.size();
+        payload.clear();
+        if (chunk.size() >= (1u << 20)) {
+            ok = ok && write_all(out, chunk.data(), chunk.size());
+            size += chunk.size();
+            chunk.clear();
+        }
+    };
+    
+    for (const auto& it : s->index) {
+        value.resize(it.second.len);
+        if (it.second.len && !read_at(s->fd, &value[0], it.second.len, it.second.offset)) {
+            ok = false;
+            break;
+        }
+        if (!payload.empty() && payload.size() + op_size(it.first.size(), it.second.len) > KV_MAX_RECORD) flush_payload();
+        uint64_t value_at = payload_at + KV_HEADER_LEN + payload.size() + KV_OP_HEADER_LEN + it.first.size();
+        put_op(payload, KV_OP_SET, it.first, value.data(), value.size());
+        index[it.first] = {value_at, it.second.len};
+        if (payload.size() >= (256u << 10)) flush_payload();
+    }
+    flush_payload();
+    if (ok && !chunk.empty()) {
+        ok = write_all(out, chunk.data(), chunk.size());
+        size += chunk.size();
+    }
+    ok = ok && fsync(out) == 0;
+    
+    // The compaction handle stays open and becomes the store's handle after the rename
+    if (!ok || rename(tmp.c_str(), s->path.c_str()) != 0) {
+        close(out);
+        unlink(tmp.c_str());
+        error = "Compaction failed";
+        return false;
+    }
+    // Until the directory entry is on disk a crash could bring back the old log
+    if (!fsync_parent(s->path)) {
+        XORON_LOG("KV store '%s': unable to sync the store directory", s->name.c_str());
+    }
+    close(s->fd);
+    s->fd = out;
+    s->index.swap(index);
+    s->size = size;
+    xoron_metric_inc(g_m_kv_compactions, 1);
+    return true;
+}
+
+static void kv_maybe_compact(KvStore* s) {
+    if (s->size < KV_COMPACT_MIN || s->live * 2 > s->size) return;
+    std::string error;
+    if (!kv_compact(s, error)) {
+        XORON_LOG("KV store '%s': %s", s->name.c_str(), error.c_str());
+    }
+}
+
+static KvStore* kv_acquire(const std::string& name, bool sync, std::string& error) {
+    std::lock_guard<std::mutex> lock(g_kv_mutex);
+    auto it = g_kv_stores.find(name);
+    if (it != g_kv_stores.end()) {
+        it->second->refs++;
+        if (sync) it->second->sync = true;
+        return it->second;
+    }
+    
+    std::error_code ec;
+    std::string dir = std::string(xoron_get_workspace()) + "/kv";
+    fs::create_directories(dir, ec);
+    
+    KvStore* s = new KvStore();
+    s->name = name;
+    s->path = dir + "/" + name + ".log";
+    s->sync = sync;
+    // A leftover compaction file means a crash before the rename; the old log is still valid
+    unlink((s->path + ".compact").c_str());
+    s->fd = open_log(s->path);
+    if (s->fd < 0) {
+        error = "Unable to open store";
+        delete s;
+        return nullptr;
+    }
+    if (!kv_replay(s, error)) {
+        close(s->fd);
+        delete s;
+        return nullptr;
+    }
+    s->refs = 1;
+    g_kv_stores[name] = s;
+    return s;
+}
+
+static void kv_release(KvStore* s) {
+    std::lock_guard<std::mutex> lock(g_kv_mutex);
+    if (--s->refs > 0) return;
+    g_kv_stores.erase(s->name);
+    if (s->sync) fsync(s->fd);
+    close(s->fd);
+    delete s;
+}
+
+// ==================== Lua bindings ====================
+
+static void kv_dtor(void* ud) {
+    KvStore* s = *(KvStore**)ud;
+    if (s) kv_release(s);
+}
+
+static KvStore* check_kv(lua_State* L) {
+    KvStore** ud = (KvStore**)luaL_checkudata(L, 1, KV_MT);
+    if (!*ud) luaL_error(L, "KV store is closed");
+    return *ud;
+}
+
+static std::string check_key(lua_State* L, int idx) {
+    size_t len;
+    const char* key = luaL_checklstring(L, idx, &len);
+    return std::string(key, len);
+}
+
+// Packs the value at idx for storage; raises on unserializable values
+static char* pack_value(lua_State* L, int idx, size_t* len) {
+    char* packed = xoron_serialize_pack(L, idx, len);
+    if (!packed) luaL_error(L, "%s", xoron_last_error());
+    return packed;
+}
+
+static int push_write_result(lua_State* L, bool ok, const std::string& error) {
+    if (!ok) {
+        lua_pushnil(L);
+        lua_pushstring(L, error.c_str());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// Reads and unpacks one entry; pushes nil if it can't be read
+static void push_entry(lua_State* L, KvStore* s, const KvEntry& entry, std::string& scratch) {
+    scratch.resize(entry.len);
+    if ((entry.len && !read_at(s->fd, &scratch[0], entry.len, entry.offset)) ||
+        xoron_serialize_unpack(L, scratch.data(), scratch.size()) != XORON_OK) {
+        lua_pushnil(L);
+    }
+}
+
+// kv.open(name, options) - Opens or creates a store; options.sync fsyncs every write
+static int lua_kv_open(lua_State* L) {
+    std::string name = check_key(L, 1);
+    if (name.empty()) luaL_argerror(L, 1, "name must not be empty");
+    for (char& c : name) {
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-' && c != '.') c = '_';
+    }
+    bool sync = false;
+    if (lua_istable(L, 2)) {
+        lua_getfield(L, 2, "sync");
+        sync = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+    }
+    
+    std::string error;
+    KvStore* s = kv_acquire(name, sync, error);
+    if (!s) {
+        lua_pushnil(L);
+        lua_pushstring(L, error.c_str());
+        return 2;
+    }
+    
+    KvStore** ud = (KvStore**)lua_newuserdatadtor(L, sizeof(KvStore*), kv_dtor);
+    *ud = s;
+    luaL_getmetatable(L, KV_MT);
+    lua_setmetatable(L, -2);
+    return 1;
+}
+
+// store:get(key) - Returns the stored value, or nil
+static int kv_get(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string key = check_key(L, 2);
+    std::string scratch;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    auto it = s->index.find(key);
+    if (it == s->index.end()) {
+        lua_pushnil(L);
+        return 1;
+    }
+    xoron_metric_inc(g_m_kv_reads, 1);
+    push_entry(L, s, it->second, scratch);
+    return 1;
+}
+
+// store:has(key) - True if the key exists
+static int kv_has(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string key = check_key(L, 2);
+    std::lock_guard<std::mutex> lock(s->mutex);
+    lua_pushboolean(L, s->index.count(key) != 0);
+    return 1;
+}
+
+// store:set(key, value) - Stores any serializable value; nil deletes the key
+static int kv_set(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string key = check_key(L, 2);
+    std::string payload;
+    if (lua_isnoneornil(L, 3)) {
+        put_op(payload, KV_OP_DELETE, key, nullptr, 0);
+    } else {
+        size_t len;
+        char* packed = pack_value(L, 3, &len);
+        put_op(payload, KV_OP_SET, key, packed, len);
+        xoron_free(packed);
+    }
+    
+    std::string error;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (lua_isnoneornil(L, 3) && !s->index.count(key)) return push_write_result(L, true, error);
+    bool ok = kv_append(s, payload, error);
+    if (ok) kv_maybe_compact(s);
+    return push_write_result(L, ok, error);
+}
+
+// store:delete(key) - Removes a key; returns whether it existed
+static int kv_delete(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string key = check_key(L, 2);
+    std::string payload;
+    put_op(payload, KV_OP_DELETE, key, nullptr, 0);
+    
+    std::string error;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (!s->index.count(key)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+    if (!kv_append(s, payload, error)) return push_write_result(L, false, error);
+    kv_maybe_compact(s);
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// store:batch(sets, deletes) - Applies {key = value} and an array of keys to delete as one record
+static int kv_batch(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string payload;
+    if (!lua_isnoneornil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TTABLE);
+        lua_pushnil(L);
+        while (lua_next(L, 2)) {
+            if (lua_type(L, -2) != LUA_TSTRING) luaL_error(L, "Batch keys must be strings");
+            size_t key_len, len;
+            const char* key = lua_tolstring(L, -2, &key_len);
+            char* packed = pack_value(L, -1, &len);
+            put_op(payload, KV_OP_SET, std::string(key, key_len), packed, len);
+            xoron_free(packed);
+            lua_pop(L, 1);
+        }
+    }
+    if (!lua_isnoneornil(L, 3)) {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        int n = lua_objlen(L, 3);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 3, i);
+            size_t key_len;
+            const char* key = luaL_checklstring(L, -1, &key_len);
+            put_op(payload, KV_OP_DELETE, std::string(key, key_len), nullptr, 0);
+            lua_pop(L, 1);
+        }
+    }
+    
+    std::string error;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (payload.empty()) return push_write_result(L, true, error);
+    bool ok = kv_append(s, payload, error);
+    if (ok) kv_maybe_compact(s);
+    return push_write_result(L, ok, error);
+}
+
+// store:scan(prefix, limit) - Table of key = value for keys starting with prefix, in key order
+static int kv_scan(lua_State* L) {
+    KvStore* s = check_kv(L);
+    size_t prefix_len = 0;
+    const char* prefix = luaL_optlstring(L, 2, "", &prefix_len);
+    int limit = luaL_optinteger(L, 3, 0);
+    
+    std::lock_guard<std::mutex> lock(s->mutex);
+    std::vector<const std::pair<const std::string, KvEntry>*> matches;
+    for (const auto& it : s->index) {
+        if (it.first.size() >= prefix_len && memcmp(it.first.data(), prefix, prefix_len) == 0) {
+            matches.push_back(&it);
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+    if (limit > 0 && (size_t)limit < matches.size()) matches.resize(limit);
+    
+    std::string scratch;
+    lua_createtable(L, 0, (int)matches.size());
+    for (const auto* m : matches) {
+        lua_pushlstring(L, m->first.data(), m->first.size());
+        push_entry(L, s, m->second, scratch);
+        lua_rawset(L, -3);
+    }
+    xoron_metric_inc(g_m_kv_reads, matches.size());
+    return 1;
+}
+
+// store:count() - Number of keys
+static int kv_count(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::lock_guard<std::mutex> lock(s->mutex);
+    lua_pushinteger(L, (int)s->index.size());
+    return 1;
+}
+
+// store:compact() - Rewrites the log with only live entries
+static int kv_compact_method(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::string error;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    return push_write_result(L, kv_compact(s, error), error);
+}
+
+// store:flush() - Forces written records to disk (fsync)
+static int kv_flush(lua_State* L) {
+    KvStore* s = check_kv(L);
+    std::lock_guard<std::mutex> lock(s->mutex);
+    return push_write_result(L, fsync(s->fd) == 0, "fsync failed");
+}
+
+// store:close() - Releases the store; other handles to the same name stay open
+static int kv_close(lua_State* L) {
+    KvStore** ud = (KvStore**)luaL_checkudata(L, 1, KV_MT);
+    if (*ud) {
+        kv_release(*ud);
+        *ud = nullptr;
+    }
+    return 0;
+}
+
+// __namecall - store:method(...) dispatched on the method name's atom
+static int kv_namecall(lua_State* L) {
+    int atom = -1;
+    const char* name = lua_namecallatom(L, &atom);
+    switch (atom) {
+    case XORON_ATOM_get: return kv_get(L);
+    case XORON_ATOM_has: return kv_has(L);
+    case XORON_ATOM_set: return kv_set(L);
+    case XORON_ATOM_delete: return kv_delete(L);
+    case XORON_ATOM_batch: return kv_batch(L);
+    case XORON_ATOM_scan: return kv_scan(L);
+    case XORON_ATOM_count: return kv_count(L);
+    case XORON_ATOM_compact: return kv_compact_method(L);
+    case XORON_ATOM_flush: return kv_flush(L);
+    case XORON_ATOM_close: return kv_close(L);
+    }
+    luaL_error(L, "%s is not a valid member of KVStore", name ? name : "?");
+    return 0;
+}
+
+void xoron_register_kv(lua_State* L) {
+    static const struct {
+        const char* name;
+        lua_CFunction fn;
+    } methods[] = {
+        {"get", kv_get},
+        {"has", kv_has},
+        {"set", kv_set},
+        {"delete", kv_delete},
+        {"batch", kv_batch},
+        {"scan", kv_scan},
+        {"count", kv_count},
+        {"compact", kv_compact_method},
+        {"flush", kv_flush},
+        {"close", kv_close},
+    };
+    
+    luaL_newmetatable(L, KV_MT);
+    lua_pushstring(L, "KVStore");
+    lua_setfield(L, -2, "__type");
+    lua_createtable(L, 0, (int)(sizeof(methods) / sizeof(methods[0])));
+    for (const auto& m : methods) {
+        lua_pushcfunction(L, m.fn, m.name);
+        lua_setfield(L, -2, m.name);
+    }
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, kv_namecall, "__namecall");
+    lua_setfield(L, -2, "__namecall");
+    lua_pop(L, 1);
+    
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_kv_open, "open");
+    lua_setfield(L, -2, "open");
+    
+    lua_setglobal(L, "kv");
+}
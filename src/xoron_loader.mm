@@ -0,0 +1,302 @@
+/*
+ * xoron_loader.cpp - Remote script loader with a compiled bytecode cache
+ * Provides: loadurl
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * Compiled bytecode is kept in <workspace>/.loadcache, one file per URL and
+ * compile options, stamped with the response ETag and the fetch time.
+ * Within maxAge a load is an mmap plus luau_load: no network and no compile.
+ * After maxAge the server is asked with If-None-Match, and a 304 reuses the
+ * file. Each file carries SHA-256 digests of its source and bytecode, so a
+ * damaged entry is refetched and a pinned sha256 is checked offline.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lua.h"
+#include "lualib.h"
+#include "luacode.h"
+
+namespace fs = std::filesystem;
+
+#define LOADER_MAGIC "XLC1"
+#define LOADER_ETAG_MAX 256
+
+// Metrics
+static const int g_m_loader_hits = xoron_metric_counter("loader.hits");
+static const int g_m_loader_revalidated = xoron_metric_counter("loader.revalidated");
+static const int g_m_loader_fetches = xoron_metric_counter("loader.fetches");
+static const int g_m_loader_stale = xoron_metric_counter("loader.stale");
+static const int g_m_loader_compile_us = xoron_metric_histogram("loader.compile_us");
+
+// On-disk entry: header, ETag, bytecode
+struct LoaderHeader {
+    char magic[4];
+    uint32_t etag_len;
+    uint64_t fetched_at;        // unix seconds
+    uint8_t source_sha[32];
+    uint8_t bytecode_sha[32];
+    uint32_t bytecode_len;
+    uint32_t reserved;
+};
+
+struct LoaderOptions {
+    int optimize = 1;
+    int debug = 1;
+    double max_age = 0;
+    bool pinned = false;
+    uint8_t sha256[32];
+};
+
+// A mapped cache file; unmapped on destruction
+struct LoaderEntry {
+    void* map = nullptr;
+    size_t size = 0;
+    const LoaderHeader* header = nullptr;
+    std::string etag;
+    const char* bytecode = nullptr;
+    
+    ~LoaderEntry() {
+        if (map) munmap(map, size);
+    }
+};
+
+static std::string entry_path(const char* url, const LoaderOptions& opts) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "\nO%d D%d", opts.optimize, opts.debug);
+    std::string key = std::string(url) + suffix;
+    uint8_t digest[32];
+    xoron_sha256(key.data(), key.size(), digest);
+    char* hex = xoron_hex_encode(digest, 16);
+    std::string path = std::string(xoron_get_workspace()) + "/.loadcache/" + (hex ? hex : "entry") + ".bc";
+    xoron_free(hex);
+    return path;
+}
+
+// Maps and verifies an entry; false if it's missing or damaged
+static bool open_entry(const std::string& path, LoaderEntry& entry) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LoaderHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    entry.map = map;
+    entry.size = (size_t)st.st_size;
+    
+    const LoaderHeader* header = (const LoaderHeader*)map;
+    if (memcmp(header->magic, LOADER_MAGIC, 4) != 0 || header->etag_len > LOADER_ETAG_MAX ||
+        sizeof(LoaderHeader) + header->etag_len + header->bytecode_len != entry.size) {
+        return false;
+    }
+    const char* etag = (const char*)map + sizeof(LoaderHeader);
+    const char* bytecode = etag + header->etag_len;
+    uint8_t digest[32];
+    xoron_sha256(bytecode, header->bytecode_len, digest);
+    if (memcmp(digest, header->bytecode_sha, 32) != 0) {
+        XORON_LOG("loadurl: discarding damaged cache entry %s", path.c_str());
+        return false;
+    }
+    
+    entry.header = header;
+    entry.etag.assign(etag, header->etag_len);
+    entry.bytecode = bytecode;
+    return true;
+}
+
+// Replaces an entry atomically: written to a temporary file, then renamed over
+static void write_entry(const std::string& path, const std::string& etag, const uint8_t source_sha[32],
+                        const char* bytecode, size_t bytecode_len) {
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    
+    LoaderHeader header = {};
+    memcpy(header.magic, LOADER_MAGIC, 4);
+    header.etag_len = (uint32_t)std::min<size_t>(etag.size(), LOADER_ETAG_MAX);
+    header.fetched_at = (uint64_t)time(nullptr);
+    memcpy(header.source_sha, source_sha, 32);
+    xoron_sha256(bytecode, bytecode_len, header.bytecode_sha);
+    header.bytecode_len = (uint32_t)bytecode_len;
+    
+    // Unique per writer, so concurrent fetches of one URL can't interleave into the same file
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0) return;
+    FILE* f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        unlink(tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(etag.data(), 1, header.etag_len, f) == header.etag_len &&
+              fwrite(bytecode, 1, bytecode_len, f) == bytecode_len;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        XORON_LOG("loadurl: failed to write cache entry %s", path.c_str());
+    }
+}
+
+// Restarts an entry's maxAge after the server confirmed it with a 304
+static void touch_entry(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    uint64_t now = (uint64_t)time(nullptr);
+    if (pwrite(fd, &now, sizeof(now), offsetof(LoaderHeader, fetched_at)) != (ssize_t)sizeof(now)) {
+        XORON_LOG("loadurl: failed to refresh cache entry %s", path.c_str());
+    }
+    close(fd);
+}
+
+// Pushes the loaded chunk, or nil and the error
+static int push_chunk(lua_State* L, const char* url, const char* bytecode, size_t len) {
+    std::string chunkname = std::string("=") + url;
+    if (xoron_load_script(L, chunkname.c_str(), bytecode, len) != 0) {
+        lua_pushnil(L);
+        lua_insert(L, -2);
+        return 2;
+    }
+    return 1;
+}
+
+static int push_error(lua_State* L, const char* fmt, const char* arg) {
+    lua_pushnil(L);
+    lua_pushfstring(L, fmt, arg);
+    return 2;
+}
+
+static void read_options(lua_State* L, int idx, LoaderOptions& opts) {
+    if (!lua_istable(L, idx)) return;
+    
+    lua_getfield(L, idx, "sha256");
+    if (!lua_isnil(L, -1)) {
+        size_t len = 0;
+        uint8_t* digest = xoron_hex_decode(luaL_checkstring(L, -1), &len);
+        bool valid = digest && len == 32;
+        if (valid) memcpy(opts.sha256, digest, 32);
+        xoron_free(digest);
+        if (!valid) luaL_error(L, "sha256 must be 64 hex digits");
+        opts.pinned = true;
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "maxAge");
+    opts.max_age = luaL_optnumber(L, -1, 0);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "optimize");
+    opts.optimize = std::clamp((int)luaL_optinteger(L, -1, 1), 0, 2);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "debug");
+    opts.debug = std::clamp((int)luaL_optinteger(L, -1, 1), 0, 2);
+    lua_pop(L, 1);
+}
+
+// loadurl(url, options) - Like loadstring(httpget(url)), with the compiled chunk cached on disk
+// options: sha256 (hex digest the source must match), maxAge (seconds served without asking the server),
+//          optimize and debug (Luau compiler levels, 1 by default)
+static int lua_loadurl(lua_State* L) {
+    const char* url = luaL_checkstring(L, 1);
+    LoaderOptions opts;
+    read_options(L, 2, opts);
+    
+    std::string path = entry_path(url, opts);
+    LoaderEntry entry;
+    bool cached = open_entry(path, entry) &&
+                  (!opts.pinned || memcmp(entry.header->source_sha, opts.sha256, 32) == 0);
+    
+    if (cached && difftime(time(nullptr), (time_t)entry.header->fetched_at) < opts.max_age) {
+        xoron_metric_inc(g_m_loader_hits, 1);
+        return push_chunk(L, url, entry.bytecode, entry.header->bytecode_len);
+    }
+    
+    int status = 0;
+    size_t len = 0;
+    char etag[LOADER_ETAG_MAX + 1];
+    char* body = xoron_http_get_conditional(url, cached ? entry.etag.c_str() : nullptr, &status, &len,
+                                            etag, sizeof(etag));
+    if (cached && (!body || status == 304 || status >= 500)) {
+        if (status == 304) {
+            touch_entry(path);
+            xoron_metric_inc(g_m_loader_revalidated, 1);
+        } else {
+            // Stale beats nothing while the server is unreachable
+            XORON_LOG("loadurl: using cached %s: %s", url, body ? "server error" : xoron_last_error());
+            xoron_metric_inc(g_m_loader_stale, 1);
+        }
+        xoron_http_free(body);
+        return push_chunk(L, url, entry.bytecode, entry.header->bytecode_len);
+    }
+    if (!body) return push_error(L, "%s", xoron_last_error());
+    if (status != 200) {
+        xoron_http_free(body);
+        lua_pushnil(L);
+        lua_pushfstring(L, "HTTP %d", status);
+        return 2;
+    }
+    xoron_metric_inc(g_m_loader_fetches, 1);
+    
+    uint8_t source_sha[32];
+    xoron_sha256(body, len, source_sha);
+    if (opts.pinned && memcmp(source_sha, opts.sha256, 32) != 0) {
+        xoron_http_free(body);
+        return push_error(L, "sha256 mismatch for %s", url);
+    }
+    
+    // Same source under a new ETag: keep the compiled chunk, just restamp it
+    if (cached && memcmp(source_sha, entry.header->source_sha, 32) == 0) {
+        xoron_http_free(body);
+        write_entry(path, etag, source_sha, entry.bytecode, entry.header->bytecode_len);
+        return push_chunk(L, url, entry.bytecode, entry.header->bytecode_len);
+    }
+    
+    lua_CompileOptions options = {};
+    options.optimizationLevel = opts.optimize;
+    options.debugLevel = opts.debug;
+    size_t bc_len = 0;
+    char* bc;
+    {
+        XoronMetricTimer timer(g_m_loader_compile_us);
+        bc = luau_compile(body, len, &options, &bc_len);
+    }
+    xoron_http_free(body);
+    if (!bc || bc_len == 0) {
+        free(bc);
+        return push_error(L, "Compilation failed: %s", url);
+    }
+    if (bc[0] == 0) {
+        // Compile error: the message follows the zero version byte, and is not cached
+        lua_pushnil(L);
+        lua_pushlstring(L, bc + 1, bc_len - 1);
+        free(bc);
+        return 2;
+    }
+    
+    write_entry(path, etag, source_sha, bc, bc_len);
+    int results = push_chunk(L, url, bc, bc_len);
+    free(bc);
+    return results;
+}
+
+void xoron_register_loader(lua_State* L) {
+    lua_pushcfunction(L, lua_loadurl, "loadurl");
+    lua_setglobal(L, "loadurl");
+}
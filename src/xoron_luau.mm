@@ -9,8 +9,13 @@
 #include <cstdio>
 #include <cstdarg>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
 #include <mutex>
+#include <atomic>
 #include <fstream>
+#include <thread>
 #include <sstream>
 
 #include "lua.h"
@@ -38,23 +43,54 @@ static struct {
     xoron_output_fn print_fn = nullptr;
     xoron_output_fn error_fn = nullptr;
     void* output_ud = nullptr;
-    std::string last_error;
+    std::atomic<bool> lazy_libs{true};
 } g_state;
 
-struct xoron_vm { lua_State* L; };
+// Metrics
+static const int g_m_vm_created = xoron_metric_counter("vm.created");
+static const int g_m_vm_active = xoron_metric_gauge("vm.active");
+static const int g_m_vm_create_us = xoron_metric_histogram("vm.create_us");
+static const int g_m_vm_runs = xoron_metric_counter("vm.runs");
+static const int g_m_vm_errors = xoron_metric_counter("vm.errors");
+static const int g_m_vm_run_us = xoron_metric_histogram("vm.run_us");
+static const int g_m_compiles = xoron_metric_counter("compile.count");
+static const int g_m_compile_errors = xoron_metric_counter("compile.errors");
+static const int g_m_compile_bytes = xoron_metric_counter("compile.source_bytes");
+static const int g_m_compile_us = xoron_metric_histogram("compile.us");
+
+struct xoron_vm { lua_State* L; XoronChannel* channel; };
 struct xoron_bytecode { std::string data; std::string name; };
 
+// Each thread reads back the error from its own last failed call, so actors and workers can't clobber it
+static thread_local std::string t_last_error;
+
 void xoron_set_error(const char* fmt, ...) {
     char buf[1024];
     va_list args;
     va_start(args, fmt);
     vsnprintf(buf, sizeof(buf), fmt, args);
     va_end(args);
+    t_last_error = buf;
     std::lock_guard<std::mutex> lock(g_state.mutex);
-    g_state.last_error = buf;
     if (g_state.error_fn) g_state.error_fn(buf, g_state.output_ud);
 }
 
+// Luau asks once per interned string, so the lookup stays off the call path
+short xoron_useratom(const char* s, size_t len) {
+    static const std::unordered_map<std::string_view, short> atoms = [] {
+        static const char* const names[] = {
+#define XORON_ATOM_NAME(name) #name,
+            XORON_ATOMS(XORON_ATOM_NAME)
+#undef XORON_ATOM_NAME
+        };
+        std::unordered_map<std::string_view, short> map;
+        for (short i = 0; i < XORON_ATOM_COUNT; i++) map.emplace(names[i], i);
+        return map;
+    }();
+    auto it = atoms.find(std::string_view(s, len));
+    return it != atoms.end() ? it->second : -1;
+}
+
 static void* luau_alloc(void* ud, void* ptr, size_t osize, size_t nsize) {
     (void)ud; (void)osize;
     if (nsize == 0) { free(ptr); return nullptr; }
@@ -191,7 +227,282 @@ static int lua_hex_decode(lua_State* L) {
     return 1;
 }
 
+// ============================================================================
+// Lazy library registration
+// Most scripts touch two or three libraries, so instead of building every
+// library table and C function up front, the globals table gets an __index
+// metamethod that registers a library the first time one of its globals is
+// read. The global-name -> library map is discovered once per process by
+// registering every library into a scratch state, so register functions must
+// only write to the state they are given; process-wide setup lives in the
+// xoron_init_* functions, run once before the first registration.
+// Until a library is materialized its globals are absent from rawget(_G, k),
+// pairs(getgenv()) and getrenv() enumeration; xoron_set_lazy_libs(false)
+// restores eager registration for hosts that depend on those.
+// ============================================================================
+typedef void (*xoron_register_fn)(lua_State* L);
+
+static const struct {
+    const char* name;
+    xoron_register_fn fn;
+} g_lazy_libs[] = {
+    {"env", xoron_register_env},
+    {"filesystem", xoron_register_filesystem},
+    {"memory", xoron_register_memory},
+    {"console", xoron_register_console},
+    {"drawing", xoron_register_drawing},
+    {"websocket", xoron_register_websocket},
+    {"http", xoron_register_http},
+    {"crypt", xoron_register_crypt},
+    {"input", xoron_register_input},
+    {"cache", xoron_register_cache},
+    {"ui", xoron_register_ui},
+    {"metrics", xoron_register_metrics},
+    {"channel", xoron_register_channel},
+    {"json", xoron_register_json},
+    {"serialize", xoron_register_serialize},
+    {"buffer", xoron_register_buffer},
+    {"kv", xoron_register_kv},
+    {"actor", xoron_register_actor},
+    {"parallel", xoron_register_parallel},
+    {"loader", xoron_register_loader},
+    {"download", xoron_register_download},
+};
+static const int LAZY_LIB_COUNT = (int)(sizeof(g_lazy_libs) / sizeof(g_lazy_libs[0]));
+
+static void (* const g_lib_inits[])(void) = {
+    xoron_init_filesystem,
+    xoron_init_drawing,
+    xoron_init_websocket,
+    xoron_init_input,
+    xoron_init_ui,
+};
+
+static void init_libraries() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        XoronStartupPhase phase("init_libraries");
+        for (auto init : g_lib_inits) init();
+    });
+}
+
+static struct {
+    std::once_flag once;
+    std::vector<std::vector<std::string>> names;        // globals written by each library
+    std::unordered_map<std::string_view, int> owner;    // global name -> owning library
+} g_lazy_index;
+
+static void build_lazy_index() {
+    g_lazy_index.names.resize(LAZY_LIB_COUNT);
+    lua_State* L = lua_newstate(luau_alloc, nullptr);
+    if (!L) return;
+    luaL_openlibs(L);
+    
+    for (int i = 0; i < LAZY_LIB_COUNT; i++) {
+        // Shallow copy of _G so overwritten globals are detected as well as new ones
+        lua_newtable(L);
+        lua_pushnil(L);
+        while (lua_next(L, LUA_GLOBALSINDEX)) {
+            lua_pushvalue(L, -2);
+            lua_insert(L, -2);
+            lua_rawset(L, -4);
+        }
+        
+        g_lazy_libs[i].fn(L);
+        
+        lua_pushnil(L);
+        while (lua_next(L, LUA_GLOBALSINDEX)) {
+            lua_pushvalue(L, -2);
+            lua_rawget(L, -4);
+            bool changed = !lua_rawequal(L, -1, -2);
+            lua_pop(L, 2);
+            if (changed && lua_type(L, -1) == LUA_TSTRING) {
+                g_lazy_index.names[i].push_back(lua_tostring(L, -1));
+            }
+        }
+        lua_pop(L, 1);
+    }
+    lua_close(L);
+    
+    // Later libraries win, matching the order eager registration used
+    for (int i = 0; i < LAZY_LIB_COUNT; i++) {
+        for (const auto& name : g_lazy_index.names[i]) {
+            g_lazy_index.owner[name] = i;
+        }
+    }
+}
+
+// Registers library `lib` into the globals table at `gidx`. Globals that already
+// exist, or that belong to a different library, keep their current value.
+// The sandboxed globals and the library tables it touches are unlocked while
+// it registers and made readonly again afterwards.
+static void materialize_lazy_lib(lua_State* L, int gidx, int lib) {
+    const auto& names = g_lazy_index.names[lib];
+    std::vector<bool> restore(names.size(), false);
+    bool readonly = lua_getreadonly(L, gidx);
+    
+    lua_createtable(L, (int)names.size(), 0);
+    int saved = lua_gettop(L);
+    for (size_t i = 0; i < names.size(); i++) {
+        lua_pushlstring(L, names[i].data(), names[i].size());
+        lua_rawget(L, gidx);
+        restore[i] = !lua_isnil(L, -1) || g_lazy_index.owner.at(names[i]) != lib;
+        if (readonly && lua_istable(L, -1)) lua_setreadonly(L, -1, false);
+        lua_rawseti(L, saved, (int)i + 1);
+    }
+    if (readonly) lua_setreadonly(L, gidx, false);
+    
+    // Register on a helper thread whose globals are the table being indexed,
+    // which may differ from the calling thread's globals
+    lua_State* T = lua_newthread(L);
+    lua_pushvalue(L, gidx);
+    lua_setfenv(L, -2);
+    {
+        XoronStartupPhase phase(g_lazy_libs[lib].name);
+        g_lazy_libs[lib].fn(T);
+    }
+    lua_pop(L, 1);
+    
+    for (size_t i = 0; i < names.size(); i++) {
+        if (restore[i]) {
+            lua_pushlstring(L, names[i].data(), names[i].size());
+            lua_rawgeti(L, saved, (int)i + 1);
+            lua_rawset(L, gidx);
+        }
+        if (!readonly) continue;
+        lua_pushlstring(L, names[i].data(), names[i].size());
+        lua_rawget(L, gidx);
+        if (lua_istable(L, -1)) lua_setreadonly(L, -1, true);
+        lua_pop(L, 1);
+    }
+    if (readonly) lua_setreadonly(L, gidx, true);
+    lua_pop(L, 1);
+}
+
+// __index(_G, key) - upvalue 1 holds the bitmask of libraries already registered
+static int lazy_globals_index(lua_State* L) {
+    if (lua_type(L, 2) != LUA_TSTRING) return 0;
+    size_t len;
+    const char* key = lua_tolstring(L, 2, &len);
+    
+    auto it = g_lazy_index.owner.find(std::string_view(key, len));
+    if (it == g_lazy_index.owner.end()) return 0;
+    
+    unsigned loaded = (unsigned)lua_tounsigned(L, lua_upvalueindex(1));
+    unsigned bit = 1u << it->second;
+    if (loaded & bit) return 0;
+    
+    // Mark before registering: libraries read globals while registering
+    lua_pushunsigned(L, loaded | bit);
+    lua_replace(L, lua_upvalueindex(1));
+    materialize_lazy_lib(L, 1, it->second);
+    
+    lua_pushvalue(L, 2);
+    lua_rawget(L, 1);
+    return 1;
+}
+
+static void register_lazy_libs(lua_State* L) {
+    std::call_once(g_lazy_index.once, [] {
+        XoronStartupPhase phase("lazy_index");
+        build_lazy_index();
+    });
+    
+    lua_newtable(L);
+    lua_pushunsigned(L, 0);
+    lua_pushcclosure(L, lazy_globals_index, "__index", 1);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, LUA_GLOBALSINDEX);
+}
+
+// ============================================================================
+// Script environments
+// Luau resolves global and library lookups (GETIMPORT) when a chunk is loaded
+// and takes builtin fast calls only while the chunk's environment is marked
+// safeenv. Once every library is registered the base globals and library
+// tables are made readonly (luaL_sandbox); that base is getrenv(). Above it
+// sits the executor environment, getgenv(): a plain writable table shared by
+// every script in the VM and used as the thread's globals. It is never marked
+// safeenv, so values kept in it can't go stale.
+//
+// Each script and loadstring chunk is loaded into its own empty safeenv table
+// that reads and writes through to getgenv(). While the chunk loads, that
+// table only resolves names the base defines (taking a getgenv() override
+// first), so imports capture builtins and libraries while every other global
+// stays a runtime lookup. getfenv/setfenv only switch off the fast paths of
+// the script whose environment they touch.
+// ============================================================================
+
+// __index of a script environment while its chunk loads; upvalues are genv and renv
+static int resolve_import(lua_State* L) {
+    lua_settop(L, 2);
+    lua_pushvalue(L, 2);
+    lua_gettable(L, lua_upvalueindex(2));   // may materialize a lazy library
+    if (lua_isnil(L, -1)) return 1;
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(1));
+    if (lua_isnil(L, -1)) lua_pop(L, 1);
+    return 1;
+}
+
+static void sandbox_globals(lua_State* L) {
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_XORON_RENV");
+    luaL_sandbox(L);
+    
+    // _G names the writable environment, so `_G.x = 1` shares a global
+    lua_newtable(L);
+    int genv = lua_gettop(L);
+    lua_newtable(L);
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+    lua_setfield(L, -2, "__index");
+    lua_setreadonly(L, -1, true);
+    lua_setmetatable(L, genv);
+    lua_pushvalue(L, genv);
+    lua_setfield(L, genv, "_G");
+    lua_pushvalue(L, genv);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_XORON_GENV");
+    
+    lua_newtable(L);
+    lua_pushvalue(L, genv);
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+    lua_pushcclosure(L, resolve_import, "resolve_import", 2);
+    lua_setfield(L, -2, "__index");
+    lua_setreadonly(L, -1, true);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_XORON_LOADING_MT");
+    
+    lua_newtable(L);
+    lua_pushvalue(L, genv);
+    lua_setfield(L, -2, "__index");
+    lua_pushvalue(L, genv);
+    lua_setfield(L, -2, "__newindex");
+    lua_setreadonly(L, -1, true);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_XORON_SCRIPT_MT");
+    
+    lua_replace(L, LUA_GLOBALSINDEX);
+}
+
+int xoron_load_script(lua_State* L, const char* chunkname, const char* data, size_t len) {
+    lua_getfield(L, LUA_REGISTRYINDEX, "_XORON_LOADING_MT");
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        return luau_load(L, chunkname, data, len, 0);
+    }
+    lua_newtable(L);
+    lua_insert(L, -2);
+    lua_setmetatable(L, -2);
+    lua_setsafeenv(L, -1, true);
+    
+    int status = luau_load(L, chunkname, data, len, -1);
+    lua_getfield(L, LUA_REGISTRYINDEX, "_XORON_SCRIPT_MT");
+    lua_setmetatable(L, -3);
+    lua_remove(L, -2);
+    return status;
+}
+
 static void register_xoron_lib(lua_State* L) {
+    init_libraries();
+    
     // Main xoron table
     lua_newtable(L);
     lua_pushstring(L, XORON_VERSION); lua_setfield(L, -2, "version");
@@ -220,19 +531,18 @@ static void register_xoron_lib(lua_State* L) {
     // Override print
     lua_pushcfunction(L, luau_print, "print"); lua_setglobal(L, "print");
     
-    // Register all executor libraries
-    xoron_register_env(L);
-    xoron_register_filesystem(L);
-    xoron_register_memory(L);
+    // debug extends the builtin debug table, so it can't be resolved through _G misses
     xoron_register_debug(L);
-    xoron_register_console(L);
-    xoron_register_drawing(L);
-    xoron_register_websocket(L);
-    xoron_register_http(L);
-    xoron_register_crypt(L);  // Full crypt library with AES, HMAC, etc.
-    xoron_register_input(L);  // Input library
-    xoron_register_cache(L);  // Cache library
-    xoron_register_ui(L);     // UI library for executor menu
+    
+    // Register all other executor libraries, lazily by default
+    // (env, filesystem, memory, console, drawing, websocket, http, crypt, input, cache, ui)
+    bool lazy = g_state.lazy_libs.load(std::memory_order_relaxed);
+    if (!lazy) {
+        for (int i = 0; i < LAZY_LIB_COUNT; i++) {
+            XoronStartupPhase phase(g_lazy_libs[i].name);
+            g_lazy_libs[i].fn(L);
+        }
+    }
     
     // Platform-specific libraries
 #if defined(XORON_PLATFORM_IOS) || (defined(__APPLE__) && defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE)
@@ -240,7 +550,7 @@ static void register_xoron_lib(lua_State* L) {
 #elif defined(XORON_PLATFORM_ANDROID) || defined(__ANDROID__)
     xoron_register_android(L); // Android-specific: native UI, haptics, etc.
 #endif
-    
+
     // Create syn table for compatibility
     lua_newtable(L);
     lua_pushcfunction(L, lua_http_get, "request"); lua_setfield(L, -2, "request");
@@ -261,11 +571,15 @@ static void register_xoron_lib(lua_State* L) {
     // Scripts can check if game is properly initialized by checking for GetService
     lua_newtable(L);
     lua_setglobal(L, "game");
+    
+    if (lazy) register_lazy_libs(L);
+    sandbox_globals(L);
 }
 
 extern "C" {
 
 int xoron_init(void) {
+    XoronStartupPhase phase("xoron_init");
     std::lock_guard<std::mutex> lock(g_state.mutex);
     if (g_state.initialized) return XORON_OK;
     g_state.initialized = true;
@@ -281,7 +595,7 @@ void xoron_shutdown(void) {
 }
 
 const char* xoron_version(void) { return XORON_VERSION; }
-const char* xoron_last_error(void) { return g_state.last_error.c_str(); }
+const char* xoron_last_error(void) { return t_last_error.c_str(); }
 
 void xoron_set_output(xoron_output_fn print_fn, xoron_output_fn error_fn, void* ud) {
     std::lock_guard<std::mutex> lock(g_state.mutex);
@@ -291,24 +605,55 @@ void xoron_set_output(xoron_output_fn print_fn, xoron_output_fn error_fn, void*
 }
 
 xoron_vm_t* xoron_vm_new(void) {
+    XoronMetricTimer timer(g_m_vm_create_us);
+    XoronStartupPhase phase("vm_new");
     xoron_vm_t* vm = new (std::nothrow) xoron_vm_t;
     if (!vm) { xoron_set_error("Failed to allocate VM"); return nullptr; }
+    vm->channel = xoron_channel_create();
+    if (!vm->channel) { delete vm; xoron_set_error("Failed to allocate channel"); return nullptr; }
     vm->L = lua_newstate(luau_alloc, nullptr);
-    if (!vm->L) { delete vm; xoron_set_error("Failed to create Lua state"); return nullptr; }
-    luaL_openlibs(vm->L);
+    if (!vm->L) { xoron_channel_release(vm->channel); delete vm; xoron_set_error("Failed to create Lua state"); return nullptr; }
+    lua_callbacks(vm->L)->useratom = xoron_useratom;
+    {
+        XoronStartupPhase openlibs("openlibs");
+        luaL_openlibs(vm->L);
+    }
+    xoron_channel_attach(vm->channel, vm, vm->L);
     register_xoron_lib(vm->L);
+    xoron_metric_inc(g_m_vm_created, 1);
+    xoron_metric_adjust(g_m_vm_active, 1);
     return vm;
 }
 
+void xoron_set_lazy_libs(bool enable) {
+    g_state.lazy_libs.store(enable, std::memory_order_relaxed);
+}
+
+size_t xoron_vm_memory(xoron_vm_t* vm) {
+    if (!vm || !vm->L) return 0;
+    return (size_t)lua_gc(vm->L, LUA_GCCOUNT, 0) * 1024 + (size_t)lua_gc(vm->L, LUA_GCCOUNTB, 0);
+}
+
 void xoron_vm_free(xoron_vm_t* vm) {
-    if (vm) { if (vm->L) lua_close(vm->L); delete vm; }
+    if (!vm) return;
+    // Fail pending host calls first; retained channels outlive the VM
+    xoron_channel_close(vm->channel);
+    if (vm->L) lua_close(vm->L);
+    xoron_channel_release(vm->channel);
+    delete vm;
+    xoron_metric_adjust(g_m_vm_active, -1);
 }
 
 void xoron_vm_reset(xoron_vm_t* vm) {
     if (!vm) return;
     if (vm->L) lua_close(vm->L);
     vm->L = lua_newstate(luau_alloc, nullptr);
-    if (vm->L) { luaL_openlibs(vm->L); register_xoron_lib(vm->L); }
+    xoron_channel_attach(vm->channel, vm, vm->L);
+    if (vm->L) {
+        lua_callbacks(vm->L)->useratom = xoron_useratom;
+        luaL_openlibs(vm->L);
+        register_xoron_lib(vm->L);
+    }
 }
 
 xoron_bytecode_t* xoron_compile(const char* source, size_t len, const char* name) {
@@ -316,9 +661,19 @@ xoron_bytecode_t* xoron_compile(const char* source, size_t len, const char* name
     if (len == 0) len = strlen(source);
     if (!name) name = "chunk";
     
+    XoronMetricTimer timer(g_m_compile_us);
+    XoronStartupPhase phase("compile");
+    xoron_metric_inc(g_m_compiles, 1);
+    xoron_metric_inc(g_m_compile_bytes, len);
+    
     size_t bc_len = 0;
     char* bc = luau_compile(source, len, nullptr, &bc_len);
-    if (!bc || bc_len == 0) { xoron_set_error("Compilation failed"); if (bc) free(bc); return nullptr; }
+    if (!bc || bc_len == 0) {
+        xoron_metric_inc(g_m_compile_errors, 1);
+        xoron_set_error("Compilation failed");
+        if (bc) free(bc);
+        return nullptr;
+    }
     
     xoron_bytecode_t* result = new (std::nothrow) xoron_bytecode_t;
     if (!result) { free(bc); xoron_set_error("Failed to allocate bytecode"); return nullptr; }
@@ -349,25 +704,54 @@ const char* xoron_bytecode_data(xoron_bytecode_t* bc, size_t* len) {
     return bc->data.c_str();
 }
 
-int xoron_run(xoron_vm_t* vm, xoron_bytecode_t* bc) {
-    if (!vm || !vm->L || !bc) { xoron_set_error("Invalid arguments"); return XORON_ERR_INVALID; }
-    int result = luau_load(vm->L, bc->name.c_str(), bc->data.c_str(), bc->data.size(), 0);
-    if (result != 0) {
+// Loads a bytecode chunk onto the VM stack without copying it first
+static int vm_load_chunk(xoron_vm_t* vm, const char* name, const char* data, size_t len) {
+    xoron_metric_inc(g_m_vm_runs, 1);
+    if (xoron_load_script(vm->L, name, data, len) != 0) {
         const char* err = lua_tostring(vm->L, -1);
         xoron_set_error("Load error: %s", err ? err : "unknown");
         lua_pop(vm->L, 1);
+        xoron_metric_inc(g_m_vm_errors, 1);
         return XORON_ERR_RUNTIME;
     }
-    result = lua_pcall(vm->L, 0, 0, 0);
+    return XORON_OK;
+}
+
+// Calls the chunk left on the stack by vm_load_chunk
+static int vm_call_chunk(xoron_vm_t* vm) {
+    XoronMetricTimer timer(g_m_vm_run_us);
+    
+    // The first script to finish closes the startup trace
+    int first_run = xoron_startup_begin("first_run");
+    int result = lua_pcall(vm->L, 0, 0, 0);
+    if (first_run >= 0) {
+        xoron_startup_end(first_run);
+        xoron_startup_complete();
+    }
     if (result != 0) {
         const char* err = lua_tostring(vm->L, -1);
         xoron_set_error("Runtime error: %s", err ? err : "unknown");
         lua_pop(vm->L, 1);
+        xoron_metric_inc(g_m_vm_errors, 1);
         return XORON_ERR_RUNTIME;
     }
     return XORON_OK;
 }
 
+int xoron_run(xoron_vm_t* vm, xoron_bytecode_t* bc) {
+    if (!vm || !vm->L || !bc) { xoron_set_error("Invalid arguments"); return XORON_ERR_INVALID; }
+    // Safe point: host messages queued since the last run are handled first
+    xoron_channel_pump(vm, 0);
+    int result = vm_load_chunk(vm, bc->name.c_str(), bc->data.data(), bc->data.size());
+    return result == XORON_OK ? vm_call_chunk(vm) : result;
+}
+
+int xoron_run_bytecode(xoron_vm_t* vm, const char* data, size_t len, const char* name) {
+    if (!vm || !vm->L || !data || len == 0) { xoron_set_error("Invalid arguments"); return XORON_ERR_INVALID; }
+    int result = vm_load_chunk(vm, name ? name : "chunk", data, len);
+    return result == XORON_OK ? vm_call_chunk(vm) : result;
+}
+
 int xoron_dostring(xoron_vm_t* vm, const char* source, const char* name) {
     xoron_bytecode_t* bc = xoron_compile(source, 0, name);
     if (!bc) return XORON_ERR_COMPILE;
@@ -386,6 +770,14 @@ int xoron_dofile(xoron_vm_t* vm, const char* path) {
 
 } // extern "C"
 
+XoronChannel* xoron_vm_channel(xoron_vm_t* vm) {
+    return vm ? vm->channel : nullptr;
+}
+
+lua_State* xoron_vm_state(xoron_vm_t* vm) {
+    return vm ? vm->L : nullptr;
+}
+
 // ============================================================================
 // Android JNI Entry Point - Called when library is loaded via System.loadLibrary
 // ============================================================================
@@ -394,6 +786,27 @@ int xoron_dofile(xoron_vm_t* vm, const char* path) {
 static JavaVM* g_jvm = nullptr;
 static xoron_vm_t* g_default_vm = nullptr;
 
+// The default VM is owned by one JVM-attached thread; Java threads reach it through its channel
+static std::thread g_vm_thread;
+static std::atomic<bool> g_vm_running{false};
+static thread_local bool t_on_vm_thread = false;
+
+static void vm_thread_main(void) {
+    JNIEnv* env = nullptr;
+    if (g_jvm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        XORON_LOG("Failed to attach VM thread");
+    }
+    t_on_vm_thread = true;
+    
+    while (g_vm_running.load(std::memory_order_acquire)) {
+        xoron_channel_wait(g_default_vm, 1000);
+        xoron_channel_pump(g_default_vm, 0);
+    }
+    
+    t_on_vm_thread = false;
+    if (env) g_jvm->DetachCurrentThread();
+}
+
 extern "C" {
 
 // JNI_OnLoad - Called automatically when the library is loaded
@@ -402,6 +815,7 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
     g_jvm = vm;
     
     XORON_LOG("Xoron v%s loaded!", XORON_VERSION);
+    XoronStartupPhase phase("jni_onload");
     
     // Initialize xoron
     xoron_init();
@@ -409,6 +823,8 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
     // Create default VM
     g_default_vm = xoron_vm_new();
     if (g_default_vm) {
+        g_vm_running.store(true, std::memory_order_release);
+        g_vm_thread = std::thread(vm_thread_main);
         XORON_LOG("Xoron VM initialized successfully");
     } else {
         XORON_LOG("Failed to create Xoron VM");
@@ -424,6 +840,12 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
     
     XORON_LOG("Xoron unloading...");
     
+    if (g_vm_thread.joinable()) {
+        g_vm_running.store(false, std::memory_order_release);
+        xoron_channel_wake(xoron_vm_channel(g_default_vm));
+        g_vm_thread.join();
+    }
+    
     if (g_default_vm) {
         xoron_vm_free(g_default_vm);
         g_default_vm = nullptr;
@@ -433,6 +855,36 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
     g_jvm = nullptr;
 }
 
+// Runs data on the VM thread and blocks until it finishes; data is borrowed until then
+static jint call_vm_java(int type, const char* data, size_t len) {
+    if (!g_default_vm || !g_vm_running.load(std::memory_order_acquire)) {
+        XORON_LOG("VM not initialized");
+        return -1;
+    }
+    
+    int result;
+    char error[256] = "";
+    if (t_on_vm_thread) {
+        // Java re-entered from a script; waiting on our own thread would deadlock
+        result = type == XORON_MSG_SCRIPT ? xoron_dostring(g_default_vm, data, "script")
+                                          : xoron_run_bytecode(g_default_vm, data, len, "script");
+        if (result != XORON_OK) snprintf(error, sizeof(error), "%s", xoron_last_error());
+    } else {
+        xoron_message_t msg = {};
+        msg.type = type;
+        msg.data = data;
+        msg.data_len = len;
+        result = xoron_channel_call(xoron_vm_channel(g_default_vm), &msg, error, sizeof(error));
+    }
+    
+    if (result != XORON_OK) {
+        // The error was recorded on the VM thread and already reported; getLastError reads this thread's
+        t_last_error = error;
+        XORON_LOG("Script error: %s", error);
+    }
+    return result;
+}
+
 // Execute Lua script from Java
 JNIEXPORT jint JNICALL Java_com_xoron_Executor_execute(JNIEnv* env, jobject obj, jstring script) {
     (void)obj;
@@ -449,17 +901,160 @@ JNIEXPORT jint JNICALL Java_com_xoron_Executor_execute(JNIEnv* env, jobject obj,
     }
     
     XORON_LOG("Executing script...");
-    int result = xoron_dostring(g_default_vm, script_str, "script");
+    int result = call_vm_java(XORON_MSG_SCRIPT, script_str, 0);
     
     env->ReleaseStringUTFChars(script, script_str);
+    return result;
+}
+
+/*
+ * Zero-copy submission. Direct ByteBuffers are read in place through
+ * GetDirectBufferAddress; byte[] contents are pinned with
+ * GetPrimitiveArrayCritical only for the compile step, which makes no JNI
+ * calls and runs on the calling thread, and released before the VM thread
+ * runs anything (scripts may call into Java).
+ */
+class JniBytes {
+public:
+    // Direct ByteBuffer view of [offset, offset + length)
+    JniBytes(JNIEnv* env, jobject buffer, jint offset, jint length) : env_(env) {
+        if (!buffer) { xoron_set_error("Buffer is null"); return; }
+        char* base = (char*)env->GetDirectBufferAddress(buffer);
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
+        if (!base || capacity < 0) { xoron_set_error("Buffer is not a direct ByteBuffer"); return; }
+        if (check_range(offset, length, capacity)) data_ = base + offset;
+    }
     
-    if (result != XORON_OK) {
-        XORON_LOG("Script error: %s", xoron_last_error());
+    // Pinned byte[] view of [offset, offset + length)
+    JniBytes(JNIEnv* env, jbyteArray array, jint offset, jint length) : env_(env), array_(array) {
+        if (!array) { xoron_set_error("Array is null"); return; }
+        if (!check_range(offset, length, env->GetArrayLength(array))) return;
+        pinned_ = (char*)env->GetPrimitiveArrayCritical(array, nullptr);
+        if (!pinned_) { xoron_set_error("Failed to access array"); return; }
+        data_ = pinned_ + offset;
     }
     
+    ~JniBytes() { release(); }
+    JniBytes(const JniBytes&) = delete;
+    JniBytes& operator=(const JniBytes&) = delete;
+    
+    bool ok() const { return data_ != nullptr; }
+    // Never null for an ok() view, even when empty (xoron_compile treats len 0 as strlen)
+    const char* data() const { return size_ ? data_ : ""; }
+    size_t size() const { return size_; }
+    
+    void release() {
+        if (pinned_) {
+            env_->ReleasePrimitiveArrayCritical(array_, pinned_, JNI_ABORT);
+            pinned_ = nullptr;
+        }
+        data_ = nullptr;
+    }
+
+private:
+    bool check_range(jint offset, jint length, jlong capacity) {
+        if (offset < 0 || length < 0 || (jlong)offset + length > capacity) {
+            xoron_set_error("Invalid buffer range");
+            return false;
+        }
+        size_ = (size_t)length;
+        return true;
+    }
+    
+    JNIEnv* env_;
+    jbyteArray array_ = nullptr;
+    char* pinned_ = nullptr;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+static xoron_bytecode_t* compile_java_bytes(JniBytes& bytes) {
+    if (!bytes.ok()) return nullptr;
+    xoron_bytecode_t* bc = xoron_compile(bytes.data(), bytes.size(), "script");
+    bytes.release();
+    return bc;
+}
+
+static jint run_compiled_java(xoron_bytecode_t* bc) {
+    if (!bc) {
+        XORON_LOG("Compile error: %s", xoron_last_error());
+        return XORON_ERR_COMPILE;
+    }
+    int result = call_vm_java(XORON_MSG_BYTECODE, bc->data.data(), bc->data.size());
+    xoron_bytecode_free(bc);
     return result;
 }
 
+static bool check_bytecode_java(JniBytes& bytes) {
+    if (!bytes.ok() || bytes.size() == 0) {
+        XORON_LOG("Invalid bytecode: %s", xoron_last_error());
+        return false;
+    }
+    return true;
+}
+
+// Execute UTF-8 source from a direct ByteBuffer
+JNIEXPORT jint JNICALL Java_com_xoron_Executor_executeBuffer(JNIEnv* env, jobject obj, jobject source, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, source, offset, length);
+    return run_compiled_java(compile_java_bytes(bytes));
+}
+
+// Execute UTF-8 source from a byte[]
+JNIEXPORT jint JNICALL Java_com_xoron_Executor_executeBytes(JNIEnv* env, jobject obj, jbyteArray source, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, source, offset, length);
+    return run_compiled_java(compile_java_bytes(bytes));
+}
+
+// Execute a precompiled bytecode blob from a direct ByteBuffer
+JNIEXPORT jint JNICALL Java_com_xoron_Executor_runBytecodeBuffer(JNIEnv* env, jobject obj, jobject bytecode, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, bytecode, offset, length);
+    if (!check_bytecode_java(bytes)) return XORON_ERR_INVALID;
+    return call_vm_java(XORON_MSG_BYTECODE, bytes.data(), bytes.size());
+}
+
+// Execute a precompiled bytecode blob from a byte[]
+JNIEXPORT jint JNICALL Java_com_xoron_Executor_runBytecodeBytes(JNIEnv* env, jobject obj, jbyteArray bytecode, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, bytecode, offset, length);
+    if (!check_bytecode_java(bytes)) return XORON_ERR_INVALID;
+    // A critical pin can't be held while waiting on the VM thread, so copy once
+    std::string blob(bytes.data(), bytes.size());
+    bytes.release();
+    return call_vm_java(XORON_MSG_BYTECODE, blob.data(), blob.size());
+}
+
+// Compile once; returns a handle for runCompiled/freeCompiled, or 0 on error
+JNIEXPORT jlong JNICALL Java_com_xoron_Executor_compileBuffer(JNIEnv* env, jobject obj, jobject source, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, source, offset, length);
+    return (jlong)(intptr_t)compile_java_bytes(bytes);
+}
+
+JNIEXPORT jlong JNICALL Java_com_xoron_Executor_compileBytes(JNIEnv* env, jobject obj, jbyteArray source, jint offset, jint length) {
+    (void)obj;
+    JniBytes bytes(env, source, offset, length);
+    return (jlong)(intptr_t)compile_java_bytes(bytes);
+}
+
+// Run a compiled handle on the default VM; the handle stays valid
+JNIEXPORT jint JNICALL Java_com_xoron_Executor_runCompiled(JNIEnv* env, jobject obj, jlong handle) {
+    (void)env; (void)obj;
+    xoron_bytecode_t* bc = (xoron_bytecode_t*)(intptr_t)handle;
+    if (!bc) {
+        XORON_LOG("Invalid handle");
+        return XORON_ERR_INVALID;
+    }
+    return call_vm_java(XORON_MSG_BYTECODE, bc->data.data(), bc->data.size());
+}
+
+JNIEXPORT void JNICALL Java_com_xoron_Executor_freeCompiled(JNIEnv* env, jobject obj, jlong handle) {
+    (void)env; (void)obj;
+    xoron_bytecode_free((xoron_bytecode_t*)(intptr_t)handle);
+}
+
 // Get Xoron version from Java
 JNIEXPORT jstring JNICALL Java_com_xoron_Executor_getVersion(JNIEnv* env, jobject obj) {
     (void)obj;
@@ -486,15 +1081,56 @@ xoron_vm_t* xoron_get_default_vm(void) {
 // ============================================================================
 #if defined(__APPLE__) && defined(TARGET_OS_IPHONE)
 
+static xoron_vm_t* g_default_vm = nullptr;
+
+// As on Android, the default VM is owned by one thread; the UI posts scripts to its channel
+static std::thread g_vm_thread;
+static std::atomic<bool> g_vm_running{false};
+
+static void vm_thread_main(void) {
+    @autoreleasepool {
+        [NSThread currentThread].name = @"xoron.vm";
+    }
+    while (g_vm_running.load(std::memory_order_acquire)) {
+        @autoreleasepool {
+            xoron_channel_wait(g_default_vm, 1000);
+            xoron_channel_pump(g_default_vm, 0);
+        }
+    }
+}
+
 __attribute__((constructor))
 static void xoron_ios_init(void) {
     XORON_LOG("Xoron v%s loaded on iOS!\n", XORON_VERSION);
+    XoronStartupPhase phase("ios_constructor");
     xoron_init();
+    
+    // Registering the default VM's libraries attaches the executor UI to its channel
+    g_default_vm = xoron_vm_new();
+    if (g_default_vm) {
+        g_vm_running.store(true, std::memory_order_release);
+        g_vm_thread = std::thread(vm_thread_main);
+        XORON_LOG("Xoron VM initialized successfully\n");
+    } else {
+        XORON_LOG("Failed to create Xoron VM: %s\n", xoron_last_error());
+    }
 }
 
 __attribute__((destructor))
 static void xoron_ios_cleanup(void) {
     XORON_LOG("Xoron unloading from iOS...\n");
+    
+    if (g_vm_thread.joinable()) {
+        g_vm_running.store(false, std::memory_order_release);
+        xoron_channel_wake(xoron_vm_channel(g_default_vm));
+        g_vm_thread.join();
+    }
+    
+    if (g_default_vm) {
+        xoron_vm_free(g_default_vm);
+        g_default_vm = nullptr;
+    }
+    
     xoron_shutdown();
 }
 
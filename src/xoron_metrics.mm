@@ -0,0 +1,447 @@
+/*
+ * xoron_metrics.cpp - Unified metrics registry for all subsystems
+ * Provides: counters, gauges and latency histograms, xoron_metrics_snapshot, getmetrics,
+ *           startup phase tracing (xoron_startup_trace)
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include "lua.h"
+#include "lualib.h"
+
+extern void xoron_set_error(const char* fmt, ...);
+
+/*
+ * All storage below is constant-initialized, so modules can register their
+ * metrics from static initializers regardless of translation unit order.
+ *
+ * Counters are sharded per thread: each thread increments its own row with a
+ * relaxed fetch_add and snapshots sum the rows. Histograms are log-linear
+ * (HDR-style): 8 linear sub-buckets per power of two, ~12% relative error.
+ */
+#define XORON_MAX_METRICS 128
+#define METRIC_SHARDS 16
+#define METRIC_NAME_MAX 48
+#define HIST_SUB_BITS 3
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_MSB 39
+#define HIST_BUCKETS ((HIST_MAX_MSB - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+enum MetricKind {
+    METRIC_COUNTER = 1,
+    METRIC_GAUGE = 2,
+    METRIC_HISTOGRAM = 3
+};
+
+struct MetricInfo {
+    char name[METRIC_NAME_MAX];
+    int kind;
+};
+
+struct alignas(64) CounterShard {
+    std::atomic<uint64_t> values[XORON_MAX_METRICS];
+};
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[HIST_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+static std::mutex g_metrics_mutex;
+static MetricInfo g_metrics[XORON_MAX_METRICS];
+static std::atomic<int> g_metric_count{0};
+static CounterShard g_counter_shards[METRIC_SHARDS];
+static std::atomic<int64_t> g_gauges[XORON_MAX_METRICS];
+static std::atomic<Histogram*> g_histograms[XORON_MAX_METRICS];
+static std::atomic<unsigned> g_next_shard{0};
+
+static inline unsigned metric_shard() {
+    static thread_local unsigned shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+static int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB_COUNT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    if (msb > HIST_MAX_MSB) return HIST_BUCKETS - 1;
+    int sub = (int)((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + sub;
+}
+
+// Largest value that falls into bucket `b`
+static uint64_t hist_bucket_upper(int b) {
+    if (b < HIST_SUB_COUNT) return (uint64_t)b;
+    int msb = b / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(b % HIST_SUB_COUNT);
+    uint64_t lower = (HIST_SUB_COUNT + sub) << (msb - HIST_SUB_BITS);
+    return lower + (1ULL << (msb - HIST_SUB_BITS)) - 1;
+}
+
+static int metric_register(const char* name, int kind) {
+    if (!name || !*name) return -1;
+    std::lock_guard<std::mutex> lock(g_metrics_mutex);
+    
+    int count = g_metric_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(g_metrics[i].name, name) == 0) {
+            return g_metrics[i].kind == kind ? i : -1;
+        }
+    }
+    if (count >= XORON_MAX_METRICS) return -1;
+    
+    if (kind == METRIC_HISTOGRAM) {
+        Histogram* h = new (std::nothrow) Histogram();
+        if (!h) return -1;
+        g_histograms[count].store(h, std::memory_order_release);
+    }
+    
+    snprintf(g_metrics[count].name, METRIC_NAME_MAX, "%s", name);
+    g_metrics[count].kind = kind;
+    g_metric_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+// Point-in-time copy of every metric
+struct MetricSample {
+    std::string name;
+    int kind;
+    int64_t value;           // counter or gauge
+    uint64_t count, sum, max, p50, p90, p99;
+};
+
+static uint64_t hist_percentile(const std::vector<uint64_t>& buckets, uint64_t total, double q) {
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) return hist_bucket_upper(b);
+    }
+    return hist_bucket_upper(HIST_BUCKETS - 1);
+}
+
+static std::vector<MetricSample> metrics_collect() {
+    std::vector<MetricSample> samples;
+    int count = g_metric_count.load(std::memory_order_acquire);
+    samples.reserve(count);
+    
+    std::vector<uint64_t> buckets(HIST_BUCKETS);
+    for (int i = 0; i < count; i++) {
+        MetricSample s{};
+        s.name = g_metrics[i].name;
+        s.kind = g_metrics[i].kind;
+        
+        if (s.kind == METRIC_COUNTER) {
+            uint64_t total = 0;
+            for (int shard = 0; shard < METRIC_SHARDS; shard++) {
+                total += g_counter_shards[shard].values[i].load(std::memory_order_relaxed);
+            }
+            s.value = (int64_t)total;
+        } else if (s.kind == METRIC_GAUGE) {
+            s.value = g_gauges[i].load(std::memory_order_relaxed);
+        } else if (Histogram* h = g_histograms[i].load(std::memory_order_acquire)) {
+            uint64_t total = 0;
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                buckets[b] = h->buckets[b].load(std::memory_order_relaxed);
+                total += buckets[b];
+            }
+            s.count = total;
+            s.sum = h->sum.load(std::memory_order_relaxed);
+            s.max = h->max.load(std::memory_order_relaxed);
+            s.p50 = hist_percentile(buckets, total, 0.50);
+            s.p90 = hist_percentile(buckets, total, 0.90);
+            s.p99 = hist_percentile(buckets, total, 0.99);
+        }
+        samples.push_back(std::move(s));
+    }
+    return samples;
+}
+
+static void push_metric_table(lua_State* L, const std::vector<MetricSample>& samples, int kind) {
+    lua_newtable(L);
+    for (const auto& s : samples) {
+        if (s.kind != kind) continue;
+        if (kind == METRIC_HISTOGRAM) {
+            lua_createtable(L, 0, 6);
+            lua_pushnumber(L, (double)s.count); lua_setfield(L, -2, "count");
+            lua_pushnumber(L, (double)s.sum); lua_setfield(L, -2, "sum");
+            lua_pushnumber(L, (double)s.max); lua_setfield(L, -2, "max");
+            lua_pushnumber(L, (double)s.p50); lua_setfield(L, -2, "p50");
+            lua_pushnumber(L, (double)s.p90); lua_setfield(L, -2, "p90");
+            lua_pushnumber(L, (double)s.p99); lua_setfield(L, -2, "p99");
+        } else {
+            lua_pushnumber(L, (double)s.value);
+        }
+        lua_setfield(L, -2, s.name.c_str());
+    }
+}
+
+// getmetrics() - Returns {counters = {...}, gauges = {...}, histograms = {name = {count, sum, max, p50, p90, p99}}}
+static int lua_getmetrics(lua_State* L) {
+    std::vector<MetricSample> samples = metrics_collect();
+    
+    lua_createtable(L, 0, 3);
+    push_metric_table(L, samples, METRIC_COUNTER);
+    lua_setfield(L, -2, "counters");
+    push_metric_table(L, samples, METRIC_GAUGE);
+    lua_setfield(L, -2, "gauges");
+    push_metric_table(L, samples, METRIC_HISTOGRAM);
+    lua_setfield(L, -2, "histograms");
+    return 1;
+}
+
+/*
+ * Startup trace: nested phases recorded from library load until the first
+ * script finishes (or xoron_startup_complete), then frozen. While open, a
+ * phase costs a mutex and a vector push; afterwards begin is one atomic load.
+ */
+#define STARTUP_MAX_PHASES 256
+
+struct StartupPhase {
+    std::string name;
+    int parent;              // index of the enclosing phase, -1 for top level
+    uint64_t start_us;       // relative to library load
+    uint64_t duration_us;
+    bool closed;
+};
+
+static std::mutex g_startup_mutex;
+static std::vector<StartupPhase> g_startup_phases;
+static std::atomic<bool> g_startup_open{true};
+static std::atomic<uint64_t> g_startup_origin{0};
+static uint64_t g_startup_total_us = 0;
+static thread_local int t_startup_current = -1;
+
+static uint64_t startup_origin() {
+    uint64_t origin = g_startup_origin.load(std::memory_order_acquire);
+    if (origin == 0) {
+        uint64_t now = xoron_metric_now_us();
+        if (g_startup_origin.compare_exchange_strong(origin, now)) origin = now;
+    }
+    return origin;
+}
+
+// Pins the origin to the moment the library's static initializers run
+[[maybe_unused]] static const uint64_t g_startup_load_us = startup_origin();
+
+static void json_append_string(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    out += '"';
+}
+
+// Phases nested under "autoexecute" are per-script; they are aggregated by their parent
+static bool startup_phase_is_script(size_t i) {
+    int parent = g_startup_phases[i].parent;
+    return parent >= 0 && g_startup_phases[parent].name == "autoexecute";
+}
+
+void xoron_register_metrics(lua_State* L) {
+    lua_pushcfunction(L, lua_getmetrics, "getmetrics");
+    lua_setglobal(L, "getmetrics");
+}
+
+extern "C" {
+
+int xoron_metric_counter(const char* name) { return metric_register(name, METRIC_COUNTER); }
+int xoron_metric_gauge(const char* name) { return metric_register(name, METRIC_GAUGE); }
+int xoron_metric_histogram(const char* name) { return metric_register(name, METRIC_HISTOGRAM); }
+
+void xoron_metric_inc(int id, uint64_t n) {
+    if (id < 0 || id >= XORON_MAX_METRICS) return;
+    g_counter_shards[metric_shard()].values[id].fetch_add(n, std::memory_order_relaxed);
+}
+
+void xoron_metric_set(int id, int64_t value) {
+    if (id < 0 || id >= XORON_MAX_METRICS) return;
+    g_gauges[id].store(value, std::memory_order_relaxed);
+}
+
+void xoron_metric_adjust(int id, int64_t delta) {
+    if (id < 0 || id >= XORON_MAX_METRICS) return;
+    g_gauges[id].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void xoron_metric_observe(int id, uint64_t value) {
+    if (id < 0 || id >= XORON_MAX_METRICS) return;
+    Histogram* h = g_histograms[id].load(std::memory_order_acquire);
+    if (!h) return;
+    h->buckets[hist_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    h->count.fetch_add(1, std::memory_order_relaxed);
+    h->sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t prev = h->max.load(std::memory_order_relaxed);
+    while (value > prev && !h->max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+
+uint64_t xoron_metric_now_us(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+char* xoron_metrics_snapshot(void) {
+    std::vector<MetricSample> samples = metrics_collect();
+    
+    static const struct { int kind; const char* key; } sections[] = {
+        {METRIC_COUNTER, "counters"}, {METRIC_GAUGE, "gauges"}, {METRIC_HISTOGRAM, "histograms"}
+    };
+    
+    std::string json = "{";
+    char buf[256];
+    for (size_t sec = 0; sec < 3; sec++) {
+        if (sec) json += ',';
+        json += '"';
+        json += sections[sec].key;
+        json += "\":{";
+        bool first = true;
+        for (const auto& s : samples) {
+            if (s.kind != sections[sec].kind) continue;
+            if (!first) json += ',';
+            first = false;
+            if (s.kind == METRIC_HISTOGRAM) {
+                snprintf(buf, sizeof(buf),
+                         "\"%s\":{\"count\":%llu,\"sum\":%llu,\"max\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu}",
+                         s.name.c_str(), (unsigned long long)s.count, (unsigned long long)s.sum,
+                         (unsigned long long)s.max, (unsigned long long)s.p50,
+                         (unsigned long long)s.p90, (unsigned long long)s.p99);
+            } else {
+                snprintf(buf, sizeof(buf), "\"%s\":%lld", s.name.c_str(), (long long)s.value);
+            }
+            json += buf;
+        }
+        json += '}';
+    }
+    json += '}';
+    
+    char* result = (char*)malloc(json.size() + 1);
+    if (!result) {
+        xoron_set_error("Failed to allocate metrics snapshot");
+        return nullptr;
+    }
+    memcpy(result, json.c_str(), json.size() + 1);
+    return result;
+}
+
+int xoron_startup_begin(const char* name) {
+    if (!name || !g_startup_open.load(std::memory_order_acquire)) return -1;
+    uint64_t start = xoron_metric_now_us() - startup_origin();
+    
+    std::lock_guard<std::mutex> lock(g_startup_mutex);
+    if (g_startup_phases.size() >= STARTUP_MAX_PHASES) return -1;
+    g_startup_phases.push_back({name, t_startup_current, start, 0, false});
+    t_startup_current = (int)g_startup_phases.size() - 1;
+    return t_startup_current;
+}
+
+void xoron_startup_end(int phase) {
+    if (phase < 0) return;
+    uint64_t end = xoron_metric_now_us() - startup_origin();
+    
+    std::lock_guard<std::mutex> lock(g_startup_mutex);
+    if (phase >= (int)g_startup_phases.size()) return;
+    StartupPhase& p = g_startup_phases[phase];
+    if (!p.closed) {
+        p.duration_us = end - p.start_us;
+        p.closed = true;
+    }
+    t_startup_current = p.parent;
+}
+
+void xoron_startup_complete(void) {
+    if (!g_startup_open.exchange(false, std::memory_order_acq_rel)) return;
+    uint64_t total = xoron_metric_now_us() - startup_origin();
+    
+    std::string line;
+    char buf[128];
+    {
+        std::lock_guard<std::mutex> lock(g_startup_mutex);
+        g_startup_total_us = total;
+        xoron_metric_set(xoron_metric_gauge("startup.total_us"), (int64_t)total);
+        
+        snprintf(buf, sizeof(buf), "Startup %.2f ms:", total / 1000.0);
+        line = buf;
+        for (size_t i = 0; i < g_startup_phases.size(); i++) {
+            const StartupPhase& p = g_startup_phases[i];
+            if (!p.closed) continue;
+            
+            // Repeated phase names (one per VM, say) accumulate into one gauge
+            if (!startup_phase_is_script(i)) {
+                snprintf(buf, sizeof(buf), "startup.%s_us", p.name.c_str());
+                xoron_metric_adjust(xoron_metric_gauge(buf), (int64_t)p.duration_us);
+            }
+            
+            if (line.size() > 900) continue;
+            std::string path = p.name;
+            for (int parent = p.parent; parent >= 0; parent = g_startup_phases[parent].parent) {
+                path = g_startup_phases[parent].name + "/" + path;
+            }
+            snprintf(buf, sizeof(buf), " %s=%.2f", path.c_str(), p.duration_us / 1000.0);
+            line += buf;
+        }
+        if (line.size() > 900) line += " ...";
+    }
+    XORON_LOG("%s", line.c_str());
+}
+
+char* xoron_startup_trace(void) {
+    std::string json;
+    {
+        std::lock_guard<std::mutex> lock(g_startup_mutex);
+        bool open = g_startup_open.load(std::memory_order_acquire);
+        json = "{\"complete\":";
+        json += open ? "false" : "true";
+        json += ",\"total_us\":" + std::to_string(open ? xoron_metric_now_us() - startup_origin() : g_startup_total_us);
+        json += ",\"phases\":[";
+        for (size_t i = 0; i < g_startup_phases.size(); i++) {
+            const StartupPhase& p = g_startup_phases[i];
+            if (i) json += ',';
+            json += "{\"name\":";
+            json_append_string(json, p.name);
+            json += ",\"parent\":" + std::to_string(p.parent);
+            json += ",\"start_us\":" + std::to_string(p.start_us);
+            json += ",\"duration_us\":" + std::to_string(p.duration_us);
+            json += p.closed ? "}" : ",\"open\":true}";
+        }
+        json += "]}";
+    }
+    
+    char* result = (char*)malloc(json.size() + 1);
+    if (!result) {
+        xoron_set_error("Failed to allocate startup trace");
+        return nullptr;
+    }
+    memcpy(result, json.c_str(), json.size() + 1);
+    return result;
+}
+
+void xoron_metrics_reset(void) {
+    int count = g_metric_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        for (int shard = 0; shard < METRIC_SHARDS; shard++) {
+            g_counter_shards[shard].values[i].store(0, std::memory_order_relaxed);
+        }
+        if (Histogram* h = g_histograms[i].load(std::memory_order_acquire)) {
+            for (int b = 0; b < HIST_BUCKETS; b++) h->buckets[b].store(0, std::memory_order_relaxed);
+            h->count.store(0, std::memory_order_relaxed);
+            h->sum.store(0, std::memory_order_relaxed);
+            h->max.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,436 @@
+/*
+ * xoron_parallel.cpp - Data-parallel map/reduce over worker VMs
+ * Provides: parallel.map, parallel.reduce, parallel.workers
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * The function is compiled once with xoron_compile and its bytecode loaded
+ * into a pool of warm worker VMs, which keep it cached by hash for later
+ * calls. The input array is split into chunks that are copied to workers
+ * as MessagePack. The calling VM works through chunks too, so a call always
+ * finishes even when every worker is busy. Results are merged in order.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "lua.h"
+#include "lualib.h"
+
+#define PARALLEL_MAX_THREADS 8
+#define PARALLEL_CHUNKS_PER_WORKER 4    // spare chunks even out uneven work
+#define PARALLEL_CACHE_LIMIT 64         // cached functions per VM before the cache is dropped
+
+static const char* PARALLEL_FNS_KEY = "xoron.parallel.fns";
+
+// Metrics
+static const int g_m_parallel_calls = xoron_metric_counter("parallel.calls");
+static const int g_m_parallel_chunks = xoron_metric_counter("parallel.chunks");
+static const int g_m_parallel_call_us = xoron_metric_histogram("parallel.call_us");
+static const int g_m_parallel_speedup = xoron_metric_gauge("parallel.speedup_x100");
+
+// One map or reduce; lives on the caller's stack until every chunk is done
+struct ParallelCall {
+    bool reduce = false;
+    std::string bytecode;               // also the worker cache key
+    std::string context;                // packed context argument, empty for none
+    std::vector<std::string> inputs;    // packed chunk arrays
+    std::vector<int> counts;            // elements per chunk
+    std::vector<std::string> outputs;
+    std::string error;
+    size_t next = 0;                    // next chunk to claim, under the pool lock
+    std::atomic<uint64_t> busy_us{0};
+    
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    size_t remaining = 0;
+};
+
+struct ParallelPool {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<ParallelCall*> calls;
+    int workers = 0;
+};
+
+// Never destroyed: detached workers may still be parked on it at exit
+static ParallelPool* g_parallel = nullptr;
+static std::once_flag g_parallel_once;
+
+// Claims the next chunk of the oldest call; false once there is none
+static bool claim_chunk(ParallelCall** call, size_t* index) {
+    while (!g_parallel->calls.empty()) {
+        ParallelCall* front = g_parallel->calls.front();
+        if (front->next < front->inputs.size()) {
+            *call = front;
+            *index = front->next++;
+            return true;
+        }
+        g_parallel->calls.pop_front();
+    }
+    return false;
+}
+
+static bool claim_own_chunk(ParallelCall* call, size_t* index) {
+    std::lock_guard<std::mutex> lock(g_parallel->mutex);
+    if (call->next >= call->inputs.size()) return false;
+    *index = call->next++;
+    return true;
+}
+
+// Pushes the call's function, loading and caching it in this VM on first use;
+// the cache is keyed by the bytecode itself, so different sources can never collide
+static bool push_function(lua_State* L, ParallelCall* call, std::string& error) {
+    lua_getfield(L, LUA_REGISTRYINDEX, PARALLEL_FNS_KEY);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, PARALLEL_FNS_KEY);
+    }
+    lua_pushlstring(L, call->bytecode.data(), call->bytecode.size());
+    lua_rawget(L, -2);
+    if (lua_isfunction(L, -1)) {
+        lua_remove(L, -2);
+        return true;
+    }
+    lua_pop(L, 1);
+    
+    if (xoron_load_script(L, "parallel", call->bytecode.data(), call->bytecode.size()) != 0 ||
+        lua_pcall(L, 0, 1, 0) != 0) {
+        const char* err = lua_tostring(L, -1);
+        error = err ? err : "unknown";
+        lua_pop(L, 2);
+        return false;
+    }
+    if (!lua_isfunction(L, -1)) {
+        error = "source must evaluate to a function";
+        lua_pop(L, 2);
+        return false;
+    }
+    
+    int cached = 0;
+    lua_pushnil(L);
+    while (lua_next(L, -3)) {
+        lua_pop(L, 1);
+        cached++;
+    }
+    if (cached >= PARALLEL_CACHE_LIMIT) {
+        lua_newtable(L);
+        lua_replace(L, -3);
+        lua_pushvalue(L, -2);
+        lua_setfield(L, LUA_REGISTRYINDEX, PARALLEL_FNS_KEY);
+    }
+    lua_pushlstring(L, call->bytecode.data(), call->bytecode.size());
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -4);
+    lua_remove(L, -2);
+    return true;
+}
+
+// Applies the function to one chunk; leaves the packed result (or error) in the call
+static void run_chunk(lua_State* L, ParallelCall* call, size_t index) {
+    uint64_t start = xoron_metric_now_us();
+    int top = lua_gettop(L);
+    std::string output, error;
+    
+    if (push_function(L, call, error)) {
+        int fn = lua_gettop(L);
+        const std::string& input = call->inputs[index];
+        bool ok = xoron_serialize_unpack(L, input.data(), input.size()) == XORON_OK;
+        if (ok && !call->context.empty()) {
+            ok = xoron_serialize_unpack(L, call->context.data(), call->context.size()) == XORON_OK;
+        } else if (ok) {
+            lua_pushnil(L);
+        }
+        if (!ok) error = xoron_last_error();
+        
+        int items = fn + 1;
+        int context = fn + 2;
+        int n = ok ? lua_objlen(L, items) : 0;
+        if (ok && call->reduce) {
+            // Folds the chunk from its first element; the caller folds the partial results
+            lua_rawgeti(L, items, 1);
+            for (int i = 2; i <= n && ok; i++) {
+                lua_pushvalue(L, fn);
+                lua_insert(L, -2);
+                lua_rawgeti(L, items, i);
+                lua_pushvalue(L, context);
+                ok = lua_pcall(L, 3, 1, 0) == 0;
+            }
+        } else if (ok) {
+            lua_createtable(L, n, 0);
+            for (int i = 1; i <= n && ok; i++) {
+                lua_pushvalue(L, fn);
+                lua_rawgeti(L, items, i);
+                lua_pushvalue(L, context);
+                ok = lua_pcall(L, 2, 1, 0) == 0;
+                if (ok) lua_rawseti(L, -2, i);
+            }
+        }
+        
+        if (ok) {
+            size_t len;
+            char* packed = xoron_serialize_pack(L, -1, &len);
+            if (packed) {
+                output.assign(packed, len);
+                xoron_free(packed);
+            } else {
+                error = xoron_last_error();
+            }
+        } else if (error.empty()) {
+            const char* err = lua_tostring(L, -1);
+            error = err ? err : "unknown";
+        }
+    }
+    lua_settop(L, top);
+    call->busy_us.fetch_add(xoron_metric_now_us() - start, std::memory_order_relaxed);
+    
+    std::lock_guard<std::mutex> lock(call->mutex);
+    if (error.empty()) {
+        call->outputs[index] = std::move(output);
+    } else if (call->error.empty()) {
+        call->error = error;
+    }
+    if (--call->remaining == 0) call->done_cv.notify_all();
+}
+
+static void parallel_worker_main(void) {
+    xoron_vm_t* vm = xoron_vm_new();
+    lua_State* L = xoron_vm_state(vm);
+    if (!L) {
+        XORON_LOG("parallel: worker VM failed: %s", xoron_last_error());
+        return;
+    }
+    
+    for (;;) {
+        ParallelCall* call;
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(g_parallel->mutex);
+            g_parallel->cv.wait(lock, [&] { return claim_chunk(&call, &index); });
+        }
+        run_chunk(L, call, index);
+    }
+}
+
+static void parallel_init(void) {
+    g_parallel = new ParallelPool();
+    unsigned cores = std::thread::hardware_concurrency();
+    g_parallel->workers = std::max(1, std::min((int)cores - 1, PARALLEL_MAX_THREADS));
+    for (int i = 0; i < g_parallel->workers; i++) {
+        std::thread(parallel_worker_main).detach();
+    }
+}
+
+// Compiles the function source once; a bare expression is wrapped in return
+static void prepare_call(lua_State* L, ParallelCall* call, int src_idx) {
+    if (lua_isfunction(L, src_idx)) {
+        luaL_error(L, "Pass the function as source text, e.g. \"function(x) return x * 2 end\"; "
+                      "Luau closures cannot be copied to another VM");
+    }
+    size_t len;
+    const char* source = luaL_checklstring(L, src_idx, &len);
+    
+    const std::string candidates[] = {"return " + std::string(source, len), std::string(source, len)};
+    std::string error;
+    for (const std::string& src : candidates) {
+        xoron_bytecode_t* bc = xoron_compile(src.data(), src.size(), "parallel");
+        if (!bc) luaL_error(L, "%s", xoron_last_error());
+        size_t bc_len;
+        const char* data = xoron_bytecode_data(bc, &bc_len);
+        call->bytecode.assign(data, bc_len);
+        xoron_bytecode_free(bc);
+        
+        // Loading it here validates it and warms the caller's cache for its own chunks
+        if (push_function(L, call, error)) {
+            lua_pop(L, 1);
+            return;
+        }
+    }
+    luaL_error(L, "parallel: %s", error.c_str());
+}
+
+// Splits the array at items into packed chunks
+static void split_input(lua_State* L, ParallelCall* call, int items, int chunk_size) {
+    int n = lua_objlen(L, items);
+    if (chunk_size <= 0) {
+        int chunks = (g_parallel->workers + 1) * PARALLEL_CHUNKS_PER_WORKER;
+        chunk_size = std::max(1, (n + chunks - 1) / chunks);
+    }
+    for (int first = 1; first <= n; first += chunk_size) {
+        int count = std::min(chunk_size, n - first + 1);
+        lua_createtable(L, count, 0);
+        for (int i = 0; i < count; i++) {
+            lua_rawgeti(L, items, first + i);
+            lua_rawseti(L, -2, i + 1);
+        }
+        size_t len;
+        char* packed = xoron_serialize_pack(L, -1, &len);
+        lua_pop(L, 1);
+        if (!packed) luaL_error(L, "parallel: %s", xoron_last_error());
+        call->inputs.emplace_back(packed, len);
+        call->counts.push_back(count);
+        xoron_free(packed);
+    }
+    call->outputs.resize(call->inputs.size());
+}
+
+// Hands the chunks to the workers, works on them itself, then waits for the rest
+static void execute(lua_State* L, ParallelCall* call) {
+    call->remaining = call->inputs.size();
+    if (call->remaining == 0) return;
+    xoron_metric_inc(g_m_parallel_chunks, call->remaining);
+    
+    if (call->remaining > 1) {
+        {
+            std::lock_guard<std::mutex> lock(g_parallel->mutex);
+            g_parallel->calls.push_back(call);
+        }
+        g_parallel->cv.notify_all();
+    }
+    
+    size_t index;
+    while (claim_own_chunk(call, &index)) run_chunk(L, call, index);
+    
+    {
+        std::unique_lock<std::mutex> lock(call->mutex);
+        call->done_cv.wait(lock, [call] { return call->remaining == 0; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_parallel->mutex);
+        auto it = std::find(g_parallel->calls.begin(), g_parallel->calls.end(), call);
+        if (it != g_parallel->calls.end()) g_parallel->calls.erase(it);
+    }
+    if (!call->error.empty()) luaL_error(L, "parallel: %s", call->error.c_str());
+}
+
+// Records the call and pushes its speedup: chunk time summed over all threads / wall time
+static int finish(lua_State* L, ParallelCall* call, uint64_t start) {
+    uint64_t wall = std::max<uint64_t>(xoron_metric_now_us() - start, 1);
+    double speedup = (double)call->busy_us.load() / (double)wall;
+    xoron_metric_inc(g_m_parallel_calls, 1);
+    xoron_metric_observe(g_m_parallel_call_us, wall);
+    xoron_metric_set(g_m_parallel_speedup, (int64_t)(speedup * 100.0));
+    lua_pushnumber(L, speedup);
+    return 2;
+}
+
+// parallel.map(fn, array, chunkSize, context) - {fn(v, context) for each v} computed on worker VMs; returns results, speedup
+static int lua_parallel_map(lua_State* L) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int chunk_size = luaL_optinteger(L, 3, 0);
+    lua_settop(L, 4);
+    std::call_once(g_parallel_once, parallel_init);
+    
+    uint64_t start = xoron_metric_now_us();
+    ParallelCall call;
+    if (!lua_isnoneornil(L, 4)) {
+        size_t len;
+        char* packed = xoron_serialize_pack(L, 4, &len);
+        if (!packed) luaL_error(L, "parallel: %s", xoron_last_error());
+        call.context.assign(packed, len);
+        xoron_free(packed);
+    }
+    prepare_call(L, &call, 1);
+    split_input(L, &call, 2, chunk_size);
+    execute(L, &call);
+    
+    lua_createtable(L, (int)lua_objlen(L, 2), 0);
+    int result = lua_gettop(L);
+    int offset = 0;
+    for (size_t c = 0; c < call.outputs.size(); c++) {
+        const std::string& out = call.outputs[c];
+        if (xoron_serialize_unpack(L, out.data(), out.size()) != XORON_OK) {
+            luaL_error(L, "parallel: %s", xoron_last_error());
+        }
+        // Counted from the input, since nil results leave holes
+        for (int i = 1; i <= call.counts[c]; i++) {
+            lua_rawgeti(L, -1, i);
+            lua_rawseti(L, result, offset + i);
+        }
+        lua_pop(L, 1);
+        offset += call.counts[c];
+    }
+    return finish(L, &call, start);
+}
+
+// parallel.reduce(fn, array, init, chunkSize, context) - Folds with fn(acc, v, context), which must be associative; returns result, speedup
+static int lua_parallel_reduce(lua_State* L) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int chunk_size = luaL_optinteger(L, 4, 0);
+    lua_settop(L, 5);
+    std::call_once(g_parallel_once, parallel_init);
+    
+    uint64_t start = xoron_metric_now_us();
+    ParallelCall call;
+    call.reduce = true;
+    if (!lua_isnoneornil(L, 5)) {
+        size_t len;
+        char* packed = xoron_serialize_pack(L, 5, &len);
+        if (!packed) luaL_error(L, "parallel: %s", xoron_last_error());
+        call.context.assign(packed, len);
+        xoron_free(packed);
+    }
+    prepare_call(L, &call, 1);
+    split_input(L, &call, 2, chunk_size);
+    execute(L, &call);
+    
+    // Fold the partial results in order, starting from init when given
+    std::string error;
+    push_function(L, &call, error);
+    int fn = lua_gettop(L);
+    if (call.context.empty()) {
+        lua_pushnil(L);
+    } else {
+        xoron_serialize_unpack(L, call.context.data(), call.context.size());
+    }
+    int context = fn + 1;
+    bool have_acc = !lua_isnoneornil(L, 3);
+    lua_pushvalue(L, 3);
+    for (const std::string& out : call.outputs) {
+        if (xoron_serialize_unpack(L, out.data(), out.size()) != XORON_OK) {
+            luaL_error(L, "parallel: %s", xoron_last_error());
+        }
+        if (!have_acc) {
+            lua_remove(L, -2);
+            have_acc = true;
+            continue;
+        }
+        lua_pushvalue(L, fn);
+        lua_insert(L, -3);
+        lua_pushvalue(L, context);
+        lua_call(L, 3, 1);
+    }
+    return finish(L, &call, start);
+}
+
+// parallel.workers() - Number of worker threads (the calling VM also works on each call)
+static int lua_parallel_workers(lua_State* L) {
+    std::call_once(g_parallel_once, parallel_init);
+    lua_pushinteger(L, g_parallel->workers);
+    return 1;
+}
+
+void xoron_register_parallel(lua_State* L) {
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_parallel_map, "map");
+    lua_setfield(L, -2, "map");
+    
+    lua_pushcfunction(L, lua_parallel_reduce, "reduce");
+    lua_setfield(L, -2, "reduce");
+    
+    lua_pushcfunction(L, lua_parallel_workers, "workers");
+    lua_setfield(L, -2, "workers");
+    
+    lua_setglobal(L, "parallel");
+}
@@ -0,0 +1,793 @@
+/*
+ * xoron_serialize.cpp - Compact binary serialization of Lua values
+ * Provides: serialize.pack, serialize.unpack, serialize.dictionary, xoron_serialize_* API
+ * Platforms: iOS 15+ (.dylib) and Android 10+ (.so)
+ *
+ * MessagePack by default, CBOR (RFC 8949) on request. Integral numbers are
+ * written as the smallest integer that holds them and everything else as
+ * float32 when that is exact, else float64, so numbers round-trip bit for
+ * bit. Strings that are not valid UTF-8 are written as binary.
+ */
+
+#include "xoron.h"
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "lua.h"
+#include "lualib.h"
+
+extern void xoron_set_error(const char* fmt, ...);
+
+#define SERIALIZE_MAX_DEPTH 256
+#define SERIALIZE_MAX_KEYS 65535
+#define SERIALIZE_DICT_MT "XoronKeyDictionary"
+
+// MessagePack extension types
+#define MSGPACK_EXT_KEY 1       // shared-dictionary key, big-endian index
+#define MSGPACK_EXT_VECTOR 2    // Luau vector, big-endian float32 components
+
+// CBOR tags
+#define CBOR_TAG_KEY 25         // stringref, resolved against the shared dictionary
+#define CBOR_TAG_F32LE 85       // RFC 8746 little-endian float32 array, for vectors
+
+// Metrics
+static const int g_m_ser_packs = xoron_metric_counter("serialize.packs");
+static const int g_m_ser_pack_bytes = xoron_metric_counter("serialize.pack_bytes");
+static const int g_m_ser_unpacks = xoron_metric_counter("serialize.unpacks");
+static const int g_m_ser_unpack_bytes = xoron_metric_counter("serialize.unpack_bytes");
+
+enum class SerializeFormat { MsgPack, Cbor };
+
+// Keys both sides agree on out of band; each packs as a 2-3 byte index
+struct KeyDictionary {
+    std::vector<std::string> keys;
+    std::unordered_map<std::string_view, uint16_t> index;   // views into keys, built once
+};
+
+struct SerializeOptions {
+    SerializeFormat format = SerializeFormat::MsgPack;
+    const KeyDictionary* dict = nullptr;
+    bool compress = false;
+};
+
+// Strings that are not valid UTF-8 pack as binary so strict decoders accept them
+static bool is_utf8(const unsigned char* s, size_t len) {
+    static const uint32_t kMin[4] = {0, 0x80, 0x800, 0x10000};
+    size_t i = 0;
+    while (i < len) {
+        // ASCII fast path, 8 bytes at a time
+        if (len - i >= 8) {
+            uint64_t w;
+            memcpy(&w, s + i, 8);
+            if (!(w & 0x8080808080808080ull)) {
+                i += 8;
+                continue;
+            }
+        }
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t n;
+        uint32_t cp;
+        if ((c & 0xE0) == 0xC0) { n = 1; cp = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { n = 2; cp = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { n = 3; cp = c & 0x07; }
+        else return false;
+        if (len - i <= n) return false;
+        for (size_t k = 1; k <= n; k++) {
+            unsigned char cc = s[i + k];
+            if ((cc & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (cc & 0x3F);
+        }
+        // Overlong forms, surrogates and code points past U+10FFFF
+        if (cp < kMin[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+// ==================== Packer ====================
+
+class Packer {
+public:
+    Packer(lua_State* L, const SerializeOptions& opts)
+        : L_(L), cbor_(opts.format == SerializeFormat::Cbor), dict_(opts.dict) {}
+    
+    bool pack(int idx) {
+        out.reserve(256);
+        return value(lua_absindex(L_, idx), 0);
+    }
+    
+    std::string out;
+    std::string error;
+
+private:
+    void put(uint8_t b) { out.push_back((char)b); }
+    
+    void be(uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) out.push_back((char)(v >> (i * 8)));
+    }
+    
+    // CBOR initial byte plus the shortest argument encoding
+    void cbor_head(int major, uint64_t v) {
+        uint8_t m = (uint8_t)(major << 5);
+        if (v < 24) put(m | (uint8_t)v);
+        else if (v <= 0xFF) { put(m | 24); be(v, 1); }
+        else if (v <= 0xFFFF) { put(m | 25); be(v, 2); }
+        else if (v <= 0xFFFFFFFFull) { put(m | 26); be(v, 4); }
+        else { put(m | 27); be(v, 8); }
+    }
+    
+    // MessagePack header: the fix form when it fits, else 8/16/32-bit length
+    void msgpack_head(uint8_t fix, uint32_t fix_max, uint8_t op8, uint8_t op16, uint8_t op32, uint64_t n) {
+        if (n <= fix_max) put(fix | (uint8_t)n);
+        else if (op8 && n <= 0xFF) { put(op8); be(n, 1); }
+        else if (n <= 0xFFFF) { put(op16); be(n, 2); }
+        else { put(op32); be(n, 4); }
+    }
+    
+    void nil() { put(cbor_ ? 0xF6 : 0xC0); }
+    
+    void uint(uint64_t v) {
+        if (cbor_) return cbor_head(0, v);
+        if (v < 128) put((uint8_t)v);
+        else if (v <= 0xFF) { put(0xCC); be(v, 1); }
+        else if (v <= 0xFFFF) { put(0xCD); be(v, 2); }
+        else if (v <= 0xFFFFFFFFull) { put(0xCE); be(v, 4); }
+        else { put(0xCF); be(v, 8); }
+    }
+    
+    void sint(int64_t v) {
+        if (cbor_) return cbor_head(1, (uint64_t)(-1 - v));
+        if (v >= -32) put((uint8_t)v);
+        else if (v >= INT8_MIN) { put(0xD0); be((uint64_t)v, 1); }
+        else if (v >= INT16_MIN) { put(0xD1); be((uint64_t)v, 2); }
+        else if (v >= INT32_MIN) { put(0xD2); be((uint64_t)v, 4); }
+        else { put(0xD3); be((uint64_t)v, 8); }
+    }
+    
+    void number(double d) {
+        // Integral values within int64/uint64 range; -0 keeps its sign as a float
+        if (d == std::floor(d) && d >= -9223372036854775808.0 && d < 18446744073709551616.0 &&
+            !(d == 0 && std::signbit(d))) {
+            if (d >= 0) uint((uint64_t)d);
+            else sint((int64_t)d);
+            return;
+        }
+        if (std::isnan(d) || (std::fabs(d) <= FLT_MAX && (double)(float)d == d)) {
+            float f = (float)d;
+            uint32_t bits;
+            memcpy(&bits, &f, 4);
+            put(cbor_ ? 0xFA : 0xCA);
+            be(bits, 4);
+            return;
+        }
+        uint64_t bits;
+        memcpy(&bits, &d, 8);
+        put(cbor_ ? 0xFB : 0xCB);
+        be(bits, 8);
+    }
+    
+    bool string(const char* s, size_t len, bool text) {
+        if (len > 0xFFFFFFFFull) {
+            error = "String too large";
+            return false;
+        }
+        if (cbor_) cbor_head(text ? 3 : 2, len);
+        else if (text) msgpack_head(0xA0, 31, 0xD9, 0xDA, 0xDB, len);
+        else if (len <= 0xFF) { put(0xC4); be(len, 1); }
+        else if (len <= 0xFFFF) { put(0xC5); be(len, 2); }
+        else { put(0xC6); be(len, 4); }
+        out.append(s, len);
+        return true;
+    }
+    
+    void vector(const float* v) {
+        if (cbor_) {
+            cbor_head(6, CBOR_TAG_F32LE);
+            cbor_head(2, LUA_VECTOR_SIZE * 4);
+            for (int i = 0; i < LUA_VECTOR_SIZE; i++) {
+                uint32_t bits;
+                memcpy(&bits, &v[i], 4);
+                for (int b = 0; b < 4; b++) put((uint8_t)(bits >> (b * 8)));
+            }
+            return;
+        }
+        put(0xC7);
+        put(LUA_VECTOR_SIZE * 4);
+        put(MSGPACK_EXT_VECTOR);
+        for (int i = 0; i < LUA_VECTOR_SIZE; i++) {
+            uint32_t bits;
+            memcpy(&bits, &v[i], 4);
+            be(bits, 4);
+        }
+    }
+    
+    bool value(int idx, int depth) {
+        switch (lua_type(L_, idx)) {
+            case LUA_TNIL:
+                nil();
+                return true;
+            case LUA_TBOOLEAN:
+                if (cbor_) put(lua_toboolean(L_, idx) ? 0xF5 : 0xF4);
+                else put(lua_toboolean(L_, idx) ? 0xC3 : 0xC2);
+                return true;
+            case LUA_TNUMBER:
+                number(lua_tonumber(L_, idx));
+                return true;
+            case LUA_TSTRING: {
+                size_t len;
+                const char* s = lua_tolstring(L_, idx, &len);
+                return string(s, len, is_utf8((const unsigned char*)s, len));
+            }
+            case LUA_TVECTOR:
+                vector(lua_tovector(L_, idx));
+                return true;
+            case LUA_TTABLE:
+                return table(idx, depth);
+            case LUA_TUSERDATA: {
+                // Buffers always pack as binary
+                size_t len;
+                const char* s = xoron_tobytes(L_, idx, &len);
+                if (s) return string(s, len, false);
+                break;
+            }
+            case LUA_TLIGHTUSERDATA:
+                // json.null
+                if (lua_touserdata(L_, idx) == nullptr) {
+                    nil();
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+        error = std::string("Cannot pack ") + luaL_typename(L_, idx);
+        return false;
+    }
+    
+    bool key(int idx) {
+        int type = lua_type(L_, idx);
+        if (type == LUA_TSTRING && dict_) {
+            size_t len;
+            const char* s = lua_tolstring(L_, idx, &len);
+            auto it = dict_->index.find(std::string_view(s, len));
+            if (it != dict_->index.end()) {
+                if (cbor_) {
+                    cbor_head(6, CBOR_TAG_KEY);
+                    cbor_head(0, it->second);
+                } else if (it->second <= 0xFF) {
+                    put(0xD4);
+                    put(MSGPACK_EXT_KEY);
+                    be(it->second, 1);
+                } else {
+                    put(0xD5);
+                    put(MSGPACK_EXT_KEY);
+                    be(it->second, 2);
+                }
+                return true;
+            }
+        }
+        if (type == LUA_TSTRING || type == LUA_TNUMBER || type == LUA_TBOOLEAN) {
+            // Works on the key in place; nothing here converts it, so lua_next stays valid
+            return value(idx, 0);
+        }
+        error = std::string("Cannot pack ") + luaL_typename(L_, idx) + " key";
+        return false;
+    }
+    
+    bool table(int idx, int depth) {
+        if (depth >= SERIALIZE_MAX_DEPTH) {
+            error = "Nesting too deep";
+            return false;
+        }
+        const void* self = lua_topointer(L_, idx);
+        for (const void* p : path_) {
+            if (p == self) {
+                error = "Cannot pack cyclic table";
+                return false;
+            }
+        }
+        if (!lua_checkstack(L_, 3)) {
+            error = "Stack overflow";
+            return false;
+        }
+        
+        // An array is a table whose keys all lie in 1..#t (holes pack as nil)
+        int n = lua_objlen(L_, idx);
+        bool array = true;
+        uint64_t count = 0;
+        lua_pushnil(L_);
+        while (lua_next(L_, idx)) {
+            lua_pop(L_, 1);
+            count++;
+            if (array) {
+                double k = lua_type(L_, -1) == LUA_TNUMBER ? lua_tonumber(L_, -1) : 0.0;
+                array = k >= 1 && k <= n && k == std::floor(k);
+            }
+        }
+        
+        path_.push_back(self);
+        bool ok = true;
+        if (array) {
+            if (cbor_) cbor_head(4, (uint64_t)n);
+            else msgpack_head(0x90, 15, 0, 0xDC, 0xDD, (uint64_t)n);
+            for (int i = 1; ok && i <= n; i++) {
+                lua_rawgeti(L_, idx, i);
+                ok = value(lua_gettop(L_), depth + 1);
+                lua_pop(L_, 1);
+            }
+        } else {
+            if (cbor_) cbor_head(5, count);
+            else msgpack_head(0x80, 15, 0, 0xDE, 0xDF, count);
+            lua_pushnil(L_);
+            while (lua_next(L_, idx)) {
+                int top = lua_gettop(L_);
+                ok = key(top - 1) && value(top, depth + 1);
+                lua_pop(L_, 1);
+                if (!ok) {
+                    lua_pop(L_, 1);
+                    break;
+                }
+            }
+        }
+        path_.pop_back();
+        return ok;
+    }
+    
+    lua_State* L_;
+    bool cbor_;
+    const KeyDictionary* dict_;
+    std::vector<const void*> path_;     // tables being packed, for cycle detection
+};
+
+// ==================== Unpacker ====================
+
+static double half_to_double(uint16_t h) {
+    int exp = (h >> 10) & 0x1F;
+    int mant = h & 0x3FF;
+    double v;
+    if (exp == 0) v = std::ldexp(mant, -24);
+    else if (exp != 31) v = std::ldexp(mant + 1024, exp - 25);
+    else v = mant == 0 ? INFINITY : NAN;
+    return (h & 0x8000) ? -v : v;
+}
+
+class Unpacker {
+public:
+    Unpacker(lua_State* L, const char* data, size_t len, const SerializeOptions& opts)
+        : L_(L), begin_((const uint8_t*)data), p_((const uint8_t*)data), end_((const uint8_t*)data + len),
+          cbor_(opts.format == SerializeFormat::Cbor), dict_(opts.dict) {}
+    
+    // Pushes exactly one value, or nothing on failure
+    bool unpack() {
+        int base = lua_gettop(L_);
+        bool ok = lua_checkstack(L_, 4) ? value(0) : fail("Stack overflow");
+        if (ok && p_ != end_) ok = fail("Unexpected trailing bytes");
+        if (!ok) lua_settop(L_, base);
+        return ok;
+    }
+    
+    std::string error;
+
+private:
+    bool fail(const char* msg) {
+        error = std::string(msg) + " at byte " + std::to_string(p_ - begin_);
+        return false;
+    }
+    
+    bool need(uint64_t n) {
+        if ((uint64_t)(end_ - p_) < n) return fail("Truncated data");
+        return true;
+    }
+    
+    uint64_t be(int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; i++) v = (v << 8) | *p_++;
+        return v;
+    }
+    
+    bool read_be(int bytes, uint64_t& v) {
+        if (!need(bytes)) return false;
+        v = be(bytes);
+        return true;
+    }
+    
+    bool str(uint64_t len) {
+        if (!need(len)) return false;
+        lua_pushlstring(L_, (const char*)p_, (size_t)len);
+        p_ += len;
+        return true;
+    }
+    
+    bool dict_key(uint64_t index) {
+        if (!dict_) return fail("Dictionary key without a dictionary");
+        if (index >= dict_->keys.size()) return fail("Dictionary index out of range");
+        const std::string& k = dict_->keys[(size_t)index];
+        lua_pushlstring(L_, k.data(), k.size());
+        return true;
+    }
+    
+    bool vector(uint64_t len, bool little_endian) {
+        if (len != LUA_VECTOR_SIZE * 4) return fail("Invalid vector size");
+        if (!need(len)) return false;
+        float v[4] = {0, 0, 0, 0};
+        for (int i = 0; i < LUA_VECTOR_SIZE; i++) {
+            uint32_t bits = 0;
+            for (int b = 0; b < 4; b++) {
+                if (little_endian) bits |= (uint32_t)p_[b] << (b * 8);
+                else bits = (bits << 8) | p_[b];
+            }
+            memcpy(&v[i], &bits, 4);
+            p_ += 4;
+        }
+#if LUA_VECTOR_SIZE == 4
+        lua_pushvector(L_, v[0], v[1], v[2], v[3]);
+#else
+        lua_pushvector(L_, v[0], v[1], v[2]);
+#endif
+        return true;
+    }
+    
+    bool f32(uint32_t bits) {
+        float f;
+        memcpy(&f, &bits, 4);
+        lua_pushnumber(L_, f);
+        return true;
+    }
+    
+    bool f64(uint64_t bits) {
+        double d;
+        memcpy(&d, &bits, 8);
+        lua_pushnumber(L_, d);
+        return true;
+    }
+    
+    bool array(uint64_t n, int depth) {
+        if (depth >= SERIALIZE_MAX_DEPTH) return fail("Nesting too deep");
+        if (!lua_checkstack(L_, 3)) return fail("Stack overflow");
+        // Every element takes at least one byte; don't trust the header beyond that
+        if (n > (uint64_t)(end_ - p_)) return fail("Truncated data");
+        lua_createtable(L_, (int)n, 0);
+        for (uint64_t i = 1; i <= n; i++) {
+            if (!value(depth + 1)) return false;
+            lua_rawseti(L_, -2, (int)i);
+        }
+        return true;
+    }
+    
+    bool map(uint64_t n, int depth) {
+        if (depth >= SERIALIZE_MAX_DEPTH) return fail("Nesting too deep");
+        if (!lua_checkstack(L_, 4)) return fail("Stack overflow");
+        if (n > (uint64_t)(end_ - p_) / 2) return fail("Truncated data");
+        lua_createtable(L_, 0, (int)n);
+        for (uint64_t i = 0; i < n; i++) {
+            if (!value(depth + 1)) return false;
+            if (lua_isnil(L_, -1) || (lua_isnumber(L_, -1) && std::isnan(lua_tonumber(L_, -1)))) {
+                return fail("Invalid map key");
+            }
+            if (!value(depth + 1)) return false;
+            lua_rawset(L_, -3);
+        }
+        return true;
+    }
+    
+    bool value(int depth) {
+        if (!need(1)) return false;
+        return cbor_ ? cbor_value(depth) : msgpack_value(depth);
+    }
+    
+    bool msgpack_value(int depth) {
+        uint8_t b = *p_++;
+        uint64_t v;
+        if (b <= 0x7F) { lua_pushnumber(L_, b); return true; }
+        if (b >= 0xE0) { lua_pushnumber(L_, (int8_t)b); return true; }
+        if ((b & 0xF0) == 0x80) return map(b & 0x0F, depth);
+        if ((b & 0xF0) == 0x90) return array(b & 0x0F, depth);
+        if ((b & 0xE0) == 0xA0) return str(b & 0x1F);
+        switch (b) {
+            case 0xC0: lua_pushnil(L_); return true;
+            case 0xC2: lua_pushboolean(L_, 0); return true;
+            case 0xC3: lua_pushboolean(L_, 1); return true;
+            case 0xC4: case 0xD9: return read_be(1, v) && str(v);
+            case 0xC5: case 0xDA: return read_be(2, v) && str(v);
+            case 0xC6: case 0xDB: return read_be(4, v) && str(v);
+            case 0xC7: return read_be(1, v) && ext(v);
+            case 0xC8: return read_be(2, v) && ext(v);
+            case 0xC9: return read_be(4, v) && ext(v);
+            case 0xCA: return read_be(4, v) && f32((uint32_t)v);
+            case 0xCB: return read_be(8, v) && f64(v);
+            case 0xCC: return read_be(1, v) && (lua_pushnumber(L_, (double)v), true);
+            case 0xCD: return read_be(2, v) && (lua_pushnumber(L_, (double)v), true);
+            case 0xCE: return read_be(4, v) && (lua_pushnumber(L_, (double)v), true);
+            case 0xCF: return read_be(8, v) && (lua_pushnumber(L_, (double)v), true);
+            case 0xD0: return read_be(1, v) && (lua_pushnumber(L_, (int8_t)v), true);
+            case 0xD1: return read_be(2, v) && (lua_pushnumber(L_, (int16_t)v), true);
+            case 0xD2: return read_be(4, v) && (lua_pushnumber(L_, (int32_t)v), true);
+            case 0xD3: return read_be(8, v) && (lua_pushnumber(L_, (double)(int64_t)v), true);
+            case 0xD4: return ext(1);
+            case 0xD5: return ext(2);
+            case 0xD6: return ext(4);
+            case 0xD7: return ext(8);
+            case 0xD8: return ext(16);
+            case 0xDC: return read_be(2, v) && array(v, depth);
+            case 0xDD: return read_be(4, v) && array(v, depth);
+            case 0xDE: return read_be(2, v) && map(v, depth);
+            case 0xDF: return read_be(4, v) && map(v, depth);
+            default:
+                p_--;
+                return fail("Invalid type byte");
+        }
+    }
+    
+    bool ext(uint64_t len) {
+        if (!need(1 + len)) return false;
+        int8_t type = (int8_t)*p_++;
+        if (type == MSGPACK_EXT_KEY && (len == 1 || len == 2)) return dict_key(be((int)len));
+        if (type == MSGPACK_EXT_VECTOR) return vector(len, false);
+        p_--;
+        return fail("Unsupported extension type");
+    }
+    
+    bool cbor_value(int depth) {
+        uint8_t b = *p_++;
+        int major = b >> 5;
+        int info = b & 0x1F;
+        uint64_t arg = (uint64_t)info;
+        if (info >= 24 && info <= 27) {
+            if (!read_be(1 << (info - 24), arg)) return false;
+        } else if (info == 31) {
+            p_--;
+            return fail("Indefinite-length items are not supported");
+        } else if (info > 27) {
+            p_--;
+            return fail("Invalid type byte");
+        }
+        
+        switch (major) {
+            case 0: lua_pushnumber(L_, (double)arg); return true;
+            case 1: lua_pushnumber(L_, -1.0 - (double)arg); return true;
+            case 2: case 3: return str(arg);
+            case 4: return array(arg, depth);
+            case 5: return map(arg, depth);
+            case 6:
+                if (arg == CBOR_TAG_KEY) {
+                    uint64_t index;
+                    if (!need(1)) return false;
+                    uint8_t h = *p_++;
+                    if ((h >> 5) != 0) return fail("Invalid dictionary key");
+                    index = h & 0x1F;
+                    if (index >= 24 && index <= 27) {
+                        if (!read_be(1 << (index - 24), index)) return false;
+                    } else if (index > 27) {
+                        return fail("Invalid dictionary key");
+                    }
+                    return dict_key(index);
+                }
+                if (arg == CBOR_TAG_F32LE) {
+                    if (!need(1)) return false;
+                    uint8_t h = *p_++;
+                    uint64_t len = h & 0x1F;
+                    if ((h >> 5) != 2 || len > 23) return fail("Invalid vector");
+                    return vector(len, true);
+                }
+                // Other tags only annotate the item that follows
+                if (depth >= SERIALIZE_MAX_DEPTH) return fail("Nesting too deep");
+                return value(depth + 1);
+            default:
+                switch (info) {
+                    case 20: lua_pushboolean(L_, 0); return true;
+                    case 21: lua_pushboolean(L_, 1); return true;
+                    case 22: case 23: lua_pushnil(L_); return true;
+                    case 25: lua_pushnumber(L_, half_to_double((uint16_t)arg)); return true;
+                    case 26: return f32((uint32_t)arg);
+                    case 27: return f64(arg);
+                    default:
+                        p_--;
+                        return fail("Unsupported simple value");
+                }
+        }
+    }
+    
+    lua_State* L_;
+    const uint8_t* begin_;
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool cbor_;
+    const KeyDictionary* dict_;
+};
+
+// ==================== Lua bindings ====================
+
+static void dictionary_dtor(void* ud) {
+    delete *(KeyDictionary**)ud;
+}
+
+// Reads the optional options table: { format = "msgpack" | "cbor", dictionary = d, compress = bool }
+static SerializeOptions check_options(lua_State* L, int idx) {
+    SerializeOptions opts;
+    if (lua_isnoneornil(L, idx)) return opts;
+    luaL_checktype(L, idx, LUA_TTABLE);
+    
+    lua_getfield(L, idx, "format");
+    const char* format = luaL_optstring(L, -1, "msgpack");
+    if (strcmp(format, "cbor") == 0) opts.format = SerializeFormat::Cbor;
+    else if (strcmp(format, "msgpack") != 0) luaL_error(L, "Unknown format '%s'", format);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "dictionary");
+    if (!lua_isnil(L, -1)) {
+        // The options table keeps the dictionary alive for the call
+        opts.dict = *(KeyDictionary**)luaL_checkudata(L, -1, SERIALIZE_DICT_MT);
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "compress");
+    opts.compress = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return opts;
+}
+
+// serialize.pack(value, options) - Packs a value as MessagePack (or CBOR), optionally LZ4-compressed; Buffers pack as binary
+static int lua_serialize_pack(lua_State* L) {
+    luaL_checkany(L, 1);
+    SerializeOptions opts = check_options(L, 2);
+    Packer packer(L, opts);
+    if (!packer.pack(1)) {
+        lua_pushnil(L);
+        lua_pushstring(L, packer.error.c_str());
+        return 2;
+    }
+    xoron_metric_inc(g_m_ser_packs, 1);
+    xoron_metric_inc(g_m_ser_pack_bytes, packer.out.size());
+    
+    if (opts.compress) {
+        size_t len = 0;
+        char* compressed = xoron_lz4_compress(packer.out.data(), packer.out.size(), &len);
+        if (!compressed) {
+            lua_pushnil(L);
+            lua_pushstring(L, xoron_last_error());
+            return 2;
+        }
+        lua_pushlstring(L, compressed, len);
+        free(compressed);
+        return 1;
+    }
+    lua_pushlstring(L, packer.out.data(), packer.out.size());
+    return 1;
+}
+
+// serialize.unpack(data, options) - Unpacks a string or Buffer written by serialize.pack with the same options
+static int lua_serialize_unpack(lua_State* L) {
+    size_t len;
+    const char* data = xoron_checkbytes(L, 1, &len);
+    SerializeOptions opts = check_options(L, 2);
+    
+    char* decompressed = nullptr;
+    if (opts.compress) {
+        decompressed = xoron_lz4_decompress(data, len, 0, &len);
+        if (!decompressed) {
+            lua_pushnil(L);
+            lua_pushstring(L, xoron_last_error());
+            return 2;
+        }
+        data = decompressed;
+    }
+    
+    Unpacker unpacker(L, data, len, opts);
+    bool ok = unpacker.unpack();
+    free(decompressed);
+    if (!ok) {
+        lua_pushnil(L);
+        lua_pushstring(L, unpacker.error.c_str());
+        return 2;
+    }
+    xoron_metric_inc(g_m_ser_unpacks, 1);
+    xoron_metric_inc(g_m_ser_unpack_bytes, len);
+    return 1;
+}
+
+// serialize.dictionary(keys) - Builds a shared key dictionary from an array of strings
+static int lua_serialize_dictionary(lua_State* L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int n = lua_objlen(L, 1);
+    if (n > SERIALIZE_MAX_KEYS) {
+        luaL_error(L, "Dictionary holds at most %d keys", SERIALIZE_MAX_KEYS);
+        return 0;
+    }
+    
+    KeyDictionary* dict = new KeyDictionary();
+    KeyDictionary** ud = (KeyDictionary**)lua_newuserdatadtor(L, sizeof(KeyDictionary*), dictionary_dtor);
+    *ud = dict;
+    luaL_getmetatable(L, SERIALIZE_DICT_MT);
+    lua_setmetatable(L, -2);
+    
+    dict->keys.reserve(n);
+    for (int i = 1; i <= n; i++) {
+        lua_rawgeti(L, 1, i);
+        if (lua_type(L, -1) != LUA_TSTRING) {
+            luaL_error(L, "Dictionary key %d is not a string", i);
+            return 0;
+        }
+        size_t len;
+        const char* key = lua_tolstring(L, -1, &len);
+        dict->keys.emplace_back(key, len);
+        lua_pop(L, 1);
+    }
+    // keys no longer moves, so the index can hold views into it
+    for (size_t i = 0; i < dict->keys.size(); i++) {
+        if (!dict->index.emplace(dict->keys[i], (uint16_t)i).second) {
+            luaL_error(L, "Duplicate dictionary key '%s'", dict->keys[i].c_str());
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void xoron_register_serialize(lua_State* L) {
+    luaL_newmetatable(L, SERIALIZE_DICT_MT);
+    lua_pushstring(L, "KeyDictionary");
+    lua_setfield(L, -2, "__type");
+    lua_pop(L, 1);
+    
+    lua_newtable(L);
+    
+    lua_pushcfunction(L, lua_serialize_pack, "pack");
+    lua_setfield(L, -2, "pack");
+    
+    lua_pushcfunction(L, lua_serialize_unpack, "unpack");
+    lua_setfield(L, -2, "unpack");
+    
+    lua_pushcfunction(L, lua_serialize_dictionary, "dictionary");
+    lua_setfield(L, -2, "dictionary");
+    
+    lua_setglobal(L, "serialize");
+}
+
+// ==================== Native API ====================
+
+char* xoron_serialize_pack(lua_State* L, int idx, size_t* len) {
+    if (!L) {
+        xoron_set_error("Invalid arguments");
+        return nullptr;
+    }
+    Packer packer(L, SerializeOptions());
+    if (!packer.pack(idx)) {
+        xoron_set_error("Serialize: %s", packer.error.c_str());
+        return nullptr;
+    }
+    char* out = (char*)malloc(packer.out.size() + 1);
+    if (!out) {
+        xoron_set_error("Out of memory");
+        return nullptr;
+    }
+    memcpy(out, packer.out.data(), packer.out.size());
+    out[packer.out.size()] = '\0';
+    if (len) *len = packer.out.size();
+    xoron_metric_inc(g_m_ser_packs, 1);
+    xoron_metric_inc(g_m_ser_pack_bytes, packer.out.size());
+    return out;
+}
+
+int xoron_serialize_unpack(lua_State* L, const char* data, size_t len) {
+    if (!L || (!data && len)) {
+        xoron_set_error("Invalid arguments");
+        return XORON_ERR_INVALID;
+    }
+    Unpacker unpacker(L, data, len, SerializeOptions());
+    if (!unpacker.unpack()) {
+        xoron_set_error("Serialize: %s", unpacker.error.c_str());
+        return XORON_ERR_INVALID;
+    }
+    xoron_metric_inc(g_m_ser_unpacks, 1);
+    xoron_metric_inc(g_m_ser_unpack_bytes, len);
+    return XORON_OK;
+}
@@ -434,15 +434,16 @@ static int lua_handle_touch(lua_State* L) {
 #ifdef XORON_UI_IOS
                 xoron_ios_haptic_feedback(1); // Medium haptic on execute
 #endif
-                // Execute the script
-                lua_getglobal(L, "xoron_execute");
-                if (lua_isfunction(L, -1)) {
-                    lua_pushstring(L, g_uiState.editorContent.c_str());
-                    lua_call(L, 1, 0);
+                // Queue the script; it runs at the VM's next safe point, not inside this handler
+                xoron_message_t msg = {};
+                msg.type = XORON_MSG_SCRIPT;
+                msg.data = g_uiState.editorContent.c_str();
+                msg.data_len = g_uiState.editorContent.size();
+                if (xoron_channel_send(xoron_channel_of(L), &msg) == XORON_OK) {
+                    g_uiState.addConsoleMessage("Script queued", ConsoleMessageType::Success);
                 } else {
-                    lua_pop(L, 1);
+                    g_uiState.addConsoleMessage(std::string("Error: ") + xoron_last_error(), ConsoleMessageType::Error);
                 }
-                g_uiState.addConsoleMessage("Script executed", ConsoleMessageType::Success);
                 lua_pushboolean(L, true);
                 return 1;
             }
@@ -521,6 +522,15 @@ static int lua_handle_touch_move(lua_State* L) {
     return 1;
 }
 
+// Channel handler for XORON_MSG_TOUCH posted by platform input threads
+static void channel_touch(lua_State* L, const xoron_message_t* msg) {
+    lua_pushcfunction(L, msg->arg == 1 ? lua_handle_touch_move : lua_handle_touch, "touch");
+    lua_pushnumber(L, msg->x);
+    lua_pushnumber(L, msg->y);
+    lua_pushboolean(L, msg->arg == 0);
+    if (lua_pcall(L, 3, 0, 0) != 0) lua_pop(L, 1);
+}
+
 // Lua function to set editor content
 static int lua_set_editor_content(lua_State* L) {
     const char* content = luaL_checkstring(L, 1);
@@ -672,6 +682,11 @@ static int lua_clear_console(lua_State* L) {
 
 } // namespace XoronUI
 
+// Touches reach the VM whether or not a script has used the UI library yet
+void xoron_init_ui(void) {
+    xoron_channel_handle("touch", XoronUI::channel_touch);
+}
+
 // Register UI functions
 void xoron_register_ui(lua_State* L) {
     // Create XoronUI table
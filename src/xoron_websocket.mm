@@ -11,12 +11,10 @@
 #include <cstdio>
 #include <string>
 #include <vector>
-#include <queue>
 #include <unordered_map>
 #include <mutex>
 #include <thread>
 #include <atomic>
-#include <condition_variable>
 #include <functional>
 #include <random>
 
@@ -74,9 +72,10 @@ struct WebSocketConnection {
     std::atomic<bool> running;
     
     std::mutex send_mutex;
-    std::queue<std::string> recv_queue;
-    std::mutex recv_mutex;
-    std::condition_variable recv_cv;
+    
+    // Frames reach Lua as channel messages, handled on the VM thread
+    XoronChannel* channel;
+    bool binary_buffers;    // hand binary frames to OnMessage as Buffers
     
     // Lua callbacks
     lua_State* L;
@@ -86,11 +85,12 @@ struct WebSocketConnection {
     
     WebSocketConnection() : id(0), port(80), secure(false), socket_fd(-1),
                             ssl(nullptr), ssl_ctx(nullptr), state(WS_CLOSED),
-                            running(false), L(nullptr), on_message_ref(LUA_NOREF),
+                            running(false), channel(nullptr), binary_buffers(false), L(nullptr), on_message_ref(LUA_NOREF),
                             on_close_ref(LUA_NOREF), on_error_ref(LUA_NOREF) {}
     
     ~WebSocketConnection() {
         close_connection();
+        xoron_channel_release(channel);
     }
     
     void close_connection() {
@@ -139,6 +139,15 @@ static std::atomic<uint32_t> g_next_ws_id{1};
 
 static const char* WEBSOCKET_MT = "XoronWebSocket";
 
+// Metrics
+static const int g_m_ws_connections = xoron_metric_counter("ws.connections");
+static const int g_m_ws_connect_errors = xoron_metric_counter("ws.connect_errors");
+static const int g_m_ws_open = xoron_metric_gauge("ws.open");
+static const int g_m_ws_messages_sent = xoron_metric_counter("ws.messages_sent");
+static const int g_m_ws_messages_received = xoron_metric_counter("ws.messages_received");
+static const int g_m_ws_bytes_sent = xoron_metric_counter("ws.bytes_sent");
+static const int g_m_ws_bytes_received = xoron_metric_counter("ws.bytes_received");
+
 // Base64 encoding for WebSocket key
 static std::string base64_encode(const unsigned char* data, size_t len) {
     static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -407,6 +416,16 @@ static bool ws_recv_frame(WebSocketConnection* conn, std::string& data, WSOpcode
     return true;
 }
 
+static void ws_post(WebSocketConnection* conn, const char* topic, const std::string& data) {
+    xoron_message_t msg = {};
+    msg.type = XORON_MSG_NETWORK;
+    msg.topic = topic;
+    msg.arg = conn->id;
+    msg.data = data.data();
+    msg.data_len = data.size();
+    xoron_channel_send(conn->channel, &msg);
+}
+
 // Receive thread
 static void ws_recv_thread(WebSocketConnection* conn) {
     while (conn->running && conn->state == WS_OPEN) {
@@ -420,9 +439,9 @@ static void ws_recv_thread(WebSocketConnection* conn) {
         switch (opcode) {
             case WS_TEXT:
             case WS_BINARY: {
-                std::lock_guard<std::mutex> lock(conn->recv_mutex);
-                conn->recv_queue.push(data);
-                conn->recv_cv.notify_one();
+                xoron_metric_inc(g_m_ws_messages_received, 1);
+                xoron_metric_inc(g_m_ws_bytes_received, data.size());
+                ws_post(conn, opcode == WS_BINARY ? "websocket.binary" : "websocket", data);
                 break;
             }
             case WS_CLOSE:
@@ -437,6 +456,37 @@ static void ws_recv_thread(WebSocketConnection* conn) {
     }
     
     conn->state = WS_CLOSED;
+    xoron_metric_adjust(g_m_ws_open, -1);
+    ws_post(conn, "websocket.close", std::string());
+}
+
+// Channel handler for "websocket", "websocket.binary" and "websocket.close"; runs on the VM thread
+static void ws_dispatch(lua_State* L, const xoron_message_t* msg) {
+    bool closed = strcmp(msg->topic, "websocket.close") == 0;
+    bool as_buffer = false;
+    int ref = LUA_NOREF;
+    {
+        std::lock_guard<std::mutex> lock(g_ws_mutex);
+        auto it = g_connections.find((uint32_t)msg->arg);
+        if (it == g_connections.end() || it->second->channel != xoron_channel_of(L)) return;
+        ref = closed ? it->second->on_close_ref : it->second->on_message_ref;
+        as_buffer = it->second->binary_buffers && strcmp(msg->topic, "websocket.binary") == 0;
+    }
+    if (ref == LUA_NOREF) return;
+    
+    lua_getref(L, ref);
+    int nargs = 0;
+    if (as_buffer) {
+        memcpy(xoron_pushbuffer(L, msg->data_len), msg->data, msg->data_len);
+        nargs = 1;
+    } else if (!closed) {
+        lua_pushlstring(L, msg->data, msg->data_len);
+        nargs = 1;
+    }
+    if (lua_pcall(L, nargs, 0, 0) != 0) {
+        xoron_set_error("WebSocket callback error: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
 }
 
 // Get WebSocket from userdata
@@ -449,18 +499,23 @@ static WebSocketConnection* get_websocket(lua_State* L, int idx) {
     return *ud;
 }
 
-// WebSocket:Send(data)
+// WebSocket:Send(data) - Strings go out as text frames, Buffers as binary frames
 static int ws_send(lua_State* L) {
     WebSocketConnection* conn = get_websocket(L, 1);
     size_t len;
-    const char* data = luaL_checklstring(L, 2, &len);
+    const char* data = xoron_checkbytes(L, 2, &len);
+    WSOpcode opcode = xoron_isbuffer(L, 2) ? WS_BINARY : WS_TEXT;
     
     if (conn->state != WS_OPEN) {
         lua_pushboolean(L, false);
         return 1;
     }
     
-    bool success = ws_send_frame(conn, WS_TEXT, data, len);
+    bool success = ws_send_frame(conn, opcode, data, len);
+    if (success) {
+        xoron_metric_inc(g_m_ws_messages_sent, 1);
+        xoron_metric_inc(g_m_ws_bytes_sent, len);
+    }
     lua_pushboolean(L, success);
     return 1;
 }
@@ -512,27 +567,18 @@ static int ws_on_close(lua_State* L) {
     return 0;
 }
 
-// WebSocket __index
-static int ws_index(lua_State* L) {
-    WebSocketConnection* conn = get_websocket(L, 1);
-    const char* key = luaL_checkstring(L, 2);
-    
-    if (strcmp(key, "Send") == 0) {
-        lua_pushcfunction(L, ws_send, "Send");
-    } else if (strcmp(key, "Close") == 0) {
-        lua_pushcfunction(L, ws_close, "Close");
-    } else if (strcmp(key, "OnMessage") == 0) {
-        lua_pushvalue(L, 1);
-        lua_pushcclosure(L, ws_on_message, "OnMessage", 1);
-    } else if (strcmp(key, "OnClose") == 0) {
-        lua_pushvalue(L, 1);
-        lua_pushcclosure(L, ws_on_close, "OnClose", 1);
-    } else {
-        lua_pushnil(L);
-    }
-    
-    (void)conn;
-    return 1;
+// WebSocket __namecall - ws:Method(...) dispatched on the method name's atom
+static int ws_namecall(lua_State* L) {
+    int atom = -1;
+    const char* name = lua_namecallatom(L, &atom);
+    switch (atom) {
+    case XORON_ATOM_Send: return ws_send(L);
+    case XORON_ATOM_Close: return ws_close(L);
+    case XORON_ATOM_OnMessage: return ws_on_message(L);
+    case XORON_ATOM_OnClose: return ws_on_close(L);
+    }
+    luaL_error(L, "%s is not a valid member of WebSocket", name ? name : "?");
+    return 0;
 }
 
 // WebSocket __gc
@@ -547,13 +593,21 @@ static int ws_gc(lua_State* L) {
     return 0;
 }
 
-// WebSocket.connect(url)
+// WebSocket.connect(url, options) - options.BinaryType = "buffer" delivers binary frames as Buffers
 static int lua_websocket_connect(lua_State* L) {
     const char* url = luaL_checkstring(L, 1);
+    bool binary_buffers = false;
+    if (lua_istable(L, 2)) {
+        lua_getfield(L, 2, "BinaryType");
+        const char* type = lua_tostring(L, -1);
+        binary_buffers = type && strcmp(type, "buffer") == 0;
+        lua_pop(L, 1);
+    }
     
     WebSocketConnection* conn = new WebSocketConnection();
     conn->id = g_next_ws_id++;
     conn->url = url;
+    conn->binary_buffers = binary_buffers;
     
     if (!parse_ws_url(url, conn->host, conn->path, conn->port, conn->secure)) {
         delete conn;
@@ -563,6 +617,7 @@ static int lua_websocket_connect(lua_State* L) {
     }
     
     if (!ws_connect(conn)) {
+        xoron_metric_inc(g_m_ws_connect_errors, 1);
         delete conn;
         lua_pushnil(L);
         lua_pushstring(L, "Connection failed");
@@ -570,6 +625,7 @@ static int lua_websocket_connect(lua_State* L) {
     }
     
     if (!ws_handshake(conn)) {
+        xoron_metric_inc(g_m_ws_connect_errors, 1);
         conn->close_connection();
         delete conn;
         lua_pushnil(L);
@@ -577,8 +633,12 @@ static int lua_websocket_connect(lua_State* L) {
         return 2;
     }
     
+    conn->channel = xoron_channel_of(L);
+    xoron_channel_retain(conn->channel);
     conn->state = WS_OPEN;
     conn->running = true;
+    xoron_metric_inc(g_m_ws_connections, 1);
+    xoron_metric_adjust(g_m_ws_open, 1);
     conn->recv_thread = std::thread(ws_recv_thread, conn);
     
     {
@@ -596,14 +656,37 @@ static int lua_websocket_connect(lua_State* L) {
     return 1;
 }
 
+void xoron_init_websocket(void) {
+    xoron_channel_handle("websocket", ws_dispatch);
+    xoron_channel_handle("websocket.binary", ws_dispatch);
+    xoron_channel_handle("websocket.close", ws_dispatch);
+}
+
 // Register WebSocket library
 void xoron_register_websocket(lua_State* L) {
-    // Create metatable
+    static const struct {
+        const char* name;
+        lua_CFunction fn;
+    } methods[] = {
+        {"Send", ws_send},
+        {"Close", ws_close},
+        {"OnMessage", ws_on_message},
+        {"OnClose", ws_on_close},
+    };
+    
+    // Create metatable; ws.Send reads the shared methods table, ws:Send() goes through __namecall
     luaL_newmetatable(L, WEBSOCKET_MT);
     
-    lua_pushcfunction(L, ws_index, "__index");
+    lua_createtable(L, 0, (int)(sizeof(methods) / sizeof(methods[0])));
+    for (const auto& m : methods) {
+        lua_pushcfunction(L, m.fn, m.name);
+        lua_setfield(L, -2, m.name);
+    }
     lua_setfield(L, -2, "__index");
     
+    lua_pushcfunction(L, ws_namecall, "__namecall");
+    lua_setfield(L, -2, "__namecall");
+
     lua_pushcfunction(L, ws_gc, "__gc");
     lua_setfield(L, -2, "__gc");
     